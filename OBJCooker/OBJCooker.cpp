@@ -0,0 +1,311 @@
+#include <dojo.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <tuple>
+
+using namespace Dojo;
+
+//converts Wavefront .obj files to .mesh v2 files, see MeshFile
+//each group or object of the .obj becomes a sub-mesh, and each additional .obj is the next LOD of the same sub-meshes
+
+static void _printUsage()
+{
+	printf(
+		"usage: objcooker [options] model.obj [model_lod1.obj ...]\n"
+		"  --out=PATH      where to write the .mesh file (default: the first .obj with the .mesh extension)\n"
+		"  --compress      store positions, normals and UVs in the compressed formats of Mesh::compress()\n"
+		"  --no-optimize   keep the vertices and indices in the order of the .obj\n"
+		"the .obj can have vertex colors as \"vc r g b [a]\" lines, referenced by a fourth index in the faces (v/vt/vn/vc)\n" );
+}
+
+static bool _readOption( const std::string& arg, const char* name, std::string& value )
+{
+	std::string prefix = std::string( "--" ) + name + "=";
+
+	if( arg.compare( 0, prefix.size(), prefix ) != 0 )
+		return false;
+
+	value = arg.substr( prefix.size() );
+	return true;
+}
+
+//the position, uv, normal and color of a face corner, -1 when missing
+typedef std::tuple< int, int, int, int > Corner;
+
+struct SubMesh
+{
+	String name;
+	std::map< Corner, int > cornerIndex;
+	std::vector< Corner > corners;
+	std::vector< int > indices;
+};
+
+struct OBJ
+{
+	std::vector< Vector > positions, normals, uvs;
+	std::vector< Color > colors;
+
+	std::vector< SubMesh > subMeshes;
+};
+
+//returns the 0-based index of an .obj index, which is 1-based or negative to count from the last element
+static int _resolveIndex( const std::string& token, size_t count )
+{
+	if( token.empty() )
+		return -1;
+
+	int idx = atoi( token.c_str() );
+	idx = ( idx < 0 ) ? (int)count + idx : idx - 1;
+
+	return ( idx >= 0 && idx < (int)count ) ? idx : -2;
+}
+
+static bool _parseCorner( const OBJ& obj, const std::string& token, Corner& out )
+{
+	std::string parts[ 4 ];
+	std::stringstream stream( token );
+
+	for( int i = 0; i < 4 && std::getline( stream, parts[ i ], '/' ); ++i );
+
+	out = std::make_tuple(
+		_resolveIndex( parts[ 0 ], obj.positions.size() ),
+		_resolveIndex( parts[ 1 ], obj.uvs.size() ),
+		_resolveIndex( parts[ 2 ], obj.normals.size() ),
+		_resolveIndex( parts[ 3 ], obj.colors.size() ) );
+
+	return std::get< 0 >( out ) >= 0 && std::get< 1 >( out ) >= -1 && std::get< 2 >( out ) >= -1 && std::get< 3 >( out ) >= -1;
+}
+
+static SubMesh& _getSubMesh( OBJ& obj, const String& name )
+{
+	for( auto& subMesh : obj.subMeshes )
+	{
+		if( subMesh.name == name )
+			return subMesh;
+	}
+
+	if( name.size() >= MeshFile::MAX_NAME_LENGTH )
+		printf( "warning: the name %s is too long and will be truncated\n", name.c_str() );
+
+	obj.subMeshes.push_back( SubMesh() );
+	obj.subMeshes.back().name = name.substr( 0, MeshFile::MAX_NAME_LENGTH - 1 );
+	return obj.subMeshes.back();
+}
+
+static bool _parse( const std::string& path, OBJ& obj )
+{
+	std::ifstream file( path );
+
+	if( !file )
+	{
+		printf( "error: cannot open %s\n", path.c_str() );
+		return false;
+	}
+
+	SubMesh* current = nullptr;
+	std::string line, type;
+	int lineNumber = 0;
+
+	while( std::getline( file, line ) )
+	{
+		++lineNumber;
+
+		std::stringstream stream( line );
+		type.clear();
+		stream >> type;
+
+		if( type == "v" || type == "vn" )
+		{
+			Vector v;
+			stream >> v.x >> v.y >> v.z;
+			( type == "v" ? obj.positions : obj.normals ).push_back( v );
+		}
+		else if( type == "vt" )
+		{
+			Vector uv;
+			stream >> uv.x >> uv.y;
+			obj.uvs.push_back( uv );
+		}
+		else if( type == "vc" )
+		{
+			Color c = Color::WHITE;
+			stream >> c.r >> c.g >> c.b;
+
+			//the alpha is optional
+			float a;
+			if( stream >> a )
+				c.a = a;
+
+			obj.colors.push_back( c );
+		}
+		else if( type == "o" || type == "g" )
+		{
+			std::string name;
+			stream >> name;
+			current = &_getSubMesh( obj, name );
+		}
+		else if( type == "f" )
+		{
+			if( !current )
+				current = &_getSubMesh( obj, String::EMPTY );
+
+			std::vector< int > polygon;
+			std::string token;
+
+			while( stream >> token )
+			{
+				Corner corner;
+				if( !_parseCorner( obj, token, corner ) )
+				{
+					printf( "error: %s:%d: invalid face index %s\n", path.c_str(), lineNumber, token.c_str() );
+					return false;
+				}
+
+				auto elem = current->cornerIndex.find( corner );
+				if( elem == current->cornerIndex.end() )
+				{
+					elem = current->cornerIndex.insert( std::make_pair( corner, (int)current->corners.size() ) ).first;
+					current->corners.push_back( corner );
+				}
+
+				polygon.push_back( elem->second );
+			}
+
+			//triangulate the polygon as a fan
+			for( size_t i = 2; i < polygon.size(); ++i )
+			{
+				current->indices.push_back( polygon[ 0 ] );
+				current->indices.push_back( polygon[ i - 1 ] );
+				current->indices.push_back( polygon[ i ] );
+			}
+		}
+	}
+
+	return true;
+}
+
+static void _build( const OBJ& obj, const SubMesh& subMesh, Mesh& mesh )
+{
+	bool hasUV = false, hasNormal = false, hasColor = false;
+
+	for( auto& corner : subMesh.corners )
+	{
+		hasUV |= std::get< 1 >( corner ) >= 0;
+		hasNormal |= std::get< 2 >( corner ) >= 0;
+		hasColor |= std::get< 3 >( corner ) >= 0;
+	}
+
+	mesh.setVertexFieldEnabled( VertexField::Position3D );
+
+	if( hasColor )
+		mesh.setVertexFieldEnabled( VertexField::Color );
+	if( hasNormal )
+		mesh.setVertexFieldEnabled( VertexField::Normal );
+	if( hasUV )
+		mesh.setVertexFieldEnabled( VertexField::UV0 );
+
+	mesh.setTriangleMode( TriangleMode::TriangleList );
+	mesh.setIndexByteSize( subMesh.corners.size() > 0xffff ? 4 : 2 );
+
+	mesh.begin( (int)subMesh.corners.size(), (int)subMesh.indices.size() );
+
+	for( auto& corner : subMesh.corners )
+	{
+		mesh.vertex( obj.positions[ std::get< 0 >( corner ) ] );
+
+		if( hasColor )
+			mesh.color( std::get< 3 >( corner ) >= 0 ? obj.colors[ std::get< 3 >( corner ) ] : Color::WHITE );
+		if( hasNormal )
+			mesh.normal( std::get< 2 >( corner ) >= 0 ? obj.normals[ std::get< 2 >( corner ) ] : Vector::ZERO );
+		if( hasUV )
+			mesh.uv( std::get< 1 >( corner ) >= 0 ? obj.uvs[ std::get< 1 >( corner ) ] : Vector::ZERO );
+	}
+
+	for( int idx : subMesh.indices )
+		mesh.index( idx );
+}
+
+int main( int argc, char** argv )
+{
+	std::vector< std::string > inputs;
+	std::string outPath, value;
+	bool compress = false, optimize = true;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = argv[ i ];
+
+		if( _readOption( arg, "out", value ) )
+			outPath = value;
+		else if( arg == "--compress" )
+			compress = true;
+		else if( arg == "--no-optimize" )
+			optimize = false;
+		else if( arg.size() && arg[ 0 ] != '-' )
+			inputs.push_back( arg );
+		else
+		{
+			_printUsage();
+			return arg == "--help" ? 0 : 2;
+		}
+	}
+
+	if( inputs.empty() )
+	{
+		_printUsage();
+		return 2;
+	}
+
+	if( outPath.empty() )
+		outPath = inputs[ 0 ].substr( 0, inputs[ 0 ].find_last_of( '.' ) ) + ".mesh";
+
+	//the meshes are only built on the CPU, but the engine code still logs
+	gp_log = new Log();
+
+	MeshFile meshFile;
+
+	for( size_t lod = 0; lod < inputs.size(); ++lod )
+	{
+		OBJ obj;
+
+		if( !_parse( inputs[ lod ], obj ) )
+			return 1;
+
+		for( auto& subMesh : obj.subMeshes )
+		{
+			if( subMesh.indices.empty() )
+				continue;
+
+			Mesh mesh;
+			_build( obj, subMesh, mesh );
+
+			if( optimize )
+				mesh.optimize();
+
+			if( compress )
+				mesh.compress();
+
+			printf( "%s lod %d: %d vertices, %d triangles\n",
+				subMesh.name.empty() ? "(default)" : subMesh.name.c_str(), (int)lod, (int)mesh.getVertexCount(), mesh.getPrimitiveCount() );
+
+			meshFile.addSection( mesh, subMesh.name, (int)lod, optimize );
+		}
+	}
+
+	auto data = meshFile.serialize();
+
+	std::ofstream out( outPath, std::ios::binary );
+	out.write( (const char*)data.data(), data.size() );
+
+	if( !out )
+	{
+		printf( "error: cannot write %s\n", outPath.c_str() );
+		return 1;
+	}
+
+	printf( "wrote %s, %d bytes\n", outPath.c_str(), (int)data.size() );
+	return 0;
+}
@@ -1,3 +0,0 @@
-#!/bin/bash
-
-java -jar OBJCooker.jar $1
\ No newline at end of file
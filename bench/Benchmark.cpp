@@ -0,0 +1,219 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+
+using namespace Dojo;
+using namespace Dojo::Bench;
+
+volatile const void* Dojo::Bench::gp_sink = nullptr;
+
+namespace
+{
+	struct RegisteredBenchmark
+	{
+		std::string name;
+		Function function;
+	};
+
+	//a function-local static doesn't depend on the initialization order of the benchmark files
+	std::vector< RegisteredBenchmark >& _getRegistry()
+	{
+		static std::vector< RegisteredBenchmark > registry;
+		return registry;
+	}
+
+	Options gOptions;
+
+	void _run( const Function& function, int64_t iterations, State& state )
+	{
+		state = State( iterations );
+		function( state );
+	}
+
+	std::string _escape( const std::string& s )
+	{
+		std::string res;
+		for( char c : s )
+		{
+			if( c == '"' || c == '\\' )
+				res += '\\';
+			res += c;
+		}
+		return res;
+	}
+}
+
+Registration::Registration( const char* name, const Function& function )
+{
+	DEBUG_ASSERT( name && function, "A benchmark needs a name and a function" );
+
+	RegisteredBenchmark e;
+	e.name = name;
+	e.function = function;
+	_getRegistry().push_back( e );
+}
+
+std::vector< Result > Dojo::Bench::runAll( const Options& options )
+{
+	gOptions = options;
+
+	std::vector< Result > results;
+	State state( 0 );
+
+	for( auto& entry : _getRegistry() )
+	{
+		if( options.filter.size() && entry.name.find( options.filter ) == std::string::npos )
+			continue;
+
+		//grow the iterations until a run lasts minTime
+		int64_t iterations = 1;
+		while( true )
+		{
+			_run( entry.function, iterations, state );
+
+			double elapsed = state.getElapsed();
+			if( elapsed >= options.minTime || iterations >= 1000000000 )
+				break;
+
+			double multiplier = elapsed > 0 ? options.minTime * 1.4 / elapsed : 10.0;
+			iterations = std::max( iterations + 1, (int64_t)( iterations * std::min( 10.0, std::max( 1.0, multiplier ) ) ) );
+		}
+
+		Result r;
+		r.name = entry.name;
+		r.iterations = iterations;
+		r.bestTime = state.getElapsed();
+		r.meanTime = state.getElapsed();
+
+		double bestItemsPerSecond = state.getItemsProcessed() / state.getElapsed();
+		double bestBytesPerSecond = state.getBytesProcessed() / state.getElapsed();
+
+		for( int i = 1; i < options.repetitions; ++i )
+		{
+			_run( entry.function, iterations, state );
+
+			r.meanTime += state.getElapsed();
+
+			if( state.getElapsed() < r.bestTime )
+			{
+				r.bestTime = state.getElapsed();
+				bestItemsPerSecond = state.getItemsProcessed() / state.getElapsed();
+				bestBytesPerSecond = state.getBytesProcessed() / state.getElapsed();
+			}
+		}
+
+		r.bestTime /= iterations;
+		r.meanTime /= iterations * std::max( 1, options.repetitions );
+		r.itemsPerSecond = bestItemsPerSecond;
+		r.bytesPerSecond = bestBytesPerSecond;
+
+		printf( "%-56s %12.1f ns %12lld it", r.name.c_str(), r.bestTime * 1e9, (long long)r.iterations );
+		if( r.itemsPerSecond > 0 )
+			printf( " %12.3f M items/s", r.itemsPerSecond * 1e-6 );
+		if( r.bytesPerSecond > 0 )
+			printf( " %10.1f MB/s", r.bytesPerSecond / ( 1024 * 1024 ) );
+		printf( "\n" );
+		fflush( stdout );
+
+		results.push_back( r );
+	}
+
+	return results;
+}
+
+bool Dojo::Bench::saveResults( const std::vector< Result >& results, const std::string& path )
+{
+	FILE* f = fopen( path.c_str(), "w" );
+
+	if( !f )
+		return false;
+
+	time_t now = time( nullptr );
+	char date[ 64 ];
+	strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%S", localtime( &now ) );
+
+	fprintf( f, "{\n\"context\": {\"date\": \"%s\", \"threads\": %d, ", date, (int)std::thread::hardware_concurrency() );
+#if defined( PUBLISH )
+	fprintf( f, "\"build\": \"publish\"" );
+#elif defined( _DEBUG )
+	fprintf( f, "\"build\": \"debug\"" );
+#else
+	fprintf( f, "\"build\": \"release\"" );
+#endif
+	fprintf( f, ", \"min_time\": %g, \"repetitions\": %d},\n\"benchmarks\": [\n", gOptions.minTime, gOptions.repetitions );
+
+	for( size_t i = 0; i < results.size(); ++i )
+	{
+		auto& r = results[ i ];
+
+		//one benchmark per line, compareResults() relies on it
+		fprintf( f, "{\"name\": \"%s\", \"iterations\": %lld, \"time_ns\": %.3f, \"mean_ns\": %.3f, \"items_per_second\": %.1f, \"bytes_per_second\": %.1f}%s\n",
+			_escape( r.name ).c_str(),
+			(long long)r.iterations,
+			r.bestTime * 1e9,
+			r.meanTime * 1e9,
+			r.itemsPerSecond,
+			r.bytesPerSecond,
+			i + 1 < results.size() ? "," : "" );
+	}
+
+	fprintf( f, "]\n}\n" );
+
+	return fclose( f ) == 0;
+}
+
+int Dojo::Bench::compareResults( const std::vector< Result >& results, const std::string& baselinePath, double tolerance )
+{
+	std::ifstream file( baselinePath );
+
+	if( !file.is_open() )
+	{
+		printf( "Cannot open the baseline %s\n", baselinePath.c_str() );
+		return 0;
+	}
+
+	//read the name and the time of each line written by saveResults
+	std::unordered_map< std::string, double > baseline;
+	std::string line;
+	const std::string nameKey = "{\"name\": \"", timeKey = "\"time_ns\": ";
+
+	while( std::getline( file, line ) )
+	{
+		if( line.compare( 0, nameKey.size(), nameKey ) != 0 )
+			continue;
+
+		std::string name;
+		size_t i = nameKey.size();
+		for( ; i < line.size() && line[ i ] != '"'; ++i )
+		{
+			if( line[ i ] == '\\' )
+				++i;
+			name += line[ i ];
+		}
+
+		size_t timePos = line.find( timeKey, i );
+		if( timePos != std::string::npos )
+			baseline[ name ] = atof( line.c_str() + timePos + timeKey.size() );
+	}
+
+	int regressions = 0;
+
+	printf( "\nCompared with %s:\n", baselinePath.c_str() );
+
+	for( auto& r : results )
+	{
+		auto elem = baseline.find( r.name );
+		if( elem == baseline.end() || elem->second <= 0 )
+			continue;
+
+		double ratio = r.bestTime * 1e9 / elem->second;
+		bool regressed = ratio > 1.0 + tolerance;
+
+		if( regressed )
+			++regressions;
+
+		printf( "%-56s %+7.1f%%%s\n", r.name.c_str(), ( ratio - 1.0 ) * 100.0, regressed ? "  REGRESSION" : "" );
+	}
+
+	return regressions;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <dojo.h>
+
+#include <chrono>
+
+namespace Dojo
+{
+	namespace Bench
+	{
+		///State is passed to a benchmark, which runs its measured loop while run() returns true
+		/**
+		the setup before the loop is not measured; pause() and resume() can exclude the per-iteration setup too.
+		*/
+		class State
+		{
+		public:
+
+			typedef std::chrono::steady_clock Clock;
+
+			State( int64_t iterations ) :
+				mIterations( iterations ),
+				mLeft( iterations ),
+				mElapsed( 0 ),
+				mItems( 0 ),
+				mBytes( 0 ),
+				mRunning( false )
+			{
+
+			}
+
+			///returns true while there are iterations left; the first call starts the clock and the last one stops it
+			bool run()
+			{
+				if( mLeft == mIterations && !mRunning )
+					resume();
+
+				if( mLeft-- > 0 )
+					return true;
+
+				pause();
+				return false;
+			}
+
+			///stops the clock, eg. to prepare the data for the next iteration
+			void pause()
+			{
+				if( mRunning )
+				{
+					mElapsed += std::chrono::duration< double >( Clock::now() - mStart ).count();
+					mRunning = false;
+				}
+			}
+
+			void resume()
+			{
+				mStart = Clock::now();
+				mRunning = true;
+			}
+
+			int64_t getIterations() const
+			{
+				return mIterations;
+			}
+
+			///returns the measured time in seconds
+			double getElapsed() const
+			{
+				return mElapsed;
+			}
+
+			///sets how many items all the iterations processed, to report the throughput
+			void setItemsProcessed( int64_t items )
+			{
+				mItems = items;
+			}
+
+			int64_t getItemsProcessed() const
+			{
+				return mItems;
+			}
+
+			///sets how many bytes all the iterations processed, to report the bandwidth
+			void setBytesProcessed( int64_t bytes )
+			{
+				mBytes = bytes;
+			}
+
+			int64_t getBytesProcessed() const
+			{
+				return mBytes;
+			}
+
+		protected:
+
+			int64_t mIterations, mLeft;
+			double mElapsed;
+			int64_t mItems, mBytes;
+
+			bool mRunning;
+			Clock::time_point mStart;
+		};
+
+		typedef std::function< void( State& ) > Function;
+
+		///registers a benchmark at static initialization time
+		/**
+		the names are "Subject/variant", eg. "Table::deserialize/2048 entries"
+		*/
+		class Registration
+		{
+		public:
+			Registration( const char* name, const Function& function );
+		};
+
+		///the result of a benchmark, times are per iteration
+		struct Result
+		{
+			std::string name;
+			int64_t iterations;
+			double bestTime, meanTime;
+			double itemsPerSecond, bytesPerSecond;
+		};
+
+		struct Options
+		{
+			///the benchmarks that don't contain this are skipped
+			std::string filter;
+
+			///each benchmark runs for at least this many seconds per repetition
+			double minTime = 0.25;
+
+			///the best of the repetitions is reported, to filter out the noise
+			int repetitions = 3;
+		};
+
+		///runs the registered benchmarks that pass the filter, printing their results as they complete
+		std::vector< Result > runAll( const Options& options );
+
+		///writes the results as JSON, one benchmark per line
+		bool saveResults( const std::vector< Result >& results, const std::string& path );
+
+		///compares the results with a file written by saveResults, and prints the benchmarks that got slower than tolerance
+		/**
+		\returns the number of regressions
+		*/
+		int compareResults( const std::vector< Result >& results, const std::string& baselinePath, double tolerance );
+
+		///measures the deserialization of a .ds text, shared by the generated tables and the files passed with --table
+		void deserializeTable( State& state, const std::string& text );
+
+		extern volatile const void* gp_sink;
+
+		///keeps the compiler from optimizing away the computation of value
+		template< class T >
+		inline void doNotOptimize( const T& value )
+		{
+#ifdef _MSC_VER
+			gp_sink = &value;
+			_ReadWriteBarrier();
+#else
+			asm volatile( "" : : "g"( &value ) : "memory" );
+#endif
+		}
+	}
+}
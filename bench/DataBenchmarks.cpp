@@ -0,0 +1,213 @@
+#include "Benchmark.h"
+
+using namespace Dojo;
+using namespace Dojo::Bench;
+
+namespace
+{
+	///builds a Table that looks like a large level or entity definition file
+	Table _makeTable( int entries )
+	{
+		Table t;
+
+		for( int i = 0; i < entries; ++i )
+		{
+			auto& entity = t.createTable( String( "entity" ) + String( i ) );
+
+			entity.set( "name", String( "Entity number " ) + String( i ) );
+			entity.set( "position", Vector( i * 0.5f, i * -0.25f, 12.f ) );
+			entity.set( "health", 100.f - i % 100 );
+			entity.set( "flags", i % 7 );
+
+			auto& stats = entity.createTable( "stats" );
+			stats.set( "speed", 3.5f );
+			stats.set( "armor", 0.125f * ( i % 8 ) );
+			stats.set( "color", Color( 1, 0.5f, 0.25f ) );
+		}
+
+		return t;
+	}
+
+	std::string _serialize( const Table& t )
+	{
+		String buf;
+		t.serialize( buf );
+		return buf.UTF8();
+	}
+
+	void _serializeTable( State& state, int entries )
+	{
+		Table t = _makeTable( entries );
+		int64_t chars = 0;
+
+		while( state.run() )
+		{
+			String buf;
+			t.serialize( buf );
+
+			chars += buf.size();
+			doNotOptimize( buf );
+		}
+
+		state.setBytesProcessed( chars );
+	}
+
+	void _deserializeTable( State& state, int entries )
+	{
+		deserializeTable( state, _serialize( _makeTable( entries ) ) );
+	}
+
+	Registration _r0( "Table::serialize/256 entries", []( State& s ) { _serializeTable( s, 256 ); } );
+	Registration _r1( "Table::serialize/4096 entries", []( State& s ) { _serializeTable( s, 4096 ); } );
+	Registration _r2( "Table::deserialize/256 entries", []( State& s ) { _deserializeTable( s, 256 ); } );
+	Registration _r3( "Table::deserialize/4096 entries", []( State& s ) { _deserializeTable( s, 4096 ); } );
+
+	Registration _r4( "String::ASCII/1024 chars", []( State& state )
+	{
+		String s;
+		for( int i = 0; i < 1024; ++i )
+			s += (unichar)( 'a' + i % 26 );
+
+		while( state.run() )
+			doNotOptimize( s.ASCII() );
+
+		state.setBytesProcessed( state.getIterations() * s.size() );
+	} );
+
+	Registration _r11( "String::codepoints/1024 chars, mixed scripts", []( State& state )
+	{
+		const unichar alphabet[] = { 'a', 'Z', 0xe8, 0x3b1, 0x416, 0x3042, 0x6f22, 0x1f600 };
+
+		String s;
+		for( int i = 0; i < 1024; ++i )
+			s += alphabet[ i % 8 ];
+
+		while( state.run() )
+		{
+			unichar sum = 0;
+			for( unichar c : s.codepoints() )
+				sum += c;
+
+			doNotOptimize( sum );
+		}
+
+		state.setItemsProcessed( state.getIterations() * 1024 );
+		state.setBytesProcessed( state.getIterations() * s.size() );
+	} );
+
+	Registration _r5( "String::appendFloat", []( State& state )
+	{
+		String s;
+		float f = 0.f;
+
+		while( state.run() )
+		{
+			s.appendFloat( f );
+			f += 1.37f;
+
+			//keep the string short, or the reallocations dominate
+			if( s.size() > 4096 )
+				s.clear();
+		}
+
+		doNotOptimize( s );
+		state.setItemsProcessed( state.getIterations() );
+	} );
+
+	void _findResources( State& state, int count )
+	{
+		ResourceGroup group;
+		std::vector< String > names;
+
+		for( int i = 0; i < count; ++i )
+		{
+			names.push_back( String( "data/tables/level_" ) + String( i ) );
+			group.addTable( names.back(), make_unique< Table >() );
+		}
+
+		size_t i = 0;
+		while( state.run() )
+		{
+			doNotOptimize( group.getTable( names[ i ] ) );
+
+			if( ++i == names.size() )
+				i = 0;
+		}
+
+		state.setItemsProcessed( state.getIterations() );
+	}
+
+	Registration _r6( "ResourceGroup::find/64 tables", []( State& s ) { _findResources( s, 64 ); } );
+	Registration _r7( "ResourceGroup::find/4096 tables", []( State& s ) { _findResources( s, 4096 ); } );
+
+	Registration _r8( "ResourceGroup::find/missing", []( State& state )
+	{
+		ResourceGroup group;
+		for( int i = 0; i < 1024; ++i )
+			group.addTable( String( "table" ) + String( i ), make_unique< Table >() );
+
+		String missing( "not_there" );
+
+		while( state.run() )
+			doNotOptimize( group.getTable( missing ) );
+
+		state.setItemsProcessed( state.getIterations() );
+	} );
+
+	Registration _r9( "ResourceGroup::find/4096 tables, interned IDs", []( State& state )
+	{
+		ResourceGroup group;
+		std::vector< ResourceID > ids;
+
+		for( int i = 0; i < 4096; ++i )
+		{
+			String name = String( "data/tables/level_" ) + String( i );
+			group.addTable( name, make_unique< Table >() );
+			ids.push_back( ResourceNames::intern( name ) );
+		}
+
+		size_t i = 0;
+		while( state.run() )
+		{
+			doNotOptimize( group.getTable( ids[ i ] ) );
+
+			if( ++i == ids.size() )
+				i = 0;
+		}
+
+		state.setItemsProcessed( state.getIterations() );
+	} );
+
+	Registration _r10( "ResourceHandle::get/subgroup", []( State& state )
+	{
+		ResourceGroup group, sub;
+		group.addSubgroup( &sub );
+
+		for( int i = 0; i < 1024; ++i )
+			sub.addTable( String( "table" ) + String( i ), make_unique< Table >() );
+
+		ResourceHandle< Table > handle( group, "table512" );
+
+		while( state.run() )
+			doNotOptimize( handle.get() );
+
+		group.removeSubgroup( &sub );
+
+		state.setItemsProcessed( state.getIterations() );
+	} );
+}
+
+void Dojo::Bench::deserializeTable( State& state, const std::string& text )
+{
+	while( state.run() )
+	{
+		StringReader reader( text );
+
+		Table t;
+		t.deserialize( reader );
+
+		doNotOptimize( t );
+	}
+
+	state.setBytesProcessed( state.getIterations() * (int64_t)text.size() );
+}
@@ -0,0 +1,140 @@
+#include "Benchmark.h"
+
+using namespace Dojo;
+using namespace Dojo::Bench;
+
+namespace
+{
+	Registration _r0( "Noise::perlinNoise", []( State& state )
+	{
+		Noise noise( (size_t)42 );
+		float x = 0.f, sum = 0.f;
+
+		while( state.run() )
+		{
+			sum += noise.perlinNoise( x, x * 0.5f, 0.25f );
+			x += 0.173f;
+		}
+
+		doNotOptimize( sum );
+		state.setItemsProcessed( state.getIterations() );
+	} );
+
+	Registration _r1( "Random::randInt", []( State& state )
+	{
+		Random random( 42 );
+		Random::uint32 sum = 0;
+
+		while( state.run() )
+			sum += random.randInt();
+
+		doNotOptimize( sum );
+		state.setItemsProcessed( state.getIterations() );
+	} );
+
+	Registration _r2( "Random::randInt/range", []( State& state )
+	{
+		Random random( 42 );
+		int sum = 0;
+
+		while( state.run() )
+			sum += random.randInt( -100, 100 );
+
+		doNotOptimize( sum );
+		state.setItemsProcessed( state.getIterations() );
+	} );
+
+	///a size x size grid, with walls on every 8th column that leave a gap alternately at the top and at the bottom
+	void _buildMaze( AStar::Graph& graph, int size )
+	{
+		auto isWall = [ size ]( int x, int y )
+		{
+			if( x % 8 != 4 )
+				return false;
+
+			return ( x / 8 ) % 2 ? y != 0 : y != size - 1;
+		};
+
+		for( int y = 0; y < size; ++y )
+		{
+			for( int x = 0; x < size; ++x )
+			{
+				if( isWall( x, y ) )
+					continue;
+
+				if( x + 1 < size && !isWall( x + 1, y ) )
+					graph.addEdge( Vector( (float)x, (float)y ), Vector( (float)x + 1, (float)y ) );
+
+				if( y + 1 < size && !isWall( x, y + 1 ) )
+					graph.addEdge( Vector( (float)x, (float)y ), Vector( (float)x, (float)y + 1 ) );
+			}
+		}
+	}
+
+	void _solveMaze( State& state, int size )
+	{
+		AStar::Graph graph;
+		_buildMaze( graph, size );
+
+		Vector start( 0, 0 ), end( (float)size - 1, (float)size - 1 );
+
+		while( state.run() )
+		{
+			AStar path( graph, start, end );
+			doNotOptimize( path.getLength() );
+		}
+
+		state.setItemsProcessed( state.getIterations() * (int64_t)graph.size() );
+
+		for( auto& node : graph )
+			delete node.second;
+	}
+
+	Registration _r3( "AStar/maze 32x32", []( State& s ) { _solveMaze( s, 32 ); } );
+	Registration _r4( "AStar/maze 128x128", []( State& s ) { _solveMaze( s, 128 ); } );
+
+	///adds a circle made of 8 quadratic arcs, like a TrueType "O"
+	void _addCircle( Tessellation& t, const Vector& center, float radius, bool clockwise, float quality )
+	{
+		const float step = ( clockwise ? -1.f : 1.f ) * (float)Math::PI / 4.f;
+		const float controlRadius = radius / cosf( (float)Math::PI / 8.f );
+
+		t.startPath( center + Vector( radius, 0 ) );
+
+		for( int i = 0; i < 8; ++i )
+		{
+			float a = step * i;
+
+			t.addQuadradratic(
+				center + Vector( cosf( a + step * 0.5f ), sinf( a + step * 0.5f ) ) * controlRadius,
+				center + Vector( cosf( a + step ), sinf( a + step ) ) * radius,
+				quality );
+		}
+	}
+
+	void _tessellateGlyph( State& state, float quality )
+	{
+		int64_t triangles = 0;
+
+		while( state.run() )
+		{
+			state.pause();
+
+			Tessellation t;
+			_addCircle( t, Vector( 0.5f, 0.5f ), 0.5f, false, quality );
+			_addCircle( t, Vector( 0.5f, 0.5f ), 0.3f, true, quality );
+
+			state.resume();
+
+			//the same flags that Font uses
+			t.tessellate( Tessellation::PREPARE_EXTRUSION | Tessellation::GUESS_HOLES, 1 << 16 );
+
+			triangles += t.outIndices.size() / 3;
+		}
+
+		state.setItemsProcessed( triangles );
+	}
+
+	Registration _r5( "Tessellation::tessellate/glyph quality 10", []( State& s ) { _tessellateGlyph( s, 10 ); } );
+	Registration _r6( "Tessellation::tessellate/glyph quality 100", []( State& s ) { _tessellateGlyph( s, 100 ); } );
+}
@@ -0,0 +1,83 @@
+#include "Benchmark.h"
+
+#include <dojo/FBPipe.h>
+
+using namespace Dojo;
+using namespace Dojo::Bench;
+
+namespace
+{
+	typedef Dojo::Pipe< int > CamelPipe;
+	typedef folly::Pipe< int > FacebookPipe;
+
+	bool _tryQueue( CamelPipe& pipe, int value )
+	{
+		return pipe.tryQueue( value );
+	}
+
+	bool _tryQueue( FacebookPipe& pipe, int value )
+	{
+		//FBPipe::queue spins while the pipe is full, and there's a single producer
+		return !pipe.isFull() && pipe.queue( value );
+	}
+
+	///a producer thread fills the pipe as fast as it can, each iteration pops an element
+	template< class P >
+	void _throughput( State& state )
+	{
+		P pipe( 4096 );
+		std::atomic< bool > stop( false );
+
+		std::thread producer( [ & ]()
+		{
+			int i = 0;
+			while( !stop.load( std::memory_order_relaxed ) )
+			{
+				if( _tryQueue( pipe, i ) )
+					++i;
+			}
+		} );
+
+		int value;
+		int64_t sum = 0;
+
+		while( state.run() )
+		{
+			while( !pipe.tryPop( value ) );
+
+			sum += value;
+		}
+
+		stop = true;
+		producer.join();
+
+		doNotOptimize( sum );
+		state.setItemsProcessed( state.getIterations() );
+		state.setBytesProcessed( state.getIterations() * sizeof( int ) );
+	}
+
+	///queues and pops on the same thread, measuring the cost of the operations without contention
+	template< class P >
+	void _roundTrip( State& state )
+	{
+		P pipe( 4096 );
+		int value;
+		int64_t sum = 0;
+
+		while( state.run() )
+		{
+			_tryQueue( pipe, 1 );
+			pipe.tryPop( value );
+
+			sum += value;
+		}
+
+		doNotOptimize( sum );
+		state.setItemsProcessed( state.getIterations() );
+	}
+
+	Registration _r0( "Pipe/throughput", _throughput< CamelPipe > );
+	Registration _r1( "FBPipe/throughput", _throughput< FacebookPipe > );
+	Registration _r2( "Pipe/round trip", _roundTrip< CamelPipe > );
+	Registration _r3( "FBPipe/round trip", _roundTrip< FacebookPipe > );
+}
@@ -0,0 +1,274 @@
+#include "Benchmark.h"
+
+#include <dojo/TransformSystem.h>
+
+using namespace Dojo;
+using namespace Dojo::Bench;
+
+namespace
+{
+	///a root that doesn't need a GameState, and so a Platform
+	class Root : public Object
+	{
+	public:
+		Root() :
+			Object( this, Vector::ZERO )
+		{
+			gameState = nullptr;
+		}
+	};
+
+	///adds "depth" levels of children under parent, each with "breadth" children
+	void _addChildren( Object& parent, int depth, int breadth )
+	{
+		if( depth == 0 )
+			return;
+
+		for( int i = 0; i < breadth; ++i )
+		{
+			auto& child = parent.addChild( make_unique< Object >( &parent, Vector( 1.f, (float)i, 0 ) ) );
+			child.setRotation( Vector( 0, 0, 0.1f * i ) );
+
+			_addChildren( child, depth - 1, breadth );
+		}
+	}
+
+	int _countObjects( int depth, int breadth )
+	{
+		int count = 0, level = 1;
+		for( int i = 0; i < depth; ++i )
+		{
+			level *= breadth;
+			count += level;
+		}
+		return count;
+	}
+
+	///moves the root each iteration so that every world transform below it has to be recomputed
+	void _updateHierarchy( State& state, int depth, int breadth )
+	{
+		Root root;
+		_addChildren( root, depth, breadth );
+
+		while( state.run() )
+		{
+			root.position.x += 0.01f;
+			root.onAction( 0 );
+		}
+
+		state.setItemsProcessed( state.getIterations() * _countObjects( depth, breadth ) );
+	}
+
+	Registration _r0( "Object::updateWorldTransform/chain of 256", []( State& s ) { _updateHierarchy( s, 256, 1 ); } );
+	Registration _r1( "Object::updateWorldTransform/depth 6 x 4 children", []( State& s ) { _updateHierarchy( s, 6, 4 ); } );
+
+	Registration _r2( "Object::updateWorldTransform/static hierarchy", []( State& state )
+	{
+		Root root;
+		_addChildren( root, 6, 4 );
+		root.onAction( 0 );
+
+		//nothing moves, this measures the dirty checks
+		while( state.run() )
+			root.onAction( 0 );
+
+		state.setItemsProcessed( state.getIterations() * _countObjects( 6, 4 ) );
+	} );
+
+	///a Mesh whose CPU-side building can be measured without a GL context, by never calling end()
+	class CPUMesh : public Mesh
+	{
+	public:
+		///does the CPU-side work of end()
+		void _stopEditing()
+		{
+			_updateBounds();
+			editing = false;
+		}
+	};
+
+	void _buildMesh( State& state, int quads, bool reserve )
+	{
+		CPUMesh mesh;
+		mesh.setVertexFields( { VertexField::Position3D, VertexField::Color, VertexField::UV0 } );
+		mesh.setIndexByteSize( sizeof( GLushort ) );
+		mesh.setTriangleMode( TriangleMode::TriangleList );
+
+		while( state.run() )
+		{
+			mesh.begin( reserve ? quads * 4 : 1 );
+
+			for( int i = 0; i < quads; ++i )
+			{
+				float x = (float)( i % 64 ), y = (float)( i / 64 );
+
+				int base = mesh.vertex( x, y, 0 );
+				mesh.color( Color::WHITE );
+				mesh.uv( 0, 0 );
+
+				mesh.vertex( x + 1, y, 0 );
+				mesh.color( Color::WHITE );
+				mesh.uv( 1, 0 );
+
+				mesh.vertex( x, y + 1, 0 );
+				mesh.color( Color::WHITE );
+				mesh.uv( 0, 1 );
+
+				mesh.vertex( x + 1, y + 1, 0 );
+				mesh.color( Color::WHITE );
+				mesh.uv( 1, 1 );
+
+				mesh.quad( base, base + 1, base + 2, base + 3 );
+			}
+
+			mesh._stopEditing();
+		}
+
+		state.setItemsProcessed( state.getIterations() * quads * 4 );
+	}
+
+	Registration _r3( "Mesh::vertex+index/4096 quads", []( State& s ) { _buildMesh( s, 4096, true ); } );
+	Registration _r4( "Mesh::vertex+index/4096 quads, no reserve", []( State& s ) { _buildMesh( s, 4096, false ); } );
+
+	Registration _r6( "Mesh::appendVertices+appendIndices/4096 quads", []( State& state )
+	{
+		static const Mesh::IndexType QUAD_INDICES[] = { 0, 2, 1, 2, 3, 1 };
+		const int quads = 4096;
+
+		CPUMesh mesh;
+		mesh.setVertexFields( { VertexField::Position3D, VertexField::Color, VertexField::UV0 } );
+		mesh.setIndexByteSize( sizeof( GLushort ) );
+		mesh.setTriangleMode( TriangleMode::TriangleList );
+
+		auto white = Color::WHITE.toRGBA();
+
+		while( state.run() )
+		{
+			mesh.begin( quads * 4, quads * 6 );
+
+			Mesh::IndexType first = mesh.appendVertices( quads * 4 );
+			auto positions = mesh.getFieldSpan< Vector >( VertexField::Position3D, first, quads * 4 );
+			auto colors = mesh.getFieldSpan< Color::RGBAPixel >( VertexField::Color, first, quads * 4 );
+			auto uvs = mesh.getFieldSpan< glm::vec2 >( VertexField::UV0, first, quads * 4 );
+
+			for( int i = 0; i < quads; ++i )
+			{
+				float x = (float)( i % 64 ), y = (float)( i / 64 );
+				Mesh::IndexType base = i * 4;
+
+				positions[ base ] = Vector( x, y, 0 );
+				positions[ base + 1 ] = Vector( x + 1, y, 0 );
+				positions[ base + 2 ] = Vector( x, y + 1, 0 );
+				positions[ base + 3 ] = Vector( x + 1, y + 1, 0 );
+
+				for( int j = 0; j < 4; ++j )
+				{
+					colors[ base + j ] = white;
+					uvs[ base + j ] = glm::vec2( (float)( j % 2 ), (float)( j / 2 ) );
+				}
+
+				mesh.appendIndices( QUAD_INDICES, 6, base );
+			}
+
+			mesh._stopEditing();
+		}
+
+		state.setItemsProcessed( state.getIterations() * quads * 4 );
+	} );
+
+	Registration _r7( "Mesh::optimize/64x64 grid as an unindexed list", []( State& state )
+	{
+		const int side = 64;
+
+		CPUMesh mesh;
+		mesh.setVertexFields( { VertexField::Position3D, VertexField::Normal, VertexField::UV0 } );
+		mesh.setTriangleMode( TriangleMode::TriangleList );
+
+		while( state.run() )
+		{
+			state.pause();
+
+			mesh.begin( side * side * 6 );
+
+			for( int y = 0; y < side; ++y )
+			{
+				for( int x = 0; x < side; ++x )
+				{
+					static const int corners[] = { 0, 1, 2, 1, 3, 2 };
+
+					for( int c : corners )
+					{
+						float cx = (float)( x + c % 2 ), cy = (float)( y + c / 2 );
+
+						mesh.vertex( cx, cy, 0 );
+						mesh.normal( Vector::UNIT_Z );
+						mesh.uv( cx / side, cy / side );
+					}
+				}
+			}
+
+			state.resume();
+
+			mesh.optimize();
+			mesh._stopEditing();
+		}
+
+		state.setItemsProcessed( state.getIterations() * side * side * 2 );
+	} );
+
+	Registration _r5( "TransformSystem::update/depth 6 x 4 children", []( State& state )
+	{
+		TransformSystem transforms;
+
+		std::function< void( TransformSystem::Handle, int ) > addChildren = [ & ]( TransformSystem::Handle parent, int depth )
+		{
+			if( depth == 0 )
+				return;
+
+			for( int i = 0; i < 4; ++i )
+				addChildren( transforms.add( parent, Vector( 1.f, (float)i, 0 ) ), depth - 1 );
+		};
+
+		auto root = transforms.add( TransformSystem::INVALID_HANDLE, Vector::ZERO );
+		addChildren( root, 6 );
+
+		Vector position = Vector::ZERO;
+
+		while( state.run() )
+		{
+			position.x += 0.01f;
+			transforms.setPosition( root, position );
+			transforms.update();
+		}
+
+		state.setItemsProcessed( state.getIterations() * _countObjects( 6, 4 ) );
+	} );
+
+	Registration _r8( "TransformSystem::update/100k transforms, 1000 groups", []( State& state )
+	{
+		const int groups = 1000, groupSize = 99;
+
+		TransformSystem transforms;
+
+		//a wide and shallow hierarchy, like a crowd or a particle field
+		auto root = transforms.add( TransformSystem::INVALID_HANDLE, Vector::ZERO );
+		for( int i = 0; i < groups; ++i )
+		{
+			auto group = transforms.add( root, Vector( (float)i, 0, 0 ) );
+
+			for( int j = 0; j < groupSize; ++j )
+				transforms.add( group, Vector( 0, (float)j, 0 ) );
+		}
+
+		Vector position = Vector::ZERO;
+
+		while( state.run() )
+		{
+			position.x += 0.01f;
+			transforms.setPosition( root, position );
+			transforms.update();
+		}
+
+		state.setItemsProcessed( state.getIterations() * ( 1 + groups * ( 1 + groupSize ) ) );
+	} );
+}
@@ -0,0 +1,97 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+
+using namespace Dojo;
+
+static void _printUsage()
+{
+	printf(
+		"usage: dojo_bench [options]\n"
+		"  --filter=TEXT       only run the benchmarks whose name contains TEXT\n"
+		"  --min-time=SECONDS  minimum time of each repetition (default 0.25)\n"
+		"  --repetitions=N     repetitions of each benchmark, the best one is reported (default 3)\n"
+		"  --out=PATH          where to write the JSON results (default bench_results.json)\n"
+		"  --baseline=PATH     compare with a previous JSON result, exit with 1 if something got slower\n"
+		"  --tolerance=RATIO   how much slower than the baseline is a regression (default 0.1)\n"
+		"  --table=PATH        also deserialize this .ds file\n" );
+}
+
+static bool _readOption( const std::string& arg, const char* name, std::string& value )
+{
+	std::string prefix = std::string( "--" ) + name + "=";
+
+	if( arg.compare( 0, prefix.size(), prefix ) != 0 )
+		return false;
+
+	value = arg.substr( prefix.size() );
+	return true;
+}
+
+static void _addTableFile( const std::string& path )
+{
+	std::string name = "Table::deserialize/" + path;
+
+	Bench::Registration( name.c_str(), [ path ]( Bench::State& state )
+	{
+		std::ifstream file( path, std::ios::binary );
+		std::string text( ( std::istreambuf_iterator< char >( file ) ), std::istreambuf_iterator< char >() );
+
+		DEBUG_ASSERT_INFO( text.size(), "Cannot read the table file", String( path ) );
+
+		Bench::deserializeTable( state, text );
+	} );
+}
+
+int main( int argc, char** argv )
+{
+	Bench::Options options;
+	std::string outPath = "bench_results.json", baselinePath, value;
+	double tolerance = 0.1;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = argv[ i ];
+
+		if( _readOption( arg, "filter", value ) )
+			options.filter = value;
+		else if( _readOption( arg, "min-time", value ) )
+			options.minTime = atof( value.c_str() );
+		else if( _readOption( arg, "repetitions", value ) )
+			options.repetitions = std::max( 1, atoi( value.c_str() ) );
+		else if( _readOption( arg, "out", value ) )
+			outPath = value;
+		else if( _readOption( arg, "baseline", value ) )
+			baselinePath = value;
+		else if( _readOption( arg, "tolerance", value ) )
+			tolerance = atof( value.c_str() );
+		else if( _readOption( arg, "table", value ) )
+			_addTableFile( value );
+		else
+		{
+			_printUsage();
+			return arg == "--help" ? 0 : 2;
+		}
+	}
+
+	//the benchmarks run without a Platform, but the engine code still logs
+	gp_log = new Log();
+
+	auto results = Bench::runAll( options );
+
+	int res = 0;
+
+	if( !Bench::saveResults( results, outPath ) )
+	{
+		printf( "Cannot write the results to %s\n", outPath.c_str() );
+		res = 1;
+	}
+
+	if( baselinePath.size() && Bench::compareResults( results, baselinePath, tolerance ) > 0 )
+		res = 1;
+
+	gp_log->flush();
+	SAFE_DELETE( gp_log );
+
+	return res;
+}
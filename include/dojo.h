@@ -33,6 +33,8 @@
 #include <dojo/RenderState.h>
 #include <dojo/Renderable.h>
 #include <dojo/ResourceGroup.h>
+#include <dojo/ResourceHandle.h>
+#include <dojo/ResourceID.h>
 #include <dojo/SoundBuffer.h>
 #include <dojo/SoundManager.h>
 #include <dojo/SoundSet.h>
@@ -53,4 +55,5 @@
 #include <dojo/dojo_config.h>
 #include <dojo/dojomath.h>
 #include <dojo/dojostring.h>
+#include <dojo/StringView.h>
 
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "SpatialIndex.h"
+
+namespace Dojo
+{
+	///An AABBTree is a dynamic bounding volume hierarchy, meant to cull the elements of perspective layers against the view frustum
+	/**
+	the leaves store a "fat" AABB larger than the element, so that small movements don't change the tree.
+	The tree is kept balanced with rotations as elements are inserted and removed.
+	*/
+	class AABBTree : public SpatialIndex
+	{
+	public:
+
+		///how much the leaf AABBs are enlarged on each side, relative to the element's size
+		static const float FAT_MARGIN;
+
+		AABBTree();
+
+		virtual void add( Renderable& r );
+
+		virtual void remove( Renderable& r );
+
+		virtual void update( Renderable& r );
+
+		virtual void clear();
+
+		virtual void query( const Viewport& viewport, ResultList& result ) const;
+
+	protected:
+
+		static const int NULL_NODE = -1;
+
+		struct Node
+		{
+			Vector min, max;
+
+			//the parent when in the tree, the next free node when in the free list
+			int parent;
+			int child1, child2;
+
+			//leaf only
+			Renderable* object;
+
+			//0 for leaves, -1 for free nodes
+			int height;
+
+			//true if the leaf is in mUnbounded instead of the tree
+			bool unbounded;
+
+			bool isLeaf() const
+			{
+				return child1 == NULL_NODE;
+			}
+		};
+
+		std::vector< Node > mNodes;
+		int mRoot, mFreeList;
+
+		//the elements with an AABB that can't be placed in the tree
+		std::vector< int > mUnbounded;
+
+		mutable std::vector< int > mStack;
+
+		int _allocateNode();
+		void _freeNode( int nodeID );
+
+		void _insertLeaf( int leaf );
+		void _removeLeaf( int leaf );
+
+		///does a tree rotation on A if it is unbalanced, returns the new root of its subtree
+		int _balance( int A );
+
+		///recomputes the bounds and the height of the node from its children
+		void _refit( int nodeID );
+
+		void _setFatAABB( Node& leaf, const Vector& min, const Vector& max );
+
+	private:
+	};
+}
@@ -10,6 +10,10 @@ namespace Dojo
 	/**
 	Dojo always spawns a default BackgroundQueue that can be retrieved with Platform::getBackgroundQueue(), but more can be created if needed.
 	The BackgroundQueue also fires the "then" callbacks for the tasks that have finished on the main thread.
+
+	Each worker has its own deques of tasks: the tasks queued by a worker go to its own deque and are run newest first,
+	while the idle workers steal the oldest tasks from the others. The tasks queued by other threads go to a shared injection queue.
+	Workers with nothing to do sleep until a task is queued.
 	*/
 	class BackgroundQueue
 	{
@@ -18,11 +22,38 @@ namespace Dojo
 		typedef std::function< void() > Task;
 		typedef std::function< void() > Callback;
 
+		///the tasks with a higher priority are always picked first
+		enum Priority
+		{
+			PRIORITY_HIGH, ///things that are needed right now, eg. streaming audio
+			PRIORITY_NORMAL,
+			PRIORITY_LOW, ///background work that can wait, eg. asset preloading
+
+			_PRIORITY_COUNT
+		};
+
+		///a Blocking object marks the scope of a blocking call (file IO, sleeps, waits) inside a task
+		/**
+		while it exists, the task doesn't count against the pool size and another worker can run a task in its place.
+		It does nothing outside of the workers.
+		*/
+		class Blocking
+		{
+		public:
+			Blocking( BackgroundQueue& queue );
+			~Blocking();
+
+		protected:
+			BackgroundQueue* pQueue;
+			bool mActive;
+		};
+
 		static const Callback NOP_CALLBACK;
 
 		///Creates a new empty BackgroundQueue and starts its thread pool
 		/**
-		\param poolSize the number of threads in the pool size. If -1 is passed, the default size is the available cores number x 2.
+		\param poolSize the number of tasks that can run at the same time. If -1 is passed, the default size is the available cores number.
+		Twice as many threads are created, so that the tasks that block can be replaced.
 		*/
 		BackgroundQueue( int poolSize = -1 );
 
@@ -37,24 +68,23 @@ namespace Dojo
 		Tasks are void to void lambdas, ie []() { printf( "Hello World\n" ); }
 		Task execution parameters can be captured with the closure operator.
 		*/
-		void queueTask( const Task& task, const Callback& callback = NOP_CALLBACK );
+		void queueTask( const Task& task, const Callback& callback = NOP_CALLBACK, Priority priority = PRIORITY_NORMAL );
 
 		///queues a function to be executed on the main thread
 		void queueOnMainThread( const Callback& c );
 
+		///runs body( i ) for each i in [0, count) on the thread pool and on the calling thread, and returns when all are done
+		/**
+		the calling thread takes part in the work, so this also works (serially) when the pool has no threads or is busy.
+		No callbacks are fired for the iterations.
+		*/
+		void parallelFor( int count, const std::function< void( int ) >& body );
+
 		///Waits until this queue stops itself
 		/**
 		be sure that no tasks are stalling it!
 		*/
-		void stop()
-		{
-			if (mRunning) {
-				mRunning = false;
-
-				for( auto& w : mWorkers )
-					w->join();
-			}
-		}
+		void stop();
 
 		///causes the queue to fire the completion listeners on the main thread.
 		/**
@@ -62,45 +92,132 @@ namespace Dojo
 		*/
 		void fireCompletedCallbacks();
 
+		///returns the number of worker threads
+		int getWorkerCount() const
+		{
+			return mWorkers.size();
+		}
+
+		///returns the fraction of time that a worker spent running tasks since the last resetStats()
+		float getWorkerUtilization( int worker ) const;
+
+		///returns how many tasks a worker ran since the last resetStats(), and how many of them it stole from the others
+		int getWorkerTaskCount( int worker, int* stolen = nullptr ) const;
+
+		///resets the worker utilization and task counts
+		void resetStats();
+
 	protected:
 
+		struct Job
+		{
+			Task task;
+			Callback callback;
+			Priority priority;
+
+			Job() :
+				priority( PRIORITY_NORMAL )
+			{
+
+			}
+
+			Job( const Task& t, const Callback& c, Priority p ) :
+				task( t ),
+				callback( c ),
+				priority( p )
+			{
+
+			}
+		};
+
+		typedef std::deque< Job > JobQueue;
+
 		class Worker
 		{
 		public:
 
-			Worker(BackgroundQueue* parent);
+			std::atomic< int64_t > busyMicroseconds;
+			std::atomic< int > taskCount, stolenCount;
+
+			Worker(BackgroundQueue* parent, int index);
+
+			///starts the thread, once all the workers exist
+			void start();
 
 			void join() {
 				thread.join();
 			}
 
+			std::thread::id getID() const
+			{
+				return thread.get_id();
+			}
+
+			int getIndex() const
+			{
+				return mIndex;
+			}
+
+			///pushes a job on this worker's own deque
+			void push( Job&& job );
+
+			///pops the newest job of this priority from this worker's own deque
+			bool pop( Priority p, Job& out );
+
+			///takes the oldest job of this priority, called by the other workers
+			bool steal( Priority p, Job& out );
+
 		protected:
 			BackgroundQueue* pParent;
+			int mIndex;
+
+			std::mutex mMutex;
+			JobQueue mJobs[ _PRIORITY_COUNT ];
+
 			std::thread thread;
+
+			void _run();
 		};
 
-		typedef std::pair< Task, Callback > TaskCallbackPair;
-		typedef Pipe< TaskCallbackPair > TaskQueue;
 		typedef Pipe< Task > CompletedTaskQueue;
 		typedef std::vector< Unique< Worker > > WorkerList;
 
 		std::atomic<bool> mRunning;
 
-		Unique<TaskQueue> mQueue;
+		//the jobs queued by the threads that aren't workers
+		JobQueue mInjectionQueue[ _PRIORITY_COUNT ];
+		std::mutex mInjectionMutex;
+
+		//the number of jobs queued anywhere, and how many more tasks can run right now
+		std::atomic< int > mPendingJobs, mFreeSlots;
+
+		std::mutex mParkMutex;
+		std::condition_variable mParkCondition;
+
+		//the workers are all producers of the completed queue, but a Pipe only allows one at a time
 		Unique<CompletedTaskQueue> mCompletedQueue;
+		std::mutex mCompletedQueueMutex;
 
 		WorkerList mWorkers;
 
 		std::thread::id mMainThreadID;
 
-		///waits for a task, returns false if the thread has to close
-		bool _waitForTaskOrClose( TaskCallbackPair& out )
-		{
-			if( mRunning ) //fetch a new task from the queue
-				return mQueue->tryPop(out);
+		double mStatsStartTime;
 
-			else return false;
-		}
+		///returns the worker that is running on this thread, or nullptr
+		Worker* _getCurrentWorker() const;
+
+		///queues a job on the current worker if called from one, else on the injection queue, and wakes up a worker
+		void _push( Job&& job );
+
+		///finds the best job to run for the given worker (or nullptr for other threads)
+		bool _findJob( Worker* self, Job& out );
+
+		///wakes up a parked worker if there is work for it
+		void _wakeWorker();
+
+		///waits for a job and reserves a slot for it, returns false if the thread has to close
+		bool _waitForJobOrClose( Worker& self, Job& out );
 
 	private:
 	};
@@ -97,6 +97,16 @@ namespace Dojo
 			return Color( r * c.r, g * c.g, b * c.b, a * c.a );
 		}
 
+		bool operator == ( const Color& c ) const
+		{
+			return r == c.r && g == c.g && b == c.b && a == c.a;
+		}
+
+		bool operator != ( const Color& c ) const
+		{
+			return !(*this == c);
+		}
+
 		///sums two colors component-wise
 		Color operator + ( float s ) const
 		{
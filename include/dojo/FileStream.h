@@ -36,6 +36,23 @@ namespace Dojo
 		*/
 		virtual void close() = 0;
 
+		///reads up to "number" bytes from the start of the file, without opening it; returns the number of bytes read
+		/**
+		useful to look at a header when opening would read or unpack the whole file
+		\remark the FileStream must not be open
+		*/
+		virtual int readHead( byte* buf, int number )
+		{
+			DEBUG_ASSERT( !isOpen(), "readHead: the FileStream is already open" );
+
+			if( open() == SA_BAD_FILE )
+				return 0;
+
+			int read = this->read( buf, number );
+			close();
+			return read;
+		}
+
 	protected:
 
 		bool mWrite;
@@ -78,6 +78,9 @@ namespace Dojo
 
 			virtual ~Page();
 
+			///renders the characters in memory, so that onLoad() only has to upload them
+			virtual void onPrepare();
+
 			virtual bool onLoad();
 
 			virtual void onUnload( bool soft = false );
@@ -114,6 +117,13 @@ namespace Dojo
 
 			Character chars[ FONT_CHARS_PER_PAGE ];
 
+			//the pixels rendered by onPrepare(), waiting for onLoad()
+			byte* mPreparedPixels;
+			int mPreparedWidth, mPreparedHeight;
+
+			///renders all the characters in a new RGBA buffer
+			byte* _rasterize( int& width, int& height );
+
 			bool _charInPage( unichar c ) 
 			{
 				return c >= firstCharIdx && c < (firstCharIdx + FONT_CHARS_PER_PAGE);
@@ -131,6 +141,12 @@ namespace Dojo
 		
 		virtual ~Font();
 
+		///reads the font description and renders the preloaded pages in memory
+		/**
+		\remark the Fonts share their FreeType faces, so they must be prepared one at a time
+		*/
+		virtual void onPrepare();
+
 		virtual bool onLoad();
 		///purges all the loaded pages from memory and prompts a rebuild
 		virtual void onUnload( bool soft = false );
@@ -215,6 +231,11 @@ namespace Dojo
 
 		FT_Face face;
 
+		bool mDescriptionLoaded;
+
+		///reads the .font file, opens the face and creates the preloaded pages
+		void _loadDescription();
+
 		///this has to be called each time that we need to use the face
 		void _prepareFace();
 		
@@ -63,6 +63,9 @@ namespace Dojo
 		*/
 		void setAtlas( const Table& atlasTable, ResourceGroup& atlasTextureProvider );
 
+		///decodes the images of the frames
+		virtual void onPrepare();
+
 		virtual bool onLoad();
 		
 		///unload all of the content;
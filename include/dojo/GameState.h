@@ -14,6 +14,8 @@
 #include "Object.h"
 #include "ResourceGroup.h"
 #include "StateInterface.h"
+#include "TransformSystem.h"
+#include "TaskGraph.h"
 
 namespace Dojo 
 {	
@@ -55,6 +57,12 @@ namespace Dojo
 				
 		///returns the Viewport that is primary on this GameState
 		Viewport* getViewport()		{	return camera;			}
+
+		///returns the contiguous transform hierarchy of this GameState, for large numbers of lightweight moving things
+		TransformSystem& getTransformSystem()	{	return mTransforms;	}
+
+		///returns the TaskGraph for the background work of this GameState, such as loading; its tasks are cancelled by clear()
+		TaskGraph& getTaskGraph()	{	return mTasks;	}
 		
 		///sets the primary Viewport (ie. camera) on this GameState, needed for pixel-perfect behaviour! (Sprites and TextAreas)
 		void setViewport( Viewport& v );
@@ -65,6 +73,21 @@ namespace Dojo
 
 		///triggers all the TouchAreas to send their events if they were touched before the last updateClickableState call
         void updateClickableState();
+
+		///updates the independent children in parallel on the BackgroundQueue, then the others on this thread
+		/**
+		after the parallel phase the functions queued with runSerially() are called, in no particular order
+		*/
+		void updateChildsParallel( float dt );
+
+		///queues f to be run on the main thread right after the parallel update, or runs it now outside of it
+		/**
+		use it from independent Objects for anything that touches the Renderer, the GameState or other Objects
+		*/
+		void runSerially( const std::function< void() >& f );
+
+		///true while the independent children are being updated
+		bool isInParallelUpdate() const		{	return mParallelUpdate;	}
         
 		///default implementation for the GameState, with TouchAreas and child objects update
 		/**
@@ -74,7 +97,10 @@ namespace Dojo
         {
             updateClickableState();
             
-            updateChilds( dt );
+            updateChildsParallel( dt );
+
+			//after the children moved them
+			mTransforms.update();
         }
 		
 	protected:
@@ -88,6 +114,16 @@ namespace Dojo
 		Viewport* camera;
 		
 		float timeElapsed;
+
+		TransformSystem mTransforms;
+
+		TaskGraph mTasks;
+
+		std::atomic< bool > mParallelUpdate;
+		std::vector< Object* > mParallelChilds;
+
+		std::mutex mSerialCallsMutex;
+		std::vector< std::function< void() > > mSerialCalls;
 	};
 }
 
@@ -10,26 +10,54 @@ namespace Dojo
 	class LogListener;
 
 	///The Log class manages dojo's debug output and can redirect it to file, or it can be read from a console
+	/**
+	any thread can append to a Log without locking or allocating: each message is copied in a preallocated record of a ring,
+	and the records are moved in the history and sent to the listeners in a single batch when the Platform calls flush() at each frame.
+	*/
 	class Log
 	{
 	public:
 
-		typedef std::vector< LogEntry > LogQueue;
+		typedef std::deque< LogEntry > LogQueue;
 
-		Log( int maxLines = 1024 ) :
-			mMaxLines( maxLines )
-		{
-			DEBUG_ASSERT( mMaxLines > 0, "Cannot create a Log with 0 or less lines" );
-		}
+		///the longest message that fits in a record in UTF-8 bytes, longer messages are truncated
+		static const int MESSAGE_MAX_LENGTH = 256;
 
-		~Log()
-		{
+		///creates a Log that keeps the last maxLines messages, and can hold "capacity" messages between two flushes
+		/**
+		the capacity is rounded up to a power of two
+		*/
+		Log( int maxLines = 1024, int capacity = 4096 );
 
-		}
+		///flushes the last messages
+		~Log();
 
 		///appends another message to the log, with an optional severity level
+		/**
+		it is safe to call this from any thread; the message shows up at the next flush().
+		When the ring is full until the next flush, the message is dropped.
+		*/
 		void append( const String& message, LogEntry::Level level = LogEntry::EL_WARNING );
 
+		///moves the appended messages in the history, and sends them to the listeners in the order they were appended
+		/**
+		\remark call this from the main thread, as the listeners are not thread safe
+		*/
+		void flush();
+
+		///flushes like flush(), unless a flush is already running on any thread; returns false if it didn't flush
+		/**
+		for the paths that can't wait, like the assert handler: it might be running on a worker during the main thread's flush,
+		or inside a listener of a flush
+		*/
+		bool tryFlush();
+
+		///returns how many messages were dropped because the ring was full
+		int getDroppedCount() const
+		{
+			return mDropped;
+		}
+
 		///adds a listener that will receive events from this Log
 		void addListener( LogListener* l )
 		{
@@ -43,7 +71,7 @@ namespace Dojo
 			pListeners.remove( l );
 		}
 
-		///returns the last appended entry
+		///returns the last flushed entry
 		const LogEntry& getLastMessage()
 		{
 			return mOutput.back();
@@ -61,11 +89,38 @@ namespace Dojo
 
 	protected:
 
+		///a message waiting for the flush; its sequence says if it's free or full, to the appending threads and to the flush
+		struct Record
+		{
+			std::atomic< unsigned int > sequence;
+
+			LogEntry::Level level;
+			time_t timestamp;
+			std::thread::id thread;
+
+			int length;
+			char text[ MESSAGE_MAX_LENGTH ];
+		};
+
 		Array< LogListener* > pListeners;
 		LogQueue mOutput;
 		int mMaxLines;
 
-		void _append( const String& message, LogEntry::Level level );
+		std::vector< Record > mRecords;
+		unsigned int mMask;
+
+		std::atomic< unsigned int > mAppendPosition;
+		unsigned int mFlushPosition;
+		std::atomic< int > mDropped;
+		int mReportedDropped;
+
+		//there can be only one flush at a time, but a failing assertion can flush from any thread
+		std::mutex mFlushMutex;
+		//the thread that is running _flush(), if any
+		std::atomic< std::thread::id > mFlushThread;
+
+		///flush(), with mFlushMutex locked
+		void _flush();
 
 		void _fireOnLogUpdated( const LogEntry& e );
 	};
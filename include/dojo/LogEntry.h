@@ -20,12 +20,26 @@ namespace Dojo {
 		String text;
 		Level level;
 
+		///the thread that appended the entry
+		std::thread::id thread;
+
 		LogEntry(const String& msg, Level lvl) :
 			text(msg),
-			level(lvl)
+			level(lvl),
+			thread(std::this_thread::get_id())
 		{
 			timestamp = time(NULL);
 		}
+
+		///creates an entry that was appended at the given time by the given thread
+		LogEntry(const String& msg, Level lvl, time_t time, std::thread::id threadID) :
+			timestamp(time),
+			text(msg),
+			level(lvl),
+			thread(threadID)
+		{
+
+		}
 	};
 
 }
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+namespace Dojo
+{
+	///MappedFile maps a whole file in memory as read-only
+	/**
+	the contents are paged in by the OS only when they are touched, so mapping a big archive is cheap and
+	reading from it doesn't need any copy.
+	MappedFiles are shared between all the streams that read from them, and are unmapped when the last one goes away.
+	*/
+	class MappedFile
+	{
+	public:
+
+		///maps the file at path; check isOpen() to know if it worked
+		MappedFile( const String& path );
+
+		~MappedFile();
+
+		bool isOpen() const
+		{
+			return mOpen;
+		}
+
+		///returns the contents of the file, or nullptr if it is empty or not open
+		const byte* getData() const
+		{
+			return pData;
+		}
+
+		size_t getSize() const
+		{
+			return mSize;
+		}
+
+		const String& getPath() const
+		{
+			return mPath;
+		}
+
+	protected:
+
+		String mPath;
+		bool mOpen;
+
+		const byte* pData;
+		size_t mSize;
+
+#ifdef PLATFORM_WIN32
+		HANDLE mFile, mMapping;
+#else
+		int mFile;
+#endif
+
+	private:
+
+		MappedFile( const MappedFile& ) = delete;
+		MappedFile& operator=( const MappedFile& ) = delete;
+	};
+}
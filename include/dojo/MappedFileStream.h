@@ -0,0 +1,76 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "FileStream.h"
+
+namespace Dojo
+{
+	class MappedFile;
+
+	///MappedFileStream reads a file, or a file inside an archive, from a MappedFile
+	/**
+	uncompressed contents are read in place without any copy, and getData() gives direct access to them;
+	deflated archive entries are inflated in a private buffer when the stream is opened, and released when it is closed.
+	A MappedFileStream is read-only.
+	*/
+	class MappedFileStream : public FileStream
+	{
+	public:
+
+		///how the contents are stored in the MappedFile
+		enum Compression
+		{
+			C_NONE,
+			C_DEFLATE
+		};
+
+		///creates a stream for the loose file at path, mapping it at open()
+		MappedFileStream( const String& path );
+
+		///creates a stream for "size" bytes stored in source at offset, eg. an entry of an archive
+		/**
+		\param path the path that the stream will report
+		\param storedSize the bytes taken in source, which are different from size when the data is compressed
+		*/
+		MappedFileStream( const String& path, const Shared< MappedFile >& source, size_t offset, size_t storedSize, size_t size, Compression compression );
+
+		virtual ~MappedFileStream();
+
+		virtual Access open();
+
+		virtual void close();
+
+		///reads the start of the file; deflated entries are inflated only as far as needed
+		virtual int readHead( byte* buf, int number );
+
+		virtual long getSize();
+
+		virtual const byte* getData();
+
+		virtual Access getAccess();
+
+		virtual long getCurrentPosition();
+
+		virtual int seek( long offset, int fromWhere = SEEK_SET );
+
+		virtual int read( byte* buf, int number );
+
+		///creates a new unopened stream on the same data, sharing the mapping
+		virtual Stream* copy();
+
+	protected:
+
+		Shared< MappedFile > mSource;
+		size_t mOffset, mStoredSize, mSize;
+		Compression mCompression;
+
+		std::vector< byte > mInflated;
+		const byte* pData;
+		long mPosition;
+
+		Access mAccess;
+
+		bool _inflate( const byte* src );
+	};
+}
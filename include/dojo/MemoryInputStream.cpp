@@ -27,6 +27,10 @@ long MemoryInputStream::getSize() {
 	return mSize;
 }
 
+const byte* MemoryInputStream::getData() {
+	return pMem;
+}
+
 MemoryInputStream::Access MemoryInputStream::getAccess() {
 	return SA_READONLY;
 }
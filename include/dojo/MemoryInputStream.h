@@ -19,6 +19,9 @@ namespace Dojo
 		///returns the total bytes in the stream, -1 if this stream has no end
 		virtual long getSize();
 
+		///returns the memory area
+		virtual const byte* getData();
+
 		///returns the kind of access this stream provides, ie. read-only
 		virtual Access getAccess();
 
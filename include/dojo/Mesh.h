@@ -15,12 +15,14 @@
 #include "Vector.h"
 #include "VertexField.h"
 #include "TriangleMode.h"
+#include "MeshFile.h"
 
 namespace Dojo
 {
 	class Color;
 	class ResourceGroup;
 	class Shader;
+	class FileStream;
 
 	///A Mesh is the only primitive Dojo can render.
 	/**
@@ -31,28 +33,83 @@ namespace Dojo
 
 	After a Vertex Format has been defined, a Mesh can be procedurally generated by calling the vertex() method which adds a new vertex,
 	and specifying vertex features using color(), normal() and uv() methods.
+	Many vertices can also be added at once with appendVertices() and written in place through the FieldSpans returned by getFieldSpan(),
+	and many indices with appendIndices().
 
 	Calling end() is required before the mesh can be used, so that its data is loaded to the GPU.
+
+	Meshes can also be loaded from .mesh files, see MeshFile; the "meshLOD" user configuration value chooses the LOD
+	that is loaded from files that have more than one.
 	*/
 	class Mesh : public Resource
 	{
+		friend class MeshFile;
+
 	public:
 		typedef unsigned int IndexType;
 
 		static const int VERTEX_PAGE_SIZE = 256;
 		static const int INDEX_PAGE_SIZE = 256;
 
+		///meshes with this many vertices or less keep their CPU-side data after end(), so that the Renderer can batch them
+		static const int BATCHABLE_VERTEX_MAX = 64;
+
 		static const int VERTEX_FIELD_SIZES[];
 
+		///returns the bytes taken by the field f stored in the given format
+		static int getVertexFieldSize( VertexField f, VertexFieldFormat format );
+
+		///returns true if the GL context can read VertexFieldFormat::Int2_10_10_10 normals
+		/**
+		needs DOJO_PACKED_NORMALS_AVAILABLE, and GL 3.3 or ARB_vertex_type_2_10_10_10_rev at runtime
+		*/
+		static bool arePackedNormalsAvailable();
+
+		///A typed view over one VertexField of a range of vertices, which steps over the other fields of the interleaved format
+		/**
+		\remark it is invalidated by adding more vertices to the Mesh
+		*/
+		template< typename T >
+		class FieldSpan
+		{
+		public:
+			FieldSpan( byte* first, int stride, IndexType count ) :
+				pFirst( first ),
+				mStride( stride ),
+				mCount( count )
+			{
+
+			}
+
+			T& operator[]( IndexType i )
+			{
+				DEBUG_ASSERT( i < mCount, "The vertex is out of the span" );
+				return *(T*)( pFirst + i * mStride );
+			}
+
+			IndexType size() const
+			{
+				return mCount;
+			}
+
+		protected:
+			byte* pFirst;
+			int mStride;
+			IndexType mCount;
+		};
+
 		///Creates a new empty Mesh
 		Mesh( ResourceGroup* creator = NULL );
 
 		///Creates a new Mesh bound to the file at filePath
-		Mesh( ResourceGroup* creator, const String& filePath );
+		/**
+		\param subMesh the sub-mesh of the file to load, or the first one when empty
+		*/
+		Mesh( ResourceGroup* creator, const String& filePath, const String& subMesh = String::EMPTY );
 
 		virtual ~Mesh();
 
-		///frees all CPU-side memory (done automatically on static meshes)
+		///frees all CPU-side memory (done automatically on static meshes too big to be batched)
 		void destroyBuffers();
 
 		///sets the dimension of a single index in this mesh
@@ -68,13 +125,33 @@ namespace Dojo
 		void setVertexFields(const std::initializer_list<VertexField>& fs);
 
 		///A dynamic mesh set as dynamic won't clear its CPU cache when loaded, allowing for quick editing
+		/**
+		when a dynamic mesh is updated, only the vertices and indices that changed are uploaded
+		*/
 		void setDynamic( bool d);
 
+		///A streaming mesh is a dynamic mesh that is rebuilt every frame
+		/**
+		its buffers are orphaned at each end(), so that the GPU can keep reading the previous frame's data without stalling the upload
+		*/
+		void setStreaming( bool s );
+
+		bool isDynamic() const
+		{
+			return dynamic;
+		}
+
+		bool isStreaming() const
+		{
+			return streaming;
+		}
+
 		///Sets the primitive for the rendering of this mesh
 		void setTriangleMode( TriangleMode m )	{	triangleMode = m;	}
 
-		TriangleMode getTriangleMode()	{	return triangleMode;	}
+		TriangleMode getTriangleMode() const	{	return triangleMode;	}
 
+		///the bounds of the vertices, updated by end()
 		const Vector& getMax()
 		{
 			return max;
@@ -103,9 +180,10 @@ namespace Dojo
 
 		///begins editing this mesh. Vertex Fields have to be set at this point
 		/**
-		\param extimatedVertes number of vertices that have to be reserved
+		\param extimatedVerts number of vertices that have to be reserved
+		\param extimatedIndices number of indices that have to be reserved
 		*/
-		void begin( int extimatedVerts = 1 );
+		void begin( int extimatedVerts = 1, int extimatedIndices = 0 );
 
 		///starts editing a dynamic mesh that was already begin'd and end'ed
 		/**
@@ -113,6 +191,32 @@ namespace Dojo
 		*/
 		void beginAppend();
 
+		///reserves memory for more vertices and indices, so that adding them doesn't reallocate the buffers
+		void reserve( IndexType additionalVertices, int additionalIndices = 0 );
+
+		///adds count vertices with undefined contents, and returns the index of the first one
+		/**
+		the new vertices are meant to be written with getFieldSpan()
+		*/
+		IndexType appendVertices( IndexType count );
+
+		///returns a view of the field f of count vertices starting from first
+		/**
+		the vertices are assumed to be modified and will be uploaded by the next end().
+		T must match the layout of the field, eg. glm::vec2 for Position2D and UVs, Vector for Position3D and Normal, Color::RGBAPixel for Color
+		*/
+		template< typename T >
+		FieldSpan< T > getFieldSpan( VertexField f, IndexType first, IndexType count )
+		{
+			DEBUG_ASSERT( !compressed, "getFieldSpan: the vertices of a compressed Mesh can't be edited" );
+			DEBUG_ASSERT( isVertexFieldEnabled( f ), "getFieldSpan: the field is not enabled" );
+			DEBUG_ASSERT( sizeof( T ) <= (size_t)getVertexFieldSize( f, getVertexFieldFormat( f ) ), "getFieldSpan: the type is larger than the field" );
+			DEBUG_ASSERT( first + count <= getVertexCount(), "getFieldSpan: the vertices are out of bounds" );
+
+			_markVerticesDirty( first, count );
+			return FieldSpan< T >( vertices.data() + first * vertexSize + _offset( f ), vertexSize, count );
+		}
+
 		///adds a vertex at the given position
 		int vertex( float x, float y );
 
@@ -143,6 +247,9 @@ namespace Dojo
 		///adds one index
 		void index(IndexType idx);
 
+		///adds count indices, offsetting each one by base
+		void appendIndices(const IndexType* src, int count, IndexType base = 0);
+
 		///adds 3 clockwise indices to make a triangle
 		void triangle(unsigned int i1, unsigned int i2, unsigned int i3)
 		{
@@ -158,17 +265,58 @@ namespace Dojo
 			triangle(i21,i22,i12);
 		}
 
+		///rearranges the mesh being edited so that it is cheaper to draw, without changing what is drawn
+		/**
+		-welds the vertices with exactly the same contents
+		-reorders the triangles for the post-transform vertex cache, converting strips to lists when it saves bandwidth
+		-reorders the vertices in the order they are used, removing the unused ones
+		-picks the narrowest index size that can address the remaining vertices
+
+		Meshes loaded from file are optimized when the "optimizeMeshes" user configuration flag is set.
+		\remark the vertex indices change, so this must be called before any code relying on them
+		*/
+		void optimize();
+
+		///stores the vertices of the mesh being edited in less memory, converting the fields to the given formats
+		/**
+		passing VertexFieldFormat::Default leaves a field as it is; UV sets with coordinates outside [0,1] are left as floats.
+		Positions are scaled to fit the bounds of the mesh, and the Renderer applies getPositionDecodeTransform() before the world transform;
+		the scale is the same on all the axes, so that shaders can still transform normals with the world matrix.
+
+		After this the vertices can't be edited anymore, and the mesh can't be batched.
+		Meshes loaded from file are compressed when the "compressMeshes" user configuration flag is set.
+		Int2_10_10_10 normals are stored as Byte when arePackedNormalsAvailable() is false.
+		\remark needs DOJO_SHADERS_AVAILABLE, as the fixed function pipeline doesn't normalize integer positions
+		*/
+		void compress( VertexFieldFormat positionFormat = VertexFieldFormat::Short, VertexFieldFormat normalFormat = VertexFieldFormat::Byte, VertexFieldFormat uvFormat = VertexFieldFormat::Short );
+
+		bool isCompressed() const
+		{
+			return compressed;
+		}
+
+		bool hasCompressedPositions() const
+		{
+			return getVertexFieldFormat( isVertexFieldEnabled( VertexField::Position3D ) ? VertexField::Position3D : VertexField::Position2D ) != VertexFieldFormat::Default;
+		}
+
+		///returns the transform from the stored positions to the model space, which is the identity unless the positions are compressed
+		Matrix getPositionDecodeTransform() const;
+
 		///loads the data on the device
 		/**
 		-will discard all the data if the buffer is static
-		-if the buffer is dynamic, this can be called again to update device data
+		-if the buffer is dynamic, this can be called again to update device data, and only the changed ranges are uploaded
 		*/
 		bool end();
 
 		//Removes the given vertices from the mesh
 		void cutSection(IndexType i1, IndexType i2);
 
-		///loads the whole file passed in the constructor
+		///reads the file passed in the constructor, and optimizes and compresses it if the user configuration asks to
+		virtual void onPrepare();
+
+		///loads the file passed in the constructor, uploading the data of .mesh v2 files straight from the mapped file when possible
 		virtual bool onLoad();
 
 		virtual void onUnload( bool soft = false );
@@ -186,11 +334,16 @@ namespace Dojo
 			return indexGLType;
 		}
 
-		bool isVertexFieldEnabled( VertexField f )
+		bool isVertexFieldEnabled( VertexField f ) const
 		{
 			return vertexFieldOffset[(unsigned char)f] != 0xff;
 		}
 
+		VertexFieldFormat getVertexFieldFormat( VertexField f ) const
+		{
+			return vertexFieldFormat[(unsigned char)f];
+		}
+
 		IndexType getVertexCount() const
 		{
 			return vertexCount;
@@ -204,6 +357,7 @@ namespace Dojo
 		///returns the total triangle count in this mesh
 		int getPrimitiveCount() const;
 
+		///returns the position of a vertex, which is assumed to be modified and will be uploaded by the next end()
 		Vector& getVertex(int idx);
 
 		IndexType getIndex(int idxidx) const;
@@ -212,6 +366,25 @@ namespace Dojo
 
 		void setIndex(int idxidx, IndexType idx);
 
+		///returns true if the Renderer can merge this mesh in a batch with other meshes
+		bool isBatchable() const
+		{
+			return vertexCount <= BATCHABLE_VERTEX_MAX && !vertices.empty() && !editing && !compressed;
+		}
+
+		///returns true if m has the same vertex fields of this mesh, in the same order
+		bool hasSameVertexFormat( const Mesh& m ) const;
+
+		///appends the vertices and the primitives of m, transforming them with transform and multiplying their color by tint
+		/**
+		\remark this mesh must be editing, it must have both the Position3D and the Color fields,
+		and its TriangleMode must be getListTriangleMode( m.getTriangleMode() )
+		*/
+		void appendTransformedMesh( const Mesh& m, const Matrix& transform, const Color& tint );
+
+		///returns the "list" TriangleMode that draws the same primitives of mode as disjoint primitives
+		static TriangleMode getListTriangleMode( TriangleMode mode );
+
 		///Creates a new empty mesh with the same format of this one
 		Unique<Mesh> cloneWithSameFormat() const;
 
@@ -219,35 +392,127 @@ namespace Dojo
 		Unique<Mesh> cloneFromSlice(IndexType vertexStart, IndexType vertexEnd, const Vector& offset = Vector::ZERO) const;
 
 	protected:
+		///a range of bytes of a CPU-side buffer that changed since the last upload
+		struct DirtyRange
+		{
+			size_t start = SIZE_MAX, end = 0;
+
+			void add( size_t s, size_t e )
+			{
+				start = std::min( start, s );
+				end = std::max( end, e );
+			}
+
+			bool empty() const
+			{
+				return start >= end;
+			}
+
+			void clear()
+			{
+				start = SIZE_MAX;
+				end = 0;
+			}
+		};
+
 		Vector max, min, center, dimensions;
 
 		int vertexSize = 0;
 		byte* currentVertex = nullptr;
 		std::vector<byte> vertices;
 
+		//the vertices already accounted for in max and min
+		IndexType boundsVertexCount = 0;
+
 		byte indexSize = 0;
 		IndexType indexMaxValue = 0;
 		GLenum indexGLType = 0;
 		std::vector<byte> indices;//indices have varying size
 
 		GLuint vertexArrayDesc = 0;
+		bool vertexArrayDirty = false;
 		GLuint vertexHandle = 0, indexHandle = 0;
 
+		//the bytes allocated in the GPU buffers, which are grown geometrically for dynamic meshes
+		GLsizeiptr vertexCapacity = 0, indexCapacity = 0;
+		DirtyRange vertexDirty, indexDirty;
+
 		int vertexCount = 0, indexCount = 0;
 
 		byte vertexFieldOffset[ (int)VertexField::_Count ];
+		VertexFieldFormat vertexFieldFormat[ (int)VertexField::_Count ];
+
+		//compressed positions are stored as (position - positionOffset) / positionScale
+		bool compressed = false;
+		Vector positionOffset;
+		float positionScale = 1.f;
 
 		TriangleMode triangleMode = TriangleMode::TriangleStrip;
 
 		bool dynamic = false;
+		bool streaming = false;
 		bool editing = false;
 
-		void _prepareVertex(const Vector& v);
+		String mSubMesh;
+
+		//the file read by onPrepare(), waiting for onLoad()
+		Unique< FileStream > mPreparedFile;
+		//the copy of the file when it can't be read in place
+		std::vector< byte > mPreparedCopy;
+		//the data that goes straight from the file to the GPU, when it isn't copied to vertices and indices
+		const byte* mPreparedVertices = nullptr;
+		const byte* mPreparedIndices = nullptr;
+		GLsizeiptr mPreparedVertexBytes = 0, mPreparedIndexBytes = 0;
+		bool mPrepared = false;
+
+		void _prepareVertex();
+
+		void _setIndexByteSize( byte bytenumber );
+
+		///extends max and min to contain the vertices added since the last update
+		void _updateBounds();
+
+		void _markVerticesDirty( IndexType first, IndexType count )
+		{
+			vertexDirty.add( first * vertexSize, ( first + count ) * vertexSize );
+		}
+
+		void _markIndicesDirty( int first, int count )
+		{
+			indexDirty.add( first * indexSize, ( first + count ) * indexSize );
+		}
+
+		///creates the GPU buffers if needed and uploads the given data to them
+		bool _upload( const byte* vertexData, GLsizeiptr vertexBytes, const byte* indexData, GLsizeiptr indexBytes );
+
+		///uploads data to the buffer bound to target, or just its dirty range when possible
+		void _uploadBuffer( GLenum target, const byte* data, GLsizeiptr size, GLsizeiptr& capacity, DirtyRange& dirty );
+
+		///opens and reads the file passed in the constructor, leaving the data ready for the upload
+		/**
+		\remark doesn't use the GL, so that it can run in onPrepare()
+		*/
+		bool _read();
+
+		///releases the file and the data kept by _read()
+		void _releasePrepared();
+
+		///loads a file in the format written by the old Java OBJCooker
+		bool _loadLegacy( const byte* data, size_t size );
+
+		///loads a section of a .mesh v2 file
+		bool _loadSection( const MeshFile::Section& section, const byte* data );
+
+		///optimizes and compresses the loaded data as requested by the user configuration
+		void _process( bool optimized );
 
 		///returns low level binding informations about a vertex field
 		void _getVertexFieldData( VertexField field, int& outComponents, GLenum& outComponentsType, bool& outNormalized, void*& outOffset );
 
 		///binds the attribute arrays and the Buffer Objects required to render the mesh
+		/**
+		\remark with shaders, the attributes go to the fixed locations given by Shader::getBuiltInAttributeLocation
+		*/
 		void _bindAttribArrays( Shader* shader );
 
 		byte& _offset(VertexField f);
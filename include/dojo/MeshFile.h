@@ -0,0 +1,127 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+namespace Dojo
+{
+	class Mesh;
+	class FileStream;
+
+	///MeshFile describes the binary .mesh format, version 2, and builds new .mesh files
+	/**
+	a .mesh file starts with a Header, followed by a table of Sections and by the vertex and index data of each Section.
+	Each Section holds one LOD of a named sub-mesh, already in the layout that is uploaded to the GPU, so that
+	a Mesh is loaded by mapping the file and passing the data straight to glBufferData.
+
+	All the values are little endian, every structure is naturally aligned and the data blocks are aligned to DATA_ALIGNMENT.
+	The checksum is the CRC-32 of everything after the Header, and is verified only in debug builds.
+	*/
+	class MeshFile
+	{
+	public:
+
+		static const uint32_t MAGIC = 0x48534d44; //"DMSH"
+		static const uint16_t VERSION = 2;
+
+		///written as is, so that files written on a big endian machine can be rejected
+		static const uint16_t BYTE_ORDER_MARK = 0xfeff;
+
+		static const size_t DATA_ALIGNMENT = 16;
+
+		///the VertexFields that a file can describe, so that the layout doesn't depend on DOJO_MAX_TEXTURE_COORDS
+		static const int MAX_FIELDS = 16;
+		static const int MAX_NAME_LENGTH = 32;
+
+		enum SectionFlags
+		{
+			SF_OPTIMIZED = 1 << 0, ///<the section was processed with Mesh::optimize()
+			SF_COMPRESSED = 1 << 1 ///<the section was processed with Mesh::compress()
+		};
+
+		struct Header
+		{
+			uint32_t magic;
+			uint16_t version;
+			uint16_t byteOrder;
+			uint32_t fileSize;
+			uint32_t sectionCount;
+			uint32_t checksum;
+			uint32_t reserved[ 3 ];
+		};
+
+		struct Section
+		{
+			char name[ MAX_NAME_LENGTH ]; ///<the sub-mesh, zero terminated
+			uint32_t lod; ///<0 is the most detailed
+			uint32_t flags;
+
+			uint8_t triangleMode;
+			uint8_t indexSize;
+			uint8_t reserved0[ 2 ];
+
+			uint8_t fieldOffset[ MAX_FIELDS ]; ///<0xff when the field is disabled
+			uint8_t fieldFormat[ MAX_FIELDS ];
+
+			uint32_t vertexSize, vertexCount, indexCount;
+
+			float min[ 3 ], max[ 3 ];
+
+			float positionOffset[ 3 ]; ///<the decode values of compressed positions
+			float positionScale;
+
+			uint32_t vertexDataOffset, indexDataOffset; ///<from the start of the file
+
+			uint32_t reserved1[ 2 ];
+		};
+
+		///returns true if data is aligned enough for getHeader() to read the Header and the Sections in place
+		/**
+		a loose file is mapped at a page boundary, but a file stored in an archive can start at any offset
+		*/
+		static bool isAligned( const byte* data )
+		{
+			return ( (uintptr_t)data % alignof( Section ) ) == 0;
+		}
+
+		///returns the header of the .mesh v2 file in data, or nullptr if data isn't one, is damaged or is not aligned, see isAligned()
+		static const Header* getHeader( const byte* data, size_t size );
+
+		static const Section* getSections( const Header& header )
+		{
+			return (const Section*)( &header + 1 );
+		}
+
+		///returns the section holding subMesh at the given lod, or at the closest lod in the file preferring the more detailed ones; nullptr if subMesh isn't in the file
+		/**
+		an empty subMesh finds the first sub-mesh in the file
+		*/
+		static const Section* findSection( const Header& header, const String& subMesh, int lod );
+
+		///appends the names of the sub-meshes in the file to out, in the order they were added
+		/**
+		only the Header and the Section table are read, and the data isn't checked; the file must not be open
+		\returns false if file is not a .mesh v2 file
+		*/
+		static bool readSubMeshNames( FileStream& file, std::vector< String >& out );
+
+		///adds a copy of the data of mesh as the given LOD of subMesh
+		/**
+		\param optimized tells that mesh went through Mesh::optimize(), so that it isn't optimized again when loaded
+		\remark the mesh must still be in edit mode, so that its data is on the CPU
+		*/
+		void addSection( Mesh& mesh, const String& subMesh, int lod = 0, bool optimized = false );
+
+		///lays out the sections added so far as a .mesh file
+		std::vector< byte > serialize() const;
+
+	protected:
+
+		struct Entry
+		{
+			Section section;
+			std::vector< byte > vertices, indices;
+		};
+
+		std::vector< Entry > mEntries;
+	};
+}
@@ -53,8 +53,33 @@ namespace Dojo {
 		virtual void reset();
 		
 		//forces an update of the world transform
+		/**
+		\remark onAction only updates it when position, scale, rotation or the parent's transform changed,
+		so call this after changing inheritScale or after moving a static Object
+		*/
 		void updateWorldTransform();
 
+		///a static Object doesn't update its world transform and AABB in onAction, saving their per-frame cost
+		/**
+		use it for scenery that doesn't move after being placed; the children are still updated.
+		The world transform is still computed in the first onAction, and whenever the local transform is explicitly changed
+		*/
+		void setStatic( bool s )				{	mStatic = s;	}
+
+		bool isStatic() const					{	return mStatic;	}
+
+		///an independent child of a GameState is updated on a worker thread, in parallel with the other independent ones
+		/**
+		its onAction subtree must only change itself: anything that touches the Renderer, the GameState or other Objects
+		has to be deferred with GameState::runSerially()
+		*/
+		void setIndependent( bool i )			{	mIndependent = i;	}
+
+		bool isIndependent() const				{	return mIndependent;	}
+
+		///returns a number that changes each time the world transform of this Object changes
+		unsigned int getTransformVersion() const	{	return mTransformVersion;	}
+
 		///sets a AABB size
 		void setSize( const Vector& bbSize )
 		{
@@ -74,6 +99,7 @@ namespace Dojo {
 		void setRotation( const Quaternion& quat )
 		{
 			rotation = quat;
+			mLocalTransformDirty = true;
 		}
 
 		///sets the rotation around the Z axis (2D rotation) for this object
@@ -83,6 +109,7 @@ namespace Dojo {
 		void rotate( float r, const Vector& axis = Vector::UNIT_Z )
 		{
 			rotation = glm::rotate( rotation, r, axis );
+			mLocalTransformDirty = true;
 		}
 		
 		///sets the full orientation using a vector made of radians around x,y,z
@@ -199,6 +226,7 @@ namespace Dojo {
 		void _notifyParent( Object* p )
 		{
 			parent = p;
+			mLocalTransformDirty = true;
 		}
 				
 	protected:		
@@ -215,11 +243,45 @@ namespace Dojo {
 				
 		bool active;
 
+		bool mStatic, mLocalTransformDirty, mIndependent;
+
+		//what the world transform was last computed from
+		Vector mLastPosition, mLastScale;
+		unsigned int mTransformVersion, mParentTransformVersion;
+
+		//the local AABB that the world AABB was last computed from
+		Vector mLocalAABBMin, mLocalAABBMax;
+
 		Object* parent;
 		ChildList childs;
 		
 		void _updateWorldAABB( const Vector& min, const Vector& max );
 
+		///returns the local space AABB that the world AABB is computed from
+		virtual void _getLocalAABB( Vector& min, Vector& max ) const
+		{
+			min = -halfSize;
+			max = halfSize;
+		}
+
+		///recomputes the world AABB if forced or if the local AABB changed
+		void _refreshWorldAABB( bool force );
+
+		///returns true if the world transform needs to be recomputed
+		bool _isTransformDirty() const
+		{
+			return mLocalTransformDirty || 
+				position != mLastPosition || 
+				scale != mLastScale || 
+				(parent && parent->mTransformVersion != mParentTransformVersion);
+		}
+
+		///called when _updateWorldAABB changes the world AABB
+		virtual void _onWorldAABBChanged()
+		{
+
+		}
+
 		Object& _addChild(Unique<Object> o);
 		Renderable& _addChild(Unique<Renderable> o, int layer);
 
@@ -15,6 +15,8 @@ namespace Dojo
 	class ApplicationListener;
 	class FileStream;
 	class BackgroundQueue;
+	class Profiler;
+	class ZipArchive;
 	
 	///Platform is the base of the engine; it runs the main loop, creates the windows and updates the Game
 	/** the Platform is the first object to be initialized in a Dojo game, using the static method Platform::create() */
@@ -65,6 +67,9 @@ namespace Dojo
 		///returns the system Log
 		Log& getLog()						{	return *mLog;	}
 
+		///returns the Profiler, which is disabled until it's needed
+		Profiler& getProfiler()				{	return *mProfiler;	}
+
 		///returns the default BackgroundQueue
 		BackgroundQueue* getBackgroundQueue()	{	return mBackgroundQueue;	}
 
@@ -172,10 +177,26 @@ namespace Dojo
 		}
 
 		///creates a new FileStream object for the given path, but does not open it
+		/**
+		the path can point to a loose file, to a file inside an archive (eg. "data.dpk/textures/hero.png") or to a file
+		provided by a mounted archive; the stream is read-only and memory-mapped.
+		*/
 		FilePtr getFile( const String& path );
 
 		///loads the whole file allocating a new buffer
 		int loadFileContent( char*& bufptr, const String& path );
+
+		///mounts the archive at archivePath over the folder mountPoint, so that its files are found as if they were in that folder
+		/**
+		the files in the archive hide the loose files with the same path and the files of the archives mounted with a lower priority,
+		eg. "patch.dpk" can be mounted with priority 1 over a "data.dpk" mounted with priority 0 to replace some of its files.
+		Both paths can be absolute or relative to the resources path, an empty mountPoint means the resources path itself.
+		\returns false if the archive couldn't be opened
+		*/
+		bool mountArchive( const String& archivePath, const String& mountPoint = String::EMPTY, int priority = 0 );
+
+		///removes all the mount points of the archive at archivePath
+		void unmountArchive( const String& archivePath );
 				
 		///discovers all the files with an extension in a folder
 		/**\param type type extension, es "png"
@@ -219,6 +240,14 @@ namespace Dojo
 		typedef std::vector< String > PathList;
 		typedef std::unordered_map< String, PathList > ZipFoldersMap;
 		typedef std::unordered_map< String, ZipFoldersMap > ZipFileMapping;
+		typedef std::unordered_map< String, Shared< ZipArchive > > ArchiveMap;
+
+		struct MountPoint
+		{
+			String path;
+			Shared< ZipArchive > archive;
+			int priority;
+		};
 
 		static Unique<Platform> singletonPtr;
 		
@@ -241,6 +270,7 @@ namespace Dojo
 		float realFrameTime;
 
 		Log* mLog;
+		Profiler* mProfiler;
 		BackgroundQueue* mBackgroundQueue;
 
 		Array< ApplicationListener* > focusListeners;
@@ -249,6 +279,13 @@ namespace Dojo
 		ZipFileMapping mZipFileMaps;
 		ZipExtensionList mZipExtensions;
 
+		///the archives opened so far, kept mapped for the next files
+		ArchiveMap mArchives;
+		///the mount points, by decreasing priority
+		std::vector< MountPoint > mMountPoints;
+		///guards the archives, the mount points and the zip maps, as files are opened from the loading threads too
+		std::mutex mArchivesMutex;
+
 		String _getTablePath( const String& absPathOrName );
 
 		///for each component in the path, check if a directory.zip file exists
@@ -256,6 +293,15 @@ namespace Dojo
 
 		const ZipFoldersMap& _getZipFileMap( const String& path, String& zipPath, String& reminder );
 
+		///returns the files of the archive at zipPath grouped by their folder, mArchivesMutex must be locked
+		const ZipFoldersMap& _getZipFolders( const String& zipPath );
+
+		///returns the archive at path opening it if needed, or nullptr if it isn't a valid archive; mArchivesMutex must be locked
+		Shared< ZipArchive > _getArchive( const String& path );
+
+		///returns the path made absolute with respect to the resources path
+		String _getAbsolutePath( const String& path );
+
 		int _findZipExtension( const String & path );
 
 		///protected singleton constructor
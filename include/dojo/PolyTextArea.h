@@ -73,13 +73,7 @@ namespace Dojo
 			return mInterline;
 		}
 
-		virtual void onAction( float dt )
-		{
-			if( mDirty )
-				_prepare();
-
-			Renderable::onAction(dt);
-		}
+		virtual void onAction( float dt );
 
 	protected:
 
@@ -104,6 +98,9 @@ namespace Dojo
 		void _tesselateExtrusionStrip( Tessellation* t, int layerAbaseIdx, int layerBbaseIdx );
 		void _addExtrusionLayer( Tessellation* t, const Vector& origin, float inflate, const Vector* forcedNormal = NULL );
 
+		void _addPositions( Tessellation* t, const Vector& origin );
+		void _addIndices( const std::vector< int >& indices, int baseIdx );
+
 	private:
 	};
 }
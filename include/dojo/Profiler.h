@@ -0,0 +1,253 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+namespace Dojo
+{
+	class Profiler;
+
+	///the Profiler created by the Platform
+	extern Profiler* gp_profiler;
+
+	///The Profiler measures where the time of each frame goes, on all the threads and on the GPU
+	/**
+	the time is measured in zones, which are scopes marked with DOJO_PROFILE_ZONE( "name" ), or with DOJO_PROFILE_GPU_ZONE( "name" )
+	to also time the GL commands issued in the scope with timestamp queries.
+
+	When enabled, the Profiler sums the time spent in each zone of the main thread and of the GPU during a frame, see getLastFrameStats().
+	During a capture it also records each zone of each thread in a buffer that only that thread writes, and the capture can be saved
+	as a Chrome trace to be opened in chrome://tracing.
+	When disabled, a zone only costs a check.
+
+	\remark the zone names are compared and stored by pointer, so they have to be literals or intern()ed
+	*/
+	class Profiler
+	{
+	public:
+
+		///the frames that the GPU timings are read after, so that reading them doesn't stall
+		static const int GPU_FRAME_LATENCY = 3;
+
+		///a CPU zone that lasts as long as this object
+		class Zone
+		{
+		public:
+			Zone( const char* name ) :
+				mName( nullptr )
+			{
+				if( gp_profiler && gp_profiler->isEnabled() )
+				{
+					mName = name;
+					mStart = gp_profiler->_beginZone( name );
+				}
+			}
+
+			~Zone()
+			{
+				if( mName )
+					gp_profiler->_endZone( mName, mStart );
+			}
+
+		protected:
+			const char* mName;
+			double mStart;
+		};
+
+		///a zone that also times the GL commands issued while it exists
+		/**
+		\remark only use it on the main thread
+		*/
+		class GPUZone : public Zone
+		{
+		public:
+			GPUZone( const char* name ) :
+				Zone( name ),
+				mQuery( mName ? gp_profiler->_beginGPUZone( name ) : -1 )
+			{
+
+			}
+
+			~GPUZone()
+			{
+				if( mQuery >= 0 )
+					gp_profiler->_endGPUZone( mQuery );
+			}
+
+		protected:
+			int mQuery;
+		};
+
+		///the time spent in a zone during a frame
+		struct ZoneStats
+		{
+			const char* name;
+			double time;
+			int calls, depth;
+			bool gpu;
+		};
+
+		typedef std::vector< ZoneStats > StatsList;
+
+		///creates a disabled Profiler; the thread that creates it is the main thread
+		Profiler( int eventsPerThread = DOJO_PROFILER_EVENTS_PER_THREAD );
+
+		~Profiler();
+
+		void setEnabled( bool enabled );
+
+		bool isEnabled() const
+		{
+			return mEnabled.load( std::memory_order_relaxed );
+		}
+
+		///starts recording the zones of all the threads, enabling the Profiler if needed
+		void beginCapture();
+
+		///stops recording, the capture can then be saved
+		void endCapture();
+
+		bool isCapturing() const
+		{
+			return mCapturing.load( std::memory_order_relaxed );
+		}
+
+		///captures the next "frames" frames and saves the capture to path
+		void captureFrames( int frames, const String& path );
+
+		///saves the last capture to path in the Chrome trace JSON format
+		bool saveCapture( const String& path );
+
+		///returns the time spent in each zone of the main thread and of the GPU in the last frame, in order of appearance
+		/**
+		the GPU times belong to a frame that ended GPU_FRAME_LATENCY frames ago
+		*/
+		const StatsList& getLastFrameStats() const
+		{
+			return mLastFrameStats;
+		}
+
+		///returns the last frame's stats as text, one zone per line
+		String getSummary() const;
+
+		///returns a copy of name that lives as long as the Profiler, to be used as a zone name
+		const char* intern( const std::string& name );
+
+		///internal - closes the frame stats and reads the GPU timings that are ready, called by the Platform at the end of each frame
+		void _endFrame();
+
+		double _beginZone( const char* name );
+		void _endZone( const char* name, double start );
+
+		int _beginGPUZone( const char* name );
+		void _endGPUZone( int query );
+
+	protected:
+
+		struct Event
+		{
+			const char* name;
+			double start, end;
+		};
+
+		///the events of a thread, written only by that thread; count tells the others how many events are complete
+		struct ThreadBuffer
+		{
+			int index;
+			int depth;
+
+			std::vector< Event > events;
+			std::atomic< int > count;
+
+			//the capture that the events belong to
+			std::atomic< int > captureID;
+
+			ThreadBuffer( int idx ) :
+				index( idx ),
+				depth( 0 ),
+				count( 0 ),
+				captureID( -1 )
+			{
+
+			}
+		};
+
+		struct GPUQuery
+		{
+			const char* name;
+			int begin, end;
+			int depth;
+		};
+
+		struct GPUFrame
+		{
+			std::vector< GLuint > queries;
+			int usedQueries;
+
+			std::vector< GPUQuery > zones;
+
+			//the zones were issued during a capture
+			bool captured;
+
+			GPUFrame() :
+				usedQueries( 0 ),
+				captured( false )
+			{
+
+			}
+		};
+
+		std::atomic< bool > mEnabled, mCapturing;
+		std::thread::id mMainThreadID;
+
+		int mEventsPerThread;
+
+		std::mutex mThreadsMutex;
+		std::vector< Unique< ThreadBuffer > > mThreads;
+
+		std::atomic< int > mCaptureID;
+		double mCaptureStart;
+		int mCaptureFramesLeft, mSaveCountdown;
+		String mCapturePath;
+
+		StatsList mFrameStats, mLastFrameStats, mGPUStats;
+
+		bool mGPUTimersChecked, mGPUTimersAvailable;
+		GPUFrame mGPUFrames[ GPU_FRAME_LATENCY ];
+		int mGPUFrame;
+		double mGPUTimeOffset;
+		std::vector< Event > mGPUEvents;
+
+		std::mutex mNamesMutex;
+		std::unordered_set< std::string > mNames;
+
+		///returns the buffer of the calling thread, creating it the first time
+		ThreadBuffer& _getThreadBuffer();
+
+		void _addStats( StatsList& stats, const char* name, double time, int depth, bool gpu, int calls );
+
+		///finds out if the GPU timers are supported the first time they are used, when there is a GL context
+		void _checkGPUTimers();
+
+		///measures the offset between the GPU and the CPU clocks
+		void _calibrateGPUTime();
+
+		///returns the index of a free query of the frame
+		int _nextQuery( GPUFrame& frame );
+
+		///reads the zones of the oldest GPU frame if the GPU is done with them
+		void _readGPUFrame( GPUFrame& frame );
+
+	private:
+	};
+}
+
+#ifdef DOJO_PROFILER_ENABLED
+	#define _DOJO_PROFILE_CONCAT_IMPL( A, B ) A##B
+	#define _DOJO_PROFILE_CONCAT( A, B ) _DOJO_PROFILE_CONCAT_IMPL( A, B )
+
+	#define DOJO_PROFILE_ZONE( NAME ) Dojo::Profiler::Zone _DOJO_PROFILE_CONCAT( _profileZone, __LINE__ )( NAME )
+	#define DOJO_PROFILE_GPU_ZONE( NAME ) Dojo::Profiler::GPUZone _DOJO_PROFILE_CONCAT( _profileZone, __LINE__ )( NAME )
+#else
+	#define DOJO_PROFILE_ZONE( NAME )
+	#define DOJO_PROFILE_GPU_ZONE( NAME )
+#endif
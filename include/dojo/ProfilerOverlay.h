@@ -0,0 +1,25 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "TextArea.h"
+
+namespace Dojo
+{
+	///A ProfilerOverlay is a TextArea that shows the last frame's Profiler zones and Renderer counters on screen
+	class ProfilerOverlay : public TextArea
+	{
+	public:
+
+		///creates a new ProfilerOverlay that refreshes its text every refreshPeriod seconds, and enables the Profiler
+		ProfilerOverlay( Object* parent, const String& fontSetName, const Vector& pos, float refreshPeriod = 0.5f );
+
+		virtual void onAction( float dt );
+
+	protected:
+
+		float mRefreshPeriod, mElapsed;
+
+		void _refresh();
+	};
+}
@@ -6,6 +6,7 @@
 
 namespace Dojo {
 	class Renderable;
+	class SpatialIndex;
 
 	class RenderLayer
 	{
@@ -18,7 +19,19 @@ namespace Dojo {
 			depthClear = true,
 			wireframe = false;
 
+		///if true, the Renderer is free to reorder the elements of this layer to save state changes
+		/**
+		\remark on layers with depthCheck the opaque elements are always sorted and drawn first
+		*/
+		bool orderIndependent = false;
+
 		SmallSet<Renderable*> elements;
+
+		///the index used to cull the elements, owned by the Renderer (see Renderer::setSpatialIndexEnabled)
+		SpatialIndex* spatialIndex = nullptr;
+
+		///the name of this layer's zone in the Profiler
+		const char* profileName = "Layer";
 	};
 }
 
@@ -159,14 +159,46 @@ namespace Dojo
 		}
 
 		bool isAlphaRequired();
+
+		///returns false if any of the loaded textures doesn't have its pixels on the GPU yet, see Texture::isResident()
+		bool hasResidentTextures() const;
 		
 		///returns the "weight" of the changes needed to pass from "this" to "s"
 		int getDistance( RenderState* s );
+
+		///returns true if s has the same textures, shader, blending and culling of this state, so that they can be drawn in the same batch
+		bool isBatchableWith( const RenderState& s ) const;
+
+		bool isBlendingEnabled() const
+		{
+			return blendingEnabled;
+		}
+
+		///returns a key that sorts together the states that are cheap to switch between
+		/**
+		\remark equal states always have equal keys, but different states might collide
+		*/
+		uint64_t getSortKey() const;
 		
+		///applies the whole state, including the binding of the Mesh
 		void applyState();
+
+		///applies only the textures, blending and culling that differ from lastState
+		/**
+		\param lastState the state that was applied last, the GL must not have been touched since
+		\return the number of GL state changes that were skipped
+		*/
+		int applyStateChanges( const RenderState& lastState );
 		
 		void commitChanges();
 
+		///commits the color, textures, blending and culling of this state, but doesn't bind the Mesh
+		/**
+		when lastState is not null, only the differences from it are applied
+		\return the number of GL state changes that were skipped
+		*/
+		int commitChanges( const RenderState* lastState );
+
 	protected:
 			
 		bool blendingEnabled;
@@ -179,6 +211,11 @@ namespace Dojo
 		Shader* pShader;
 
 		void _bindTextureSlot( int i );
+
+		void _applyColor();
+		void _applyBlending();
+		void _applyCullMode();
+		void _applyRenderState();
 	};
 }
 
@@ -46,7 +46,7 @@ namespace Dojo
 		
 		///returns the ID of the Render::Layer this object is assigned to
 		int getLayer()	const			{	return layer;			}
-		int getRenderingOrder()		{	return renderingOrder;	}
+		int getRenderingOrder() const	{	return renderingOrder;	}
 
 		///true if this object has been assigned to a Render::Layer
 		bool hasLayer()						{	return layer != INT_MIN;	}
@@ -63,6 +63,10 @@ namespace Dojo
 		virtual void onAction( float dt );		
 		
 		void _notifyRenderInfo( Renderer* r, int layerID, int renderIdx );
+
+		///the handle of this Renderable in its layer's SpatialIndex, -1 if none
+		int _getSpatialProxy() const		{	return spatialProxy;	}
+		void _setSpatialProxy( int proxy )	{	spatialProxy = proxy;	}
 	protected:
 		
 		bool visible;
@@ -70,11 +74,16 @@ namespace Dojo
 		Renderer* render;
 		int layer;
 		int renderingOrder;
+		int spatialProxy;
 		
 		bool fading;
 		float currentFadeTime;
 		float fadeEndTime;
 		Color fadeStartColor;
 		Color fadeEndColor;	
+
+		virtual void _onWorldAABBChanged();
+
+		virtual void _getLocalAABB( Vector& min, Vector& max ) const;
 	};
 }
@@ -13,6 +13,8 @@
 #include "Color.h"
 #include "Vector.h"
 #include "RenderLayer.h"
+#include "SpatialIndex.h"
+#include "Timer.h"
 
 namespace Dojo {
 	
@@ -22,20 +24,44 @@ namespace Dojo {
 	class Viewport;
 	class Mesh;
 	class Game;
+	class Shader;
+	class TextureStreamer;
 	
 	class Renderer 
 	{	
 	public:		
+		///the maximum number of vertices that can be merged in a single batch (they must be addressed by 16 bit indices)
+		static const int BATCH_VERTEX_MAX = 0xffff;
+
 		///a struct that exposes current rendering parameters such as transforms
 		struct CurrentState
 		{
 			Matrix view, world, projection, worldView, worldViewProjection;
 			Vector viewDirection, targetDimension;
+			float time;
 
 		} currentState;
 						
 		typedef std::vector< RenderLayer > LayerList;
 		typedef std::vector< Viewport* > ViewportList;
+		typedef std::vector< std::pair< uint64_t, Renderable* > > RenderQueue;
+
+		///the per-frame built-in uniforms, laid out as the std140 DOJO_FRAME uniform block
+		struct FrameUniforms
+		{
+			Matrix view, projection;
+			float viewDirection[4];
+			float targetDimension[2], targetPixel[2];
+			float time;
+			float _padding[3];
+		};
+
+		///the per-instance data streamed to the BIA_* attributes of instanced Shaders
+		struct InstanceData
+		{
+			Matrix world;
+			Color color;
+		};
 		
 		Renderer( int width, int height, Orientation renderOrientation );		
 		
@@ -87,14 +113,45 @@ namespace Dojo {
 		int getLastFrameVertexCount()		{	return frameVertexCount;	}
 		int getLastFrameTriCount()			{	return frameTriCount;		}
 		int getLastFrameBatchCount()		{	return frameBatchCount;		}
+		///returns how many redundant GL state changes were skipped in the last frame
+		int getLastFrameSkippedStateChangeCount()	{	return frameSkippedStateChangeCount;	}
+		///returns how many uniforms (and uniform buffers) were uploaded in the last frame
+		int getLastFrameUniformUploadCount()		{	return frameUniformUploadCount;	}
+		///returns how many uniform uploads were skipped in the last frame because the GL already had the same value
+		int getLastFrameSkippedUniformCount()		{	return frameSkippedUniformCount;	}
+
+		///returns a number that changes each time the per-frame uniforms change
+		int getFrameUniformsVersion() const			{	return mFrameUniformsVersion;	}
 
 		const Color& getDefaultAmbient()			{	return defaultAmbient;		}
+
+		///returns the TextureStreamer that uploads the streamed Textures at the start of each frame
+		TextureStreamer& getTextureStreamer()		{	return *mTextureStreamer;	}
+
+		///enables or disables a spatial index on the given layer, to cull it in a time proportional to its visible elements
+		/**
+		orthographic layers use a SpatialGrid with gridCellSize (in world units) cells, perspective layers use an AABBTree,
+		so the layer's orthographic flag has to be set before enabling the index.
+		\remark the elements of an indexed layer are always drawn in the order they were added to it
+		*/
+		void setSpatialIndexEnabled( RenderLayer::ID layerID, bool enabled, float gridCellSize = 256.f );
+
+		///enables or disables merging consecutive compatible Renderables into a single draw call
+		void setBatchingEnabled( bool enabled )		{	mBatchingEnabled = enabled;	}
+
+		bool isBatchingEnabled() const				{	return mBatchingEnabled;	}
 		
 		bool isValid()						{	return valid;		}
 		
 		///renders a single element using the given viewport
 		void renderElement( Viewport& viewport, Renderable& elem );
 		
+		///renders a group of compatible Renderables in a single draw call, pretransforming their vertices on the CPU
+		void renderBatch( Viewport& viewport, const std::vector< Renderable* >& elems );
+		
+		///renders a group of Renderables sharing the same Mesh and an instanced Shader in a single instanced draw call
+		void renderInstanced( Viewport& viewport, const std::vector< Renderable* >& elems );
+		
 		///renders a whole layer on the given viewport
 		void renderLayer( Viewport& viewport, const RenderLayer& layer );
 
@@ -103,6 +160,18 @@ namespace Dojo {
 		
 		//renders all the layers and their contained Renderables in the given order
 		void render();
+
+		///moves r in its layer's SpatialIndex
+		/**
+		\remark during a parallel update the move is deferred until the update ends
+		*/
+		void _notifyWorldAABBChanged( Renderable& r );
+
+		///starts or ends a parallel update, where the Renderables can't be added, removed or rendered
+		/**
+		ending it applies the deferred AABB changes
+		*/
+		void _setParallelUpdate( bool parallel );
 				
 	protected:
 		
@@ -118,7 +187,8 @@ namespace Dojo {
 		
 		const RenderLayer* currentLayer;
 
-		int frameVertexCount, frameTriCount, frameBatchCount;
+		int frameVertexCount, frameTriCount, frameBatchCount, frameSkippedStateChangeCount;
+		int frameUniformUploadCount, frameSkippedUniformCount;
 				
 		bool frameStarted;
 		
@@ -127,6 +197,70 @@ namespace Dojo {
 		Color defaultAmbient;
 		
 		Matrix mRenderRotation;
+
+		Timer mTimer;
+
+		FrameUniforms mFrameUniforms;
+		int mFrameUniformsVersion;
+		GLuint mFrameUniformBuffer;
+
+		///updates the per-frame uniforms (and their uniform buffer) from currentState
+		void _updateFrameUniforms();
+
+		RenderQueue mRenderQueue;
+
+		std::unordered_map< RenderLayer::ID, Unique< SpatialIndex > > mSpatialIndices;
+		SpatialIndex::ResultList mCullCandidates;
+
+		//increases with each added Renderable, to draw the elements of indexed layers in order
+		int mNextRenderingOrder;
+
+		//the SpatialIndices aren't thread safe, so the AABB changes that happen during a parallel update wait here
+		std::atomic< bool > mParallelUpdate;
+		std::mutex mDeferredAABBMutex;
+		std::vector< Renderable* > mDeferredAABBChanges;
+
+		//the last state committed to the GL, valid only during a viewport's rendering
+		const RenderState* mLastState;
+		Mesh* mLastMesh;
+
+		bool mBatchingEnabled;
+		std::vector< Renderable* > mBatchQueue;
+		int mBatchVertexCount;
+
+		///one dynamic mesh for each vertex format that has been batched
+		std::unordered_map< int, Unique< Mesh > > mBatchMeshes;
+
+		void _sortRenderQueue( RenderQueue::iterator begin, RenderQueue::iterator end );
+
+		GLuint mInstanceBuffer;
+		std::vector< InstanceData > mInstanceData;
+		///false when the context can't draw instanced, then the instanced Shaders get one draw per Renderable
+		bool mInstancingAvailable;
+
+		static bool _isInstanced( Renderable& r );
+
+		bool _canBatch( Renderable& a, Renderable& b );
+
+		void _flushBatch( Viewport& viewport );
+
+		Mesh& _getBatchMesh( Mesh& format );
+
+		///draws m with the given state, instanced if instances is not 0
+		void _renderMesh( Renderable& state, Mesh& m, int instances = 0 );
+
+		void _bindInstanceAttributes( Shader& shader );
+
+		///sets the instance attributes of shader to the constant values of a single instance
+		void _setInstanceAttributes( Shader& shader, const InstanceData& instance );
+
+		//the shaders that replace the fixed function pipeline for Renderables without a Shader
+		Unique< Shader > mDefaultShader, mDefaultTexturedShader;
+
+		Unique< TextureStreamer > mTextureStreamer;
+
+		///returns the Shader that will draw r
+		Shader& _getShaderFor( Renderable& r );
 	};		
 }
 
@@ -65,6 +65,16 @@ namespace Dojo
 			DEBUG_ASSERT( loaded == false, "A Resource was destroyed without being unloaded before (resource leak!)" );
 		}
 		
+		///first phase of a two-phase load, for the file IO and the CPU decoding that can run on a worker thread
+		/**
+		it must not use the GL: onLoad() is called later on the main thread and uses the prepared data if there is any.
+		The default does nothing and leaves all the work to onLoad()
+		*/
+		virtual void onPrepare()
+		{
+
+		}
+
 		virtual bool onLoad()=0;
 		virtual void onUnload( bool soft = false )=0;
 		
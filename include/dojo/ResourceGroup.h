@@ -19,6 +19,8 @@
 #include "Shader.h"
 #include "ShaderProgram.h"
 #include "Log.h"
+#include "TaskGraph.h"
+#include "ResourceID.h"
 
 #undef RT_FONT
 
@@ -33,7 +35,12 @@ namespace Dojo
 	A ResourceGroup will load all the Tables, FrameSets, Sounds, Fonts and Meshes found in the folder that are added to it,
 	and individual Resources are referenced by their name, eg: "data/graphics/ninja.png" is retrieved with getFrameSet( "ninja" )
 	
-	A ResourceGroup can be attached to one or more "sub" ResourceGroups to share their resources. */
+	A ResourceGroup can be attached to one or more "sub" ResourceGroups to share their resources.
+
+	The names are interned as ResourceIDs when the resources are added, and each group keeps a single flat table
+	of all the resources it can see, its own first and then the ones of its subgroups in order, so that a lookup
+	never recurses in the subgroups. The table is rebuilt at the first lookup after something changed in the group or in any of its subgroups.
+	See ResourceHandle to also skip the lookup. */
 	class ResourceGroup 
 	{			
 	public:	
@@ -53,6 +60,12 @@ namespace Dojo
 				
 		//various resource properties TODO: refactor
 		bool disableBilinear, disableMipmaps, disableTiling, logchanges = true;
+
+		///if true, the Textures are uploaded over the next frames by the Renderer's TextureStreamer instead of while loading
+		/**
+		the streamed Textures can be used right away, but they only show up when they are resident
+		*/
+		bool streamTextures;
 		
 		typedef std::unordered_map<String, FrameSet*> FrameSetMap;
 		typedef std::unordered_map<String, Font*> FontMap;
@@ -88,38 +101,39 @@ namespace Dojo
 			return (std::unordered_map< String, R* >*)mapArray[ (int)r ];
 		}
 		
-		///finds a named resource of type R
+		///returns the ResourceType that the resources of class R are stored as
+		template < class R >
+		static ResourceType getResourceType();
+
+		///finds a named resource of type R in this group or in its subgroups
 		template < class R >
 		R* find( const String& name, ResourceType r ) const
 		{
-			typedef std::unordered_map< String, R* > RMap;
-			
-			RMap* map = getResourceMap< R >( r );
-			
-			typename RMap::iterator itr = map->find( name );
-			
-			if( itr != map->end() )
-				return itr->second;
-			
-			//try in subgroups
-			R* f;
-			for( int i = 0; i < subs.size(); ++i )
-			{
-				f = subs[i]->find< R >( name, r );
-				
-				if( f )
-					return f;
-			}
-			
-			return NULL;
+			ResourceID id = ResourceNames::find( name );
+
+			return id != INVALID_RESOURCE_ID ? find< R >( id, r ) : nullptr;
+		}
+
+		///finds a resource of type R by the ID of its name, in this group or in its subgroups
+		template < class R >
+		R* find( ResourceID id, ResourceType r ) const
+		{
+			return static_cast< R* >( _find( id, r ) );
+		}
+
+		///returns a number that changes each time that the resources visible from this group change
+		unsigned int getVersion() const
+		{
+			return mVersion.load( std::memory_order_acquire );
 		}
 		
 		void addFrameSet( FrameSet* set, const String& name )
 		{
-			DEBUG_ASSERT_INFO( !getFrameSet( name ), "A FrameSet with this name already exists", "name = " + name );
+			DEBUG_ASSERT_INFO( !frameSets.count( name ), "A FrameSet with this name already exists", "name = " + name );
 			DEBUG_ASSERT( !finalized, "This ResourceGroup can't be modified" );
 			
 			frameSets[name] = set;
+			_onAdded( name );
 			
 			if (logchanges)
 				DEBUG_MESSAGE("+" + name + "\t\t set");
@@ -127,10 +141,11 @@ namespace Dojo
 		
 		void addFont( Font* f, const String& name )
 		{
-			DEBUG_ASSERT_INFO( !getFont( name ), "A Sound with this name already exists", "name = " + name );
+			DEBUG_ASSERT_INFO( !fonts.count( name ), "A Font with this name already exists", "name = " + name );
 			DEBUG_ASSERT( !finalized, "This ResourceGroup can't be modified" );
 			
 			fonts[name] = f;
+			_onAdded( name );
 			
 			if (logchanges)
 				DEBUG_MESSAGE("+" + name + "\t\t font");
@@ -138,10 +153,11 @@ namespace Dojo
 		
 		void addMesh( Mesh* m, const String& name )
 		{
-			DEBUG_ASSERT_INFO( !getMesh( name ), "A Mesh with this name already exists", "name = " + name );
+			DEBUG_ASSERT_INFO( !meshes.count( name ), "A Mesh with this name already exists", "name = " + name );
 			DEBUG_ASSERT( !finalized, "This ResourceGroup can't be modified" );
 			
 			meshes[ name ] = m;
+			_onAdded( name );
 			
 			if (logchanges)
 				DEBUG_MESSAGE("+" + name + "\t\t mesh");
@@ -149,10 +165,11 @@ namespace Dojo
 		
 		void addSound( SoundSet* sb, const String& name )
 		{
-			DEBUG_ASSERT_INFO( !getSound( name ), "A Sound with this name already exists", "name = " + name );
+			DEBUG_ASSERT_INFO( !sounds.count( name ), "A Sound with this name already exists", "name = " + name );
 			DEBUG_ASSERT( !finalized, "This ResourceGroup can't be modified" );
 			
 			sounds[ name ] = sb;
+			_onAdded( name );
 			
 			if (logchanges)
 				DEBUG_MESSAGE("+" + name + "\t\t sound");
@@ -163,10 +180,11 @@ namespace Dojo
 		///adds an existing Shader to this group
 		void addShader( Shader* s, const String& name )
 		{
-			DEBUG_ASSERT_INFO( !getShader( name ), "A Shader with this name already exists", "name = " + name );
+			DEBUG_ASSERT_INFO( !shaders.count( name ), "A Shader with this name already exists", "name = " + name );
 			DEBUG_ASSERT( !finalized, "This ResourceGroup can't be modified" );
 
 			shaders[ name ] = s;
+			_onAdded( name );
 
 			if (logchanges)
 				DEBUG_MESSAGE("+" + name + "\t\t shader");
@@ -175,60 +193,56 @@ namespace Dojo
 		///adds an existing ShaderProgram to this group
 		void addProgram( ShaderProgram* sp, const String& name )
 		{
-			DEBUG_ASSERT_INFO( !getProgram( name ), "A ShaderProgram with this name already exists", "name = " + name );
+			DEBUG_ASSERT_INFO( !programs.count( name ), "A ShaderProgram with this name already exists", "name = " + name );
 			DEBUG_ASSERT( !finalized, "This ResourceGroup can't be modified" );
 
 			programs[ name ] = sp;
+			_onAdded( name );
 
 			if (logchanges)
 				DEBUG_MESSAGE("+" + name + "\t\t shader program");
 		}
 		
 		///adds a ResourceGroup as an additional subgroup where to look for Resources
-		void addSubgroup( ResourceGroup* g )
-		{
-			DEBUG_ASSERT( g != nullptr, "Adding a null subgroup" );
-			
-			subs.add( g );
-		}
+		/**
+		the resources of the subgroups added first hide the ones with the same name in the subgroups added later
+		*/
+		void addSubgroup( ResourceGroup* g );
 		
 		///removes a subgroup
-		void removeSubgroup( ResourceGroup* g )
-		{
-			DEBUG_ASSERT( g != nullptr, "Removing a null subgroup" );
-			
-			subs.remove( g );
-		}
+		void removeSubgroup( ResourceGroup* g );
 
 		///removes all of the registered subgrops from this ResourceGroup
-		void removeAllSubgroups()
-		{
-			subs.clear();
-		}
+		void removeAllSubgroups();
 		
 		void removeFrameSet( const String& name )
 		{
 			frameSets.erase( name );
+			_invalidateIndex();
 		}
 		
 		void removeFont( const String& name )
 		{
 			fonts.erase( name );
+			_invalidateIndex();
 		}
 		
 		void removeMesh( const String& name )
 		{
 			meshes.erase( name );
+			_invalidateIndex();
 		}
 		
 		void removeSound( const String& name )
 		{
 			sounds.erase( name );
+			_invalidateIndex();
 		}
 		
 		void removeTable( const String& name )
 		{
 			tables.erase( name );
+			_invalidateIndex();
 		}
 
 		///returns a dummy empty FrameSet
@@ -286,6 +300,14 @@ namespace Dojo
 			DEBUG_ASSERT( name.size(), "empty name provided" );
 			return find< ShaderProgram >( name, RT_PROGRAM );
 		}
+
+		FrameSet* getFrameSet( ResourceID id ) const		{	return find< FrameSet >( id, RT_FRAMESET );	}
+		Font* getFont( ResourceID id ) const				{	return find< Font >( id, RT_FONT );	}
+		Mesh* getMesh( ResourceID id ) const				{	return find< Mesh >( id, RT_MESH );	}
+		SoundSet* getSound( ResourceID id ) const			{	return find< SoundSet >( id, RT_SOUND );	}
+		Table* getTable( ResourceID id ) const				{	return find< Table >( id, RT_TABLE );	}
+		Shader* getShader( ResourceID id ) const			{	return find< Shader >( id, RT_SHADER );	}
+		ShaderProgram* getProgram( ResourceID id ) const	{	return find< ShaderProgram >( id, RT_PROGRAM );	}
 		
 		///return the locale of this ResourceGroup, eg: en, it, de, se
 		const String& getLocale() const
@@ -315,6 +337,7 @@ namespace Dojo
 		\remark all the assets without a version are by default version 0*/
 		void addFonts( const String& folder, int version = 0 );
 		///add all the Meshes in a folder
+		/**the sub-meshes of .mesh files that have more than one are added as "file.subMesh"*/
 		void addMeshes( const String& folder );
 		///add all the Sounds in a folder
 		void addSounds( const String& folder );
@@ -366,23 +389,22 @@ namespace Dojo
 			finalized = true;
 		}
 
-		///loads all the resources that are in the group but aren't loaded
-		void loadResources( bool recursive = false )
-		{
-			_load< FrameSet >( frameSets );
-			_load< Font >( fonts );
-			_load< Mesh >( meshes );
-			_load< SoundSet >( sounds );
-			_load< Table >( tables );
-			_load< ShaderProgram >( programs );
-			_load< Shader >( shaders );
+		typedef std::function< void( float ) > ProgressCallback;
 
-			//load sets again to load missing atlases!
-			_load< FrameSet >( frameSets );
+		///loads all the resources that are in the group but aren't loaded
+		/**
+		the files are read and decoded in parallel on the BackgroundQueue, then the GL uploads are done on the calling thread
+		*/
+		void loadResources( bool recursive = false );
 
-			if( recursive)
-				for( int i = 0; i < subs.size(); ++i )	subs[i]->loadResources( recursive );
-		}
+		///starts loading the resources in graph, and returns the ID of the task that is done when all of them are loaded
+		/**
+		the first phase calls onPrepare() on the workers, for the file IO and the decoding of each resource in parallel;
+		the second calls onLoad() on all of them in a single main thread task, that only has to upload them to the GL.
+		progress is called on the main thread with the fraction of the work that is done.
+		\remark the resources of the group must not be used or changed until the returned task is done
+		*/
+		TaskGraph::TaskID loadResourcesAsync( TaskGraph& graph, const ProgressCallback& progress = ProgressCallback(), bool recursive = false );
 
 		///empties the group destroying all the resources
 		void unloadResources( bool recursive = false )
@@ -396,6 +418,8 @@ namespace Dojo
 			_unload< Shader >( shaders, false );
 			_unload< ShaderProgram >( programs, false );
 
+			_invalidateIndex();
+
 			if( recursive )
 				for( int i = 0; i < subs.size(); ++i )	subs[i]->unloadResources( recursive );
 		}
@@ -443,6 +467,134 @@ namespace Dojo
 		
 		SubgroupList subs;
 
+		///the groups that have this one as a subgroup, and that see its resources
+		SubgroupList supers;
+
+		///a slot of the flat table, the key being the ID of the name and the ResourceType
+		struct IndexSlot
+		{
+			uint32_t key;
+			Resource* resource;
+		};
+
+		///an open addressing table, never changed after it is published
+		struct Index
+		{
+			std::vector< IndexSlot > slots;
+			uint32_t mask;
+		};
+
+		///the current table, swapped with a new one on rebuild as _find() reads it without locking
+		mutable std::atomic< const Index* > mIndex;
+		///the tables built so far, the last one is mIndex; a reader could still be probing the older ones, so they are
+		///only freed by a rebuild that finds no readers
+		mutable std::vector< Unique< const Index > > mIndices;
+		///the threads that are probing one of mIndices
+		mutable std::atomic< int > mIndexReaders;
+		///the mVersion that mIndex was built from
+		mutable std::atomic< unsigned int > mIndexVersion;
+		mutable std::mutex mIndexMutex;
+
+		std::atomic< unsigned int > mVersion;
+
+		static uint32_t _indexKey( ResourceID id, ResourceType r )
+		{
+			DEBUG_ASSERT( id < ( 1u << 29 ), "Too many resource names" );
+
+			//the IDs start at 1, so 0 is never a key
+			return ( id << 3 ) | (uint32_t)r;
+		}
+
+		Resource* _find( ResourceID id, ResourceType r ) const
+		{
+			if( _isIndexStale() )
+				_buildIndex();
+
+			const uint32_t key = _indexKey( id, r );
+			Resource* found = nullptr;
+
+			//count this reader before loading the table, so that a rebuild either sees it or has already swapped the table
+			++mIndexReaders;
+
+			const Index& index = *mIndex.load();
+
+			for( uint32_t i = ( key * 2654435769u ) & index.mask;; i = ( i + 1 ) & index.mask )
+			{
+				auto& slot = index.slots[ i ];
+
+				if( slot.key == key )
+				{
+					found = slot.resource;
+					break;
+				}
+				else if( slot.key == 0 )
+					break;
+			}
+
+			--mIndexReaders;
+
+			return found;
+		}
+
+		///returns true if resources were added or removed, here or in a subgroup, since mIndex was built
+		bool _isIndexStale() const
+		{
+			return mIndexVersion != mVersion;
+		}
+
+		///builds a new flat table from the resources of this group and the tables of the subgroups, and swaps it in
+		void _buildIndex() const;
+
+		template< class T >
+		static void _collectIndexSlots( const std::unordered_map< String, T* >& map, ResourceType r, std::vector< IndexSlot >& out )
+		{
+			for( auto& resourcePair : map )
+			{
+				IndexSlot slot = { _indexKey( ResourceNames::intern( resourcePair.first ), r ), resourcePair.second };
+				out.push_back( slot );
+			}
+		}
+
+		///marks the flat tables of this group and of the groups that see it as stale
+		void _invalidateIndex();
+
+		void _onAdded( const String& name )
+		{
+			ResourceNames::intern( name );
+			_invalidateIndex();
+		}
+
+		///gathers this group and, if recursive, its subgroups once each
+		void _collectGroups( std::vector< ResourceGroup* >& groups, bool recursive );
+
+		///gathers the resources to prepare, the Fonts apart as they can't be prepared in parallel
+		static void _collectUnloaded( const std::vector< ResourceGroup* >& groups, std::vector< Resource* >& resources, std::vector< Resource* >& fonts );
+
+		///the second loading phase of this group, in dependency order
+		void _loadPrepared()
+		{
+			_load< FrameSet >( frameSets );
+			_load< Font >( fonts );
+			_load< Mesh >( meshes );
+			_load< SoundSet >( sounds );
+			_load< Table >( tables );
+			_load< ShaderProgram >( programs );
+			_load< Shader >( shaders );
+
+			//load sets again to load missing atlases!
+			_load< FrameSet >( frameSets );
+		}
+
+		template< class T >
+		static void _collectUnloaded( const std::unordered_map< String, T* >& map, std::vector< Resource* >& out )
+		{
+			for( auto& resourcePair : map )
+			{
+				if( !resourcePair.second->isLoaded() )
+					out.push_back( resourcePair.second );
+			}
+		}
+
 		///load all unloaded registered resources
 		template< class T>
 		void _load( std::unordered_map< String, T* >& map )
@@ -483,4 +635,12 @@ namespace Dojo
 				map.clear();
 		}
 	};
+
+	template<> inline ResourceGroup::ResourceType ResourceGroup::getResourceType< FrameSet >()		{	return RT_FRAMESET;	}
+	template<> inline ResourceGroup::ResourceType ResourceGroup::getResourceType< Font >()			{	return RT_FONT;	}
+	template<> inline ResourceGroup::ResourceType ResourceGroup::getResourceType< Mesh >()			{	return RT_MESH;	}
+	template<> inline ResourceGroup::ResourceType ResourceGroup::getResourceType< SoundSet >()		{	return RT_SOUND;	}
+	template<> inline ResourceGroup::ResourceType ResourceGroup::getResourceType< Table >()			{	return RT_TABLE;	}
+	template<> inline ResourceGroup::ResourceType ResourceGroup::getResourceType< Shader >()		{	return RT_SHADER;	}
+	template<> inline ResourceGroup::ResourceType ResourceGroup::getResourceType< ShaderProgram >()	{	return RT_PROGRAM;	}
 }
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "ResourceGroup.h"
+
+namespace Dojo
+{
+	///A ResourceHandle refers to a resource of type R by name, and caches the resource until the group changes
+	/**
+	the name is interned once when the handle is created, and then get() only compares the version of the group
+	with the cached one, so it's the fastest way to use a resource over and over, eg. when spawning Sprites:
+
+	ResourceHandle< FrameSet > bullet( *gameState, "bullet" );
+	...
+	registerAnimation( bullet.get() );
+
+	\remark a handle is not thread safe, use one per thread
+	*/
+	template < class R >
+	class ResourceHandle
+	{
+	public:
+
+		///creates an handle that refers to nothing
+		ResourceHandle() :
+			pGroup( nullptr ),
+			mID( INVALID_RESOURCE_ID ),
+			pResource( nullptr ),
+			mVersion( 0 )
+		{
+
+		}
+
+		///creates an handle to the resource called name in group or in its subgroups
+		ResourceHandle( const ResourceGroup& group, const String& name ) :
+			ResourceHandle( group, ResourceNames::intern( name ) )
+		{
+
+		}
+
+		ResourceHandle( const ResourceGroup& group, ResourceID id ) :
+			pGroup( &group ),
+			mID( id ),
+			pResource( nullptr ),
+			mVersion( group.getVersion() - 1 )
+		{
+
+		}
+
+		///returns the resource, or nullptr if it doesn't exist
+		R* get() const
+		{
+			if( pGroup && mVersion != pGroup->getVersion() )
+			{
+				mVersion = pGroup->getVersion();
+				pResource = pGroup->find< R >( mID, ResourceGroup::getResourceType< R >() );
+			}
+
+			return pResource;
+		}
+
+		R* operator->() const
+		{
+			R* r = get();
+
+			DEBUG_ASSERT_INFO( r, "The resource of this handle doesn't exist", "name = " + getName() );
+
+			return r;
+		}
+
+		R& operator*() const
+		{
+			return *operator->();
+		}
+
+		ResourceID getID() const
+		{
+			return mID;
+		}
+
+		const String& getName() const
+		{
+			return mID != INVALID_RESOURCE_ID ? ResourceNames::getName( mID ) : String::EMPTY;
+		}
+
+	protected:
+
+		const ResourceGroup* pGroup;
+		ResourceID mID;
+
+		mutable R* pResource;
+		mutable unsigned int mVersion;
+	};
+}
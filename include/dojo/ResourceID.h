@@ -0,0 +1,66 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "dojostring.h"
+
+namespace Dojo
+{
+	///a compact handle to an interned resource name, see ResourceNames
+	typedef uint32_t ResourceID;
+
+	///the ID of no name
+	const ResourceID INVALID_RESOURCE_ID = 0;
+
+	///ResourceNames interns the names of the resources, giving the same ResourceID to equal names for the whole run
+	/**
+	the ResourceGroups intern the names of their resources when they are added, so that their lookups only compare integers;
+	a name that is looked up often can be interned once, eg. in a static, to avoid hashing it at each lookup.
+
+	find() doesn't lock, intern() locks only when the name is new.
+	*/
+	class ResourceNames
+	{
+	public:
+
+		///returns the ID of name, assigning a new one if name wasn't interned yet
+		static ResourceID intern( const String& name );
+
+		///returns the ID of name, or INVALID_RESOURCE_ID if it was never interned
+		static ResourceID find( const String& name );
+
+		///returns the name that was interned as id
+		static const String& getName( ResourceID id );
+
+	protected:
+
+		struct Entry
+		{
+			String name;
+			size_t hash;
+			ResourceID id;
+		};
+
+		///an open addressing table of the entries; when it grows the old one is kept, as find() could be reading it
+		struct Table
+		{
+			uint32_t mask;
+			std::unique_ptr< std::atomic< const Entry* >[] > slots;
+
+			Table( uint32_t capacity );
+		};
+
+		std::mutex mMutex;
+		std::atomic< Table* > mTable;
+		std::vector< Unique< Table > > mTables;
+		std::vector< Unique< Entry > > mEntries;
+
+		static ResourceNames& _singleton();
+
+		ResourceNames();
+
+		static ResourceID _find( const Table& table, const String& name, size_t hash );
+
+		static void _insert( Table& table, const Entry& entry );
+	};
+}
@@ -40,7 +40,13 @@ namespace Dojo
 			BU_TEXTURE_0_TRANSFORM,
 			BU_TEXTURE_N_TRANSFORM = BU_TEXTURE_0_TRANSFORM + DOJO_MAX_TEXTURES-1,
 
-			BU_WORLD = BU_TEXTURE_0_DIMENSION + DOJO_MAX_TEXTURES,			///<The world matrix
+			///The world matrix
+			/**
+			for a Mesh with compressed positions it also includes Mesh::getPositionDecodeTransform(), and so do WORLDVIEW,
+			WORLDVIEWPROJ and INSTANCE_WORLD. The decode is a uniform scale, so normals transformed with these matrices
+			keep their direction but not their length, and the shader has to normalize them again
+			*/
+			BU_WORLD,
 			BU_VIEW,		///<The view matrix
 			BU_PROJECTION,		///<The projection matrix
         		BU_WORLDVIEW,           ///<The world view matrix
@@ -54,6 +60,18 @@ namespace Dojo
 			BU_TARGET_PIXEL   ///<The dimension in the UV space of one pixel
 		};
 
+		///A built-in instance attribute is a per-instance attribute which Dojo fills when drawing instanced Renderables
+		/**
+		\remark a Shader using any of these is always drawn instanced, and its Renderables are grouped by Mesh
+		*/
+		enum BuiltInInstanceAttribute
+		{
+			BIA_NONE,
+
+			BIA_WORLD,			///<The world matrix of the instance (mat4), replaces the WORLD uniform
+			BIA_OBJECT_COLOR	///<The color of the instance (vec4), replaces the OBJECT_COLOR uniform
+		};
+
 		///A VertexAttribute represents a "attribute" binding in a vertex shader
 		struct VertexAttribute
 		{
@@ -61,16 +79,18 @@ namespace Dojo
 			GLint count; ///<The array size *for a single vertex*
 
 			VertexField builtInAttribute;
+			BuiltInInstanceAttribute builtInInstanceAttribute;
 
 			VertexAttribute()
 			{
 
 			}
 
-			VertexAttribute( GLint loc, GLint size, VertexField bia ) :
+			VertexAttribute( GLint loc, GLint size, VertexField bia, BuiltInInstanceAttribute biia = BIA_NONE ) :
 				location( loc ),
 				count( size ),
-				builtInAttribute( bia )
+				builtInAttribute( bia ),
+				builtInInstanceAttribute( biia )
 			{
 				DEBUG_ASSERT( location >= 0, "Invalid VertexAttribute location" );
 				DEBUG_ASSERT( count > 0, "Invalid element count" );
@@ -79,9 +99,42 @@ namespace Dojo
 
 		typedef std::unordered_map< std::string, VertexAttribute > NameAttributeMap;
 
+		///the name of the uniform block that shaders can declare to read the per-frame built-ins from a shared uniform buffer
+		/**
+		the block must be declared as
+		
+		layout(std140) uniform DOJO_FRAME {
+			mat4 VIEW;
+			mat4 PROJECTION;
+			vec4 VIEW_DIRECTION;
+			vec2 TARGET_DIMENSION;
+			vec2 TARGET_PIXEL;
+			float TIME;
+		};
+
+		members can only be removed from the end.
+		The block needs GL 3.1 or ARB_uniform_buffer_object, shaders meant for older contexts should declare the plain uniforms instead.
+		*/
+		static const char* FRAME_UNIFORM_BLOCK_NAME;
+
+		///the uniform buffer binding point that the Renderer uses for the DOJO_FRAME block
+		static const GLuint FRAME_UNIFORM_BLOCK_BINDING = 0;
+
 		///Creates a new Shader from a file path
 		Shader( ResourceGroup* creator, const String& filePath );
 
+		///Creates a new "immediate" Shader from the sources of its programs
+		Shader( const std::string& vertexShader, const std::string& fragmentShader );
+
+		///returns the location that any Shader uses for the attribute bound to field
+		/**
+		built-in attributes are bound to fixed locations before linking, so that a Mesh can be bound once for all the Shaders
+		*/
+		static GLuint getBuiltInAttributeLocation( VertexField field );
+
+		///returns the (first) location that any Shader uses for the given instance attribute
+		static GLuint getBuiltInInstanceAttributeLocation( BuiltInInstanceAttribute attribute );
+
 		///Assigns this data source (Binder) to the Uniform with the given name
 		/**
 		the Binder will be executed each time something is rendered with this Shader
@@ -105,8 +158,35 @@ namespace Dojo
 			return mAttributeMap;
 		}
 
+		///returns true if this Shader reads per-instance attributes and needs to be drawn instanced
+		bool isInstanced() const
+		{
+			return mInstanced;
+		}
+
 		///binds the shader to the OpenGL state with the object that is using it
-		virtual void use( const Renderable& user );
+		/**
+		uniforms that already hold the same value in the GL are not uploaded again
+		\param uploads incremented by the number of glUniform calls made
+		\param skipped incremented by the number of uniforms that were left as they were
+		*/
+		virtual void use( const Renderable& user, int& uploads, int& skipped );
+
+		///returns false if the Shader reads uniforms that can change between the objects of a batch
+		/**
+		the uniforms that have a UniformCallback and the texture transforms are read from the single Renderable passed to use(),
+		so merging objects that use them would draw all of them with the values of one
+		*/
+		bool isBatchable() const
+		{
+			return mBatchable;
+		}
+
+		///returns true if the built-in uniform has the same value for a whole layer of a frame
+		static bool isPerFrameUniform( BuiltInUniform builtin )
+		{
+			return builtin == BU_VIEW || builtin == BU_PROJECTION || builtin >= BU_VIEW_DIRECTION;
+		}
 
 		virtual bool onLoad();
 
@@ -124,47 +204,78 @@ namespace Dojo
 			BuiltInUniform builtInUniform;
 			UniformCallback userUniformCallback;
 
+			std::string name;
+
+			///the position and size of the last uploaded value in the shadow buffer
+			int shadowOffset, size;
+			bool uploaded;
+
 			Uniform()
 			{
 
 			}
 
-			Uniform( GLint loc, GLint elementCount, GLenum ty, BuiltInUniform biu ) :
+			Uniform( const std::string& uniformName, GLint loc, GLint elementCount, GLenum ty, BuiltInUniform biu ) :
 				location( loc ),
 				count( elementCount ),
 				type( ty ),
-				builtInUniform( biu )
+				builtInUniform( biu ),
+				name( uniformName ),
+				shadowOffset( 0 ),
+				size( 0 ),
+				uploaded( false )
 			{
 				DEBUG_ASSERT( location >= 0, "Invalid Uniform location" );
 				DEBUG_ASSERT( count > 0, "Invalid element count" );
 			}
 		};
 
-		typedef std::unordered_map< std::string, Uniform > NameUniformMap;
+		typedef std::vector< Uniform > UniformList;
 
 		typedef std::unordered_map< std::string, BuiltInUniform > NameBuiltInUniformMap;
 		typedef std::unordered_map< std::string, VertexField > NameBuiltInAttributeMap;
+		typedef std::unordered_map< std::string, BuiltInInstanceAttribute > NameBuiltInInstanceAttributeMap;
 
 		static NameBuiltInUniformMap sBuiltiInUniformsNameMap;
 		static NameBuiltInAttributeMap sBuiltInAttributeNameMap;
+		static NameBuiltInInstanceAttributeMap sBuiltInInstanceAttributeNameMap;
 
 		static void _populateUniformNameMap();
 		static void _populateAttributeNameMap();
 
 		static BuiltInUniform _getUniformForName( const std::string& name );
 		static VertexField _getAttributeForName( const std::string& name );
+		static BuiltInInstanceAttribute _getInstanceAttributeForName( const std::string& name );
 
 		std::string mPreprocessorHeader;
 
-		NameUniformMap mUniformMap;
+		//flat list of the active uniforms, compiled at link time, per-frame uniforms last
+		UniformList mUniforms;
+		int mFirstPerFrameUniform;
+		//the last values uploaded to the program, referenced by the Uniforms
+		std::vector< byte > mUniformShadow;
+		//the Renderer's frame uniforms version that the per-frame uniforms were last uploaded for
+		int mFrameUniformsVersion;
+
 		NameAttributeMap mAttributeMap;
 
 		GLuint mGLProgram;
 
+		bool mInstanced;
+		bool mBatchable;
+
 		ShaderProgram* pProgram[ (byte)ShaderProgramType::_Count ];
 		bool mOwnsProgram[ (byte)ShaderProgramType::_Count ];
 
 		void _assignProgram(const Table& desc, ShaderProgramType type);
+
+		void _bindBuiltInAttributeLocations();
+
+		///builds the flat uniform list and its shadow buffer from the linked program
+		void _compileUniforms();
+
+		///uploads the uniform if its data differs from the shadow copy, returns false if it was skipped
+		bool _uploadUniform( Uniform& uniform, const void* data );
         
         const void* _getUniformData( const Uniform& uniform, const Renderable& user );
 
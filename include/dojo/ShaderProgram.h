@@ -37,16 +37,23 @@ namespace Dojo
 		///creates a new ShaderProgram using the source of this one, concatenated with the given preprocessor header
 		ShaderProgram* cloneWithHeader( const std::string& preprocessorHeader );
 
+		///reads the source file
+		virtual void onPrepare();
+
 		virtual bool onLoad();
 		virtual void onUnload( bool soft = false );
 
 	protected:
 
 		std::string mContentString;
+		bool mContentRead;
 
 		ShaderProgramType mType;
 		GLuint mGLShader;
 
 		bool _load();
+
+		///reads the file in mContentString
+		bool _readFile();
 	};
 }
@@ -77,6 +77,9 @@ namespace Dojo
 		
 		~SoundBuffer();
 
+		///decodes the sound, so that onLoad() only has to create the OpenAL buffers
+		virtual void onPrepare();
+
 		virtual bool onLoad();
 		virtual void onUnload( bool soft = false );
 
@@ -123,6 +126,11 @@ namespace Dojo
 		Stream* mSource;
 		Unique< FileStream > mFile; //this unique ptr keeps ownership of the file accessor when the src is a file
 
+		//the PCM decoded by onPrepare(), uploaded and freed by onLoad()
+		std::vector< char > mPreparedPCM;
+		ALenum mPreparedFormat;
+		ALsizei mPreparedFrequency;
+
 		bool _loadOgg( Stream* source );
 		bool _loadOggFromFile();
 	};
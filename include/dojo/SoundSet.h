@@ -24,6 +24,9 @@ namespace Dojo
 		///Creates a new set named setName
 		SoundSet( ResourceGroup* creator, const String& setName );
 
+		///decodes the sounds, so that onLoad() only has to create the OpenAL buffers
+		virtual void onPrepare();
+
 		virtual bool onLoad();
 		virtual void onUnload( bool soft = true );
 
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "SpatialIndex.h"
+
+namespace Dojo
+{
+	///A SpatialGrid is a sparse uniform grid on the XY plane, meant to cull the elements of orthographic layers
+	/**
+	each element is stored in all the cells that its AABB touches; elements too large to be stored efficiently
+	are kept apart and returned by every query.
+	*/
+	class SpatialGrid : public SpatialIndex
+	{
+	public:
+
+		///the maximum number of cells per side that an element can span before being considered too large
+		static const int MAX_ELEMENT_CELL_SPAN = 16;
+
+		///creates a grid with square cells of side cellSize, in world units
+		/**
+		\remark a good size is a few times the size of the typical element
+		*/
+		explicit SpatialGrid( float cellSize );
+
+		virtual void add( Renderable& r );
+
+		virtual void remove( Renderable& r );
+
+		virtual void update( Renderable& r );
+
+		virtual void clear();
+
+		virtual void query( const Viewport& viewport, ResultList& result ) const;
+
+	protected:
+
+		struct CellRange
+		{
+			int minX, minY, maxX, maxY;
+
+			bool operator==( const CellRange& other ) const
+			{
+				return minX == other.minX && minY == other.minY && maxX == other.maxX && maxY == other.maxY;
+			}
+		};
+
+		struct Proxy
+		{
+			Renderable* object;
+			CellRange cells;
+			bool oversized;
+
+			//the last query that returned this proxy, to return each one once
+			mutable unsigned int queryStamp;
+		};
+
+		typedef std::vector< int > ProxyList;
+
+		float mCellSize, mInvCellSize;
+
+		std::vector< Proxy > mProxies;
+		std::vector< int > mFreeProxies;
+
+		std::unordered_map< uint64_t, ProxyList > mCells;
+		ProxyList mOversized;
+
+		mutable unsigned int mQueryStamp;
+
+		static uint64_t _getCellKey( int x, int y )
+		{
+			return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+		}
+
+		///computes the cells covered by the given AABB, returns false if it spans more than maxSpan cells per side
+		bool _getCellRange( const Vector& min, const Vector& max, CellRange& range, int maxSpan = MAX_ELEMENT_CELL_SPAN ) const;
+
+		void _link( int proxyID );
+		void _unlink( int proxyID );
+
+	private:
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "Vector.h"
+
+namespace Dojo
+{
+	class Renderable;
+	class Viewport;
+
+	///A SpatialIndex keeps the Renderables of a RenderLayer sorted by their world AABB, to cull them without looking at each one
+	/**
+	the Renderables store their proxy in the index, so each Renderable can belong to one SpatialIndex at a time
+	*/
+	class SpatialIndex
+	{
+	public:
+
+		typedef std::vector< Renderable* > ResultList;
+
+		virtual ~SpatialIndex()
+		{
+
+		}
+
+		virtual void add( Renderable& r ) = 0;
+
+		virtual void remove( Renderable& r ) = 0;
+
+		///moves r after its world AABB changed
+		virtual void update( Renderable& r ) = 0;
+
+		///removes all the elements
+		virtual void clear() = 0;
+
+		///appends to result the elements that might be visible from viewport
+		/**
+		the result is conservative and unordered, each element still needs its own culling test
+		*/
+		virtual void query( const Viewport& viewport, ResultList& result ) const = 0;
+
+	protected:
+
+		///returns false for empty, inverted or not finite AABBs, that can't be placed anywhere
+		static bool _isValidAABB( const Vector& min, const Vector& max )
+		{
+			//written to be false with NaNs
+			return
+				min.x <= max.x && min.y <= max.y && min.z <= max.z &&
+				max.x - min.x < FLT_MAX && max.y - min.y < FLT_MAX && max.z - min.z < FLT_MAX;
+		}
+	};
+}
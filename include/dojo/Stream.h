@@ -46,6 +46,15 @@ namespace Dojo
 		///returns the total bytes in the stream, -1 if this stream has no end
 		virtual long getSize()=0;
 
+		///returns all the contents of the stream if they are already in memory, so that they can be used without reading them; nullptr otherwise
+		/**
+		\remark the pointer is valid only while the stream is open
+		*/
+		virtual const byte* getData()
+		{
+			return nullptr;
+		}
+
 		///returns the kind of access this stream provides, ie. read-only
 		virtual Access getAccess()=0;
 
@@ -5,43 +5,35 @@
 using namespace Dojo;
 
 
-StringReader::StringReader(const String& string) :
-wcharStr(&string),
-utf8Str(NULL),
-idx(0) {
-
-}
-
-StringReader::StringReader(const std::string& string) :
-utf8Str(&string),
-wcharStr(NULL),
+StringReader::StringReader(const StringView& string) :
+mString(string),
 idx(0) {
 
 }
 
 unichar StringReader::get() {
-	DEBUG_ASSERT((wcharStr && !utf8Str) || (!wcharStr && utf8Str), "StringReader is uninitialized");
-
-	//HACK this doesn't care about utf8 multichars!
-	if ((wcharStr && idx >= wcharStr->size()) || (utf8Str && idx >= utf8Str->size()))
+	if (idx >= mString.size())
 	{
 		++idx;
 		return 0;
 	}
-	else if (wcharStr)
-	{
-		return (*wcharStr)[idx++];
-	}
-	else
-	{
-		return (unichar)(*utf8Str)[idx++];
-	}
+
+	const char* ptr = mString.data() + idx;
+	unichar c = Unicode::decodeUTF8(ptr, mString.end());
+	idx = ptr - mString.data();
+	return c;
 }
 
 void StringReader::back() {
 	DEBUG_ASSERT(idx > 0, "back: The StringReader is already at the start of the stream");
 
-	--idx;
+	if (idx > mString.size())
+		--idx;
+	else
+	{
+		//step back to the first byte of the previous character
+		do { --idx; } while (idx > 0 && Unicode::isContinuationByte(mString[idx]));
+	}
 }
 
 bool StringReader::isNumber(unichar c) {
@@ -94,6 +86,12 @@ int StringReader::getCurrentIndex() {
 	return idx;
 }
 
+StringView StringReader::getView(size_t start, size_t end) const {
+	DEBUG_ASSERT(start <= end, "Invalid range");
+
+	return mString.substr(start, end - start);
+}
+
 unsigned int StringReader::readHex() {
 	//skip 0x
 	get();
@@ -190,20 +188,11 @@ float StringReader::readFloat() {
 }
 
 void StringReader::readBytes(void* dest, int sizeBytes) {
-	DEBUG_ASSERT((wcharStr && !utf8Str) || (!wcharStr && utf8Str), "Reading bytes from an uninitialized StringReader");
-
-	//load format data
-	int elemSize = wcharStr ? sizeof(unichar) : 1;
-	byte * buf = wcharStr ? (byte*)wcharStr->data() : (byte*)utf8Str->data();
-	int startingByte = idx * elemSize;
-	buf += startingByte; //go to current element
-	int size = (wcharStr ? wcharStr->size() : utf8Str->size()) * elemSize;
-
 	//clamp into string
-	if (startingByte + sizeBytes > size)
-		sizeBytes = size - startingByte;
+	if (idx + sizeBytes > mString.size())
+		sizeBytes = idx < mString.size() ? (int)(mString.size() - idx) : 0;
 
-	memcpy(dest, buf, sizeBytes);
+	memcpy(dest, mString.data() + idx, sizeBytes);
 
-	idx += sizeBytes / elemSize;
+	idx += sizeBytes;
 }
@@ -6,20 +6,20 @@
 
 namespace Dojo
 {
-	///StringReader wraps a String to help parsing
+	///StringReader wraps an UTF-8 string to help parsing
+	/**
+	the string is not copied, so it has to outlive the reader
+	*/
 	class StringReader
 	{
 	public:
 
-		///UTF-32 constructor
-		StringReader( const String& string );
-
-		///UTF-8 constructor
-		StringReader( const std::string& string );
+		StringReader( const StringView& string );
 		
 		///returns a new unicode character or 0 if the stream ended
 		unichar get();
 		
+		///puts back the last character returned by get()
 		void back();
 		
 		//TODO move all to Utils
@@ -42,7 +42,11 @@ namespace Dojo
         
         byte getHexValue( unichar c );
 
+		///returns the byte offset of the next character
 		int getCurrentIndex();
+
+		///returns the bytes between start and end without copying them, eg. to extract a token after reading it
+		StringView getView( size_t start, size_t end ) const;
         
         ///reads a formatted hex
         unsigned int readHex();
@@ -54,8 +58,7 @@ namespace Dojo
 
 	protected:
 
-		const String* wcharStr;
-		const std::string* utf8Str;
+		StringView mString;
 
 		size_t idx;
 	};
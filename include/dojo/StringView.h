@@ -0,0 +1,258 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+namespace Dojo
+{
+	///a Unicode codepoint
+	typedef uint32_t unichar;
+
+	///Unicode contains the helpers to encode and decode the UTF-8 and UTF-16 encodings
+	class Unicode
+	{
+	public:
+
+		///the codepoint that replaces invalid or truncated sequences
+		static const unichar REPLACEMENT_CHARACTER = 0xfffd;
+
+		///the last valid codepoint
+		static const unichar MAX_CODEPOINT = 0x10ffff;
+
+		///returns true if the byte b is inside of a multibyte sequence rather than at its start
+		static bool isContinuationByte( char b )
+		{
+			return ( (unsigned char)b & 0xc0 ) == 0x80;
+		}
+
+		///decodes the codepoint starting at ptr and moves ptr past it
+		/**
+		an invalid sequence decodes to REPLACEMENT_CHARACTER and only its first byte is consumed, so that decoding always progresses
+		*/
+		static unichar decodeUTF8( const char*& ptr, const char* end )
+		{
+			DEBUG_ASSERT( ptr < end, "Cannot decode past the end of the string" );
+
+			//most text is ASCII
+			if( (unsigned char)*ptr < 0x80 )
+				return (unsigned char)*ptr++;
+
+			return _decodeMultibyteUTF8( ptr, end );
+		}
+
+		///appends the UTF-8 encoding of c to dest
+		static void encodeUTF8( unichar c, std::string& dest );
+
+		///appends the UTF-16 encoding of c to dest
+		static void encodeUTF16( unichar c, std::wstring& dest );
+
+		///returns the largest size not greater than maxSize that doesn't cut a codepoint of the UTF-8 string s
+		static size_t truncateUTF8( const char* s, size_t size, size_t maxSize );
+
+	protected:
+
+		static unichar _decodeMultibyteUTF8( const char*& ptr, const char* end );
+	};
+
+	///CodepointIterator decodes an UTF-8 buffer one codepoint at a time
+	class CodepointIterator
+	{
+	public:
+
+		CodepointIterator( const char* ptr, const char* end ) :
+			mPtr( ptr ),
+			mNext( ptr ),
+			mEnd( end ),
+			mValue( 0 )
+		{
+			_decode();
+		}
+
+		unichar operator*() const
+		{
+			return mValue;
+		}
+
+		CodepointIterator& operator++()
+		{
+			mPtr = mNext;
+			_decode();
+			return *this;
+		}
+
+		bool operator==( const CodepointIterator& other ) const
+		{
+			return mPtr == other.mPtr;
+		}
+
+		bool operator!=( const CodepointIterator& other ) const
+		{
+			return mPtr != other.mPtr;
+		}
+
+		///returns the byte where the current codepoint starts
+		const char* getPosition() const
+		{
+			return mPtr;
+		}
+
+	protected:
+
+		const char* mPtr;
+		const char* mNext;
+		const char* mEnd;
+		unichar mValue;
+
+		void _decode()
+		{
+			if( mNext < mEnd )
+				mValue = Unicode::decodeUTF8( mNext, mEnd );
+		}
+	};
+
+	///a range of codepoints to be used in range for loops, see String::codepoints()
+	class CodepointRange
+	{
+	public:
+
+		CodepointRange( const char* begin, const char* end ) :
+			mBegin( begin ),
+			mEnd( end )
+		{
+
+		}
+
+		CodepointIterator begin() const
+		{
+			return CodepointIterator( mBegin, mEnd );
+		}
+
+		CodepointIterator end() const
+		{
+			return CodepointIterator( mEnd, mEnd );
+		}
+
+	protected:
+
+		const char* mBegin;
+		const char* mEnd;
+	};
+
+	///A StringView refers to a slice of an UTF-8 buffer without copying it
+	/**
+	it is meant to be used when parsing or looking strings up; the referred buffer must outlive the view, so a
+	view is better not stored, and converted to a String instead.
+	*/
+	class StringView
+	{
+	public:
+
+		static const size_t npos = (size_t)-1;
+
+		StringView() :
+			mData( "" ),
+			mSize( 0 )
+		{
+
+		}
+
+		StringView( const char* s ) :
+			mData( s ),
+			mSize( s ? strlen( s ) : 0 )
+		{
+			DEBUG_ASSERT( s, "Cannot view a NULL string" );
+		}
+
+		StringView( const char* s, size_t size ) :
+			mData( s ),
+			mSize( size )
+		{
+
+		}
+
+		StringView( const std::string& s ) :
+			mData( s.data() ),
+			mSize( s.size() )
+		{
+
+		}
+
+		const char* data() const
+		{
+			return mData;
+		}
+
+		///returns the size in bytes
+		size_t size() const
+		{
+			return mSize;
+		}
+
+		bool empty() const
+		{
+			return mSize == 0;
+		}
+
+		char operator[]( size_t i ) const
+		{
+			DEBUG_ASSERT( i < mSize, "Index out of bounds" );
+			return mData[ i ];
+		}
+
+		const char* begin() const
+		{
+			return mData;
+		}
+
+		const char* end() const
+		{
+			return mData + mSize;
+		}
+
+		///returns the view of count bytes starting at start, clamped to this view
+		StringView substr( size_t start, size_t count = npos ) const
+		{
+			start = std::min( start, mSize );
+			return StringView( mData + start, std::min( count, mSize - start ) );
+		}
+
+		///returns the index of the first byte c at or after start, or npos
+		size_t find( char c, size_t start = 0 ) const
+		{
+			for( size_t i = start; i < mSize; ++i )
+			{
+				if( mData[ i ] == c )
+					return i;
+			}
+			return npos;
+		}
+
+		bool startsWith( const StringView& prefix ) const
+		{
+			return prefix.mSize <= mSize && memcmp( mData, prefix.mData, prefix.mSize ) == 0;
+		}
+
+		///iterates the codepoints of this view: for( unichar c : view.codepoints() )
+		CodepointRange codepoints() const
+		{
+			return CodepointRange( mData, mData + mSize );
+		}
+
+		///returns the number of codepoints in this view, which is less than size() when it isn't ASCII
+		size_t countCodepoints() const;
+
+		bool operator==( const StringView& other ) const
+		{
+			return mSize == other.mSize && memcmp( mData, other.mData, mSize ) == 0;
+		}
+
+		bool operator!=( const StringView& other ) const
+		{
+			return !( *this == other );
+		}
+
+	protected:
+
+		const char* mData;
+		size_t mSize;
+	};
+}
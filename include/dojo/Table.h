@@ -178,6 +178,13 @@ namespace Dojo
 
 		~Table();
 
+		///Tables don't use the GL, so they are loaded completely in the first phase
+		virtual void onPrepare()
+		{
+			if( !isLoaded() )
+				onLoad();
+		}
+
 		virtual bool onLoad();
 
 		virtual void onUnload( bool soft = false );
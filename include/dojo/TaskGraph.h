@@ -0,0 +1,144 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "BackgroundQueue.h"
+
+namespace Dojo
+{
+	///A TaskGraph runs tasks that depend on each other on a BackgroundQueue, each one as soon as all its predecessors are done
+	/**
+	it is meant for chains of work such as decode image -> upload texture -> build atlas tiles, where independent chains
+	and the iterations of a parallel for run at the same time on all the workers:
+
+	\code
+	auto decode = graph.add( [&]() { ... } );
+	auto upload = graph.add( [&]() { ... }, { decode }, TaskGraph::AFFINITY_GL_CONTEXT );
+	auto tiles = graph.addParallelFor( tileCount, [&]( int i ) { ... }, { upload } );
+	graph.add( [&]() { onLoaded(); }, { tiles }, TaskGraph::AFFINITY_MAIN_THREAD );
+	\endcode
+
+	Tasks are started as soon as they are added if their predecessors are done, and the ID of a finished task can still be used as a predecessor.
+	If there is no BackgroundQueue, the tasks run immediately on the calling thread.
+	*/
+	class TaskGraph
+	{
+	public:
+
+		typedef int TaskID;
+		typedef std::vector< TaskID > TaskList;
+
+		typedef BackgroundQueue::Task Task;
+		typedef std::function< void( int ) > ForBody;
+
+		///where a task has to run
+		enum Affinity
+		{
+			AFFINITY_WORKER, ///any worker of the BackgroundQueue
+			AFFINITY_MAIN_THREAD, ///the main thread, when the BackgroundQueue fires its completed callbacks
+			AFFINITY_GL_CONTEXT ///a worker, followed by a glFinish() so that the GL objects it created can be used by the other contexts
+		};
+
+		///creates an empty TaskGraph that runs its tasks on queue
+		TaskGraph( BackgroundQueue* queue );
+
+		///cancels the tasks that didn't start yet
+		~TaskGraph();
+
+		///adds a task that will run after all the tasks in "after"
+		TaskID add( const Task& task, const TaskList& after = TaskList(), Affinity affinity = AFFINITY_WORKER, BackgroundQueue::Priority priority = BackgroundQueue::PRIORITY_NORMAL );
+
+		///adds a task that calls body( i ) for each i in [0, count) in parallel, after all the tasks in "after"
+		/**
+		the iterations are spread over the workers, and the task is done when they are all done
+		*/
+		TaskID addParallelFor( int count, const ForBody& body, const TaskList& after = TaskList(), BackgroundQueue::Priority priority = BackgroundQueue::PRIORITY_NORMAL );
+
+		///returns true if task is done (or was cancelled)
+		bool isDone( TaskID task ) const;
+
+		///returns true when all the tasks are done
+		bool isDone() const;
+
+		///waits for all the tasks to be done, firing the BackgroundQueue callbacks meanwhile
+		/**
+		\remark call this from the main thread, or the main thread tasks will never run
+		*/
+		void wait();
+
+		///drops all the tasks that didn't start yet and leaves the graph empty
+		/**
+		the running tasks are not interrupted, but their successors won't run
+		*/
+		void cancel();
+
+	protected:
+
+		struct Node
+		{
+			Task task;
+
+			//a parallel for if forCount > 0
+			ForBody forBody;
+			int forCount;
+
+			Affinity affinity;
+			BackgroundQueue::Priority priority;
+
+			int unfinishedPredecessors;
+			TaskList successors;
+
+			Node() :
+				forCount( 0 ),
+				affinity( AFFINITY_WORKER ),
+				priority( BackgroundQueue::PRIORITY_NORMAL ),
+				unfinishedPredecessors( 0 )
+			{
+
+			}
+		};
+
+		///the state is shared with the queued tasks, so that they stay valid after the graph is gone
+		struct State
+		{
+			BackgroundQueue* queue;
+
+			mutable std::mutex mutex;
+
+			//only the tasks that aren't done yet
+			std::unordered_map< TaskID, Node > nodes;
+			TaskID nextID;
+
+			//changes at each cancel(), so that the queued tasks know they are stale
+			std::atomic< int > generation;
+
+			State( BackgroundQueue* q ) :
+				queue( q ),
+				nextID( 0 ),
+				generation( 0 )
+			{
+
+			}
+		};
+
+		typedef std::shared_ptr< State > StatePtr;
+		typedef std::shared_ptr< std::atomic< int > > SharedCounter;
+
+		StatePtr mState;
+
+		TaskID _add( Node&& node, const TaskList& after );
+
+		///queues a task whose predecessors are all done
+		static void _submit( const StatePtr& state, TaskID id );
+
+		static void _run( const StatePtr& state, TaskID id );
+
+		///runs the iterations of a parallel for that are left, and finishes the task if it ran the last one
+		static void _runIterations( const StatePtr& state, TaskID id, int generation, const ForBody& body, int count, const SharedCounter& next, const SharedCounter& done );
+
+		///removes a done task and submits the successors that became ready
+		static void _finish( const StatePtr& state, TaskID id );
+
+	private:
+	};
+}
@@ -148,6 +148,12 @@ namespace Dojo
 		Vector cursorPosition, screenSize, lastScale;
 		Vector mLayersLowerBound, mLayersUpperBound;
 
+		virtual void _getLocalAABB( Vector& min, Vector& max ) const
+		{
+			min = mLayersLowerBound;
+			max = mLayersUpperBound;
+		}
+
 		LayerList busyLayers, freeLayers;
 		int actualCharacters = 0;
         
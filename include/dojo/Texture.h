@@ -46,12 +46,22 @@ namespace Dojo
 		a texture of this kind is loaded via an .atlasinfo and doesn't use VRAM in itself */
 		bool loadFromAtlas( Texture* tex, int x, int y, int sx, int sy );
 
+		///decodes the image file, so that onLoad() only has to upload it
+		virtual void onPrepare();
+
 		///loads the texture with the given parameters
 		virtual bool onLoad();
 
 		virtual void onUnload( bool soft = false );
 		
 		bool isLoaded()			{	return loaded;			}
+
+		///returns true when the GPU has the pixels of this texture
+		/**
+		a Texture streamed by the TextureStreamer is loaded, and can be bound, some frames before it is resident.
+		An atlas tile is resident when its parent atlas is.
+		*/
+		bool isResident()		{	return parentAtlas ? parentAtlas->isResident() : mResident;	}
 						
 		///internal - binds this texture as the current GL active one
 		virtual void bind( GLuint index );
@@ -126,6 +136,9 @@ namespace Dojo
 			
 			ownerFrameSet = s;
 		}
+
+		///internal - called by the TextureStreamer when the GPU is done uploading the streamed pixels
+		void _notifyResident();
 				
 	protected:
 				
@@ -146,6 +159,24 @@ namespace Dojo
 
 		GLuint mFBO;
 
+		//the image decoded by onPrepare(), waiting for onLoad()
+		void* mPreparedImage;
+		GLenum mPreparedFormat;
+
+		bool mResident;
+
+		//the pixels decoded by onPrepare() were handed to the TextureStreamer
+		bool mStreamed;
+
+		///allocates the storage for a w x h image and uploads the pixels in sourceFormat, if any
+		/**
+		without pixels, the storage is cleared only if clear is true or the image is padded
+		*/
+		bool _loadImage( int w, int h, GLenum destFormat, GLenum sourceFormat, const void* pixels, bool clear );
+
+		///drops the uploads of this texture that are still in the TextureStreamer
+		void _cancelStreaming();
+
 		///builds the optimal billboard for this texture, used in AnimatedQuads
 		void _buildOptimalBillboard();
 
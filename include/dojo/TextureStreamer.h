@@ -0,0 +1,100 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+namespace Dojo
+{
+	class Texture;
+
+	///A TextureStreamer uploads images to their Textures over several frames, so that large images don't stall the main thread
+	/**
+	any thread can stream() a decoded image, which is copied in a ring of staging memory; where available the ring is a persistently
+	mapped pixel buffer, so the copy is the only work done on the CPU.
+	update() then uploads the staged images whose Textures are loaded, without going over the frame budget, and marks each
+	Texture as resident when a fence says that the GPU has read its pixels.
+
+	The Renderer owns one and updates it before rendering each frame.
+	*/
+	class TextureStreamer
+	{
+	public:
+
+		///creates a TextureStreamer with ringSize bytes of staging memory, that uploads at most frameBudget bytes per frame
+		TextureStreamer( int ringSize = DOJO_TEXTURE_STREAMING_RING_SIZE, int frameBudget = DOJO_TEXTURE_STREAMING_FRAME_BUDGET );
+
+		~TextureStreamer();
+
+		///copies the pixels in the staging ring and queues their upload to texture; it can be called from any thread
+		/**
+		\returns false if there is no room in the ring right now, so the caller has to upload the image itself
+		\remark the texture's storage has to be allocated with the same size before update() can upload it
+		*/
+		bool stream( Texture& texture, const void* pixels, int width, int height, GLenum sourceFormat, int pixelSize );
+
+		///drops the uploads of texture that are still queued, and forgets the ones in flight
+		void cancel( Texture& texture );
+
+		///uploads the staged images up to the frame budget, and makes resident the Textures that the GPU is done with
+		/**
+		\remark call this on the main thread once per frame, outside of rendering
+		*/
+		void update();
+
+		void setFrameBudget( int bytes )
+		{
+			DEBUG_ASSERT( bytes > 0, "The frame budget must be positive" );
+
+			mFrameBudget = bytes;
+		}
+
+		int getFrameBudget() const				{	return mFrameBudget;	}
+
+		///returns the bytes uploaded by the last update()
+		int getLastFrameUploadedBytes() const	{	return mLastFrameUploadedBytes;	}
+
+		///returns the bytes that are staged or being staged, and not uploaded yet
+		int getPendingBytes() const				{	return mPendingBytes;	}
+
+		///returns true if the staging memory is a pixel buffer, false if the uploads fall back to client memory
+		bool isUsingPixelBuffer() const			{	return mPixelBuffer != GL_NONE;	}
+
+	protected:
+
+		struct Upload
+		{
+			Texture* texture; //null if cancelled
+			int offset, size;
+			int width, height;
+			GLenum sourceFormat;
+
+			bool staged; //the pixels are in the ring
+			bool uploaded;
+
+#ifdef DOJO_PIXEL_BUFFERS_AVAILABLE
+			GLsync fence; //signaled when the GPU has read the pixels
+#endif
+		};
+
+		typedef std::deque< Upload > UploadQueue;
+
+		int mRingSize, mFrameBudget;
+		int mLastFrameUploadedBytes;
+		std::atomic< int > mPendingBytes;
+
+		GLuint mPixelBuffer;
+		byte* pRing;
+
+		//the uploads in ring order; the used part of the ring goes from the first one to mHead
+		std::mutex mMutex;
+		UploadQueue mUploads;
+		int mFirstUploadID, mHead;
+
+		///returns the offset of a free range of size bytes in the ring, or -1
+		int _reserve( int size ) const;
+
+		///returns true if the GPU is done reading the pixels of u
+		bool _isDone( Upload& u );
+
+	private:
+	};
+}
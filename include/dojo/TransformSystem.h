@@ -0,0 +1,111 @@
+#pragma once
+
+#include "dojo_common_header.h"
+
+#include "Vector.h"
+
+namespace Dojo
+{
+	///A TransformSystem stores a hierarchy of transforms in contiguous arrays and updates them all in a single linear sweep
+	/**
+	it is a lightweight alternative to Objects for large numbers of moving things (tiles, debris, crowds...):
+	each transform is referenced by a Handle, and its local position, rotation, scale and local AABB are stored
+	in separate arrays, with the parents always before their children.
+	update() then computes the world matrices and the world AABBs in order, using SIMD where available.
+
+	\remark unlike Objects, a transform can't be reparented
+	*/
+	class TransformSystem
+	{
+	public:
+
+		typedef int Handle;
+
+		static const Handle INVALID_HANDLE = -1;
+
+		TransformSystem();
+
+		///adds a transform, as a child of parent if it is valid
+		Handle add( Handle parent, const Vector& position, const Quaternion& rotation = Quaternion( 1, 0, 0, 0 ), const Vector& scale = Vector::ONE );
+
+		///removes a transform and all its children
+		/**
+		\remark the children handles become invalid at the next update()
+		*/
+		void remove( Handle h );
+
+		///removes all the transforms
+		void clear();
+
+		///returns the number of live transforms
+		int getCount() const
+		{
+			return (int)mParent.size() - mDeadCount;
+		}
+
+		void setPosition( Handle h, const Vector& position );
+		Vector getPosition( Handle h ) const;
+
+		void setRotation( Handle h, const Quaternion& rotation );
+		Quaternion getRotation( Handle h ) const;
+
+		void setScale( Handle h, const Vector& scale );
+		Vector getScale( Handle h ) const;
+
+		///sets the local space AABB that the world AABB is computed from
+		void setLocalAABB( Handle h, const Vector& min, const Vector& max );
+
+		///returns the world transform computed by the last update()
+		const Matrix& getWorldTransform( Handle h ) const
+		{
+			return mWorld[ _getIndex( h ) ];
+		}
+
+		///returns the world AABB computed by the last update()
+		const Vector& getWorldMin( Handle h ) const
+		{
+			return mWorldMin[ _getIndex( h ) ];
+		}
+
+		const Vector& getWorldMax( Handle h ) const
+		{
+			return mWorldMax[ _getIndex( h ) ];
+		}
+
+		///computes all the world transforms and AABBs
+		void update();
+
+	protected:
+
+		//the local transforms, one array per component
+		std::vector< float > mPosX, mPosY, mPosZ;
+		std::vector< float > mRotX, mRotY, mRotZ, mRotW;
+		std::vector< float > mScaleX, mScaleY, mScaleZ;
+
+		//the local AABBs as center and half extents
+		std::vector< Vector > mLocalCenter, mLocalExtent;
+
+		//index of the parent, always smaller than the child's, or -1
+		std::vector< int > mParent;
+
+		std::vector< Matrix > mWorld;
+		std::vector< Vector > mWorldMin, mWorldMax;
+
+		std::vector< bool > mDead;
+		int mDeadCount;
+
+		std::vector< int > mHandleToIndex, mIndexToHandle;
+		std::vector< Handle > mFreeHandles;
+
+		int _getIndex( Handle h ) const
+		{
+			DEBUG_ASSERT( h >= 0 && h < (int)mHandleToIndex.size() && mHandleToIndex[h] >= 0, "Invalid TransformSystem handle" );
+			return mHandleToIndex[ h ];
+		}
+
+		///removes the dead transforms and their children, keeping the order
+		void _compact();
+
+	private:
+	};
+}
@@ -23,7 +23,7 @@ namespace Dojo
 	{
 	public:
 				
-		static int getLastOf( const String& str, unichar c )
+		static int getLastOf( const String& str, char c )
 		{			
 			for( int i = (int)str.size()-1; i >= 0; --i )
 			{
@@ -17,6 +17,16 @@ namespace Dojo {
 		_Count = None
 	};
 
+	///How a VertexField is stored in each vertex
+	enum class VertexFieldFormat
+	{
+		Default, ///<floats, or 4 bytes for Color
+
+		Short, ///<normalized 16 bit integers: positions are mapped to the bounds of the Mesh, UVs have to be in [0,1]
+		Byte, ///<normalized 8 bit integers, for normals
+		Int2_10_10_10, ///<normals packed in 10 bits per component, see Mesh::arePackedNormalsAvailable()
+	};
+
 }
 
 
@@ -127,6 +127,9 @@ namespace Dojo
 
 		bool isContainedInFrustum( const Renderable& r ) const;
 
+		///returns true if the given world AABB is at least partially inside the frustum
+		bool isInFrustum( const Vector& min, const Vector& max ) const;
+
 		bool isVisible( Renderable& s );
 
 		bool isInViewRect( const Renderable& r ) const;
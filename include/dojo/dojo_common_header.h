@@ -17,15 +17,21 @@
 #include <sstream>
 #include <fstream>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <functional>
 #include <queue>
+#include <deque>
 #include <atomic>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <type_traits>
 #include <utility>
 #include <stdexcept>
 #include <map>
+#include <list>
+#include <algorithm>
 
 #include "glm/glm.hpp"
 #include "glm/gtc/quaternion.hpp"
@@ -52,14 +52,42 @@
 	#define DOJO_SHADERS_AVAILABLE
 #endif
 
+#if !defined( USING_OPENGLES ) && !defined( PLATFORM_OSX )
+	#define DOJO_PIXEL_BUFFERS_AVAILABLE //persistently mapped pixel buffers, needs GL 4.4 or ARB_buffer_storage and ARB_sync; checked at runtime
+	#define DOJO_GPU_TIMER_QUERIES_AVAILABLE //GL timestamps for the Profiler, needs GL 3.3 or ARB_timer_query; checked at runtime
+	#define DOJO_INSTANCING_AVAILABLE //instanced draws, needs GL 3.3 or ARB_instanced_arrays; checked at runtime
+	#define DOJO_UNIFORM_BUFFERS_AVAILABLE //the shared per-frame uniform buffer, needs GL 3.1 or ARB_uniform_buffer_object; checked at runtime
+	#define DOJO_PACKED_NORMALS_AVAILABLE //10:10:10:2 normals, needs GL 3.3 or ARB_vertex_type_2_10_10_10_rev; checked at runtime, see Mesh::arePackedNormalsAvailable()
+#endif
+
 #ifndef PLATFORM_ANDROID
 	#define DOJO_ANISOTROPIC_FILTERING_AVAILABLE //anisotropic filtering has to be tested on Android //TODO move this to Platform, maybe make a caps class?
 #endif
 
+//the SIMD instruction set used by the math hot loops, if any
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+	#define DOJO_SIMD_SSE
+#elif defined( __ARM_NEON__ ) || defined( __ARM_NEON )
+	#define DOJO_SIMD_NEON
+#endif
+
+//thread local storage for plain data, as VS2013 doesn't support thread_local
+#ifdef _MSC_VER
+	#define DOJO_THREAD_LOCAL __declspec( thread )
+#else
+	#define DOJO_THREAD_LOCAL __thread
+#endif
+
 //#define DOJO_GAMMA_CORRECTION_ENABLED
 
-//do not use the differential state commit //HACK
-#define DOJO_FORCE_WHOLE_RENDERSTATE_COMMIT
+//the Profiler zones are compiled in, even in PUBLISH builds, and enabled at runtime; comment this out to remove them altogether
+#define DOJO_PROFILER_ENABLED
+
+///how many zones each thread can record in a single Profiler capture
+#define DOJO_PROFILER_EVENTS_PER_THREAD 16384
+
+//uncomment to commit the whole RenderState at each draw instead of only the differences from the previous one
+//#define DOJO_FORCE_WHOLE_RENDERSTATE_COMMIT
 
 ///the cap for the textures bound to a single object
 #define DOJO_MAX_TEXTURES 8
@@ -67,10 +95,16 @@
 ///the cap for the texture coords in a single vertex
 #define DOJO_MAX_TEXTURE_COORDS 2
 
-//There is VAO experimental support but Valve states that VAOs are slower on all platforms
+///the size in bytes of the staging memory where the TextureStreamer copies the images waiting for upload
+#define DOJO_TEXTURE_STREAMING_RING_SIZE (32 * 1024 * 1024)
+
+///how many bytes the TextureStreamer uploads at most in a frame
+#define DOJO_TEXTURE_STREAMING_FRAME_BUDGET (4 * 1024 * 1024)
+
+//each Mesh records its bindings in a VAO, which is bound in a single call
+//Valve states that VAOs are slower on some drivers, uncomment to bind the attributes at each draw instead
 //source: https://developer.nvidia.com/sites/default/files/akamai/gamedev/docs/Porting%20Source%20to%20Linux.pdf
-//needs testing, comment to enable
-#define DOJO_DISABLE_VAOS
+//#define DOJO_DISABLE_VAOS
 
 //common enums
 namespace Dojo
@@ -2,6 +2,8 @@
 
 #include "dojo_common_header.h"
 
+#include "StringView.h"
+
 #ifdef __OBJC__
 	#import <Foundation/NSString.h>
 #endif
@@ -13,84 +15,98 @@ namespace Dojo
 #ifndef PLATFORM_WIN32
 	typedef unsigned char byte;
 #endif
-    
-    //define the right unichar
-#ifndef __APPLE__
-	typedef wchar_t unichar;
-#else
-    typedef unsigned short unichar;
-#endif
 
-	//define the unicode stuff
-	typedef std::basic_stringstream< unichar > StringStream;
+	typedef std::stringstream StringStream;
 
-	typedef std::basic_string< unichar > _ustring;
-
-	class String : public _ustring
+	///String is the string of the engine, storing UTF-8 text
+	/**
+	a String is a std::string with UTF-8 contents, so it benefits of the small string optimisation of the standard library and 
+	it can be passed as it is wherever an UTF-8 char* is expected. 
+	size(), operator[] and the other std::string methods work on bytes: text that needs to be processed per character,
+	eg. to render it, has to be iterated with codepoints().
+	*/
+	class String : public std::string
 	{
 	public:
 		
 		static const String EMPTY;
+
+		using std::string::operator+=;
 		
-		String() :
-		_ustring()
+		String()
 		{
 
 		}
 		
-		String( const String& s ) :
-		_ustring( s )
+		///converts a string from UTF8
+		String( const std::string& utf8 ) :
+		std::string( utf8 )
 		{
 			
 		}
-		
-		String( const _ustring& s ) :
-		_ustring( s )
+
+		String( std::string&& utf8 ) :
+		std::string( std::move( utf8 ) )
 		{
-			
+
 		}
 		
 		String( char s ) :
-		_ustring()
+		std::string( 1, s )
 		{
-			append( 1, (unichar)s );
+
 		}
 		
 		String( unichar c )
 		{
-			append( 1, c );
+			appendCodepoint( c );
 		}
 
-		String( const char * s ) :
-		_ustring()
+		String( const char * utf8 ) :
+		std::string( utf8 ? utf8 : "" )
 		{
-			appendASCII( s );
+			DEBUG_ASSERT( utf8, "Tried to create a String from a NULL string" );
 		}
-		
-		//converts a string from UTF8
-		String( const std::string& utf8 ) :
-		_ustring()
+
+		String( const char* utf8, size_t size ) :
+		std::string( utf8, size )
 		{
-			appendUTF8( utf8 );
+
+		}
+
+		explicit String( const StringView& view ) :
+		std::string( view.data(), view.size() )
+		{
+
+		}
+
+		///converts a string from the wide encoding of the platform, UTF-16 on Windows and UTF-32 elsewhere
+		explicit String( const wchar_t* s )
+		{
+			appendWString( s );
 		}
 		
-		String( int i, unichar paddingChar = 0 ) :
-		_ustring()
+		String( int i, unichar paddingChar = 0 )
 		{
 			appendInt( i, paddingChar );
 		}
 		
-		String( float f ) :
-		_ustring()
+		String( float f )
 		{
 			appendFloat( f );
 		}
 
-		String( float f, byte digits ) :
-			_ustring()
+		String( float f, byte digits )
 		{
 			appendFloat( f, digits );
 		}
+
+		///appends the UTF-8 encoding of the codepoint c
+		String& operator+=( unichar c )
+		{
+			appendCodepoint( c );
+			return *this;
+		}
 		
 		///if found, replace the given substr with the given replacement - they can be of different lengths.
 		void replaceToken( const String& substring, const String& replacement )
@@ -100,59 +116,63 @@ namespace Dojo
 			size_t start = find( substring );
 			
 			if( start != String::npos )
-			{
-				String postfix = substr( start + substring.size() );				
-				resize( start );
-				append( replacement );
-				append( postfix );
-			}
+				replace( start, substring.size(), replacement );
 		}
 		
-		size_t byteSize()
+		size_t byteSize() const
 		{
-			return size() * sizeof( unichar );
+			return size();
 		}
-		
-		///converts this string into ASCII. WARNING: fails silently on unsupported chars!!!
-		std::string ASCII() const 
+
+		///iterates the characters of this string: for( unichar c : str.codepoints() )
+		CodepointRange codepoints() const
 		{
-			std::string res;
-			
-			unichar c;
-			for( size_t i = 0; i < size(); ++i )
-			{
-				c = at(i);
-				if( c <= 0xff )
-					res += (char)c;
-			}
-			
-			return res;
+			return CodepointRange( data(), data() + size() );
 		}
-		
-		std::string UTF8() const 
+
+		///returns the number of characters in this string, which is less than size() when it isn't ASCII
+		size_t countCodepoints() const
 		{
-			//HACK!!!!! make a real parser!!!
-			return ASCII();
+			return StringView( *this ).countCodepoints();
 		}
 		
-		void appendASCII( const char* s )
+		///converts this string into ASCII. WARNING: drops silently the non ASCII characters!!!
+		/**
+		kept for the older code; UTF8() is free and should be preferred wherever UTF-8 is accepted
+		*/
+		std::string ASCII() const;
+		
+		///returns the UTF-8 contents of this string, without copying them
+		const std::string& UTF8() const 
 		{
-			DEBUG_ASSERT( s, "Tried to append a NULL ASCII string" );
-
-			for( int i = 0; s[i] != 0; ++i )
-				append( 1, (unichar)s[i] );
+			return *this;
 		}
+
+		///returns this string in the wide encoding of the platform, UTF-16 on Windows and UTF-32 elsewhere
+		std::wstring toWString() const;
 		
-		void appendUTF8( const std::string& utf8 )
+		///appends a Latin-1 string, ie. each byte is a character
+		void appendASCII( const char* s );
+		
+		void appendUTF8( const StringView& utf8 )
 		{
-			//TODO do it better
-			appendASCII( utf8.c_str() );
+			append( utf8.data(), utf8.size() );
+		}
+
+		void appendWString( const wchar_t* s );
+
+		void appendCodepoint( unichar c )
+		{
+			if( c < 0x80 )
+				push_back( (char)c );
+			else
+				Unicode::encodeUTF8( c, *this );
 		}
 		
 		void appendInt( int i, unichar paddingChar = 0 )
 		{
 			int div = 1000000000;
-			unichar c;
+			char c;
 
 			if( i < 0 )
 			{
@@ -162,18 +182,18 @@ namespace Dojo
 			
 			for( ; div > 0; i %= div, div /= 10 )
 			{
-				c = '0' + (i / div);
+				c = (char)( '0' + (i / div) );
 				
 				if( c != '0' )  break;
 				else if( paddingChar )
-					*this += paddingChar;
+					appendCodepoint( paddingChar );
 			}
 			
 			if( i == 0 )
 				*this += '0';
 			
 			for( ; div > 0; i %= div, div /= 10 )
-				*this += '0' + (i / div);
+				*this += (char)( '0' + (i / div) );
 			
 		}
 		
@@ -197,40 +217,37 @@ namespace Dojo
 				//append the remainder
 				f *= 10;
 				n = (int)f;
-				*this += (unichar)('0' + n);
+				*this += (char)('0' + n);
 
 				f -= floor( f );
 			} 
 		}
 
-		String toUpper() {
-
-			//WARNING THIS DOES NOT EVEN KNOW WHAT UNICODE IS
-			String res;
-			for (auto& c : *this) {
-				if (c >= 'a' && c <= 'z')
+		///returns a copy where the ASCII lowercase letters are uppercase
+		String toUpper() const
+		{
+			String res( *this );
+			for( auto& c : res )
+			{
+				if( c >= 'a' && c <= 'z' )
 					c -= 32;
-				res += c;
 			}
 			return res;
 		}
 		
-		///appends raw data to this string. It has to be wchar_t bytes aligned!
-		void appendRaw( void* data, int sz )
+		///appends raw data to this string
+		void appendRaw( const void* data, int sz )
 		{
-			DEBUG_ASSERT( sz % sizeof( unichar ) == 0, "Data is not aligned to string elements" );
-			
-			append( (unichar*)data, sz / sizeof( unichar ) );
+			append( (const char*)data, sz );
 		}
 				
 #ifdef __OBJC__
 		NSString* toNSString() const 
 		{                       
-			return [ NSString stringWithCharacters: data() length: size() ];
+			return [ NSString stringWithUTF8String: c_str() ];
 		}
 		
-		String( NSString* nss ) :
-		_ustring()
+		String( NSString* nss )
 		{
 			appendNSString( nss );
 		}
@@ -239,11 +256,7 @@ namespace Dojo
 		{
 			DEBUG_ASSERT( nss, "NSString was null" );
 			
-			auto sz = size();
-			resize( sz + [nss length] );
-			
-			///copy the whole string verbatim
-			[nss getCharacters: (unichar*)data() + sz range: NSMakeRange( 0, [nss length] )];
+			append( [nss UTF8String] );
 			
 			return *this;
 		}
@@ -253,7 +266,15 @@ namespace Dojo
 	
 	inline String operator+ ( const String& lhs, const String& rhs)
 	{
-		return String( lhs ).append( rhs );
+		String res( lhs );
+		res.append( rhs );
+		return res;
+	}
+
+	inline String operator+ ( String&& lhs, const String& rhs)
+	{
+		lhs.append( rhs );
+		return std::move( lhs );
 	}
 	
 	inline String operator+ (const char* lhs, const String& rhs)
@@ -268,12 +289,16 @@ namespace Dojo
 	
 	inline String operator+ (const String& lhs, const char* rhs)
 	{
-		return lhs + String( rhs );
+		String res( lhs );
+		res.append( rhs );
+		return res;
 	}
 	
 	inline String operator+ (const String& lhs, char rhs)
 	{
-		return lhs + String( rhs );
+		String res( lhs );
+		res.push_back( rhs );
+		return res;
 	}
 
 }
@@ -282,7 +307,7 @@ namespace std
 {
 	///hash specialization for unordered_maps
 	template<>
-	struct hash<Dojo::String> : public hash< Dojo::_ustring >
+	struct hash<Dojo::String> : public hash< std::string >
 	{
 
 	};
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "dojo_common_header.h"
 
 #ifdef PLATFORM_LINUX
@@ -7,20 +9,33 @@
 
 #include "Timer.h"
 
+//keep Xlib out of the way, its macros (None, Bool, Status...) clash with dojo names
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+
 namespace Dojo
 {
+	///LinuxPlatform is an headless Platform that renders into an offscreen EGL pbuffer
+	/**
+	\remark it works without a display server, eg. on a software renderer such as Mesa's llvmpipe (EGL_PLATFORM=surfaceless)
+	\remark setting "fixedStepFrames" in the config runs exactly that many frames with a fixed dt ("fixedStepLength", defaults
+	to the Game's native frame length) and then exits, logging the timings. This is meant for profiling and for CI.
+	*/
 	class LinuxPlatform : public Platform
 	{
 	public:
 
 		LinuxPlatform( const Table& config );
-		
+
+		virtual ~LinuxPlatform();
+
 		///initializes the platform and calls Game::onBegin()
 		virtual void initialize( Game* game );
 
 		///shuts down the Platform and calls Game::onEnd()
 		virtual void shutdown();
-		
+
 		///CALL THIS BEFORE USING ANY OTHER THREAD FOR GL OPERATIONS
 		virtual void prepareThreadContext();
 
@@ -36,7 +51,10 @@ namespace Dojo
 		virtual GLenum loadImageFile( void*& bufptr, const String& path, int& width, int& height, int& pixelSize );
 
 		///returns true if the device is able to manage non-power-of-2 textures
-		virtual bool isNPOTEnabled();
+		virtual bool isNPOTEnabled()
+		{
+			return true; //any desktop GL we can run on supports them
+		}
 
 		///returns the application data path for this game (eg. to save user files)
 		virtual const String& getAppDataPath();
@@ -44,13 +62,43 @@ namespace Dojo
 		virtual const String& getRootPath();
 		///returns the read-only resources path, eg working directory on windows or Bundle/Contents/Resources on Mac
 		virtual const String& getResourcesPath	();
-		
+
 		///opens a web page in the default browser
 		virtual void openWebPage( const String& site );
-		
+
+		///returns true if this platform runs a fixed number of frames with a fixed timestep
+		bool isFixedStepRun() const
+		{
+			return mFixedStepFrames > 0;
+		}
+
 	protected:
 
+		EGLDisplay mDisplay;
+		EGLConfig mEGLConfig;
+		EGLSurface mSurface;
+		EGLContext mContext;
+
+		///the pbuffers and the shared contexts made current on the other threads by prepareThreadContext()
+		std::vector< std::pair< EGLSurface, EGLContext > > mThreadContexts;
+		std::mutex mThreadContextsMutex;
+
+		Timer mStepTimer;
+
+		String mAppDataPath, mRootPath;
+
+		int mFixedStepFrames;
+		float mFixedStepLength;
+
+		bool _initializeContext( int w, int h );
+
+		///destroys all the EGL surfaces and contexts and terminates the display
+		void _destroyContext();
+
+		void _loopFixedStep();
+
 	private:
 	};
 }
 
+#endif
@@ -100,6 +100,8 @@ namespace Dojo
 
 		typedef Pipe< ContextShareRequest* > ContextRequestsQueue;
 		Unique<ContextRequestsQueue> mContextRequestsQueue;
+		///the Pipe has a single producer, but all the BackgroundQueue workers ask for a context at the same time
+		std::mutex mContextRequestsMutex;
 
 		bool _initializeWindow( const String& caption, int w, int h );
 		
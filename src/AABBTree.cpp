@@ -0,0 +1,367 @@
+#include "stdafx.h"
+
+#include "AABBTree.h"
+
+#include "dojomath.h"
+
+#include "Renderable.h"
+#include "Viewport.h"
+
+using namespace Dojo;
+
+const float AABBTree::FAT_MARGIN = 0.1f;
+
+//the insertion cost of an AABB, the sum of its sides works well with the flat AABBs of sprites too
+static float _getCost( const Vector& min, const Vector& max )
+{
+	Vector d = max - min;
+	return d.x + d.y + d.z;
+}
+
+static bool _contains( const Vector& outerMin, const Vector& outerMax, const Vector& min, const Vector& max )
+{
+	return
+		outerMin.x <= min.x && outerMin.y <= min.y && outerMin.z <= min.z &&
+		max.x <= outerMax.x && max.y <= outerMax.y && max.z <= outerMax.z;
+}
+
+AABBTree::AABBTree() :
+	mRoot( NULL_NODE ),
+	mFreeList( NULL_NODE )
+{
+
+}
+
+int AABBTree::_allocateNode()
+{
+	int nodeID;
+	if( mFreeList != NULL_NODE )
+	{
+		nodeID = mFreeList;
+		mFreeList = mNodes[ nodeID ].parent;
+	}
+	else
+	{
+		nodeID = mNodes.size();
+		mNodes.emplace_back();
+	}
+
+	Node& n = mNodes[ nodeID ];
+	n.parent = n.child1 = n.child2 = NULL_NODE;
+	n.object = nullptr;
+	n.height = 0;
+	n.unbounded = false;
+	return nodeID;
+}
+
+void AABBTree::_freeNode( int nodeID )
+{
+	Node& n = mNodes[ nodeID ];
+	n.parent = mFreeList;
+	n.object = nullptr;
+	n.height = -1;
+	mFreeList = nodeID;
+}
+
+void AABBTree::_setFatAABB( Node& leaf, const Vector& min, const Vector& max )
+{
+	Vector d = max - min;
+	float margin = std::max( d.x, std::max( d.y, d.z ) ) * FAT_MARGIN;
+	Vector m( margin, margin, margin );
+
+	leaf.min = min - m;
+	leaf.max = max + m;
+}
+
+void AABBTree::_refit( int nodeID )
+{
+	Node& n = mNodes[ nodeID ];
+	const Node& c1 = mNodes[ n.child1 ];
+	const Node& c2 = mNodes[ n.child2 ];
+
+	n.min = Math::min( c1.min, c2.min );
+	n.max = Math::max( c1.max, c2.max );
+	n.height = 1 + std::max( c1.height, c2.height );
+}
+
+void AABBTree::_insertLeaf( int leaf )
+{
+	if( mRoot == NULL_NODE )
+	{
+		mRoot = leaf;
+		mNodes[ leaf ].parent = NULL_NODE;
+		return;
+	}
+
+	//descend to the sibling that makes the tree grow the least
+	const Vector leafMin = mNodes[ leaf ].min, leafMax = mNodes[ leaf ].max;
+
+	int index = mRoot;
+	while( !mNodes[ index ].isLeaf() )
+	{
+		const Node& n = mNodes[ index ];
+
+		float area = _getCost( n.min, n.max );
+		float combinedArea = _getCost( Math::min( n.min, leafMin ), Math::max( n.max, leafMax ) );
+
+		//cost of creating a new parent for this node and the new leaf
+		float cost = 2.f * combinedArea;
+
+		//minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.f * (combinedArea - area);
+
+		float childCost[2];
+		int children[2] = { n.child1, n.child2 };
+		for( int i = 0; i < 2; ++i )
+		{
+			const Node& c = mNodes[ children[i] ];
+			float grownArea = _getCost( Math::min( c.min, leafMin ), Math::max( c.max, leafMax ) );
+
+			childCost[i] = (c.isLeaf() ? grownArea : grownArea - _getCost( c.min, c.max )) + inheritanceCost;
+		}
+
+		if( cost < childCost[0] && cost < childCost[1] )
+			break;
+
+		index = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+
+	int sibling = index;
+
+	//create a new parent for the sibling and the leaf
+	int oldParent = mNodes[ sibling ].parent;
+	int newParent = _allocateNode();
+
+	mNodes[ newParent ].parent = oldParent;
+	mNodes[ newParent ].child1 = sibling;
+	mNodes[ newParent ].child2 = leaf;
+	mNodes[ sibling ].parent = newParent;
+	mNodes[ leaf ].parent = newParent;
+
+	if( oldParent != NULL_NODE )
+	{
+		if( mNodes[ oldParent ].child1 == sibling )
+			mNodes[ oldParent ].child1 = newParent;
+		else
+			mNodes[ oldParent ].child2 = newParent;
+	}
+	else
+		mRoot = newParent;
+
+	//walk back up fixing the heights and the bounds
+	for( index = newParent; index != NULL_NODE; index = mNodes[ index ].parent )
+	{
+		index = _balance( index );
+		_refit( index );
+	}
+}
+
+void AABBTree::_removeLeaf( int leaf )
+{
+	if( leaf == mRoot )
+	{
+		mRoot = NULL_NODE;
+		return;
+	}
+
+	int parent = mNodes[ leaf ].parent;
+	int grandParent = mNodes[ parent ].parent;
+	int sibling = mNodes[ parent ].child1 == leaf ? mNodes[ parent ].child2 : mNodes[ parent ].child1;
+
+	mNodes[ leaf ].parent = NULL_NODE;
+
+	if( grandParent == NULL_NODE )
+	{
+		mRoot = sibling;
+		mNodes[ sibling ].parent = NULL_NODE;
+		_freeNode( parent );
+		return;
+	}
+
+	//replace the parent with the sibling
+	if( mNodes[ grandParent ].child1 == parent )
+		mNodes[ grandParent ].child1 = sibling;
+	else
+		mNodes[ grandParent ].child2 = sibling;
+
+	mNodes[ sibling ].parent = grandParent;
+	_freeNode( parent );
+
+	for( int index = grandParent; index != NULL_NODE; index = mNodes[ index ].parent )
+	{
+		index = _balance( index );
+		_refit( index );
+	}
+}
+
+int AABBTree::_balance( int iA )
+{
+	Node& A = mNodes[ iA ];
+	if( A.isLeaf() || A.height < 2 )
+		return iA;
+
+	int iB = A.child1;
+	int iC = A.child2;
+
+	int balance = mNodes[ iC ].height - mNodes[ iB ].height;
+
+	if( balance >= -1 && balance <= 1 )
+		return iA;
+
+	//rotate the taller child up
+	int iUp = balance > 1 ? iC : iB;
+	Node& up = mNodes[ iUp ];
+
+	int iF = up.child1;
+	int iG = up.child2;
+
+	//swap A and the child
+	up.child1 = iA;
+	up.parent = A.parent;
+	A.parent = iUp;
+
+	if( up.parent != NULL_NODE )
+	{
+		if( mNodes[ up.parent ].child1 == iA )
+			mNodes[ up.parent ].child1 = iUp;
+		else
+			mNodes[ up.parent ].child2 = iUp;
+	}
+	else
+		mRoot = iUp;
+
+	//the taller grandchild stays with the rotated child, the other one goes to A in place of the rotated child
+	int iTall = mNodes[ iF ].height > mNodes[ iG ].height ? iF : iG;
+	int iShort = iTall == iF ? iG : iF;
+
+	up.child2 = iTall;
+
+	if( iUp == iC )
+		A.child2 = iShort;
+	else
+		A.child1 = iShort;
+
+	mNodes[ iShort ].parent = iA;
+
+	_refit( iA );
+	_refit( iUp );
+
+	return iUp;
+}
+
+void AABBTree::add( Renderable& r )
+{
+	DEBUG_ASSERT( r._getSpatialProxy() < 0, "This Renderable is already in a SpatialIndex" );
+
+	int leaf = _allocateNode();
+	Node& n = mNodes[ leaf ];
+	n.object = &r;
+
+	r._setSpatialProxy( leaf );
+
+	if( !_isValidAABB( r.getWorldMin(), r.getWorldMax() ) )
+	{
+		n.unbounded = true;
+		mUnbounded.push_back( leaf );
+		return;
+	}
+
+	_setFatAABB( n, r.getWorldMin(), r.getWorldMax() );
+	_insertLeaf( leaf );
+}
+
+void AABBTree::remove( Renderable& r )
+{
+	int leaf = r._getSpatialProxy();
+
+	DEBUG_ASSERT( leaf >= 0 && mNodes[ leaf ].object == &r, "This Renderable is not in this AABBTree" );
+
+	if( mNodes[ leaf ].unbounded )
+		mUnbounded.erase( std::find( mUnbounded.begin(), mUnbounded.end(), leaf ) );
+	else
+		_removeLeaf( leaf );
+
+	_freeNode( leaf );
+
+	r._setSpatialProxy( -1 );
+}
+
+void AABBTree::update( Renderable& r )
+{
+	int leaf = r._getSpatialProxy();
+
+	DEBUG_ASSERT( leaf >= 0 && mNodes[ leaf ].object == &r, "This Renderable is not in this AABBTree" );
+
+	const Vector& min = r.getWorldMin();
+	const Vector& max = r.getWorldMax();
+	bool valid = _isValidAABB( min, max );
+
+	if( mNodes[ leaf ].unbounded )
+	{
+		if( !valid )
+			return;
+
+		mUnbounded.erase( std::find( mUnbounded.begin(), mUnbounded.end(), leaf ) );
+		mNodes[ leaf ].unbounded = false;
+	}
+	else
+	{
+		//still inside the fat AABB, nothing to do
+		if( valid && _contains( mNodes[ leaf ].min, mNodes[ leaf ].max, min, max ) )
+			return;
+
+		_removeLeaf( leaf );
+
+		if( !valid )
+		{
+			mNodes[ leaf ].unbounded = true;
+			mUnbounded.push_back( leaf );
+			return;
+		}
+	}
+
+	_setFatAABB( mNodes[ leaf ], min, max );
+	_insertLeaf( leaf );
+}
+
+void AABBTree::clear()
+{
+	for( auto& n : mNodes )
+	{
+		if( n.object )
+			n.object->_setSpatialProxy( -1 );
+	}
+
+	mNodes.clear();
+	mUnbounded.clear();
+	mRoot = mFreeList = NULL_NODE;
+}
+
+void AABBTree::query( const Viewport& viewport, ResultList& result ) const
+{
+	for( int leaf : mUnbounded )
+		result.push_back( mNodes[ leaf ].object );
+
+	if( mRoot == NULL_NODE )
+		return;
+
+	mStack.clear();
+	mStack.push_back( mRoot );
+
+	while( mStack.size() )
+	{
+		const Node& n = mNodes[ mStack.back() ];
+		mStack.pop_back();
+
+		if( !viewport.isInFrustum( n.min, n.max ) )
+			continue;
+
+		if( n.isLeaf() )
+			result.push_back( n.object );
+		else
+		{
+			mStack.push_back( n.child1 );
+			mStack.push_back( n.child2 );
+		}
+	}
+}
@@ -71,7 +71,10 @@ void AnimatedQuad::reset()
 		animation->setup(NULL, 0);
 	
 	setTexture( NULL );
-	mesh = gameState->getMesh( "texturedQuad" );
+
+	//every quad does this, don't hash the name each time
+	static const ResourceID texturedQuad = ResourceNames::intern( "texturedQuad" );
+	mesh = gameState->getMesh( texturedQuad );
 
 	DEBUG_ASSERT( mesh, "AnimatedQuad requires a quad mesh called 'texturedQuad' to be loaded (use addPrefabMeshes to load one)" );
 }
@@ -3,6 +3,8 @@
 #include "BackgroundQueue.h"
 
 #include "Platform.h"
+#include "Timer.h"
+#include "Profiler.h"
 
 using namespace Dojo;
 
@@ -10,29 +12,167 @@ const BackgroundQueue::Callback BackgroundQueue::NOP_CALLBACK = [](){};
 
 BackgroundQueue::BackgroundQueue( int poolSize /* = -1 */ ) :
 	mRunning( true ),
+	mPendingJobs( 0 ),
+	mFreeSlots( 0 ),
 	mCompletedQueue( new CompletedTaskQueue ),
-	mQueue( new TaskQueue )
+	mStatsStartTime( Timer::currentTime() )
 {
 	mMainThreadID = std::this_thread::get_id();
 
 	if (poolSize < 0)
 		poolSize = std::thread::hardware_concurrency();
 
-	//create the thread pool
-	for( int i = 0; i < poolSize; ++i )
-		mWorkers.push_back( Unique<Worker>(new Worker(this)) );
+	mFreeSlots = poolSize;
+
+	//create the thread pool, with spare threads to replace the blocked ones
+	for( int i = 0; i < poolSize * 2; ++i )
+		mWorkers.push_back( Unique<Worker>(new Worker(this, i)) );
+
+	//the workers look at each other, start them only when the list is complete
+	for( auto& w : mWorkers )
+		w->start();
+}
+
+void BackgroundQueue::stop()
+{
+	if( mRunning )
+	{
+		{
+			std::lock_guard< std::mutex > lock( mParkMutex );
+			mRunning = false;
+		}
+		mParkCondition.notify_all();
+
+		for( auto& w : mWorkers )
+			w->join();
+	}
+}
+
+BackgroundQueue::Worker* BackgroundQueue::_getCurrentWorker() const
+{
+	auto id = std::this_thread::get_id();
+
+	if( id != mMainThreadID )
+	{
+		for( auto& w : mWorkers )
+		{
+			if( w->getID() == id )
+				return w.get();
+		}
+	}
+	return nullptr;
 }
 
-void BackgroundQueue::queueTask( const Task& task, const Callback& callback )
+void BackgroundQueue::_wakeWorker()
+{
+	//taking the lock ensures that the worker is either waiting or will see the change
+	{
+		std::lock_guard< std::mutex > lock( mParkMutex );
+	}
+	mParkCondition.notify_one();
+}
+
+void BackgroundQueue::_push( Job&& job )
+{
+	Worker* self = _getCurrentWorker();
+
+	if( self )
+		self->push( std::move( job ) );
+	else
+	{
+		std::lock_guard< std::mutex > lock( mInjectionMutex );
+		mInjectionQueue[ job.priority ].push_back( std::move( job ) );
+	}
+
+	++mPendingJobs;
+
+	_wakeWorker();
+}
+
+bool BackgroundQueue::_findJob( Worker* self, Job& out )
+{
+	int n = mWorkers.size();
+	int first = self ? self->getIndex() + 1 : 0;
+
+	for( int p = 0; p < _PRIORITY_COUNT; ++p )
+	{
+		Priority priority = (Priority)p;
+
+		//own work first, it's the most likely to be hot in the cache
+		if( self && self->pop( priority, out ) )
+		{
+			--mPendingJobs;
+			return true;
+		}
+
+		{
+			std::lock_guard< std::mutex > lock( mInjectionMutex );
+
+			auto& queue = mInjectionQueue[ p ];
+			if( queue.size() )
+			{
+				out = std::move( queue.front() );
+				queue.pop_front();
+
+				--mPendingJobs;
+				return true;
+			}
+		}
+
+		for( int i = 0; i < n; ++i )
+		{
+			Worker* victim = mWorkers[ (first + i) % n ].get();
+
+			if( victim != self && victim->steal( priority, out ) )
+			{
+				if( self )
+					++self->stolenCount;
+
+				--mPendingJobs;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool BackgroundQueue::_waitForJobOrClose( Worker& self, Job& out )
+{
+	while( true )
+	{
+		{
+			std::unique_lock< std::mutex > lock( mParkMutex );
+
+			mParkCondition.wait( lock, [this]() { return !mRunning || (mPendingJobs > 0 && mFreeSlots > 0); } );
+
+			if( !mRunning )
+				return false;
+
+			--mFreeSlots;
+		}
+
+		if( _findJob( &self, out ) )
+			return true;
+
+		//another worker took it first
+		++mFreeSlots;
+		std::this_thread::yield();
+	}
+}
+
+void BackgroundQueue::queueTask( const Task& task, const Callback& callback, Priority priority )
 {
     //debug sync mode
     if( mWorkers.empty() )
     {
         task();
-        callback();
+
+		if( callback )
+			callback();
     }
     else
-		mQueue->queue(TaskCallbackPair(task, callback));
+		_push( Job( task, callback, priority ) );
 }
 
 void BackgroundQueue::queueOnMainThread( const Callback& c )
@@ -40,7 +180,56 @@ void BackgroundQueue::queueOnMainThread( const Callback& c )
 	if( std::this_thread::get_id() == mMainThreadID ) //is this already the main thread? just execute
 		c();
 	else
+	{
+		std::lock_guard< std::mutex > lock( mCompletedQueueMutex );
 		mCompletedQueue->queue(c);
+	}
+}
+
+void BackgroundQueue::parallelFor( int count, const std::function< void( int ) >& body )
+{
+	if( count <= 0 )
+		return;
+
+	//the state is shared, as a helper could start after this call has returned and find nothing left to do
+	struct ParallelJob
+	{
+		std::function< void( int ) > body;
+		int count;
+		std::atomic< int > next, done;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	auto job = std::make_shared< ParallelJob >();
+	job->body = body;
+	job->count = count;
+	job->next = 0;
+	job->done = 0;
+
+	auto work = [job]()
+	{
+		for( int i = job->next++; i < job->count; i = job->next++ )
+		{
+			job->body( i );
+
+			if( ++job->done == job->count )
+			{
+				std::lock_guard< std::mutex > lock( job->mutex );
+				job->finished.notify_all();
+			}
+		}
+	};
+
+	int helpers = std::min( (int)mWorkers.size(), count - 1 );
+	for( int i = 0; i < helpers; ++i )
+		_push( Job( work, Callback(), PRIORITY_HIGH ) );
+
+	//the caller works too, so nothing can wait for an iteration that nobody started
+	work();
+
+	std::unique_lock< std::mutex > lock( job->mutex );
+	job->finished.wait( lock, [&]() { return job->done == job->count; } );
 }
 
 void BackgroundQueue::fireCompletedCallbacks()
@@ -52,27 +241,130 @@ void BackgroundQueue::fireCompletedCallbacks()
 		callback();
 }
 
-BackgroundQueue::Worker::Worker(BackgroundQueue* parent) :
-pParent(parent)
+float BackgroundQueue::getWorkerUtilization( int worker ) const
+{
+	DEBUG_ASSERT( worker >= 0 && worker < getWorkerCount(), "Invalid worker index" );
+
+	double elapsed = Timer::currentTime() - mStatsStartTime;
+
+	return elapsed > 0 ? (float)( mWorkers[ worker ]->busyMicroseconds * 0.000001 / elapsed ) : 0.f;
+}
+
+int BackgroundQueue::getWorkerTaskCount( int worker, int* stolen ) const
+{
+	DEBUG_ASSERT( worker >= 0 && worker < getWorkerCount(), "Invalid worker index" );
+
+	if( stolen )
+		*stolen = mWorkers[ worker ]->stolenCount;
+
+	return mWorkers[ worker ]->taskCount;
+}
+
+void BackgroundQueue::resetStats()
+{
+	for( auto& w : mWorkers )
+	{
+		w->busyMicroseconds = 0;
+		w->taskCount = 0;
+		w->stolenCount = 0;
+	}
+
+	mStatsStartTime = Timer::currentTime();
+}
+
+BackgroundQueue::Blocking::Blocking( BackgroundQueue& queue ) :
+	pQueue( &queue ),
+	mActive( queue._getCurrentWorker() != nullptr )
+{
+	//give the slot to another worker for the duration of the call
+	if( mActive )
+	{
+		++pQueue->mFreeSlots;
+		pQueue->_wakeWorker();
+	}
+}
+
+BackgroundQueue::Blocking::~Blocking()
+{
+	//this can briefly run more tasks than the pool size, until one ends
+	if( mActive )
+		--pQueue->mFreeSlots;
+}
+
+BackgroundQueue::Worker::Worker(BackgroundQueue* parent, int index) :
+busyMicroseconds( 0 ),
+taskCount( 0 ),
+stolenCount( 0 ),
+pParent(parent),
+mIndex( index )
 {
 	DEBUG_ASSERT(pParent, "the parent can't be null");
+}
 
-	thread = std::thread([&]()
+void BackgroundQueue::Worker::start()
+{
+	thread = std::thread([this]()
 	{
-		Platform::singleton().prepareThreadContext();
+		_run();
+	});
+}
 
-		while( 1 )
-		{
-			TaskCallbackPair pair;
+void BackgroundQueue::Worker::push( Job&& job )
+{
+	std::lock_guard< std::mutex > lock( mMutex );
+	mJobs[ job.priority ].push_back( std::move( job ) );
+}
+
+bool BackgroundQueue::Worker::pop( Priority p, Job& out )
+{
+	std::lock_guard< std::mutex > lock( mMutex );
+
+	auto& jobs = mJobs[ p ];
+	if( jobs.empty() )
+		return false;
+
+	out = std::move( jobs.back() );
+	jobs.pop_back();
+	return true;
+}
+
+bool BackgroundQueue::Worker::steal( Priority p, Job& out )
+{
+	std::lock_guard< std::mutex > lock( mMutex );
+
+	auto& jobs = mJobs[ p ];
+	if( jobs.empty() )
+		return false;
 
-			if( !pParent->_waitForTaskOrClose( pair ) ) //wait for a new task or close
-				break;
+	out = std::move( jobs.front() );
+	jobs.pop_front();
+	return true;
+}
+
+void BackgroundQueue::Worker::_run()
+{
+	Platform::singleton().prepareThreadContext();
 
-			pair.first(); //execute the task
+	Job job;
 
-			//push the callback on the completed queue
-			pParent->queueOnMainThread( pair.second );
+	while( pParent->_waitForJobOrClose( *this, job ) ) //wait for a new task or close
+	{
+		double start = Timer::currentTime();
+
+		{
+			DOJO_PROFILE_ZONE( "BackgroundQueue task" );
+			job.task(); //execute the task
 		}
-	});
+
+		busyMicroseconds += (int64_t)( (Timer::currentTime() - start) * 1000000.0 );
+		++taskCount;
+
+		++pParent->mFreeSlots;
+
+		//push the callback on the completed queue
+		if( job.callback )
+			pParent->queueOnMainThread( job.callback );
+
+		job = Job(); //release the captures now
+	}
 }
-	
\ No newline at end of file
@@ -25,6 +25,11 @@ void Dojo::DEFAULT_ASSERT_HANDLER( const char* desc, const char* arg, const char
 
 	DEBUG_MESSAGE( "Function: " + String(function) + " in " + String(file) + " @ " + String(line) );
 
+	//the messages would wait for the next frame, which might never come
+	//don't wait for a flush that is already running, the assert could be inside one of its listeners
+	if( gp_log )
+		gp_log->tryFlush();
+
 	//either catch this as a breakpoint in the debugger or abort (if not debugged)
 #if defined( PLATFORM_IOS ) || defined( PLATFORM_OSX )
     
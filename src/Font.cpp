@@ -198,10 +198,13 @@ void Font::Character::init( Page* p, unichar c, int x, int y, int sx, int sy, FT
 
 Font::Page::Page( Font* f, int idx ) :
 Resource(),
+font( f ),
+texture( NULL ),
 index( idx ),
 firstCharIdx( index * FONT_CHARS_PER_PAGE ),
-font( f ),
-texture( NULL )
+mPreparedPixels( nullptr ),
+mPreparedWidth( 0 ),
+mPreparedHeight( 0 )
 {
 	DEBUG_ASSERT( font, "Page needs a non-null parent font" );
 
@@ -209,13 +212,14 @@ texture( NULL )
 }
 
 Font::Page::~Page() {
+	free(mPreparedPixels);
 	SAFE_DELETE(texture);
 }
 
 
-bool Font::Page::onLoad()
+byte* Font::Page::_rasterize( int& width, int& height )
 {
-	//create the texture
+	//the size of the texture
 	int sx = font->mCellWidth * FONT_PAGE_SIDE;
 	int sy = font->mCellHeight * FONT_PAGE_SIDE;
 
@@ -223,6 +227,9 @@ bool Font::Page::onLoad()
 	int sxp2 = npot ? sx : Math::nextPowerOfTwo( sx );
 	int syp2 = npot ? sy : Math::nextPowerOfTwo( sy );
 
+	width = sxp2;
+	height = syp2;
+
 	int pixelNumber = sxp2 * syp2;
 	int bufsize = pixelNumber * 4;
 	byte* buf = (byte*)malloc( bufsize );
@@ -320,6 +327,25 @@ bool Font::Page::onLoad()
 		free( glowBuf );
 	}
 
+	return buf;
+}
+
+void Font::Page::onPrepare()
+{
+	if( !isLoaded() && !mPreparedPixels )
+		mPreparedPixels = _rasterize( mPreparedWidth, mPreparedHeight );
+}
+
+bool Font::Page::onLoad()
+{
+	//use the pixels rasterized by onPrepare() if there are any
+	int sxp2 = mPreparedWidth, syp2 = mPreparedHeight;
+	byte* buf = mPreparedPixels;
+	mPreparedPixels = nullptr;
+
+	if( !buf )
+		buf = _rasterize( sxp2, syp2 );
+
 	//drop the buffer in the texture
 	loaded = texture->loadFromMemory( buf, sxp2, syp2, GL_RGBA, GL_RGBA );
 	texture->disableBilinearFiltering();
@@ -345,7 +371,8 @@ void Font::Page::onUnload(bool soft /*= false */) {
 /// --------------------------------------------------------------------------------
 
 Font::Font( ResourceGroup* creator, const String& path ) :
-Resource( creator, path )
+Resource( creator, path ),
+mDescriptionLoaded( false )
 {
 
 }
@@ -355,10 +382,8 @@ Font::~Font()
 
 }
 
-bool Font::onLoad()
+void Font::_loadDescription()
 {
-	DEBUG_ASSERT( !isLoaded(), "onLoad: this font is already loaded" );
-
 	Table t = Platform::singleton().load( filePath );
 
 	fontFile = Utils::getDirectory( filePath ) + '/' + t.getString( "truetype" );
@@ -380,17 +405,50 @@ bool Font::onLoad()
 
 	face = Platform::singleton().getFontSystem().getFace( fontFile );
 
+	//create the pages, they are loaded with the others
 	auto& preload = t.getTable( "preloadedPages" );
 	for( int i = 0; i < preload.getArrayLength(); ++i )
-		getPage( preload.getInt( i ) );
+	{
+		int index = preload.getInt( i );
+
+		DEBUG_ASSERT( index < FONT_MAX_PAGES, "preloadedPages: page index is past the max page index" );
+
+		if( pages.find( index ) == pages.end() )
+			pages[ index ] = new Page( this, index );
+	}
+
+	mDescriptionLoaded = true;
+}
+
+void Font::onPrepare()
+{
+	if( isLoaded() )
+		return;
+
+	if( !mDescriptionLoaded )
+		_loadDescription();
 
-	//load existing pages that were trimmed during a previous unload
+	for( auto& pair : pages )
+		pair.second->onPrepare();
+}
+
+bool Font::onLoad()
+{
+	DEBUG_ASSERT( !isLoaded(), "onLoad: this font is already loaded" );
+
+	if( !mDescriptionLoaded )
+		_loadDescription();
+
+	//load the preloaded pages, and the existing pages that were trimmed during a previous unload
 	for( auto& pair : pages )
 	{
 		if( !pair.second->isLoaded() )
 			pair.second->onLoad();
 	}
 
+	//the next load reads the description again
+	mDescriptionLoaded = false;
+
 	return loaded = true;
 }
 
@@ -444,9 +502,9 @@ int Font::getPixelLength( const String& str )
 
 	Character* lastChar = nullptr;
 
-	for( size_t i = 0; i < str.size(); ++i )
+	for( unichar c : str.codepoints() )
 	{
-		Character* chr = getCharacter( str[i] );
+		Character* chr = getCharacter( c );
 		l += (int)(chr->advance * chr->pixelWidth);
 		
 		if( lastChar && isKerningEnabled() )
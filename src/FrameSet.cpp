@@ -61,6 +61,12 @@ void FrameSet::setAtlas( const Table& atlasTable, ResourceGroup& atlasTexturePro
 	}
 }
 
+void FrameSet::onPrepare()
+{
+	for( int i = 0; i < frames.size(); ++i )
+		frames[i]->onPrepare();
+}
+
 bool FrameSet::onLoad()
 {			
 	DEBUG_ASSERT( !isLoaded(), "onLoad: this FrameSet is already loaded" );
@@ -9,6 +9,8 @@
 #include "Platform.h"
 #include "TouchArea.h"
 #include "InputSystem.h"
+#include "Renderer.h"
+#include "BackgroundQueue.h"
 
 using namespace Dojo;
 
@@ -16,8 +18,10 @@ GameState::GameState( Game* parentGame ) :
 Object( this, Vector::ZERO, Vector::ONE ),
 ResourceGroup(),
 game( parentGame ),
+camera(nullptr),
 timeElapsed(0),
-camera(nullptr)
+mTasks( Platform::singleton().getBackgroundQueue() ),
+mParallelUpdate( false )
 {
 	gameState = this; //useful to pass a GameState around as an Object
 }
@@ -29,14 +33,23 @@ GameState::~GameState()
 
 void GameState::clear()
 {		
+	DEBUG_ASSERT( !mParallelUpdate, "A GameState can't be cleared during the parallel update" );
+
+	//the pending work would refer to what's being destroyed
+	mTasks.cancel();
+
 	destroyAllChildren();
 
+	mTransforms.clear();
+
 	//flush resources
 	unloadResources( false );
 }
 
 void GameState::setViewport( Viewport& v )
 {
+	DEBUG_ASSERT( !mParallelUpdate, "The Viewport can't be changed during the parallel update, use runSerially()" );
+
 	camera = &v;
 	
 	Platform::singleton().getRenderer().addViewport( v );
@@ -70,12 +83,14 @@ void GameState::touchAreaAtPoint( const Touch& touch )
 
 void GameState::addTouchArea(TouchArea* t) {
 	DEBUG_ASSERT(t != nullptr, "addTouchArea: area passed was null");
+	DEBUG_ASSERT( !mParallelUpdate, "TouchAreas can't be added during the parallel update, use runSerially()" );
 
 	mTouchAreas.push_back(t);
 }
 
 void GameState::removeTouchArea(TouchArea* t) {
 	DEBUG_ASSERT(t != nullptr, "removeTouchArea: area passed was null");
+	DEBUG_ASSERT( !mParallelUpdate, "TouchAreas can't be removed during the parallel update, use runSerially()" );
 
 	auto elem = std::find(mTouchAreas.begin(), mTouchAreas.end(), t);
 	if (elem != mTouchAreas.end())
@@ -98,3 +113,64 @@ void GameState::updateClickableState()
 	for( auto ta : mTouchAreas )
 		ta->_fireOnTouchUsingCurrentTouches();
 }
+
+void GameState::runSerially( const std::function< void() >& f )
+{
+	if( !mParallelUpdate )
+		f();
+	else
+	{
+		std::lock_guard< std::mutex > lock( mSerialCallsMutex );
+		mSerialCalls.push_back( f );
+	}
+}
+
+void GameState::updateChildsParallel( float dt )
+{
+	mParallelChilds.clear();
+
+	for( auto& child : childs )
+	{
+		if( child->isActive() && child->isIndependent() )
+			mParallelChilds.push_back( child.get() );
+	}
+
+	if( mParallelChilds.size() )
+	{
+		Renderer& renderer = Platform::singleton().getRenderer();
+
+		//parallel phase: each independent subtree is a task
+		mParallelUpdate = true;
+		renderer._setParallelUpdate( true );
+
+		auto queue = Platform::singleton().getBackgroundQueue();
+		auto update = [this, dt]( int i )
+		{
+			mParallelChilds[ i ]->onAction( dt );
+		};
+
+		if( queue )
+			queue->parallelFor( mParallelChilds.size(), update );
+		else
+		{
+			for( int i = 0; i < (int)mParallelChilds.size(); ++i )
+				update( i );
+		}
+
+		//barrier passed, apply what was deferred
+		renderer._setParallelUpdate( false );
+		mParallelUpdate = false;
+
+		for( auto& f : mSerialCalls )
+			f();
+
+		mSerialCalls.clear();
+	}
+
+	//serial phase
+	for( auto& child : childs )
+	{
+		if( child->isActive() && !child->isIndependent() )
+			child->onAction( dt );
+	}
+}
@@ -6,6 +6,7 @@
 #include "Platform.h"
 #include "InputDevice.h"
 #include "InputSystemListener.h"
+#include "Profiler.h"
 
 using namespace Dojo;
 
@@ -104,6 +105,8 @@ Touch* InputSystem::_popExistingTouch(const Vector& point, Touch::Type type) {
 
 void InputSystem::poll(float dt)
 {
+	DOJO_PROFILE_ZONE( "InputSystem::poll" );
+
 	//update all the touches
 	for( auto touch : mTouchList )
 		touch->_update();
@@ -1,41 +1,138 @@
 #include "stdafx.h"
 
 #include "Log.h"
-#include "Platform.h"
-#include "BackgroundQueue.h"
 #include "LogListener.h"
+#include "dojomath.h"
 
 using namespace Dojo;
 
-void Log::_append( const String& message, LogEntry::Level level )
+Log::Log( int maxLines, int capacity ) :
+	mMaxLines( maxLines ),
+	mRecords( Math::nextPowerOfTwo( capacity ) ),
+	mMask( (unsigned int)mRecords.size() - 1 ),
+	mAppendPosition( 0 ),
+	mFlushPosition( 0 ),
+	mDropped( 0 ),
+	mReportedDropped( 0 ),
+	mFlushThread( std::thread::id() )
 {
-	mOutput.push_back( LogEntry( message, level ) );
+	DEBUG_ASSERT( mMaxLines > 0, "Cannot create a Log with 0 or less lines" );
+	DEBUG_ASSERT( capacity > 0, "Cannot create a Log with 0 or less records" );
 
-	if( mOutput.size() == mMaxLines )
-		mOutput.erase( mOutput.begin() );
+	//each record is free for the append at its own position
+	for( unsigned int i = 0; i < mRecords.size(); ++i )
+		mRecords[ i ].sequence.store( i, std::memory_order_relaxed );
+}
 
-	_fireOnLogUpdated( getLastMessage() );
+Log::~Log()
+{
+	flush();
 }
 
-///appends another message to the log, with an optional severity level
 void Log::append( const String& message, LogEntry::Level level )
 {
-	//execute the appending & notifying on the main thread!
-	auto q = Platform::singleton().getBackgroundQueue();
-	
-	//this hack is needed before we need Log to exist ASAP, even before a BackgroundQueue is created
-	//and anyway, when there's no BQ there should be no sync problems
-	if( q )
-		q->queueOnMainThread(
-		[&]()
+	unsigned int position = mAppendPosition.load( std::memory_order_relaxed );
+	Record* record;
+
+	//claim the record at the append position, unless another thread is faster
+	while( true )
+	{
+		record = &mRecords[ position & mMask ];
+
+		int difference = (int)( record->sequence.load( std::memory_order_acquire ) - position );
+
+		if( difference == 0 )
+		{
+			if( mAppendPosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+				break;
+		}
+		else if( difference < 0 ) //the record wasn't flushed yet, the ring is full
 		{
-			_append(message,level);
-		} );
-	else
-		_append(message,level);
+			++mDropped;
+			return;
+		}
+		else
+			position = mAppendPosition.load( std::memory_order_relaxed );
+	}
+
+	record->level = level;
+	record->timestamp = time( NULL );
+	record->thread = std::this_thread::get_id();
+
+	record->length = (int)Unicode::truncateUTF8( message.data(), message.size(), MESSAGE_MAX_LENGTH );
+	memcpy( record->text, message.data(), record->length );
+
+	//publish it to the flush
+	record->sequence.store( position + 1, std::memory_order_release );
+}
+
+void Log::flush()
+{
+	std::lock_guard< std::mutex > lock( mFlushMutex );
+
+	_flush();
+}
+
+bool Log::tryFlush()
+{
+	//a listener of this very flush could be the caller, and it would deadlock on the mutex
+	if( mFlushThread.load() == std::this_thread::get_id() )
+		return false;
+
+	std::unique_lock< std::mutex > lock( mFlushMutex, std::try_to_lock );
+
+	if( !lock.owns_lock() )
+		return false;
+
+	_flush();
+	return true;
+}
+
+void Log::_flush()
+{
+	mFlushThread = std::this_thread::get_id();
+
+	while( true )
+	{
+		Record& record = mRecords[ mFlushPosition & mMask ];
+
+		//stop at the first record that isn't complete, the ones after it will be there at the next flush
+		if( record.sequence.load( std::memory_order_acquire ) != mFlushPosition + 1 )
+			break;
+
+		mOutput.push_back( LogEntry(
+			String( record.text, record.length ),
+			record.level,
+			record.timestamp,
+			record.thread ) );
+
+		//free the record for the append that will wrap around to it
+		record.sequence.store( mFlushPosition + mMask + 1, std::memory_order_release );
+		++mFlushPosition;
+
+		_fireOnLogUpdated( mOutput.back() );
+
+		if( mOutput.size() > (size_t)mMaxLines )
+			mOutput.pop_front();
+	}
+
+	//say that something is missing, at the point where it went missing
+	int dropped = mDropped;
+	if( dropped > mReportedDropped )
+	{
+		mOutput.push_back( LogEntry( String( dropped - mReportedDropped ) + " log messages were dropped, the Log capacity is too small", LogEntry::EL_WARNING ) );
+		mReportedDropped = dropped;
+
+		_fireOnLogUpdated( mOutput.back() );
+
+		if( mOutput.size() > (size_t)mMaxLines )
+			mOutput.pop_front();
+	}
+
+	mFlushThread = std::thread::id();
 }
 
 void Log::_fireOnLogUpdated(const LogEntry& e) {
 	for (auto listener : pListeners)
-		listener->onLogUpdated(this, getLastMessage());
+		listener->onLogUpdated(this, e);
 }
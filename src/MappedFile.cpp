@@ -0,0 +1,107 @@
+#include "stdafx.h"
+
+#include "MappedFile.h"
+
+#ifndef PLATFORM_WIN32
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace Dojo;
+
+#ifdef PLATFORM_WIN32
+
+MappedFile::MappedFile( const String& path ) :
+	mPath( path ),
+	mOpen( false ),
+	pData( nullptr ),
+	mSize( 0 ),
+	mFile( INVALID_HANDLE_VALUE ),
+	mMapping( NULL )
+{
+	mFile = CreateFileW( path.toWString().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+	if( mFile == INVALID_HANDLE_VALUE )
+		return;
+
+	LARGE_INTEGER size;
+	if( !GetFileSizeEx( mFile, &size ) )
+		return;
+
+	mSize = (size_t)size.QuadPart;
+
+	//an empty file can't be mapped, but it is still a valid file
+	if( mSize > 0 )
+	{
+		mMapping = CreateFileMappingW( mFile, NULL, PAGE_READONLY, 0, 0, NULL );
+
+		if( !mMapping )
+			return;
+
+		pData = (const byte*)MapViewOfFile( mMapping, FILE_MAP_READ, 0, 0, 0 );
+
+		if( !pData )
+			return;
+	}
+
+	mOpen = true;
+}
+
+MappedFile::~MappedFile()
+{
+	if( pData )
+		UnmapViewOfFile( pData );
+
+	if( mMapping )
+		CloseHandle( mMapping );
+
+	if( mFile != INVALID_HANDLE_VALUE )
+		CloseHandle( mFile );
+}
+
+#else
+
+MappedFile::MappedFile( const String& path ) :
+	mPath( path ),
+	mOpen( false ),
+	pData( nullptr ),
+	mSize( 0 ),
+	mFile( -1 )
+{
+	mFile = ::open( path.UTF8().c_str(), O_RDONLY );
+
+	if( mFile < 0 )
+		return;
+
+	struct stat info;
+	if( fstat( mFile, &info ) != 0 || !S_ISREG( info.st_mode ) )
+		return;
+
+	mSize = (size_t)info.st_size;
+
+	//an empty file can't be mapped, but it is still a valid file
+	if( mSize > 0 )
+	{
+		void* data = mmap( nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0 );
+
+		if( data == MAP_FAILED )
+			return;
+
+		pData = (const byte*)data;
+	}
+
+	mOpen = true;
+}
+
+MappedFile::~MappedFile()
+{
+	if( pData )
+		munmap( (void*)pData, mSize );
+
+	if( mFile >= 0 )
+		::close( mFile );
+}
+
+#endif
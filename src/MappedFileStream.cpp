@@ -0,0 +1,212 @@
+#include "stdafx.h"
+
+#include "MappedFileStream.h"
+#include "MappedFile.h"
+
+#include <zlib.h>
+
+using namespace Dojo;
+
+MappedFileStream::MappedFileStream( const String& path ) :
+	FileStream( path, false ),
+	mOffset( 0 ),
+	mStoredSize( 0 ),
+	mSize( 0 ),
+	mCompression( C_NONE ),
+	pData( nullptr ),
+	mPosition( 0 ),
+	mAccess( SA_BAD_FILE )
+{
+
+}
+
+MappedFileStream::MappedFileStream( const String& path, const Shared< MappedFile >& source, size_t offset, size_t storedSize, size_t size, Compression compression ) :
+	FileStream( path, false ),
+	mSource( source ),
+	mOffset( offset ),
+	mStoredSize( storedSize ),
+	mSize( size ),
+	mCompression( compression ),
+	pData( nullptr ),
+	mPosition( 0 ),
+	mAccess( SA_BAD_FILE )
+{
+	DEBUG_ASSERT( source && source->isOpen(), "The source MappedFile is not open" );
+	DEBUG_ASSERT( offset + storedSize <= source->getSize(), "The region is outside of the source file" );
+	DEBUG_ASSERT( compression != C_NONE || storedSize == size, "Uncompressed data must have the same size it is stored with" );
+}
+
+MappedFileStream::~MappedFileStream()
+{
+	if( isOpen() )
+		close();
+}
+
+MappedFileStream::Access MappedFileStream::open()
+{
+	DEBUG_ASSERT( !isOpen(), "The stream was already open" );
+
+	//a loose file is mapped only now, so that unopened streams are cheap
+	if( !mSource )
+	{
+		auto file = make_shared< MappedFile >( mPath );
+
+		if( !file->isOpen() )
+			return mAccess = SA_BAD_FILE;
+
+		mSource = file;
+		mStoredSize = mSize = file->getSize();
+	}
+
+	const byte* src = mSource->getData() + mOffset;
+
+	if( mCompression == C_NONE )
+		pData = src;
+	else if( _inflate( src ) )
+		pData = mInflated.data();
+	else
+		return mAccess = SA_BAD_FILE;
+
+	mPosition = 0;
+	return mAccess = SA_READONLY;
+}
+
+bool MappedFileStream::_inflate( const byte* src )
+{
+	DEBUG_ASSERT( mCompression == C_DEFLATE, "Unsupported compression" );
+
+	mInflated.resize( mSize );
+
+	if( mSize == 0 )
+		return true;
+
+	z_stream stream;
+	memset( &stream, 0, sizeof( stream ) );
+
+	//zip entries are raw deflate streams, without the zlib header
+	if( inflateInit2( &stream, -MAX_WBITS ) != Z_OK )
+		return false;
+
+	stream.next_in = (Bytef*)src;
+	stream.avail_in = (uInt)mStoredSize;
+	stream.next_out = mInflated.data();
+	stream.avail_out = (uInt)mSize;
+
+	int res = inflate( &stream, Z_FINISH );
+	inflateEnd( &stream );
+
+	DEBUG_ASSERT_INFO( res == Z_STREAM_END && stream.total_out == mSize, "Cannot inflate the file", "path = " + mPath );
+
+	return res == Z_STREAM_END && stream.total_out == mSize;
+}
+
+int MappedFileStream::readHead( byte* buf, int number )
+{
+	DEBUG_ASSERT( !isOpen(), "readHead: the stream is already open" );
+
+	if( mCompression == C_NONE )
+		return FileStream::readHead( buf, number );
+
+	number = (int)std::min( (size_t)number, mSize );
+
+	if( number <= 0 )
+		return 0;
+
+	z_stream stream;
+	memset( &stream, 0, sizeof( stream ) );
+
+	if( inflateInit2( &stream, -MAX_WBITS ) != Z_OK )
+		return 0;
+
+	stream.next_in = (Bytef*)( mSource->getData() + mOffset );
+	stream.avail_in = (uInt)mStoredSize;
+	stream.next_out = buf;
+	stream.avail_out = (uInt)number;
+
+	//inflate stops by itself when buf is full
+	inflate( &stream, Z_SYNC_FLUSH );
+	inflateEnd( &stream );
+
+	return number - (int)stream.avail_out;
+}
+
+void MappedFileStream::close()
+{
+	DEBUG_ASSERT( isOpen(), "Tried to close a stream which wasn't open" );
+
+	pData = nullptr;
+	mAccess = SA_BAD_FILE;
+
+	//free the inflated copy
+	std::vector< byte >().swap( mInflated );
+}
+
+long MappedFileStream::getSize()
+{
+	return (long)mSize;
+}
+
+const byte* MappedFileStream::getData()
+{
+	DEBUG_ASSERT( isOpen(), "The stream must be open" );
+
+	return pData;
+}
+
+MappedFileStream::Access MappedFileStream::getAccess()
+{
+	return mAccess;
+}
+
+long MappedFileStream::getCurrentPosition()
+{
+	DEBUG_ASSERT( isOpen(), "The stream must be open" );
+
+	return mPosition;
+}
+
+int MappedFileStream::seek( long offset, int fromWhere /*= SEEK_SET */ )
+{
+	DEBUG_ASSERT( isOpen(), "The stream must be open" );
+
+	long position;
+	if( fromWhere == SEEK_SET )
+		position = offset;
+	else if( fromWhere == SEEK_CUR )
+		position = mPosition + offset;
+	else if( fromWhere == SEEK_END )
+		position = (long)mSize + offset;
+	else
+	{
+		DEBUG_FAIL( "invalid seek origin" );
+		return -1;
+	}
+
+	if( position < 0 || position > (long)mSize )
+		return -1;
+
+	mPosition = position;
+	return 0;
+}
+
+int MappedFileStream::read( byte* buf, int number )
+{
+	DEBUG_ASSERT( isReadable(), "The stream must be open and readable" );
+
+	int toRead = (int)std::min( (long)number, (long)mSize - mPosition );
+
+	if( toRead <= 0 )
+		return 0;
+
+	memcpy( buf, pData + mPosition, toRead );
+	mPosition += toRead;
+	return toRead;
+}
+
+Stream* MappedFileStream::copy()
+{
+	if( !mSource )
+		return new MappedFileStream( mPath );
+
+	return new MappedFileStream( mPath, mSource, mOffset, mStoredSize, mSize, mCompression );
+}
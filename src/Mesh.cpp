@@ -4,12 +4,78 @@
 
 #include "Utils.h"
 #include "Platform.h"
+#include "FileStream.h"
 #include "Shader.h"
 #include "dojomath.h"
 #include "TriangleMode.h"
 
+#include "glm/gtc/matrix_inverse.hpp"
+
+#if defined( DOJO_SIMD_SSE )
+	#include <xmmintrin.h>
+#elif defined( DOJO_SIMD_NEON )
+	#include <arm_neon.h>
+#endif
+
 using namespace Dojo;
 
+//the few 4-wide float operations needed to find the bounds of the vertices
+#if defined( DOJO_SIMD_SSE )
+	typedef __m128 float4;
+
+	static inline float4 _set( float x, float y, float z, float w )	{	return _mm_setr_ps( x, y, z, w );	}
+	static inline void _store( float* p, float4 v )			{	_mm_storeu_ps( p, v );		}
+	static inline float4 _min( float4 a, float4 b )			{	return _mm_min_ps( a, b );	}
+	static inline float4 _max( float4 a, float4 b )			{	return _mm_max_ps( a, b );	}
+#elif defined( DOJO_SIMD_NEON )
+	typedef float32x4_t float4;
+
+	static inline float4 _set( float x, float y, float z, float w )	{	float v[] = { x, y, z, w }; return vld1q_f32( v );	}
+	static inline void _store( float* p, float4 v )			{	vst1q_f32( p, v );			}
+	static inline float4 _min( float4 a, float4 b )			{	return vminq_f32( a, b );	}
+	static inline float4 _max( float4 a, float4 b )			{	return vmaxq_f32( a, b );	}
+#else
+	struct float4
+	{
+		float v[4];
+	};
+
+	static inline float4 _set( float x, float y, float z, float w )	{	float4 r = { { x, y, z, w } }; return r;	}
+	static inline void _store( float* p, float4 a )			{	p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3];	}
+	static inline float4 _min( float4 a, float4 b )			{	return _set( std::min( a.v[0], b.v[0] ), std::min( a.v[1], b.v[1] ), std::min( a.v[2], b.v[2] ), std::min( a.v[3], b.v[3] ) );	}
+	static inline float4 _max( float4 a, float4 b )			{	return _set( std::max( a.v[0], b.v[0] ), std::max( a.v[1], b.v[1] ), std::max( a.v[2], b.v[2] ), std::max( a.v[3], b.v[3] ) );	}
+#endif
+
+//accumulates the bounds of count positions with COMPONENTS floats, each stride bytes apart
+template< int COMPONENTS >
+static void _accumulateBounds( const byte* ptr, int stride, Mesh::IndexType count, float4& lo, float4& hi )
+{
+	for( Mesh::IndexType i = 0; i < count; ++i, ptr += stride )
+	{
+		const float* p = (const float*)ptr;
+		float4 v = _set( p[0], p[1], COMPONENTS == 3 ? p[2] : 0.f, 0.f );
+
+		lo = _min( lo, v );
+		hi = _max( hi, v );
+	}
+}
+
+//converts count indices to the format of the mesh, returning the biggest one
+template< typename T >
+static Mesh::IndexType _convertIndices( T* dest, const Mesh::IndexType* src, int count, Mesh::IndexType base )
+{
+	Mesh::IndexType biggest = 0;
+
+	for( int i = 0; i < count; ++i )
+	{
+		Mesh::IndexType idx = src[i] + base;
+		biggest = std::max( biggest, idx );
+		dest[i] = (T)idx;
+	}
+
+	return biggest;
+}
+
 const GLuint glFeatureStateMap[] =
 {
 	GL_VERTEX_ARRAY, //VF_POSITION2D,
@@ -29,21 +95,46 @@ const int Mesh::VERTEX_FIELD_SIZES[] = {
 	2 * sizeof( GLfloat )
 };
 
+int Mesh::getVertexFieldSize(VertexField f, VertexFieldFormat format) {
+	switch (format)
+	{
+	case VertexFieldFormat::Short:
+		//3D positions are padded to 4 components, so that the next field stays aligned
+		return (f == VertexField::Position3D) ? 4 * sizeof(GLshort) : 2 * sizeof(GLshort);
+	case VertexFieldFormat::Byte:
+	case VertexFieldFormat::Int2_10_10_10:
+		return 4;
+	default:
+		return VERTEX_FIELD_SIZES[(int)f];
+	}
+}
+
+bool Mesh::arePackedNormalsAvailable() {
+#ifdef DOJO_PACKED_NORMALS_AVAILABLE
+	return GLEW_VERSION_3_3 || GLEW_ARB_vertex_type_2_10_10_10_rev;
+#else
+	return false;
+#endif
+}
+
 Mesh::Mesh(ResourceGroup* creator /*= nullptr */) :
 Resource(creator)
 {
 	//set all fields to zero
 	memset(vertexFieldOffset, 0xff, sizeof(vertexFieldOffset));
+	std::fill(std::begin(vertexFieldFormat), std::end(vertexFieldFormat), VertexFieldFormat::Default);
 
 	//default index size is 16
 	setIndexByteSize(sizeof(GLushort));
 }
 
-Mesh::Mesh(ResourceGroup* creator, const String& filePath) :
-Resource(creator, filePath) 
+Mesh::Mesh(ResourceGroup* creator, const String& filePath, const String& subMesh /*= String::EMPTY */) :
+Resource(creator, filePath),
+mSubMesh(subMesh)
 {
 	//set all fields to zero
 	memset(vertexFieldOffset, 0xff, sizeof(vertexFieldOffset));
+	std::fill(std::begin(vertexFieldFormat), std::end(vertexFieldFormat), VertexFieldFormat::Default);
 
 	//default index size is 16
 	setIndexByteSize(sizeof(GLushort));
@@ -53,6 +144,8 @@ Mesh::~Mesh() {
 #ifndef DOJO_DISABLE_VAOS
 	if (vertexArrayDesc)
 		glDeleteVertexArrays(1, &vertexArrayDesc);
+
+	vertexArrayDesc = 0;
 #endif
 
 	if (loaded)
@@ -64,24 +157,35 @@ void Mesh::destroyBuffers() {
 	cleanup = std::move(indices);
 }
 
-void Mesh::begin(int extimatedVerts /*= 1 */) {
+void Mesh::begin(int extimatedVerts /*= 1 */, int extimatedIndices /*= 0 */) {
 	//be sure that we aren't already building
 	DEBUG_ASSERT(extimatedVerts > 0, "begin: extimated vertices for this batch must be more than 0");
 	DEBUG_ASSERT(!isEditing(), "begin: this Mesh is already in Edit mode");
 
 	vertices.clear();
 	indices.clear();
-	vertices.reserve(extimatedVerts*vertexSize);
 
 	vertexCount = indexCount = 0;
 	currentVertex = nullptr;
 
+	reserve(extimatedVerts, extimatedIndices);
+
 	max = Vector::MIN;
 	min = Vector::MAX;
+	boundsVertexCount = 0;
+
+	//everything is rewritten, the appends will mark what changed
+	vertexDirty.clear();
+	indexDirty.clear();
 
 	editing = true;
 }
 
+void Mesh::reserve(IndexType additionalVertices, int additionalIndices /*= 0 */) {
+	vertices.reserve((vertexCount + additionalVertices) * vertexSize);
+	indices.reserve((indexCount + additionalIndices) * indexSize);
+}
+
 void Mesh::beginAppend() {
 	DEBUG_ASSERT(!isEditing(), "begin: this Mesh is already in Edit mode");
 	DEBUG_ASSERT(dynamic, "can't call append() on a static mesh");
@@ -92,6 +196,11 @@ void Mesh::beginAppend() {
 
 void Mesh::setIndexByteSize(byte bytenumber) {
 	DEBUG_ASSERT(!editing, "setIndexByteSize must be called BEFORE begin!");
+
+	_setIndexByteSize(bytenumber);
+}
+
+void Mesh::_setIndexByteSize(byte bytenumber) {
 	DEBUG_ASSERT(
 		bytenumber == 1 ||
 		bytenumber == 2 ||
@@ -125,6 +234,9 @@ void Mesh::setVertexFieldEnabled(VertexField f) {
 
 	_offset(f) = vertexSize;
 	vertexSize += VERTEX_FIELD_SIZES[(byte)f];
+
+	//the attribute pointers recorded in the VAO use the old layout
+	vertexArrayDirty = true;
 }
 
 void Mesh::setVertexFields(const std::initializer_list<VertexField>& fs) {
@@ -137,49 +249,102 @@ void Mesh::setDynamic(bool d) {
 	dynamic = d;
 }
 
+void Mesh::setStreaming(bool s) {
+	streaming = s;
+
+	if (streaming)
+		dynamic = true;
+}
+
 void Mesh::index(IndexType idx) {
-	DEBUG_ASSERT(isEditing(), "index: this Mesh is not in Edit mode");
-	DEBUG_ASSERT(idx <= indexMaxValue, "index: the index passed is too big to be contained in this mesh's index format, see setIndexByteSize");
+	appendIndices(&idx, 1);
+}
+
+void Mesh::appendIndices(const IndexType* src, int count, IndexType base /*= 0 */) {
+	DEBUG_ASSERT(isEditing(), "appendIndices: this Mesh is not in Edit mode");
+	DEBUG_ASSERT(count >= 0, "appendIndices: invalid index count");
 
 	auto curSize = indices.size();
-	indices.resize(curSize + indexSize);
+	indices.resize(curSize + count * indexSize);
+
+	byte* dest = indices.data() + curSize;
+	IndexType biggest;
 
 	switch (indexSize)
 	{
 	case 1:
-		indices.back() = idx;
+		biggest = _convertIndices((GLubyte*)dest, src, count, base);
 		break;
 	case 2:
-		*((unsigned short*)(indices.data() + curSize)) = idx;
+		biggest = _convertIndices((GLushort*)dest, src, count, base);
 		break;
-	case 4:
-		*((unsigned int*)(indices.data() + curSize)) = idx;
+	default:
+		biggest = _convertIndices((GLuint*)dest, src, count, base);
 		break;
 	}
 
-	++indexCount;
+	DEBUG_ASSERT(biggest <= indexMaxValue, "appendIndices: an index is too big to be contained in this mesh's index format, see setIndexByteSize");
+
+	_markIndicesDirty(indexCount, count);
+	indexCount += count;
 }
 
+Mesh::IndexType Mesh::appendVertices(IndexType count) {
+	DEBUG_ASSERT(isEditing(), "appendVertices: this Mesh is not in Edit mode");
+	DEBUG_ASSERT(!compressed, "appendVertices: the vertices of a compressed Mesh can't be edited");
 
-void Mesh::_prepareVertex(const Vector& v)
+	IndexType first = vertexCount;
+
+	vertices.resize(vertices.size() + count * vertexSize);
+	vertexCount += count;
+
+	_markVerticesDirty(first, count);
+	return first;
+}
+
+void Mesh::_prepareVertex()
 {
-	DEBUG_ASSERT( isEditing(), "_prepareVertex: this Mesh is not in Edit mode" );
+	DEBUG_ASSERT(!compressed, "Can't add single vertices to a compressed Mesh");
 
-	//grow the buffer to the needed size
-	auto curSize = vertices.size();
-	vertices.resize(curSize + vertexSize);
+	IndexType idx = appendVertices(1);
+	currentVertex = vertices.data() + idx * vertexSize;
+}
 
-	currentVertex = (byte*)vertices.data() + curSize;
+void Mesh::_updateBounds() {
+	if (boundsVertexCount >= (IndexType)vertexCount)
+		return;
+
+	//compressed positions can't go out of the bounds they were compressed with
+	if (hasCompressedPositions()) {
+		boundsVertexCount = vertexCount;
+		return;
+	}
+
+	bool position3D = isVertexFieldEnabled(VertexField::Position3D);
+	const byte* ptr = vertices.data() + boundsVertexCount * vertexSize + _offset(position3D ? VertexField::Position3D : VertexField::Position2D);
+	IndexType count = vertexCount - boundsVertexCount;
+
+	float4 lo = _set(min.x, min.y, min.z, 0.f);
+	float4 hi = _set(max.x, max.y, max.z, 0.f);
+
+	if (position3D)
+		_accumulateBounds<3>(ptr, vertexSize, count, lo, hi);
+	else
+		_accumulateBounds<2>(ptr, vertexSize, count, lo, hi);
 
-	min = Math::min(v, min);
-	max = Math::max(v, max);
+	float res[4];
+	_store(res, lo);
+	min = Vector(res[0], res[1], res[2]);
 
-	++vertexCount;
+	_store(res, hi);
+	max = Vector(res[0], res[1], res[2]);
+
+	boundsVertexCount = vertexCount;
 }
 
 int Mesh::vertex( float x, float y )
 {				
-	_prepareVertex(Vector(x,y));
+	_prepareVertex();
 
 	float* ptr = (float*)currentVertex;
 
@@ -191,7 +356,7 @@ int Mesh::vertex( float x, float y )
 
 int Mesh::vertex(const Vector& v) 
 {
-	_prepareVertex(v);
+	_prepareVertex();
 
 	if (isVertexFieldEnabled(VertexField::Position3D))
 		*((Vector*)currentVertex) = v;
@@ -229,8 +394,7 @@ void Mesh::appendRawVertexData(void* data, IndexType count) {
 	auto start = vertices.data() + oldSize;
 	memcpy(start, data, blobSize);
 
-	//TODO max and min??
-
+	_markVerticesDirty(vertexCount, count);
 	vertexCount += count;
 }
 
@@ -286,14 +450,33 @@ void Mesh::_getVertexFieldData(VertexField field, int& outComponents, GLenum& ou
 
 	switch (field)
 	{
-	case VertexField::Position2D: outComponentsType = GL_FLOAT; outComponents = 2; outNormalized = false; break;
-	case VertexField::Position3D: outComponentsType = GL_FLOAT; outComponents = 3; outNormalized = false; break;
-	case VertexField::Color: outComponentsType = GL_UNSIGNED_BYTE; outComponents = 4; outNormalized = true; break;
-	case VertexField::Normal: outComponentsType = GL_FLOAT; outComponents = 3; outNormalized = false; break;
+	case VertexField::Position2D: outComponents = 2; break;
+	case VertexField::Position3D: outComponents = 3; break;
+	case VertexField::Color: outComponentsType = GL_UNSIGNED_BYTE; outComponents = 4; outNormalized = true; return;
+	case VertexField::Normal: outComponents = 3; break;
+	default: outComponents = 2; break; //textures
+	}
 
-	default: //textures
+	switch (getVertexFieldFormat(field))
+	{
+	case VertexFieldFormat::Short:
+		//UVs are always positive
+		outComponentsType = (field >= VertexField::UV0) ? GL_UNSIGNED_SHORT : GL_SHORT;
+		outNormalized = true;
+		break;
+	case VertexFieldFormat::Byte:
+		outComponentsType = GL_BYTE;
+		outNormalized = true;
+		break;
+#ifdef DOJO_PACKED_NORMALS_AVAILABLE
+	case VertexFieldFormat::Int2_10_10_10:
+		outComponentsType = GL_INT_2_10_10_10_REV;
+		outComponents = 4; //packed formats always have 4 components
+		outNormalized = true;
+		break;
+#endif
+	default:
 		outComponentsType = GL_FLOAT;
-		outComponents = 2;
 		outNormalized = false;
 		break;
 	}
@@ -304,23 +487,24 @@ void Mesh::_bindAttribArrays( Shader* shader )
 	glBindBuffer( GL_ARRAY_BUFFER, vertexHandle );
 
 #ifdef DOJO_SHADERS_AVAILABLE
-	if( shader ) //use custom attributes only
+	//all the shaders have the built-in attributes at the same locations, so the shader doesn't matter
+	GLint components;
+	GLenum componentsType;
+	bool normalized;
+	void* offset;
+
+	for( int i = 0; i < (int)VertexField::_Count; ++i )
 	{
-		GLint components;
-		GLenum componentsType;
-		bool normalized;
-		void* offset;
+		VertexField ft = (VertexField)i;
+		GLuint location = Shader::getBuiltInAttributeLocation( ft );
 
-		for( auto& attr : shader->getAttributes() )
+		if( isVertexFieldEnabled( ft ) )
 		{
-			if( attr.second.builtInAttribute == VertexField::None || !isVertexFieldEnabled( attr.second.builtInAttribute ) )		//skip non-provided attributes
-				continue;
-
-			_getVertexFieldData( attr.second.builtInAttribute, components, componentsType, normalized, offset );
+			_getVertexFieldData( ft, components, componentsType, normalized, offset );
 
-			glEnableVertexAttribArray( attr.second.location );
+			glEnableVertexAttribArray( location );
 			glVertexAttribPointer(
-				attr.second.location,
+				location,
 				components,
 				componentsType,
 				normalized,
@@ -329,9 +513,10 @@ void Mesh::_bindAttribArrays( Shader* shader )
 
 			CHECK_GL_ERROR;
 		}
+		else if( location != Shader::getBuiltInAttributeLocation( VertexField::Position3D ) ) //the position is always there, in either form
+			glDisableVertexAttribArray( location );
 	}
-	else //fixed function vertex binding //TODO remove this
-#endif
+#else
 	{
 		//construct attributes
 		for( int i = 0; i < (int)VertexField::_Count; ++i )
@@ -367,6 +552,7 @@ void Mesh::_bindAttribArrays( Shader* shader )
 				glDisableClientState( state );
 		}
 	}
+#endif
 
 	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, isIndexed() ? indexHandle : 0 ); //only bind the index buffer if existing (duh)
 
@@ -384,63 +570,111 @@ bool Mesh::end()
 	if (getVertexCount() == 0)
 		return false;
 
+	_upload(vertices.data(), vertices.size(), indices.data(), indices.size());
+
+	currentVertex = nullptr;
+
+	if( !dynamic && vertexCount > BATCHABLE_VERTEX_MAX ) //won't be updated ever again, and it's too big to be batched
+		destroyBuffers();
+	
+	return loaded;
+}
+
+bool Mesh::_upload(const byte* vertexData, GLsizeiptr vertexBytes, const byte* indexData, GLsizeiptr indexBytes)
+{
+	//any thread that called Platform::prepareThreadContext() can upload, as the buffers are shared between the contexts
+	//the VAO isn't, so it is only created by bind() on the main thread
+
+#ifndef DOJO_DISABLE_VAOS
+	//don't change the element buffer of whatever VAO is bound
+	glBindVertexArray( 0 );
+#endif
+
 	//create the VBO
 	if( !vertexHandle )
+	{
 		glGenBuffers(1, &vertexHandle );
+		vertexArrayDirty = true;
+	}
 
-	GLenum usage = (dynamic) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
 	glBindBuffer(GL_ARRAY_BUFFER, vertexHandle);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), usage);
+	_uploadBuffer(GL_ARRAY_BUFFER, vertexData, vertexBytes, vertexCapacity, vertexDirty);
 
 	CHECK_GL_ERROR;
 
 	//create the IBO
-	if( isIndexed() ) //we support unindexed meshes
+	if( indexBytes > 0 || isIndexed() ) //we support unindexed meshes
 	{				
 		if( !indexHandle )
+		{
 			glGenBuffers(1, &indexHandle );
+			vertexArrayDirty = true;
+		}
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexHandle );
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), usage);
+		_uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, indexData, indexBytes, indexCapacity, indexDirty);
 
 		CHECK_GL_ERROR;						
 	}
 
-#ifndef DOJO_DISABLE_VAOS //if we're using VAOs
-	//create the VAO
-	if( !vertexArrayDesc )
-		glGenVertexArrays( 1, &vertexArrayDesc );
-
-	glBindVertexArray( vertexArrayDesc );
-
-	CHECK_GL_ERROR;
-
-	_bindAttribArrays();
-
-	glBindVertexArray( 0 );
-#endif
+	//the VAO is created at the first bind, because VAOs can't be shared with the loading threads' contexts
 	
 	loaded = glGetError() == GL_NO_ERROR;
 	
-	currentVertex = nullptr;
-	
 	//geometric hints
+	_updateBounds();
+
 	center = (max + min)*0.5f;
 	
 	dimensions = max - min;
 
-	if( !dynamic ) //won't be updated ever again
-		destroyBuffers();
-	
 	return loaded;
 }
 
+void Mesh::_uploadBuffer(GLenum target, const byte* data, GLsizeiptr size, GLsizeiptr& capacity, DirtyRange& dirty)
+{
+	if (!dynamic)
+	{
+		glBufferData(target, size, data, GL_STATIC_DRAW);
+		capacity = size;
+	}
+	else if (size > capacity || streaming || (dirty.start == 0 && (GLsizeiptr)dirty.end >= size))
+	{
+		//grow geometrically, so that meshes growing a bit at a time don't reallocate at every update
+		if (size > capacity)
+			capacity = std::max(size, capacity * 2);
+
+		//allocating the storage again orphans the old one, the GPU can keep reading it while the new data is uploaded
+		glBufferData(target, capacity, nullptr, streaming ? GL_STREAM_DRAW : GL_DYNAMIC_DRAW);
+		glBufferSubData(target, 0, size, data);
+	}
+	else if (!dirty.empty() && (GLsizeiptr)dirty.start < size)
+	{
+		//only upload what changed
+		GLsizeiptr end = std::min((GLsizeiptr)dirty.end, size);
+		glBufferSubData(target, dirty.start, end - dirty.start, data + dirty.start);
+	}
+
+	dirty.clear();
+}
+
 void Mesh::bind( Shader* shader )
 {		
 #ifndef DOJO_DISABLE_VAOS
+	if( !vertexArrayDesc )
+	{
+		glGenVertexArrays( 1, &vertexArrayDesc );
+		vertexArrayDirty = true;
+	}
 
-	DEBUG_ASSERT( vertexArrayDesc );
 	glBindVertexArray( vertexArrayDesc );
+
+	//(re)record the bindings if the buffers changed
+	if( vertexArrayDirty )
+	{
+		_bindAttribArrays( shader );
+		vertexArrayDirty = false;
+	}
 #else
 	_bindAttribArrays( shader ); //bind attribs each frame! (costly)
 #endif
@@ -448,6 +682,63 @@ void Mesh::bind( Shader* shader )
 	CHECK_GL_ERROR; 
 }
 
+bool Mesh::_read()
+{
+	//open the file, unless onPrepare() already did
+	if( !mPreparedFile )
+	{
+		mPreparedFile = Platform::singleton().getFile( filePath );
+		mPreparedFile->open();
+	}
+
+	DEBUG_ASSERT_INFO( mPreparedFile->isOpen(), "onLoad: cannot find or read file", "path = " + filePath );
+
+	if( !mPreparedFile->isOpen() )
+		return false;
+
+	const byte* data = mPreparedFile->getData();
+	size_t size = mPreparedFile->getSize();
+
+	//streams that can't be read in place are copied once, and so are the files that start misaligned in an archive
+	if( !data || !MeshFile::isAligned( data ) )
+	{
+		mPreparedCopy.resize( size );
+		mPreparedFile->read( mPreparedCopy.data(), (int)size );
+		data = mPreparedCopy.data();
+	}
+
+	uint32_t magic = 0;
+	if( size >= sizeof( magic ) )
+		memcpy( &magic, data, sizeof( magic ) );
+
+	if( magic != MeshFile::MAGIC )
+		return _loadLegacy( data, size );
+
+	auto header = MeshFile::getHeader( data, size );
+
+	DEBUG_ASSERT_INFO( header, "onLoad: invalid .mesh file", "path = " + filePath );
+
+	if( !header )
+		return false;
+
+	int lod = Platform::singleton().getUserConfiguration().getInt( "meshLOD" );
+	auto section = MeshFile::findSection( *header, mSubMesh, lod );
+
+	DEBUG_ASSERT_INFO( section, "onLoad: the sub-mesh is not in the file", "path = " + filePath + ", subMesh = " + mSubMesh );
+
+	return section && _loadSection( *section, data );
+}
+
+void Mesh::_releasePrepared()
+{
+	mPreparedFile.reset();
+	std::vector< byte >().swap( mPreparedCopy );
+
+	mPreparedVertices = mPreparedIndices = nullptr;
+	mPreparedVertexBytes = mPreparedIndexBytes = 0;
+	mPrepared = false;
+}
+
 bool Mesh::onLoad()
 {
 	DEBUG_ASSERT( !isLoaded(), "onLoad: Mesh is already loaded" );
@@ -455,13 +746,35 @@ bool Mesh::onLoad()
 	if( !isReloadable() )
 		return false;
 
-	//load binary mesh
-	char* data;
-	Platform::singleton().loadFileContent( data, filePath );
-		
-	DEBUG_ASSERT_INFO( data, "onLoad: cannot find or read file", "path = " + filePath );
-	
-	char* ptr = data;
+	//read and process the file, unless onPrepare() already did
+	bool success = mPrepared || _read();
+
+	if( success )
+	{
+		//the data is either on the CPU or still in the mapped file
+		if( editing )
+			success = end();
+		else
+			success = _upload( mPreparedVertices, mPreparedVertexBytes, mPreparedIndices, mPreparedIndexBytes );
+	}
+
+	//the mapping is released only after the upload
+	_releasePrepared();
+
+	return success;
+}
+
+bool Mesh::_loadLegacy( const byte* data, size_t size )
+{
+	//index size, triangle mode, fields, max, min, vertex count, index count
+	const size_t headerSize = 2 + (size_t)VertexField::_Count + 2 * sizeof( Vector ) + 2 * sizeof( int );
+
+	DEBUG_ASSERT_INFO( size >= headerSize, "onLoad: the file is truncated", "path = " + filePath );
+
+	if( size < headerSize )
+		return false;
+
+	const byte* ptr = data;
 	
 	//index size
 	setIndexByteSize( *ptr++ );
@@ -485,38 +798,120 @@ bool Mesh::onLoad()
 	memcpy( &loadedMin, ptr, sizeof( Vector ) );
 	ptr += sizeof( Vector );
 	
-	//vertex count
-	IndexType vc = *((int*) ptr);
+	//the counts aren't aligned
+	int vc, ic;
+	memcpy( &vc, ptr, sizeof( int ) );
 	ptr += sizeof( int );
 	
-	//index count
-	int ic = *((int*)ptr);
+	memcpy( &ic, ptr, sizeof( int ) );
 	ptr += sizeof( int );
+
+	DEBUG_ASSERT_INFO( vc > 0 && ic >= 0 && headerSize + (size_t)vc * vertexSize + (size_t)ic * indexSize <= size, "onLoad: the file is truncated", "path = " + filePath );
+
+	if( vc <= 0 || ic < 0 || headerSize + (size_t)vc * vertexSize + (size_t)ic * indexSize > size )
+		return false;
 		
 	setDynamic( false );
 	
-	begin( vc );
+	begin( vc, ic );
 	
 	//grab vertex data
-	vertices.resize(vc*vertexSize);
-	memcpy( (char*)vertices.data(), ptr, vc * vertexSize );
+	vertices.assign( ptr, ptr + vc * vertexSize );
 	ptr += vc * vertexSize;
 	
 	//grab index data
-	if( ic )
-	{
-		indices.resize(ic*indexSize);
-		memcpy( (char*)indices.data(), ptr, ic * indexSize );
-	}
+	indices.assign( ptr, ptr + ic * indexSize );
 	
 	max = loadedMax;
 	min = loadedMin;
 
-	vertexCount = vc;
+	vertexCount = boundsVertexCount = vc;
 	indexCount = ic;
 
-	//push over to GPU
-	return end();
+	_process( false );
+	return true;
+}
+
+bool Mesh::_loadSection( const MeshFile::Section& section, const byte* data )
+{
+	setDynamic( false );
+	setTriangleMode( (TriangleMode)section.triangleMode );
+
+	if( section.indexCount > 0 )
+		_setIndexByteSize( section.indexSize );
+
+	for( int i = 0; i < (int)VertexField::_Count; ++i )
+	{
+		vertexFieldOffset[ i ] = section.fieldOffset[ i ];
+		vertexFieldFormat[ i ] = (VertexFieldFormat)section.fieldFormat[ i ];
+	}
+
+	vertexSize = section.vertexSize;
+
+	positionOffset = Vector( section.positionOffset[ 0 ], section.positionOffset[ 1 ], section.positionOffset[ 2 ] );
+	positionScale = section.positionScale;
+	compressed = ( section.flags & MeshFile::SF_COMPRESSED ) != 0;
+
+	const byte* vertexData = data + section.vertexDataOffset;
+	const byte* indexData = data + section.indexDataOffset;
+	GLsizeiptr vertexBytes = section.vertexCount * vertexSize;
+	GLsizeiptr indexBytes = section.indexCount * indexSize;
+
+	bool optimized = ( section.flags & MeshFile::SF_OPTIMIZED ) != 0;
+
+	auto& config = Platform::singleton().getUserConfiguration();
+	bool process = ( !optimized && config.getBool( "optimizeMeshes" ) ) || ( !compressed && config.getBool( "compressMeshes" ) );
+
+	vertexCount = boundsVertexCount = section.vertexCount;
+	indexCount = section.indexCount;
+
+	max = Vector( section.max[ 0 ], section.max[ 1 ], section.max[ 2 ] );
+	min = Vector( section.min[ 0 ], section.min[ 1 ], section.min[ 2 ] );
+
+	if( process || vertexCount <= BATCHABLE_VERTEX_MAX )
+	{
+		//the data has to be on the CPU to be processed or batched
+		vertices.assign( vertexData, vertexData + vertexBytes );
+		indices.assign( indexData, indexData + indexBytes );
+
+		editing = true;
+		_process( optimized );
+		return true;
+	}
+
+	//else, it goes straight from the mapped file to the GPU in onLoad()
+	mPreparedVertices = vertexData;
+	mPreparedIndices = indexData;
+	mPreparedVertexBytes = vertexBytes;
+	mPreparedIndexBytes = indexBytes;
+	return true;
+}
+
+void Mesh::_process( bool optimized )
+{
+	auto& config = Platform::singleton().getUserConfiguration();
+
+	if( !optimized && config.getBool( "optimizeMeshes" ) )
+		optimize();
+
+	if( !compressed && config.getBool( "compressMeshes" ) )
+		compress();
+}
+
+void Mesh::onPrepare()
+{
+	if( isReloadable() && !isLoaded() && !mPrepared )
+	{
+		//parse, optimize and compress here, so that onLoad() only has to upload
+		mPrepared = _read();
+
+		//touch every page that will be uploaded from the mapping, so that the upload doesn't wait for the disk
+		volatile byte sink = 0;
+		for( GLsizeiptr i = 0; i < mPreparedVertexBytes; i += 4096 )
+			sink += mPreparedVertices[ i ];
+		for( GLsizeiptr i = 0; i < mPreparedIndexBytes; i += 4096 )
+			sink += mPreparedIndices[ i ];
+	}
 }
 
 void Mesh::onUnload(bool soft /*= false */) {
@@ -531,6 +926,14 @@ void Mesh::onUnload(bool soft /*= false */) {
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 		vertexHandle = indexHandle = 0;
+		vertexCapacity = indexCapacity = 0;
+
+#ifndef DOJO_DISABLE_VAOS
+		if (vertexArrayDesc)
+			glDeleteVertexArrays(1, &vertexArrayDesc);
+
+		vertexArrayDesc = 0;
+#endif
 
 		destroyBuffers(); //free CPU side memory
 
@@ -539,15 +942,20 @@ void Mesh::onUnload(bool soft /*= false */) {
 }
 
 Vector& Mesh::getVertex(int idx) {
+	DEBUG_ASSERT(!hasCompressedPositions(), "getVertex: the positions are compressed");
+
 	int offset = isVertexFieldEnabled(VertexField::Position3D) ? _offset(VertexField::Position3D) : _offset(VertexField::Position2D);
 	byte* ptr = (byte*)vertices.data() + (idx * vertexSize) + offset;
 
+	_markVerticesDirty(idx, 1);
 	return *(Vector*)ptr;
 }
 
 void Mesh::setIndex(int idxidx, IndexType idx) {
 	DEBUG_ASSERT(idxidx >= 0 && idxidx < getIndexCount(), "Index out of bounds");
 
+	_markIndicesDirty(idxidx, 1);
+
 	switch (indexSize)
 	{
 	case 1:
@@ -582,6 +990,9 @@ void Mesh::eraseIndex(int idxidx) {
 
 	auto i = indices.begin() + (idxidx * indexSize);
 	indices.erase(i, i + indexSize);
+
+	//the following indices moved back
+	_markIndicesDirty(idxidx, indexCount - idxidx);
 	--indexCount;
 }
 
@@ -595,6 +1006,9 @@ void Mesh::cutSection(IndexType i1, IndexType i2) {
 	auto size = diff * vertexSize;
 	auto start = vertices.begin() + i1 * vertexSize;
 	vertices.erase(start, start + size);
+	vertexCount -= diff;
+
+	_markVerticesDirty(i1, vertexCount - i1);
 
 	//remove the indices
 	if (isIndexed()) {
@@ -612,7 +1026,10 @@ void Mesh::cutSection(IndexType i1, IndexType i2) {
 		}
 	}
 
-	//TODO recompute max and min
+	//the removed vertices could have been on the bounds, recompute them at end()
+	max = Vector::MIN;
+	min = Vector::MAX;
+	boundsVertexCount = 0;
 }
 
 Unique<Mesh> Mesh::cloneWithSameFormat() const {
@@ -622,6 +1039,11 @@ Unique<Mesh> Mesh::cloneWithSameFormat() const {
 	c->setTriangleMode(triangleMode);
 	c->vertexSize = vertexSize;
 	memcpy(c->vertexFieldOffset, vertexFieldOffset, sizeof(vertexFieldOffset));
+	memcpy(c->vertexFieldFormat, vertexFieldFormat, sizeof(vertexFieldFormat));
+
+	c->compressed = compressed;
+	c->positionOffset = positionOffset;
+	c->positionScale = positionScale;
 
 	return c;
 }
@@ -645,13 +1067,8 @@ Unique<Mesh> Mesh::cloneFromSlice(IndexType vertexStart, IndexType vertexEnd, co
 
 		memcpy(c->vertices.data(), vertices.data() + off, size);
 
-		for (int i = 0; i < c->vertexCount; ++i) {
-			auto& v = c->getVertex(i);
-			v += translation;
-
-			c->max = Math::max(c->max, v);
-			c->min = Math::min(c->min, v);
-		}
+		for (int i = 0; i < c->vertexCount; ++i)
+			c->getVertex(i) += translation;
 	}
 
 	//find the indices that were pointing to these vertices
@@ -667,3 +1084,574 @@ Unique<Mesh> Mesh::cloneFromSlice(IndexType vertexStart, IndexType vertexEnd, co
 
 	return c;
 }
+
+bool Mesh::hasSameVertexFormat(const Mesh& m) const {
+	return vertexSize == m.vertexSize &&
+		memcmp(vertexFieldOffset, m.vertexFieldOffset, sizeof(vertexFieldOffset)) == 0 &&
+		memcmp(vertexFieldFormat, m.vertexFieldFormat, sizeof(vertexFieldFormat)) == 0 &&
+		(!compressed || (positionOffset == m.positionOffset && positionScale == m.positionScale));
+}
+
+TriangleMode Mesh::getListTriangleMode(TriangleMode mode) {
+	switch (mode) {
+	case TriangleMode::TriangleStrip:
+	case TriangleMode::TriangleList:		return TriangleMode::TriangleList;
+	case TriangleMode::LineStrip:
+	case TriangleMode::LineList:			return TriangleMode::LineList;
+	default:								return TriangleMode::PointList;
+	}
+}
+
+void Mesh::appendTransformedMesh(const Mesh& m, const Matrix& transform, const Color& tint) {
+	DEBUG_ASSERT(isEditing(), "appendTransformedMesh: this Mesh is not in Edit mode");
+	DEBUG_ASSERT(m.isBatchable(), "appendTransformedMesh: the source Mesh has no CPU-side data");
+	DEBUG_ASSERT(isVertexFieldEnabled(VertexField::Position3D) && isVertexFieldEnabled(VertexField::Color), "appendTransformedMesh: this Mesh needs 3D positions and colors");
+	DEBUG_ASSERT(triangleMode == getListTriangleMode(m.triangleMode), "appendTransformedMesh: incompatible TriangleModes");
+
+	IndexType base = appendVertices(m.vertexCount);
+
+	bool position3D = m.isVertexFieldEnabled(VertexField::Position3D);
+	byte positionOffset = m.vertexFieldOffset[(byte)(position3D ? VertexField::Position3D : VertexField::Position2D)];
+
+	glm::mat3 normalTransform = glm::inverseTranspose(glm::mat3(transform));
+
+	for (IndexType i = 0; i < m.vertexCount; ++i) {
+		const byte* src = m.vertices.data() + i * m.vertexSize;
+		const float* p = (const float*)(src + positionOffset);
+
+		//write the vertex in place, the other fields are set through currentVertex
+		currentVertex = vertices.data() + (base + i) * vertexSize;
+
+		*(Vector*)(currentVertex + _offset(VertexField::Position3D)) = Vector(glm::vec3(transform * glm::vec4(p[0], p[1], position3D ? p[2] : 0.f, 1.f)));
+
+		if (m.isVertexFieldEnabled(VertexField::Color))
+			color(Color(*(const Color::RGBAPixel*)(src + m.vertexFieldOffset[(byte)VertexField::Color])) * tint);
+		else
+			color(tint);
+
+		if (m.isVertexFieldEnabled(VertexField::Normal) && isVertexFieldEnabled(VertexField::Normal))
+			normal(normalTransform * *(const Vector*)(src + m.vertexFieldOffset[(byte)VertexField::Normal]));
+
+		for (int set = 0; set < DOJO_MAX_TEXTURE_COORDS; ++set) {
+			VertexField f = (VertexField)((int)VertexField::UV0 + set);
+			if (m.isVertexFieldEnabled(f) && isVertexFieldEnabled(f)) {
+				const float* uvs = (const float*)(src + m.vertexFieldOffset[(byte)f]);
+				uv(uvs[0], uvs[1], set);
+			}
+		}
+	}
+
+	//a mirroring transform flips the winding of the triangles, flip them back
+	bool flip = glm::determinant(glm::mat3(transform)) < 0;
+
+	IndexType elemCount = m.isIndexed() ? m.getIndexCount() : m.getVertexCount();
+	auto source = [&](IndexType i) {
+		return base + (m.isIndexed() ? m.getIndex(i) : i);
+	};
+
+	switch (m.triangleMode) {
+	case TriangleMode::TriangleStrip:
+		for (IndexType i = 0; i + 2 < elemCount; ++i) {
+			IndexType a = source(i), b = source(i + 1), c = source(i + 2);
+
+			if (a == b || b == c || a == c) //skip degenerate triangles used to stitch strips
+				continue;
+
+			if ((i % 2 == 1) != flip)
+				std::swap(a, b);
+
+			triangle(a, b, c);
+		}
+		break;
+
+	case TriangleMode::TriangleList:
+		for (IndexType i = 0; i + 2 < elemCount; i += 3) {
+			if (flip)
+				triangle(source(i + 1), source(i), source(i + 2));
+			else
+				triangle(source(i), source(i + 1), source(i + 2));
+		}
+		break;
+
+	case TriangleMode::LineStrip:
+		for (IndexType i = 0; i + 1 < elemCount; ++i) {
+			index(source(i));
+			index(source(i + 1));
+		}
+		break;
+
+	default:
+		for (IndexType i = 0; i < elemCount; ++i)
+			index(source(i));
+		break;
+	}
+}
+
+//the size of the post-transform vertex cache targeted by optimize(), GPUs have between 16 and 32 entries
+static const int VERTEX_CACHE_SIZE = 32;
+
+static const Mesh::IndexType INVALID_INDEX = 0xffffffff;
+
+static uint32_t _hashBytes(const byte* data, int size) {
+	//FNV-1a
+	uint32_t h = 2166136261u;
+	for (int i = 0; i < size; ++i)
+		h = (h ^ data[i]) * 16777619u;
+	return h;
+}
+
+//maps each vertex to the first vertex with exactly the same bytes, returns the number of unique vertices
+static Mesh::IndexType _weldVertices(const byte* data, int vertexSize, Mesh::IndexType count, std::vector<Mesh::IndexType>& remap) {
+	//an open addressing table of vertex indices, hashed on the vertex contents
+	size_t tableSize = 1;
+	while (tableSize < (size_t)count * 2)
+		tableSize <<= 1;
+
+	size_t mask = tableSize - 1;
+	std::vector<Mesh::IndexType> table(tableSize, INVALID_INDEX);
+
+	Mesh::IndexType unique = 0;
+	remap.resize(count);
+
+	for (Mesh::IndexType i = 0; i < count; ++i) {
+		const byte* v = data + i * vertexSize;
+
+		for (size_t h = _hashBytes(v, vertexSize) & mask;; h = (h + 1) & mask) {
+			auto& slot = table[h];
+
+			if (slot == INVALID_INDEX) {
+				slot = remap[i] = i;
+				++unique;
+				break;
+			}
+			else if (memcmp(data + slot * vertexSize, v, vertexSize) == 0) {
+				remap[i] = slot;
+				break;
+			}
+		}
+	}
+
+	return unique;
+}
+
+//turns a strip or a list into a list, leaving out the degenerate triangles
+static std::vector<Mesh::IndexType> _getTriangleList(const std::vector<Mesh::IndexType>& idx, TriangleMode mode) {
+	std::vector<Mesh::IndexType> list;
+	list.reserve(mode == TriangleMode::TriangleStrip ? idx.size() * 3 : idx.size());
+
+	bool strip = mode == TriangleMode::TriangleStrip;
+	for (size_t i = 0; i + 2 < idx.size(); i += strip ? 1 : 3) {
+		Mesh::IndexType a = idx[i], b = idx[i + 1], c = idx[i + 2];
+
+		if (a == b || b == c || a == c)
+			continue;
+
+		//every other triangle of a strip has the opposite winding
+		if (strip && i % 2 == 1)
+			std::swap(a, b);
+
+		list.push_back(a);
+		list.push_back(b);
+		list.push_back(c);
+	}
+
+	return list;
+}
+
+//counts the vertices that miss a FIFO post-transform cache when drawing the given indices
+static int _countCacheMisses(const std::vector<Mesh::IndexType>& idx, Mesh::IndexType vertexCount) {
+	std::vector<int> insertedAt(vertexCount, -VERTEX_CACHE_SIZE - 1);
+	int insertions = 0;
+
+	for (auto i : idx) {
+		if (insertions - insertedAt[i] > VERTEX_CACHE_SIZE)
+			insertedAt[i] = insertions++;
+	}
+
+	return insertions;
+}
+
+//the scores of the vertices used by _optimizeTriangleOrder, tabulated
+class VertexScores {
+public:
+	static const int VALENCE_MAX = 32;
+
+	VertexScores() {
+		for (int i = 0; i < VERTEX_CACHE_SIZE; ++i) {
+			//the vertices of the last triangle get a fixed score, or the next triangle would just reuse them
+			if (i < 3)
+				mCache[i] = 0.75f;
+			else
+				mCache[i] = powf(1.f - (i - 3) / (float)(VERTEX_CACHE_SIZE - 3), 1.5f);
+		}
+
+		//prefer the vertices with few triangles left, to get rid of them
+		for (int i = 1; i < VALENCE_MAX; ++i)
+			mValence[i] = 2.f * powf((float)i, -0.5f);
+	}
+
+	float get(int cachePosition, int remainingTriangles) const {
+		if (remainingTriangles == 0)
+			return -1.f;
+
+		float valence = remainingTriangles < VALENCE_MAX ? mValence[remainingTriangles] : 2.f * powf((float)remainingTriangles, -0.5f);
+		return (cachePosition >= 0 ? mCache[cachePosition] : 0.f) + valence;
+	}
+
+protected:
+	float mCache[VERTEX_CACHE_SIZE];
+	float mValence[VALENCE_MAX];
+};
+
+//reorders the triangles of a list to reuse the post-transform vertex cache, see Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static void _optimizeTriangleOrder(std::vector<Mesh::IndexType>& idx, Mesh::IndexType vertexCount) {
+	int triCount = idx.size() / 3;
+
+	//the triangles left to draw for each vertex, in a flat array
+	std::vector<int> remaining(vertexCount, 0), firstTriangle(vertexCount + 1, 0);
+	for (auto i : idx)
+		++remaining[i];
+
+	for (Mesh::IndexType v = 0; v < vertexCount; ++v)
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+
+	std::vector<int> vertexTriangles(idx.size());
+	{
+		std::vector<int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t i = 0; i < idx.size(); ++i)
+			vertexTriangles[fill[idx[i]]++] = i / 3;
+	}
+
+	VertexScores scores;
+	std::vector<float> score(vertexCount);
+	for (Mesh::IndexType v = 0; v < vertexCount; ++v)
+		score[v] = scores.get(-1, remaining[v]);
+
+	std::vector<bool> drawn(triCount, false);
+	std::vector<Mesh::IndexType> out, cache, newCache;
+	out.reserve(idx.size());
+
+	int best = -1, nextUndrawn = 0;
+	for (int n = 0; n < triCount; ++n) {
+		if (best < 0) {
+			//nothing in the cache is useful, start again from the first triangle left
+			while (drawn[nextUndrawn])
+				++nextUndrawn;
+
+			best = nextUndrawn;
+		}
+
+		drawn[best] = true;
+		newCache.clear();
+
+		for (int k = 0; k < 3; ++k) {
+			Mesh::IndexType v = idx[best * 3 + k];
+			out.push_back(v);
+			newCache.push_back(v);
+
+			//remove the triangle from the ones of v
+			int* triangles = vertexTriangles.data() + firstTriangle[v];
+			int* last = triangles + --remaining[v];
+			*std::find(triangles, last, best) = *last;
+		}
+
+		for (auto v : cache) {
+			if (std::find(newCache.begin(), newCache.begin() + 3, v) == newCache.begin() + 3)
+				newCache.push_back(v);
+		}
+
+		//update the scores of the vertices in the cache and of the ones that just left it
+		for (size_t i = 0; i < newCache.size(); ++i) {
+			Mesh::IndexType v = newCache[i];
+			score[v] = scores.get(i < VERTEX_CACHE_SIZE ? (int)i : -1, remaining[v]);
+		}
+
+		if (newCache.size() > VERTEX_CACHE_SIZE)
+			newCache.resize(VERTEX_CACHE_SIZE);
+
+		//the next triangle is the best one using a vertex in the cache
+		best = -1;
+		float bestScore = -1.f;
+		for (auto v : newCache) {
+			const int* triangles = vertexTriangles.data() + firstTriangle[v];
+
+			for (int j = 0; j < remaining[v]; ++j) {
+				int t = triangles[j];
+				float s = score[idx[t * 3]] + score[idx[t * 3 + 1]] + score[idx[t * 3 + 2]];
+
+				if (s > bestScore) {
+					best = t;
+					bestScore = s;
+				}
+			}
+		}
+
+		cache.swap(newCache);
+	}
+
+	idx.swap(out);
+}
+
+void Mesh::optimize() {
+	DEBUG_ASSERT(isEditing(), "optimize: this Mesh is not in Edit mode");
+
+	if (vertexCount == 0)
+		return;
+
+	bool indexed = indexCount > 0;
+	IndexType elemCount = indexed ? indexCount : vertexCount;
+
+	std::vector<IndexType> idx(elemCount);
+	for (IndexType i = 0; i < elemCount; ++i)
+		idx[i] = indexed ? getIndex(i) : i;
+
+	std::vector<IndexType> remap;
+	IndexType uniqueCount = _weldVertices(vertices.data(), vertexSize, vertexCount, remap);
+
+	//all the vertices are different, adding indices would only cost more
+	if (!indexed && uniqueCount == (IndexType)vertexCount)
+		return;
+
+	for (auto& i : idx)
+		i = remap[i];
+
+	TriangleMode mode = triangleMode;
+	if (mode == TriangleMode::TriangleList || mode == TriangleMode::TriangleStrip) {
+		auto list = _getTriangleList(idx, mode);
+		_optimizeTriangleOrder(list, vertexCount);
+
+		if (mode == TriangleMode::TriangleList)
+			idx.swap(list);
+		else {
+			//both use the same vertices, so they get the same index size below
+			std::vector<bool> used(vertexCount, false);
+			IndexType usedCount = 0;
+			for (auto i : idx) {
+				if (!used[i]) {
+					used[i] = true;
+					++usedCount;
+				}
+			}
+
+			size_t indexBytes = usedCount <= 0x10000 ? sizeof(GLushort) : sizeof(GLuint);
+
+			//a list needs 3 indices per triangle, but can reuse the cache more than a strip; estimate the bytes read for each
+			size_t stripCost = _countCacheMisses(idx, vertexCount) * vertexSize + idx.size() * indexBytes;
+			size_t listCost = _countCacheMisses(list, vertexCount) * vertexSize + list.size() * indexBytes;
+
+			if (listCost < stripCost) {
+				idx.swap(list);
+				mode = TriangleMode::TriangleList;
+			}
+		}
+	}
+
+	//number the vertices in the order they are first used, leaving out the unused ones
+	std::vector<IndexType> newIndex(vertexCount, INVALID_INDEX), order;
+	order.reserve(uniqueCount);
+
+	for (auto& i : idx) {
+		if (newIndex[i] == INVALID_INDEX) {
+			newIndex[i] = order.size();
+			order.push_back(i);
+		}
+
+		i = newIndex[i];
+	}
+
+	//8 bit indices aren't used, desktop drivers convert them on the CPU
+	byte newIndexSize = order.size() <= 0x10000 ? sizeof(GLushort) : sizeof(GLuint);
+
+#ifndef DOJO_32BIT_INDICES_AVAILABLE
+	if (newIndexSize == sizeof(GLuint)) {
+		DEBUG_MESSAGE("WARNING: cannot optimize a Mesh with more than 65536 vertices without 32 bit indices");
+		return;
+	}
+#endif
+
+	std::vector<byte> reordered(order.size() * vertexSize);
+	for (size_t i = 0; i < order.size(); ++i)
+		memcpy(reordered.data() + i * vertexSize, vertices.data() + order[i] * vertexSize, vertexSize);
+
+	vertices.swap(reordered);
+	vertexCount = order.size();
+	currentVertex = nullptr;
+
+	triangleMode = mode;
+	_setIndexByteSize(newIndexSize);
+
+	indices.clear();
+	indexCount = 0;
+	appendIndices(idx.data(), idx.size());
+
+	//everything moved
+	_markVerticesDirty(0, vertexCount);
+
+	max = Vector::MIN;
+	min = Vector::MAX;
+	boundsVertexCount = 0;
+}
+
+static GLshort _toShort(float f) {
+	return (GLshort)floorf(glm::clamp(f, -1.f, 1.f) * 32767.f + 0.5f);
+}
+
+static GLushort _toUnsignedShort(float f) {
+	return (GLushort)floorf(glm::clamp(f, 0.f, 1.f) * 65535.f + 0.5f);
+}
+
+static GLbyte _toByte(float f) {
+	return (GLbyte)floorf(glm::clamp(f, -1.f, 1.f) * 127.f + 0.5f);
+}
+
+static uint32_t _to10Bits(float f) {
+	return (uint32_t)(int)floorf(glm::clamp(f, -1.f, 1.f) * 511.f + 0.5f) & 0x3ff;
+}
+
+//converts the field f of a vertex from its default format to format
+static void _packField(VertexField f, VertexFieldFormat format, const byte* src, byte* dest, const Vector& positionOffset, float positionScale) {
+	const float* in = (const float*)src;
+	int components = (f == VertexField::Position3D || f == VertexField::Normal) ? 3 : 2;
+
+	switch (format)
+	{
+	case VertexFieldFormat::Short:
+		if (f == VertexField::Position2D || f == VertexField::Position3D) {
+			GLshort* out = (GLshort*)dest;
+			for (int i = 0; i < components; ++i)
+				out[i] = _toShort((in[i] - positionOffset[i]) / positionScale);
+
+			if (components == 3)
+				out[3] = 0;
+		}
+		else {
+			GLushort* out = (GLushort*)dest;
+			for (int i = 0; i < components; ++i)
+				out[i] = _toUnsignedShort(in[i]);
+		}
+		break;
+
+	case VertexFieldFormat::Byte:
+	{
+		GLbyte* out = (GLbyte*)dest;
+		for (int i = 0; i < 3; ++i)
+			out[i] = _toByte(in[i]);
+
+		out[3] = 0;
+		break;
+	}
+
+	case VertexFieldFormat::Int2_10_10_10:
+	{
+		uint32_t packed = _to10Bits(in[0]) | (_to10Bits(in[1]) << 10) | (_to10Bits(in[2]) << 20);
+		memcpy(dest, &packed, sizeof(packed));
+		break;
+	}
+
+	default:
+		memcpy(dest, src, Mesh::VERTEX_FIELD_SIZES[(int)f]);
+		break;
+	}
+}
+
+void Mesh::compress(VertexFieldFormat positionFormat, VertexFieldFormat normalFormat, VertexFieldFormat uvFormat) {
+	DEBUG_ASSERT(isEditing(), "compress: this Mesh is not in Edit mode");
+	DEBUG_ASSERT(!compressed, "compress: this Mesh is already compressed");
+	DEBUG_ASSERT(positionFormat == VertexFieldFormat::Default || positionFormat == VertexFieldFormat::Short, "compress: positions can only be stored as Short");
+	DEBUG_ASSERT(normalFormat == VertexFieldFormat::Default || normalFormat == VertexFieldFormat::Byte || normalFormat == VertexFieldFormat::Int2_10_10_10, "compress: normals can only be stored as Byte or Int2_10_10_10");
+	DEBUG_ASSERT(uvFormat == VertexFieldFormat::Default || uvFormat == VertexFieldFormat::Short, "compress: UVs can only be stored as Short");
+
+#ifndef DOJO_SHADERS_AVAILABLE
+	DEBUG_MESSAGE("WARNING: compressed vertices need shaders, the Mesh is left as it is");
+#else
+
+	if (normalFormat == VertexFieldFormat::Int2_10_10_10 && !arePackedNormalsAvailable())
+		normalFormat = VertexFieldFormat::Byte;
+
+	if (vertexCount == 0)
+		return;
+
+	_updateBounds();
+
+	VertexFieldFormat format[(int)VertexField::_Count];
+	memcpy(format, vertexFieldFormat, sizeof(format));
+
+	format[(int)(isVertexFieldEnabled(VertexField::Position3D) ? VertexField::Position3D : VertexField::Position2D)] = positionFormat;
+	format[(int)VertexField::Normal] = normalFormat;
+
+	//normalized UVs can't repeat the texture, so only sets in [0,1] are compressed
+	for (int set = 0; set < DOJO_MAX_TEXTURE_COORDS && uvFormat != VertexFieldFormat::Default; ++set) {
+		VertexField f = (VertexField)((int)VertexField::UV0 + set);
+		if (!isVertexFieldEnabled(f))
+			continue;
+
+		bool inRange = true;
+		for (int i = 0; i < vertexCount && inRange; ++i) {
+			const float* uv = (const float*)(vertices.data() + i * vertexSize + _offset(f));
+			inRange = uv[0] >= 0.f && uv[0] <= 1.f && uv[1] >= 0.f && uv[1] <= 1.f;
+		}
+
+		if (inRange)
+			format[(int)f] = uvFormat;
+	}
+
+	//lay out the fields in the same order with their new sizes
+	std::vector<VertexField> fields;
+	for (int i = 0; i < (int)VertexField::_Count; ++i) {
+		if (isVertexFieldEnabled((VertexField)i))
+			fields.push_back((VertexField)i);
+	}
+
+	std::sort(fields.begin(), fields.end(), [&](VertexField a, VertexField b) {
+		return _offset(a) < _offset(b);
+	});
+
+	byte newOffset[(int)VertexField::_Count];
+	memset(newOffset, 0xff, sizeof(newOffset));
+
+	int newSize = 0;
+	for (auto f : fields) {
+		newOffset[(int)f] = newSize;
+		newSize += getVertexFieldSize(f, format[(int)f]);
+	}
+
+	//the positions are mapped to [-1,1] with the same scale on all the axes
+	Vector offset = (max + min) * 0.5f;
+	Vector halfSize = (max - min) * 0.5f;
+	float scale = std::max(halfSize.x, std::max(halfSize.y, halfSize.z));
+
+	if (scale <= 0.f)
+		scale = 1.f;
+
+	std::vector<byte> packed(vertexCount * newSize);
+	for (int i = 0; i < vertexCount; ++i) {
+		const byte* src = vertices.data() + i * vertexSize;
+		byte* dest = packed.data() + i * newSize;
+
+		for (auto f : fields)
+			_packField(f, format[(int)f], src + _offset(f), dest + newOffset[(int)f], offset, scale);
+	}
+
+	vertices.swap(packed);
+	vertexSize = newSize;
+	memcpy(vertexFieldOffset, newOffset, sizeof(vertexFieldOffset));
+	memcpy(vertexFieldFormat, format, sizeof(vertexFieldFormat));
+
+	positionOffset = offset;
+	positionScale = scale;
+	compressed = true;
+
+	currentVertex = nullptr;
+
+	//the layout changed, everything has to be uploaded and bound again
+	_markVerticesDirty(0, vertexCount);
+	vertexArrayDirty = true;
+#endif
+}
+
+Matrix Mesh::getPositionDecodeTransform() const {
+	if (!hasCompressedPositions())
+		return Matrix(1);
+
+	return glm::scale(glm::translate(Matrix(1), positionOffset), Vector(positionScale, positionScale, positionScale));
+}
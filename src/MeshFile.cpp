@@ -0,0 +1,287 @@
+#include "stdafx.h"
+
+#include "MeshFile.h"
+#include "Mesh.h"
+#include "Log.h"
+#include "FileStream.h"
+
+#include <zlib.h>
+
+using namespace Dojo;
+
+static_assert( sizeof( MeshFile::Header ) == 32, "the Header layout is part of the file format" );
+static_assert( sizeof( MeshFile::Section ) == 144, "the Section layout is part of the file format" );
+static_assert( (int)VertexField::_Count <= MeshFile::MAX_FIELDS, "the file format can't describe all the VertexFields" );
+
+static size_t _align( size_t offset )
+{
+	return ( offset + MeshFile::DATA_ALIGNMENT - 1 ) & ~( MeshFile::DATA_ALIGNMENT - 1 );
+}
+
+static bool _isValid( const MeshFile::Section& section, size_t size )
+{
+	if( section.vertexCount == 0 || section.vertexSize == 0 || section.triangleMode > TriangleMode::PointList )
+		return false;
+
+	if( section.indexCount > 0 && section.indexSize != 1 && section.indexSize != 2 && section.indexSize != 4 )
+		return false;
+
+	if( section.vertexDataOffset % MeshFile::DATA_ALIGNMENT || section.indexDataOffset % MeshFile::DATA_ALIGNMENT )
+		return false;
+
+	//64 bit math, so that the products can't overflow
+	if( section.vertexDataOffset + (uint64_t)section.vertexCount * section.vertexSize > size )
+		return false;
+
+	if( section.indexDataOffset + (uint64_t)section.indexCount * section.indexSize > size )
+		return false;
+
+#ifndef DOJO_SHADERS_AVAILABLE
+	//without shaders nothing can decode the compressed positions
+	if( section.flags & MeshFile::SF_COMPRESSED )
+		return false;
+#endif
+
+	for( int i = 0; i < MeshFile::MAX_FIELDS; ++i )
+	{
+		if( section.fieldOffset[ i ] == 0xff )
+			continue;
+
+		//fields that this build doesn't know, eg. more UV sets than DOJO_MAX_TEXTURE_COORDS
+		if( i >= (int)VertexField::_Count || section.fieldFormat[ i ] > (uint8_t)VertexFieldFormat::Int2_10_10_10 )
+			return false;
+
+		if( section.fieldFormat[ i ] == (uint8_t)VertexFieldFormat::Int2_10_10_10 && !Mesh::arePackedNormalsAvailable() )
+			return false;
+
+		int fieldSize = Mesh::getVertexFieldSize( (VertexField)i, (VertexFieldFormat)section.fieldFormat[ i ] );
+
+		if( section.fieldOffset[ i ] + fieldSize > (int)section.vertexSize )
+			return false;
+	}
+
+	return memchr( section.name, 0, MeshFile::MAX_NAME_LENGTH ) != nullptr;
+}
+
+static bool _isSupported( const MeshFile::Header& header )
+{
+	if( header.magic != MeshFile::MAGIC )
+		return false;
+
+	if( header.version != MeshFile::VERSION || header.byteOrder != MeshFile::BYTE_ORDER_MARK )
+	{
+		DEBUG_MESSAGE( "WARNING: unsupported .mesh version or byte order" );
+		return false;
+	}
+
+	return true;
+}
+
+const MeshFile::Header* MeshFile::getHeader( const byte* data, size_t size )
+{
+	if( !data || size < sizeof( Header ) || !isAligned( data ) )
+		return nullptr;
+
+	auto header = (const Header*)data;
+
+	if( !_isSupported( *header ) )
+		return nullptr;
+
+	if( header->fileSize != size || sizeof( Header ) + (uint64_t)header->sectionCount * sizeof( Section ) > size )
+	{
+		DEBUG_MESSAGE( "WARNING: the .mesh file is truncated" );
+		return nullptr;
+	}
+
+	for( uint32_t i = 0; i < header->sectionCount; ++i )
+	{
+		if( !_isValid( getSections( *header )[ i ], size ) )
+		{
+			DEBUG_MESSAGE( "WARNING: the .mesh file contains an invalid section" );
+			return nullptr;
+		}
+	}
+
+#ifdef _DEBUG
+	//reading all the data defeats the mapping, so only debug builds look for damaged files
+	uLong crc = crc32( crc32( 0, nullptr, 0 ), data + sizeof( Header ), (uInt)( size - sizeof( Header ) ) );
+
+	if( crc != header->checksum )
+	{
+		DEBUG_MESSAGE( "WARNING: the .mesh file is damaged" );
+		return nullptr;
+	}
+#endif
+
+	return header;
+}
+
+const MeshFile::Section* MeshFile::findSection( const Header& header, const String& subMesh, int lod )
+{
+	const Section* sections = getSections( header );
+	const Section* best = nullptr;
+
+	for( uint32_t i = 0; i < header.sectionCount; ++i )
+	{
+		const Section& section = sections[ i ];
+
+		if( subMesh.empty() )
+		{
+			if( best && strcmp( section.name, best->name ) != 0 )
+				continue;
+		}
+		else if( subMesh != section.name )
+			continue;
+
+		//prefer the requested lod, then the closest more detailed one, then the closest less detailed one
+		if( !best )
+			best = &section;
+		else if( section.lod <= (uint32_t)lod )
+		{
+			if( best->lod > (uint32_t)lod || section.lod > best->lod )
+				best = &section;
+		}
+		else if( best->lod > (uint32_t)lod && section.lod < best->lod )
+			best = &section;
+	}
+
+	return best;
+}
+
+bool MeshFile::readSubMeshNames( FileStream& file, std::vector< String >& out )
+{
+	Header header;
+
+	if( file.readHead( (byte*)&header, sizeof( Header ) ) != sizeof( Header ) || !_isSupported( header ) )
+		return false;
+
+	if( sizeof( Header ) + (uint64_t)header.sectionCount * sizeof( Section ) > header.fileSize )
+	{
+		DEBUG_MESSAGE( "WARNING: the .mesh file is truncated" );
+		return false;
+	}
+
+	//read the header again together with the table, as the stream can only read from the start
+	//the buffer comes from operator new, so it is aligned for the Sections
+	std::vector< byte > table( sizeof( Header ) + header.sectionCount * sizeof( Section ) );
+
+	if( file.readHead( table.data(), (int)table.size() ) != (int)table.size() )
+		return false;
+
+	auto sections = getSections( *(const Header*)table.data() );
+
+	for( uint32_t i = 0; i < header.sectionCount; ++i )
+	{
+		if( !memchr( sections[ i ].name, 0, MAX_NAME_LENGTH ) )
+			return false;
+
+		String name( sections[ i ].name );
+
+		if( std::find( out.begin(), out.end(), name ) == out.end() )
+			out.push_back( name );
+	}
+
+	return true;
+}
+
+void MeshFile::addSection( Mesh& mesh, const String& subMesh, int lod, bool optimized )
+{
+	DEBUG_ASSERT( mesh.isEditing(), "addSection: the Mesh data must be on the CPU" );
+	DEBUG_ASSERT( mesh.getVertexCount() > 0, "addSection: the Mesh is empty" );
+	DEBUG_ASSERT( subMesh.size() < MAX_NAME_LENGTH, "addSection: the sub-mesh name is too long" );
+	DEBUG_ASSERT( lod >= 0, "addSection: negative LODs are invalid" );
+
+	mesh._updateBounds();
+
+	Entry entry;
+	memset( &entry.section, 0, sizeof( Section ) );
+
+	Section& section = entry.section;
+	strncpy( section.name, subMesh.c_str(), MAX_NAME_LENGTH - 1 );
+
+	section.lod = lod;
+	section.flags = ( optimized ? SF_OPTIMIZED : 0 ) | ( mesh.isCompressed() ? SF_COMPRESSED : 0 );
+
+	section.triangleMode = (uint8_t)mesh.triangleMode;
+	section.indexSize = mesh.indexSize;
+
+	memset( section.fieldOffset, 0xff, sizeof( section.fieldOffset ) );
+	for( int i = 0; i < (int)VertexField::_Count; ++i )
+	{
+		section.fieldOffset[ i ] = mesh.vertexFieldOffset[ i ];
+		section.fieldFormat[ i ] = (uint8_t)mesh.vertexFieldFormat[ i ];
+	}
+
+	section.vertexSize = mesh.vertexSize;
+	section.vertexCount = mesh.vertexCount;
+	section.indexCount = mesh.indexCount;
+
+	for( int i = 0; i < 3; ++i )
+	{
+		section.min[ i ] = mesh.min[ i ];
+		section.max[ i ] = mesh.max[ i ];
+		section.positionOffset[ i ] = mesh.positionOffset[ i ];
+	}
+
+	section.positionScale = mesh.positionScale;
+
+	entry.vertices.assign( mesh.vertices.begin(), mesh.vertices.begin() + mesh.vertexCount * mesh.vertexSize );
+	entry.indices.assign( mesh.indices.begin(), mesh.indices.begin() + mesh.indexCount * mesh.indexSize );
+
+	mEntries.push_back( std::move( entry ) );
+}
+
+std::vector< byte > MeshFile::serialize() const
+{
+	//the sections are written in place like the rest of the file, so this only works on little endian machines
+	uint16_t byteOrder = BYTE_ORDER_MARK;
+	DEBUG_ASSERT( *(const byte*)&byteOrder == 0xff, "serialize: .mesh files can only be written on little endian machines" );
+
+	size_t offset = _align( sizeof( Header ) + mEntries.size() * sizeof( Section ) );
+
+	std::vector< Section > sections;
+	sections.reserve( mEntries.size() );
+
+	for( auto& entry : mEntries )
+	{
+		sections.push_back( entry.section );
+		Section& section = sections.back();
+
+		section.vertexDataOffset = (uint32_t)offset;
+		offset = _align( offset + entry.vertices.size() );
+
+		section.indexDataOffset = entry.indices.empty() ? 0 : (uint32_t)offset;
+		offset = _align( offset + entry.indices.size() );
+	}
+
+	DEBUG_ASSERT( offset <= 0xffffffff, "serialize: .mesh files can't be larger than 4GB" );
+
+	std::vector< byte > out( offset );
+
+	memcpy( out.data() + sizeof( Header ), sections.data(), sections.size() * sizeof( Section ) );
+
+	for( size_t i = 0; i < mEntries.size(); ++i )
+	{
+		auto& entry = mEntries[ i ];
+
+		if( !entry.vertices.empty() )
+			memcpy( out.data() + sections[ i ].vertexDataOffset, entry.vertices.data(), entry.vertices.size() );
+
+		if( !entry.indices.empty() )
+			memcpy( out.data() + sections[ i ].indexDataOffset, entry.indices.data(), entry.indices.size() );
+	}
+
+	Header header;
+	memset( &header, 0, sizeof( Header ) );
+
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.fileSize = (uint32_t)out.size();
+	header.sectionCount = (uint32_t)mEntries.size();
+	header.checksum = (uint32_t)crc32( crc32( 0, nullptr, 0 ), out.data() + sizeof( Header ), (uInt)( out.size() - sizeof( Header ) ) );
+
+	memcpy( out.data(), &header, sizeof( Header ) );
+
+	return out;
+}
@@ -18,7 +18,12 @@ active( true ),
 scale( 1,1,1 ),
 parent( nullptr ),
 dispose( false ),
-inheritScale( true )
+inheritScale( true ),
+mStatic( false ),
+mLocalTransformDirty( true ),
+mIndependent( false ),
+mTransformVersion( 0 ),
+mParentTransformVersion( 0 )
 {
 	setSize( bbSize );
 }
@@ -31,6 +36,7 @@ Object::~Object()
 Object& Object::_addChild( Unique<Object> o )
 {    
 	DEBUG_ASSERT(o->parent == nullptr, "The child you want to attach already has a parent");
+	DEBUG_ASSERT( this != gameState || !gameState->isInParallelUpdate(), "Children can't be added to the GameState during the parallel update, use runSerially()" );
 
 	o->_notifyParent(this);
 
@@ -59,6 +65,7 @@ void Object::_unregisterChild( Object& child )
 Unique<Object> Object::removeChild( Object& o )
 {
 	DEBUG_ASSERT( hasChilds(), "This Object has no childs" );
+	DEBUG_ASSERT( this != gameState || !gameState->isInParallelUpdate(), "Children can't be removed from the GameState during the parallel update, use runSerially()" );
 	
 	auto elem = ChildList::find(childs, o);
 	if (elem != childs.end()) {
@@ -95,6 +102,8 @@ void Object::destroyAllChildren()
 
 void Object::_updateWorldAABB( const Vector& localMin, const Vector& localMax )
 {
+	Vector oldUpperBound = worldUpperBound, oldLowerBound = worldLowerBound;
+
 	//get the eight world-position corners and transform them
 	worldUpperBound = Vector::MIN;
 	worldLowerBound = Vector::MAX;
@@ -111,6 +120,9 @@ void Object::_updateWorldAABB( const Vector& localMin, const Vector& localMax )
 		worldUpperBound = Math::max( worldUpperBound, vertex );
 		worldLowerBound = Math::min( worldLowerBound, vertex );
 	}
+
+	if( worldUpperBound != oldUpperBound || worldLowerBound != oldLowerBound )
+		_onWorldAABBChanged();
 }
 
 Vector Object::getWorldPosition(const Vector& localPos) const {
@@ -209,8 +221,30 @@ void Object::updateWorldTransform()
 
 	mWorldTransform = getFullTransformRelativeTo(mWorldTransform);
 
-	if (oldTransform != mWorldTransform)
-		_updateWorldAABB( -halfSize, halfSize );
+	mLastPosition = position;
+	mLastScale = scale;
+	mParentTransformVersion = parent ? parent->mTransformVersion : 0;
+	mLocalTransformDirty = false;
+
+	bool moved = oldTransform != mWorldTransform;
+	if (moved)
+		++mTransformVersion;
+
+	_refreshWorldAABB( moved );
+}
+
+void Object::_refreshWorldAABB( bool force )
+{
+	Vector min, max;
+	_getLocalAABB( min, max );
+
+	if( force || min != mLocalAABBMin || max != mLocalAABBMax )
+	{
+		mLocalAABBMin = min;
+		mLocalAABBMax = max;
+
+		_updateWorldAABB( min, max );
+	}
 }
 
 void Object::updateChilds( float dt )
@@ -229,7 +263,15 @@ void Object::onAction( float dt )
 {	
 	position += speed * dt;	
 
-	updateWorldTransform();
+	//static objects still need a first transform and AABB, even when they are made static before their first update
+	if( !mStatic || mLocalTransformDirty )
+	{
+		//only recompute the transform when something changed, most objects don't move in a given frame
+		if( _isTransformDirty() )
+			updateWorldTransform();
+		else
+			_refreshWorldAABB( false );
+	}
 	
 	updateChilds( dt );
 }
@@ -6,10 +6,12 @@
 //
 #include "Utils.h"
 #include "File.h"
+#include "MappedFileStream.h"
 #include "dojomath.h"
 #include "ApplicationListener.h"
 #include "BackgroundQueue.h"
 #include "Log.h"
+#include "Profiler.h"
 
 #if defined (PLATFORM_WIN32)
 	#include "win32/Win32Platform.h"
@@ -85,10 +87,15 @@ Platform::Platform( const Table& configTable ) :
 
 	gp_log = mLog = new Log();
 	mLog->addListener( new StdoutLog() );
+
+	gp_profiler = mProfiler = new Profiler();
 }	
 
 Platform::~Platform()
 {
+	gp_profiler = nullptr;
+	SAFE_DELETE( mProfiler );
+
 	SAFE_DELETE( mLog );
 }
 
@@ -123,7 +130,7 @@ String Platform::_replaceFoldersWithExistingZips( const String& relPath )
 			String partialFolder = res + currentFolder + ext;
 
 			//check if partialFolder exists as a zip file
-			Poco::File zipFile( partialFolder.ASCII() );
+			Poco::File zipFile( partialFolder.UTF8() );
 
 			if( zipFile.exists() && zipFile.isFile() )
 			{
@@ -157,33 +164,108 @@ const Platform::ZipFoldersMap& Platform::_getZipFileMap( const String& path, Str
 
 	DEBUG_ASSERT( remainder.find( String(".zip") ) == String::npos, "Error: nested zips are not supported!" );
 
+	return _getZipFolders( zipPath );
+}
+
+const Platform::ZipFoldersMap& Platform::_getZipFolders( const String& zipPath )
+{
 	//has this zip been already loaded?
 	ZipFileMapping::const_iterator elem = mZipFileMaps.find( zipPath );
 
 	if( elem != mZipFileMaps.end() )
 		return elem->second;
-	else
-	{
-		mZipFileMaps[ zipPath ] = ZipFoldersMap();
-		ZipFoldersMap& map = mZipFileMaps.find( zipPath )->second;
 
-		ZipArchive zip( zipPath );
+	ZipFoldersMap& map = mZipFileMaps[ zipPath ];
+
+	if( auto zip = _getArchive( zipPath ) )
+	{
 		std::vector<String> zip_files;
-		zip.getListAllFiles(".",zip_files);
+		zip->getListAllFiles( zip_files );
 
-		for(int i=0;i<zip_files.size();++i)
-			map[ Utils::getDirectory( zip_files[i] ) ].push_back( zip_files[i] );
-		
+		for( auto& file : zip_files )
+			map[ Utils::getDirectory( file ) ].push_back( file );
+	}
+
+	return map;
+}
+
+Shared< ZipArchive > Platform::_getArchive( const String& path )
+{
+	auto elem = mArchives.find( path );
+
+	if( elem != mArchives.end() )
+		return elem->second;
 
-		return map;
+	auto archive = make_shared< ZipArchive >( path );
+
+	if( !archive->isOpen() )
+	{
+		DEBUG_MESSAGE( "WARNING: cannot open the archive " + path );
+		archive = nullptr;
 	}
+
+	//remember the failures too, so that they are not retried for each file
+	return mArchives[ path ] = archive;
+}
+
+String Platform::_getAbsolutePath( const String& path )
+{
+	String res;
+
+	if( path.empty() )
+		res = getResourcesPath();
+	else if( Utils::isAbsolutePath( path ) )
+		res = path;
+	else
+		res = getResourcesPath() + '/' + path;
+
+	Utils::makeCanonicalPath( res );
+	return res;
+}
+
+bool Platform::mountArchive( const String& archivePath, const String& mountPoint /*= String::EMPTY*/, int priority /*= 0 */ )
+{
+	std::lock_guard< std::mutex > lock( mArchivesMutex );
+
+	MountPoint mount;
+	mount.path = _getAbsolutePath( mountPoint );
+	mount.archive = _getArchive( _getAbsolutePath( archivePath ) );
+	mount.priority = priority;
+
+	if( !mount.archive )
+		return false;
+
+	//keep the mount points sorted by priority, the last mounted wins among equals
+	auto where = std::find_if( mMountPoints.begin(), mMountPoints.end(), [&]( const MountPoint& m )
+	{
+		return m.priority <= priority;
+	} );
+
+	mMountPoints.insert( where, mount );
+	return true;
+}
+
+void Platform::unmountArchive( const String& archivePath )
+{
+	std::lock_guard< std::mutex > lock( mArchivesMutex );
+
+	String path = _getAbsolutePath( archivePath );
+
+	mMountPoints.erase( std::remove_if( mMountPoints.begin(), mMountPoints.end(), [&]( const MountPoint& m )
+	{
+		return m.archive->getPath() == path;
+	} ), mMountPoints.end() );
 }
 
 void Platform::getFilePathsForType( const String& type, const String& wpath, std::vector<String>& out )
 {
+	std::lock_guard< std::mutex > lock( mArchivesMutex );
+
 	//check if any part of the path has been replaced by a zip file, so that we're in fact in a zip file
 	String absPath = getResourcesPath() + "/" +  _replaceFoldersWithExistingZips( wpath );
 
+	size_t firstFound = out.size();
+
 	int idx = _findZipExtension( absPath );
 	if( idx != String::npos ) //there's at least one zip in the path
 	{
@@ -208,7 +290,7 @@ void Platform::getFilePathsForType( const String& type, const String& wpath, std
 	{
 		try
 		{				
-			Poco::DirectoryIterator itr( absPath.ASCII() );
+			Poco::DirectoryIterator itr( absPath.UTF8() );
 			Poco::DirectoryIterator end;
 
 			String extension = type;
@@ -228,63 +310,86 @@ void Platform::getFilePathsForType( const String& type, const String& wpath, std
 		}
 		catch ( ... )	{}	
 	}
+
+	if( mMountPoints.empty() )
+		return;
+
+	//add the files that the mounted archives place in this folder, once
+	std::unordered_set< String > found( out.begin() + firstFound, out.end() );
+
+	for( auto& mount : mMountPoints )
+	{
+		String folder;
+		if( absPath.size() > mount.path.size() && absPath.compare( 0, mount.path.size(), mount.path ) == 0 && absPath[ mount.path.size() ] == '/' )
+			folder = absPath.substr( mount.path.size() + 1 );
+		else if( absPath != mount.path )
+			continue;
+
+		const ZipFoldersMap& map = _getZipFolders( mount.archive->getPath() );
+
+		auto folderItr = map.find( folder );
+		if( folderItr == map.end() )
+			continue;
+
+		for( auto& filePath : folderItr->second )
+		{
+			if( Utils::getFileExtension( filePath ) != type )
+				continue;
+
+			String path = mount.path + "/" + filePath;
+
+			if( found.insert( path ).second )
+				out.push_back( path );
+		}
+	}
 }
 
 Platform::FilePtr Platform::getFile( const String& path )
 {
-	using namespace std;
+	std::lock_guard< std::mutex > lock( mArchivesMutex );
+
+	//the mounted archives hide the loose files
+	for( auto& mount : mMountPoints )
+	{
+		if( path.size() > mount.path.size() && path.compare( 0, mount.path.size(), mount.path ) == 0 && path[ mount.path.size() ] == '/' )
+		{
+			if( auto file = mount.archive->openFile( path.substr( mount.path.size() + 1 ), path ) )
+				return file;
+		}
+	}
 
 	int internalZipPathIdx = _findZipExtension( path );
 	
-	if( internalZipPathIdx == String::npos ) //normal file
-		return FilePtr( new File( path ) );
+	if( internalZipPathIdx == String::npos || internalZipPathIdx >= (int)path.size() ) //normal file
+		return make_unique< MappedFileStream >( path );
 
-	else //open a file from a zip
+	//open a file from a zip
+	if( auto zip = _getArchive( path.substr( 0, internalZipPathIdx ) ) )
 	{
-		DEBUG_TODO;
-		//TODO use a ZipStream
-		return nullptr;
-
-		/*
-		String zipPath = path.substr( 0, internalZipPathIdx );
-		String zipInternalPath = path.substr( internalZipPathIdx+1 );
-		//OPEN ZIP
-		ZipArchive zip;
-		if(zip.open(zipPath)){
-			//OPEN FILE IN ZIP
-			auto pfile=zip.openFile(  zipInternalPath,"rb");
-			if(pfile!=NULL){
-				//READ FILE
-				size = pfile->size();
-				bufptr = (char*)malloc( size+1 );
-				pfile->read(bufptr,size,1);
-				//CLOSE FILE
-				delete pfile;
-				//ADD terminator
-				bufptr[ size ] = 0;
-			}
-			else{
-				DEBUG_MESSAGE("can't read:"<<path.ASCII());
-				return 0;
-			}
-		}
-		else{
-			DEBUG_MESSAGE("can't open:"<<zipPath.ASCII());
-			return 0;
-		}*/
+		if( auto file = zip->openFile( path.substr( internalZipPathIdx + 1 ), path ) )
+			return file;
 	}
+
+	DEBUG_MESSAGE( "WARNING: can't find " + path );
+
+	//a stream that will fail to open, as for a missing loose file
+	return make_unique< MappedFileStream >( path );
 }
 
 int Platform::loadFileContent( char*& bufptr, const String& path )
 {
-	auto file = Unique<FileStream>( getFile( path ) );
+	auto file = getFile( path );
 	int size = 0;
 	if( file->open() )
 	{
 		size = file->getSize();
 		bufptr = (char*)malloc( size );
 
-		file->read( (byte*)bufptr, size );
+		//the mapped data can be copied directly
+		if( auto data = file->getData() )
+			memcpy( bufptr, data, size );
+		else
+			file->read( (byte*)bufptr, size );
 	}
 
 	return size;
@@ -317,22 +422,17 @@ void Platform::save(const Table& src, const String& absPathOrName)
 	
 	String path = _getTablePath(absPathOrName);
 
-	DEBUG_MESSAGE( path.ASCII() );
-	FILE* f = fopen( path.ASCII().c_str(), "w+" );
+	DEBUG_MESSAGE( path );
+	FILE* f = fopen( path.UTF8().c_str(), "w+" );
 	
 	if( f==NULL )
 	{
 		DEBUG_MESSAGE( "WARNING: Table parent directory not found!" );
-		DEBUG_MESSAGE( path.ASCII() );
+		DEBUG_MESSAGE( path );
 	}
 	DEBUG_ASSERT( f, "Cannot open a file for saving" );
-	
-	std::string utf8; //TODO a real UTF8 conversion
-
-	for( unichar c : buf )
-		utf8 += (char)c;
 
-	fwrite( utf8.c_str(), sizeof( char ), utf8.size(), f );
+	fwrite( buf.data(), sizeof( char ), buf.size(), f );
 	
 	fclose( f );
 }
@@ -5,6 +5,7 @@
 #include "Mesh.h"
 #include "Tessellation.h"
 #include "Font.h"
+#include "GameState.h"
 
 using namespace Dojo;
 
@@ -91,12 +92,18 @@ void PolyTextArea::_tesselateExtrusionStrip( Tessellation* t, int baseIdx, int l
 
 void PolyTextArea::_addExtrusionLayer( Tessellation* t, const Vector& origin, float inflate, const Vector* forcedNormal )
 {
-	int layerIdx = mMesh->getVertexCount();
+	Mesh::IndexType count = t->extrusionContourVertices.size();
+	int layerIdx = mMesh->appendVertices( count );
 
-	for( auto& vertex : t->extrusionContourVertices )
+	auto positions = mMesh->getFieldSpan< Vector >( VertexField::Position3D, layerIdx, count );
+	auto normals = mMesh->getFieldSpan< Vector >( VertexField::Normal, layerIdx, count );
+
+	for( Mesh::IndexType i = 0; i < count; ++i )
 	{
-		mMesh->vertex( origin + vertex.position + vertex.normal * inflate );
-		mMesh->normal( forcedNormal ? *forcedNormal : vertex.normal );
+		auto& vertex = t->extrusionContourVertices[i];
+
+		positions[i] = origin + vertex.position + vertex.normal * inflate;
+		normals[i] = forcedNormal ? *forcedNormal : vertex.normal;
 	}
 
 	if( mPrevLayerIdx >= 0 )
@@ -105,6 +112,30 @@ void PolyTextArea::_addExtrusionLayer( Tessellation* t, const Vector& origin, fl
 	mPrevLayerIdx = layerIdx;
 }
 
+void PolyTextArea::_addPositions( Tessellation* t, const Vector& origin )
+{
+	Mesh::IndexType count = t->positions.size();
+	auto positions = mMesh->getFieldSpan< glm::vec2 >( VertexField::Position2D, mMesh->appendVertices( count ), count );
+
+	for( Mesh::IndexType i = 0; i < count; ++i )
+		positions[i] = glm::vec2( origin.x + (float)t->positions[i].x, origin.y + (float)t->positions[i].y );
+}
+
+void PolyTextArea::_addIndices( const std::vector< int >& indices, int baseIdx )
+{
+	//the indices are never negative
+	mMesh->appendIndices( (const Mesh::IndexType*)indices.data(), indices.size(), baseIdx );
+}
+
+void PolyTextArea::onAction( float dt )
+{
+	//the mesh can only be uploaded on the main thread, so wait for the end of the parallel update
+	if( mDirty )
+		gameState->runSerially( [this]() { _prepare(); } );
+
+	Renderable::onAction(dt);
+}
+
 void PolyTextArea::_prepare()
 {
 	Vector basePosition;
@@ -113,7 +144,7 @@ void PolyTextArea::_prepare()
 
 	mMesh->begin();
 
-	for( auto c : mContent )
+	for( unichar c : mContent.codepoints() )
 	{
 		//get the tesselation for each character and stuff it into the mesh
 		auto character = pFont->getCharacter( c );
@@ -155,17 +186,13 @@ void PolyTextArea::_prepare()
 
 			if( mRendering == RT_SURFACE )
 			{
-				for( auto& pos : t->positions )
-					mMesh->vertex( charPosition + pos.toVec() );
-			
-				for( auto& index : t->outIndices )
-					mMesh->index( baseIdx + index );
+				_addPositions( t, charPosition );
+				_addIndices( t->outIndices, baseIdx );
 			}
 			else if( mRendering == RT_EXTRUDED )
 			{
 				//tesselate front face
-				for( auto& index : t->outIndices )
-					mMesh->index( baseIdx + index );
+				_addIndices( t->outIndices, baseIdx );
 
 				//extrude the character
 				mPrevLayerIdx = -1;
@@ -189,14 +216,10 @@ void PolyTextArea::_prepare()
 			}
 			else //HACK do not actually use contours here
 			{
-				for( size_t i = 0; i < t->positions.size(); ++i )
-				{
-					mMesh->vertex( charPosition + t->positions[i].toVec() );
-				}
+				_addPositions( t, charPosition );
 
 				for( auto& contour : t->contours )
-					for( auto& index : contour.indices )
-						mMesh->index( baseIdx + index );
+					_addIndices( contour.indices, baseIdx );
 			}
 		}
 
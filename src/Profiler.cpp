@@ -0,0 +1,454 @@
+#include "stdafx.h"
+
+#include "Profiler.h"
+
+#include "Timer.h"
+#include "Log.h"
+
+using namespace Dojo;
+
+Profiler* Dojo::gp_profiler = nullptr;
+
+//the buffer of each thread, valid only for the Profiler that created it
+static DOJO_THREAD_LOCAL Profiler* tl_profiler = nullptr;
+static DOJO_THREAD_LOCAL void* tl_buffer = nullptr;
+
+Profiler::Profiler( int eventsPerThread ) :
+	mEnabled( false ),
+	mCapturing( false ),
+	mEventsPerThread( eventsPerThread ),
+	mCaptureID( 0 ),
+	mCaptureStart( 0 ),
+	mCaptureFramesLeft( 0 ),
+	mSaveCountdown( 0 ),
+	mGPUTimersChecked( false ),
+	mGPUTimersAvailable( false ),
+	mGPUFrame( 0 ),
+	mGPUTimeOffset( 0 )
+{
+	DEBUG_ASSERT( eventsPerThread > 0, "The events per thread must be more than 0" );
+
+	mMainThreadID = std::this_thread::get_id();
+
+	//the main thread always gets the first buffer
+	_getThreadBuffer();
+}
+
+Profiler::~Profiler()
+{
+	//the queries are not deleted, as the GL context is usually gone by now and they go with it
+}
+
+Profiler::ThreadBuffer& Profiler::_getThreadBuffer()
+{
+	if( tl_profiler != this )
+	{
+		std::lock_guard< std::mutex > lock( mThreadsMutex );
+
+		mThreads.push_back( make_unique< ThreadBuffer >( (int)mThreads.size() ) );
+
+		tl_buffer = mThreads.back().get();
+		tl_profiler = this;
+	}
+
+	return *(ThreadBuffer*)tl_buffer;
+}
+
+void Profiler::setEnabled( bool enabled )
+{
+	if( !enabled && isCapturing() )
+		endCapture();
+
+	mEnabled = enabled;
+}
+
+void Profiler::_checkGPUTimers()
+{
+	DEBUG_ASSERT( std::this_thread::get_id() == mMainThreadID, "The GPU timers can only be used on the main thread" );
+
+	if( !mGPUTimersChecked )
+	{
+		mGPUTimersChecked = true;
+
+#ifdef DOJO_GPU_TIMER_QUERIES_AVAILABLE
+		mGPUTimersAvailable = GLEW_ARB_timer_query != 0;
+#endif
+		_calibrateGPUTime();
+	}
+}
+
+void Profiler::_calibrateGPUTime()
+{
+#ifdef DOJO_GPU_TIMER_QUERIES_AVAILABLE
+	if( mGPUTimersAvailable )
+	{
+		//align the GPU clock to the CPU one, so that the GPU zones can be shown next to the threads
+		GLint64 gpuTime;
+		glGetInteger64v( GL_TIMESTAMP, &gpuTime );
+
+		mGPUTimeOffset = Timer::currentTime() - gpuTime * 0.000000001;
+	}
+#endif
+}
+
+void Profiler::beginCapture()
+{
+	DEBUG_ASSERT( std::this_thread::get_id() == mMainThreadID, "Captures can only be started on the main thread" );
+	DEBUG_ASSERT( !isCapturing(), "A capture is already running" );
+
+	setEnabled( true );
+
+	++mCaptureID;
+	mCaptureStart = Timer::currentTime();
+	mGPUEvents.clear();
+
+	if( mGPUTimersChecked )
+		_calibrateGPUTime();
+
+	mCapturing = true;
+}
+
+void Profiler::endCapture()
+{
+	mCapturing = false;
+}
+
+void Profiler::captureFrames( int frames, const String& path )
+{
+	DEBUG_ASSERT( frames > 0, "Cannot capture less than 1 frame" );
+
+	beginCapture();
+
+	mCaptureFramesLeft = frames;
+	mCapturePath = path;
+}
+
+double Profiler::_beginZone( const char* name )
+{
+	ThreadBuffer& buffer = _getThreadBuffer();
+
+	//list the main thread zones as they begin, so the parents come before their children
+	if( buffer.index == 0 )
+		_addStats( mFrameStats, name, 0, buffer.depth, false, 0 );
+
+	++buffer.depth;
+
+	return Timer::currentTime();
+}
+
+void Profiler::_endZone( const char* name, double start )
+{
+	double end = Timer::currentTime();
+
+	ThreadBuffer& buffer = _getThreadBuffer();
+
+	--buffer.depth;
+
+	if( buffer.index == 0 ) //the main thread
+		_addStats( mFrameStats, name, end - start, buffer.depth, false, 1 );
+
+	if( isCapturing() )
+	{
+		//the first event of a new capture starts the buffer over
+		int capture = mCaptureID.load( std::memory_order_relaxed );
+		if( buffer.captureID.load( std::memory_order_relaxed ) != capture )
+		{
+			if( buffer.events.empty() )
+				buffer.events.resize( mEventsPerThread );
+
+			buffer.count.store( 0, std::memory_order_relaxed );
+			buffer.captureID.store( capture, std::memory_order_relaxed );
+		}
+
+		//the events that don't fit are dropped
+		int count = buffer.count.load( std::memory_order_relaxed );
+		if( count < (int)buffer.events.size() )
+		{
+			Event& e = buffer.events[ count ];
+			e.name = name;
+			e.start = start;
+			e.end = end;
+
+			buffer.count.store( count + 1, std::memory_order_release );
+		}
+	}
+}
+
+int Profiler::_beginGPUZone( const char* name )
+{
+	_checkGPUTimers();
+
+#ifdef DOJO_GPU_TIMER_QUERIES_AVAILABLE
+	if( mGPUTimersAvailable )
+	{
+		GPUFrame& frame = mGPUFrames[ mGPUFrame ];
+
+		GPUQuery zone;
+		zone.name = name;
+		zone.begin = _nextQuery( frame );
+		zone.end = -1;
+		zone.depth = _getThreadBuffer().depth - 1; //the CPU zone has already begun
+
+		glQueryCounter( frame.queries[ zone.begin ], GL_TIMESTAMP );
+
+		frame.zones.push_back( zone );
+		return (int)frame.zones.size() - 1;
+	}
+#endif
+
+	return -1;
+}
+
+void Profiler::_endGPUZone( int query )
+{
+#ifdef DOJO_GPU_TIMER_QUERIES_AVAILABLE
+	GPUFrame& frame = mGPUFrames[ mGPUFrame ];
+
+	DEBUG_ASSERT( query < (int)frame.zones.size(), "A GPU zone can't last longer than a frame" );
+
+	int end = _nextQuery( frame );
+	glQueryCounter( frame.queries[ end ], GL_TIMESTAMP );
+
+	frame.zones[ query ].end = end;
+#endif
+}
+
+int Profiler::_nextQuery( GPUFrame& frame )
+{
+#ifdef DOJO_GPU_TIMER_QUERIES_AVAILABLE
+	//the queries are reused frame after frame, more are created when a frame needs them
+	if( frame.usedQueries == (int)frame.queries.size() )
+	{
+		GLuint query;
+		glGenQueries( 1, &query );
+		frame.queries.push_back( query );
+	}
+#endif
+
+	return frame.usedQueries++;
+}
+
+void Profiler::_readGPUFrame( GPUFrame& frame )
+{
+#ifdef DOJO_GPU_TIMER_QUERIES_AVAILABLE
+	if( frame.usedQueries > 0 )
+	{
+		//the queries end in order, if the last is done all of them are
+		GLint available = 0;
+		glGetQueryObjectiv( frame.queries[ frame.usedQueries - 1 ], GL_QUERY_RESULT_AVAILABLE, &available );
+
+		//if the GPU is that late, skip the frame rather than waiting
+		if( available )
+		{
+			mGPUStats.clear();
+
+			for( auto& zone : frame.zones )
+			{
+				if( zone.end < 0 )
+					continue;
+
+				GLuint64 begin, end;
+				glGetQueryObjectui64v( frame.queries[ zone.begin ], GL_QUERY_RESULT, &begin );
+				glGetQueryObjectui64v( frame.queries[ zone.end ], GL_QUERY_RESULT, &end );
+
+				_addStats( mGPUStats, zone.name, (end - begin) * 0.000000001, zone.depth, true, 1 );
+
+				if( frame.captured )
+				{
+					Event e;
+					e.name = zone.name;
+					e.start = mGPUTimeOffset + begin * 0.000000001;
+					e.end = mGPUTimeOffset + end * 0.000000001;
+
+					mGPUEvents.push_back( e );
+				}
+			}
+		}
+	}
+#endif
+
+	frame.zones.clear();
+	frame.usedQueries = 0;
+}
+
+void Profiler::_addStats( StatsList& stats, const char* name, double time, int depth, bool gpu, int calls )
+{
+	//there are few zones per frame, a linear search is fine
+	for( auto& s : stats )
+	{
+		if( s.name == name && s.gpu == gpu )
+		{
+			s.time += time;
+			s.calls += calls;
+			return;
+		}
+	}
+
+	ZoneStats s;
+	s.name = name;
+	s.time = time;
+	s.calls = calls;
+	s.depth = depth;
+	s.gpu = gpu;
+
+	stats.push_back( s );
+}
+
+void Profiler::_endFrame()
+{
+	DEBUG_ASSERT( std::this_thread::get_id() == mMainThreadID, "The frame can only be ended on the main thread" );
+
+	//read the oldest GPU frame, and reuse it for the frame that starts now
+	if( mGPUTimersAvailable )
+	{
+		mGPUFrame = (mGPUFrame + 1) % GPU_FRAME_LATENCY;
+
+		_readGPUFrame( mGPUFrames[ mGPUFrame ] );
+
+		mGPUFrames[ mGPUFrame ].captured = isCapturing();
+	}
+
+	mLastFrameStats.swap( mFrameStats );
+	mLastFrameStats.insert( mLastFrameStats.end(), mGPUStats.begin(), mGPUStats.end() );
+	mFrameStats.clear();
+
+	//end the requested captures, and save them when the GPU timings have arrived too
+	if( mCaptureFramesLeft > 0 && --mCaptureFramesLeft == 0 )
+	{
+		endCapture();
+
+		mSaveCountdown = mGPUTimersAvailable ? GPU_FRAME_LATENCY : 1;
+	}
+	else if( mSaveCountdown > 0 && --mSaveCountdown == 0 )
+		saveCapture( mCapturePath );
+}
+
+const char* Profiler::intern( const std::string& name )
+{
+	std::lock_guard< std::mutex > lock( mNamesMutex );
+
+	return mNames.insert( name ).first->c_str();
+}
+
+//writes str as the contents of a JSON string, escaping the quotes, the backslashes and the control characters
+static void _writeEscaped( std::ostringstream& out, const char* str )
+{
+	for( ; *str; ++str )
+	{
+		char c = *str;
+
+		if( c == '"' || c == '\\' )
+			out << '\\' << c;
+		else if( (unsigned char)c < 0x20 )
+		{
+			char code[ 8 ];
+			sprintf( code, "\\u%04x", (unsigned char)c );
+			out << code;
+		}
+		else
+			out << c;
+	}
+}
+
+static void _writeEvent( std::ostringstream& out, const char* name, int thread, double start, double end, bool& first )
+{
+	if( !first )
+		out << ",\n";
+	first = false;
+
+	//chrome wants microseconds
+	out << "{\"name\":\"";
+	_writeEscaped( out, name );
+	out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread
+		<< ",\"ts\":" << start * 1000000.0 << ",\"dur\":" << (end - start) * 1000000.0 << "}";
+}
+
+static void _writeThreadName( std::ostringstream& out, int thread, const std::string& name, bool& first )
+{
+	if( !first )
+		out << ",\n";
+	first = false;
+
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread << ",\"args\":{\"name\":\"";
+	_writeEscaped( out, name.c_str() );
+	out << "\"}}";
+}
+
+bool Profiler::saveCapture( const String& path )
+{
+	DEBUG_ASSERT( !isCapturing(), "End the capture before saving it" );
+
+	std::ostringstream out;
+	out << std::fixed;
+	out.precision( 3 );
+
+	out << "{\"traceEvents\":[\n";
+
+	bool first = true;
+	int capture = mCaptureID;
+	int gpuThread;
+
+	{
+		std::lock_guard< std::mutex > lock( mThreadsMutex );
+
+		for( auto& buffer : mThreads )
+		{
+			if( buffer->captureID != capture )
+				continue;
+
+			_writeThreadName( out, buffer->index, buffer->index == 0 ? "Main thread" : "Thread " + String( buffer->index ).ASCII(), first );
+
+			int count = buffer->count.load( std::memory_order_acquire );
+			for( int i = 0; i < count; ++i )
+			{
+				const Event& e = buffer->events[ i ];
+				_writeEvent( out, e.name, buffer->index, e.start - mCaptureStart, e.end - mCaptureStart, first );
+			}
+		}
+
+		gpuThread = (int)mThreads.size();
+	}
+
+	if( mGPUEvents.size() )
+	{
+		_writeThreadName( out, gpuThread, "GPU", first );
+
+		for( auto& e : mGPUEvents )
+			_writeEvent( out, e.name, gpuThread, e.start - mCaptureStart, e.end - mCaptureStart, first );
+	}
+
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	FILE* f = fopen( path.UTF8().c_str(), "wb" );
+	if( !f )
+	{
+		DEBUG_MESSAGE( "Cannot open " + path + " to save the profiler capture" );
+		return false;
+	}
+
+	std::string json = out.str();
+	fwrite( json.c_str(), sizeof( char ), json.size(), f );
+	fclose( f );
+
+	DEBUG_MESSAGE( "Profiler capture saved to " + path );
+	return true;
+}
+
+String Profiler::getSummary() const
+{
+	std::ostringstream out;
+	out << std::fixed;
+	out.precision( 2 );
+
+	for( auto& s : mLastFrameStats )
+	{
+		out << std::string( s.depth * 2, ' ' ) << ( s.gpu ? "[GPU] " : "" ) << s.name << ": " << s.time * 1000.0 << " ms";
+
+		if( s.calls > 1 )
+			out << " (x" << s.calls << ")";
+
+		out << "\n";
+	}
+
+	return String( out.str() );
+}
@@ -0,0 +1,47 @@
+#include "stdafx.h"
+
+#include "ProfilerOverlay.h"
+
+#include "Platform.h"
+#include "Renderer.h"
+#include "Profiler.h"
+
+using namespace Dojo;
+
+ProfilerOverlay::ProfilerOverlay( Object* parent, const String& fontSetName, const Vector& pos, float refreshPeriod ) :
+	TextArea( parent, fontSetName, pos ),
+	mRefreshPeriod( refreshPeriod ),
+	mElapsed( refreshPeriod )
+{
+	DEBUG_ASSERT( refreshPeriod >= 0, "The refresh period can't be negative" );
+
+	Platform::singleton().getProfiler().setEnabled( true );
+}
+
+void ProfilerOverlay::onAction( float dt )
+{
+	//rebuilding the text each frame would show up in the profile itself
+	mElapsed += dt;
+	if( mElapsed >= mRefreshPeriod )
+	{
+		mElapsed = 0;
+		_refresh();
+	}
+
+	TextArea::onAction( dt );
+}
+
+void ProfilerOverlay::_refresh()
+{
+	Platform& platform = Platform::singleton();
+	Renderer& r = platform.getRenderer();
+
+	clearText();
+
+	addText( "frame: " + String( (float)platform.getRealFrameTime() * 1000.f ) + " ms\n" );
+	addText( "batches: " + String( r.getLastFrameBatchCount() ) +
+		" tris: " + String( r.getLastFrameTriCount() ) +
+		" verts: " + String( r.getLastFrameVertexCount() ) + "\n" );
+
+	addText( platform.getProfiler().getSummary() );
+}
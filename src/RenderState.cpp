@@ -139,47 +139,123 @@ int RenderState::getDistance(RenderState* s) {
 	return dist;
 }
 
+bool RenderState::isBatchableWith(const RenderState& s) const {
+	if (pShader != s.pShader ||
+		blendingEnabled != s.blendingEnabled ||
+		srcBlend != s.srcBlend ||
+		destBlend != s.destBlend ||
+		blendFunction != s.blendFunction ||
+		cullMode != s.cullMode)
+		return false;
+
+	for (int i = 0; i < DOJO_MAX_TEXTURES; ++i)
+	{
+		auto a = textures[i], b = s.textures[i];
+
+		if ((a ? a->texture : nullptr) != (b ? b->texture : nullptr))
+			return false;
+
+		//the texture matrix can't change inside a batch
+		if ((a && a->isTransformRequired()) || (b && b->isTransformRequired()))
+			return false;
+	}
+
+	return true;
+}
+
+bool RenderState::hasResidentTextures() const {
+	for (int i = 0; i < DOJO_MAX_TEXTURES; ++i)
+	{
+		Texture* t = textures[i] ? textures[i]->texture : nullptr;
+
+		if (t && t->isLoaded() && !t->isResident())
+			return false;
+	}
+
+	return true;
+}
+
 bool RenderState::isAlphaRequired()
 {
 	return blendingEnabled || getTextureNumber() == 0;
 }
 
-void RenderState::applyState()
+uint64_t RenderState::getSortKey() const {
+	//the most expensive switches go in the most significant bits: shader, textures, blending and culling, then the mesh
+	auto hashPointer = [](const void* p) {
+		return (uint64_t)(uintptr_t)p >> 4; //skip the alignment bits
+	};
+
+	uint64_t texturesHash = 0;
+	for (int i = 0; i < DOJO_MAX_TEXTURES; ++i)
+		texturesHash = texturesHash * 31 + hashPointer(textures[i] ? textures[i]->texture : nullptr);
+
+	uint64_t blendHash = (blendingEnabled ? 1 : 0) + srcBlend * 3 + destBlend * 7 + blendFunction * 11 + cullMode * 13;
+
+	return
+		((hashPointer(pShader) & 0xfff) << 52) |
+		((texturesHash & 0xffffff) << 28) |
+		((blendHash & 0xff) << 20) |
+		(hashPointer(mesh) & 0xfffff);
+}
+
+void RenderState::_bindTextureSlot( int i )
 {
-	for( int i = 0; i < DOJO_MAX_TEXTURES; ++i )
+	//select current slot
+	glActiveTexture( GL_TEXTURE0 + i );
+	
+#ifdef DOJO_SHADERS_AVAILABLE
+	//shaders get the texture transform as an uniform
+	if( textures[i] && textures[i]->texture )
+		textures[i]->texture->bind(i);
+	else
+		glBindTexture( GL_TEXTURE_2D, 0 );
+#else
+	if( textures[i] )
 	{
-		//select current slot
-		glActiveTexture( GL_TEXTURE0 + i );
+		textures[i]->texture->bind(i);
 		
-		if( textures[i] )
-		{
-			textures[i]->texture->bind(i);
-			
-			if( textures[i]->isTransformRequired() )
-				textures[i]->applyTransform();
-			else
-			{
-				glMatrixMode( GL_TEXTURE );
-				glLoadIdentity();
-			}
-		}
+		if( textures[i]->isTransformRequired() )
+			textures[i]->applyTransform();
 		else
 		{
-			//override the previous bound texture with nothing
-			glBindTexture( GL_TEXTURE_2D, 0 );
-			glDisable( GL_TEXTURE_2D );
-			
 			glMatrixMode( GL_TEXTURE );
 			glLoadIdentity();
 		}
 	}
-	
+	else
+	{
+		//override the previous bound texture with nothing
+		glBindTexture( GL_TEXTURE_2D, 0 );
+		glDisable( GL_TEXTURE_2D );
+		
+		glMatrixMode( GL_TEXTURE );
+		glLoadIdentity();
+	}
+#endif
+}
+
+void RenderState::_applyColor()
+{
+#ifdef DOJO_SHADERS_AVAILABLE
+	//meshes without colors read the current value of the attribute, just like glColor
+	glVertexAttrib4f( Shader::getBuiltInAttributeLocation( VertexField::Color ), color.r, color.g, color.b, color.a );
+#else
+	glColor4f( color.r, color.g, color.b, color.a );
+#endif
+}
+
+void RenderState::_applyBlending()
+{
 	if( blendingEnabled )	glEnable( GL_BLEND );
 	else                    glDisable( GL_BLEND );
 	
 	glBlendFunc( srcBlend, destBlend );
 	glBlendEquation( blendFunction );
-	
+}
+
+void RenderState::_applyCullMode()
+{
 	switch( cullMode )
 	{
 		case CM_DISABLED:
@@ -196,16 +272,81 @@ void RenderState::applyState()
 			glCullFace( GL_FRONT );
 			break;
 	}
+}
+
+void RenderState::_applyRenderState()
+{
+	for( int i = 0; i < DOJO_MAX_TEXTURES; ++i )
+		_bindTextureSlot( i );
+
+	_applyBlending();
+	_applyCullMode();
+}
+
+void RenderState::applyState()
+{
+	DEBUG_ASSERT( mesh, "A mesh is required to setup a new renderstate" );
+
+	_applyRenderState();
 
 	mesh->bind( pShader );
 }
 
+int RenderState::applyStateChanges( const RenderState& lastState )
+{
+	int skipped = 0;
+
+	for( int i = 0; i < DOJO_MAX_TEXTURES; ++i )
+	{
+		auto cur = textures[i], last = lastState.textures[i];
+
+		bool sameTexture = (cur ? cur->texture : nullptr) == (last ? last->texture : nullptr);
+
+#ifdef DOJO_SHADERS_AVAILABLE
+		bool transformed = false; //shaders take the transform as an uniform
+#else
+		//a texture transform has to be loaded anyway, as it could have changed
+		bool transformed = (cur && cur->isTransformRequired()) || (last && last->isTransformRequired());
+#endif
+
+		if( sameTexture && !transformed )
+			++skipped;
+		else
+			_bindTextureSlot( i );
+	}
+
+	if( blendingEnabled == lastState.blendingEnabled &&
+		srcBlend == lastState.srcBlend &&
+		destBlend == lastState.destBlend &&
+		blendFunction == lastState.blendFunction )
+		++skipped;
+	else
+		_applyBlending();
+
+	if( cullMode == lastState.cullMode )
+		++skipped;
+	else
+		_applyCullMode();
+
+	return skipped;
+}
+
 void RenderState::commitChanges() {
 	DEBUG_ASSERT( mesh, "A mesh is required to setup a new renderstate" );
 
 	//always bind color as it is just not expensive
-	glColor4f( color.r, color.g, color.b, color.a );
-	
-	//TODO incremental state switches please!
+	_applyColor();
+
 	applyState();
 }
+
+int RenderState::commitChanges( const RenderState* lastState ) {
+	//always bind color as it is just not expensive
+	_applyColor();
+
+	if( lastState )
+		return applyStateChanges( *lastState );
+
+	_applyRenderState();
+	return 0;
+}
@@ -6,14 +6,17 @@
 #include "Viewport.h"
 #include "Mesh.h"
 #include "GameState.h"
+#include "Renderer.h"
 
 using namespace Dojo;
 
 Renderable::Renderable( Object* parent, const Vector& pos, Mesh* m ) :
 	Object( parent, pos, Vector::ONE ),
 	visible( true ),
+	render( nullptr ),
 	layer( INT_MIN ),
 	renderingOrder(0),
+	spatialProxy( -1 ),
 	currentFadeTime(0)
 {
 	reset();
@@ -24,8 +27,10 @@ Renderable::Renderable( Object* parent, const Vector& pos, Mesh* m ) :
 Renderable::Renderable( Object* parent, const Vector& pos, const String& meshName ) :
 	Object( parent, pos, Vector::ONE ),
 	visible( true ),
+	render( nullptr ),
 	layer(0),
 	renderingOrder(0),
+	spatialProxy( -1 ),
 	currentFadeTime(0)
 {
 	reset();
@@ -82,15 +87,22 @@ void Renderable::startFade(float startAlpha, float endAlpha, float duration) {
 void Renderable::onAction( float dt )
 {
 	Object::onAction( dt );
-
-	if( mesh )
-		_updateWorldAABB( mesh->getMin(), mesh->getMax() );
 	
 	advanceFade(dt);
 }
 
+void Renderable::_getLocalAABB( Vector& min, Vector& max ) const {
+	if (mesh) {
+		min = mesh->getMin();
+		max = mesh->getMax();
+	}
+	else
+		Object::_getLocalAABB(min, max);
+}
+
 bool Renderable::canBeRendered() const {
-	return isVisible() && mesh && mesh->isLoaded() && mesh->getVertexCount() > 0;
+	//streamed textures have undefined contents until they are resident, so wait for them
+	return isVisible() && mesh && mesh->isLoaded() && mesh->getVertexCount() > 0 && hasResidentTextures();
 }
 
 void Renderable::stopFade() {
@@ -120,6 +132,11 @@ void Renderable::advanceFade(float dt) {
 	}
 }
 
+void Renderable::_onWorldAABBChanged() {
+	if (render && spatialProxy >= 0)
+		render->_notifyWorldAABBChanged(*this);
+}
+
 void Renderable::_notifyRenderInfo(Renderer* r, int layerID, int renderIdx) {
 	render = r;
 	layer = layerID;
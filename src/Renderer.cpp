@@ -9,12 +9,85 @@
 #include "Mesh.h"
 #include "AnimatedQuad.h"
 #include "Shader.h"
+#include "SpatialGrid.h"
+#include "AABBTree.h"
 
 #include "Game.h"
 #include "Texture.h"
+#include "TextureStreamer.h"
+#include "Profiler.h"
 
 using namespace Dojo;
 
+#ifdef DOJO_SHADERS_AVAILABLE
+//the default shaders do what the fixed function pipeline did: vertex or object color, modulated by the first texture
+//they are GLSL 1.20, so that they compile on the legacy and compatibility contexts that the platforms create
+static const char* sDefaultShaderHeader = "#version 120\n";
+
+static const char* sDefaultVertexShader =
+	"uniform mat4 WORLDVIEWPROJ;\n"
+	"uniform mat4 TEXTURE_0_TRANSFORM;\n"
+	"attribute vec3 POSITION;\n"
+	"attribute vec4 COLOR;\n"
+	"attribute vec2 TEXCOORD_0;\n"
+	"varying vec4 vColor;\n"
+	"varying vec2 vUV;\n"
+	"void main() {\n"
+	"	vColor = COLOR;\n"
+	"#ifdef TEXTURED\n"
+	"	vUV = (TEXTURE_0_TRANSFORM * vec4(TEXCOORD_0, 0.0, 1.0)).xy;\n"
+	"#else\n"
+	"	vUV = vec2(0.0);\n"
+	"#endif\n"
+	"	gl_Position = WORLDVIEWPROJ * vec4(POSITION, 1.0);\n"
+	"}\n";
+
+static const char* sDefaultFragmentShader =
+	"uniform sampler2D TEXTURE_0;\n"
+	"varying vec4 vColor;\n"
+	"varying vec2 vUV;\n"
+	"void main() {\n"
+	"#ifdef TEXTURED\n"
+	"	gl_FragColor = vColor * texture2D(TEXTURE_0, vUV);\n"
+	"#else\n"
+	"	gl_FragColor = vColor;\n"
+	"#endif\n"
+	"}\n";
+
+//the #version line must come before anything else in the source
+static std::string _getDefaultShaderSource( const char* body, bool textured )
+{
+	return std::string( sDefaultShaderHeader ) + ( textured ? "#define TEXTURED\n" : "" ) + body;
+}
+#endif
+
+#ifdef DOJO_INSTANCING_AVAILABLE
+//GL 3.3 has these in the core, before that ARB_instanced_arrays has the same functions with another name
+static void _vertexAttribDivisor( GLuint index, GLuint divisor )
+{
+	if( GLEW_VERSION_3_3 )
+		glVertexAttribDivisor( index, divisor );
+	else
+		glVertexAttribDivisorARB( index, divisor );
+}
+
+static void _drawArraysInstanced( GLenum mode, GLint first, GLsizei count, GLsizei instances )
+{
+	if( GLEW_VERSION_3_3 )
+		glDrawArraysInstanced( mode, first, count, instances );
+	else
+		glDrawArraysInstancedARB( mode, first, count, instances );
+}
+
+static void _drawElementsInstanced( GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances )
+{
+	if( GLEW_VERSION_3_3 )
+		glDrawElementsInstanced( mode, count, type, indices, instances );
+	else
+		glDrawElementsInstancedARB( mode, count, type, indices, instances );
+}
+#endif
+
 Renderer::Renderer( int w, int h, Orientation deviceOr ) :
 frameStarted( false ),
 valid( true ),
@@ -25,7 +98,21 @@ deviceOrientation( deviceOr ),
 currentLayer( NULL ),
 frameVertexCount(0),
 frameTriCount(0),
-frameBatchCount(0)
+frameBatchCount(0),
+frameSkippedStateChangeCount(0),
+frameUniformUploadCount(0),
+frameSkippedUniformCount(0),
+mFrameUniforms(),
+mFrameUniformsVersion(0),
+mFrameUniformBuffer(0),
+mNextRenderingOrder(0),
+mParallelUpdate( false ),
+mLastState( nullptr ),
+mLastMesh( nullptr ),
+mBatchingEnabled( true ),
+mBatchVertexCount(0),
+mInstanceBuffer(0),
+mInstancingAvailable( false )
 {
 	DEBUG_MESSAGE( "Creating OpenGL context...");
 	DEBUG_MESSAGE ("querying GL info... ");
@@ -37,18 +124,52 @@ frameBatchCount(0)
 	CHECK_GL_ERROR;
 	CHECK_GL_ERROR;
 	
-	glEnable( GL_RESCALE_NORMAL );
-	glEnable( GL_NORMALIZE );
 	glEnable( GL_CULL_FACE );
 
 	glCullFace( GL_BACK );
-	
-	glShadeModel( GL_SMOOTH );
 
 	//default status for blending
 	glEnable( GL_BLEND );	
 	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 	
+#ifdef DOJO_GAMMA_CORRECTION_ENABLED
+	glEnable( GL_FRAMEBUFFER_SRGB );
+#endif
+
+#ifdef DOJO_SHADERS_AVAILABLE
+	mDefaultShader = make_unique< Shader >( 
+		_getDefaultShaderSource( sDefaultVertexShader, false ), 
+		_getDefaultShaderSource( sDefaultFragmentShader, false ) );
+	mDefaultTexturedShader = make_unique< Shader >( 
+		_getDefaultShaderSource( sDefaultVertexShader, true ), 
+		_getDefaultShaderSource( sDefaultFragmentShader, true ) );
+
+	mDefaultShader->onLoad();
+	mDefaultTexturedShader->onLoad();
+
+	DEBUG_ASSERT( mDefaultShader->isLoaded() && mDefaultTexturedShader->isLoaded(), "Cannot compile the default shaders" );
+
+#ifdef DOJO_INSTANCING_AVAILABLE
+	mInstancingAvailable = GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays;
+#endif
+
+#ifdef DOJO_UNIFORM_BUFFERS_AVAILABLE
+	//the per-frame uniforms are shared by all the shaders through a single buffer
+	//without it, the shaders get them as plain uniforms, once per frame per program
+	if( GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object )
+	{
+		glGenBuffers( 1, &mFrameUniformBuffer );
+		glBindBuffer( GL_UNIFORM_BUFFER, mFrameUniformBuffer );
+		glBufferData( GL_UNIFORM_BUFFER, sizeof( FrameUniforms ), nullptr, GL_DYNAMIC_DRAW );
+		glBindBufferBase( GL_UNIFORM_BUFFER, Shader::FRAME_UNIFORM_BLOCK_BINDING, mFrameUniformBuffer );
+	}
+#endif
+#else
+	glEnable( GL_RESCALE_NORMAL );
+	glEnable( GL_NORMALIZE );
+	
+	glShadeModel( GL_SMOOTH );
+	
 	glEnable( GL_COLOR_MATERIAL );
 	
 	//on IOS this is default and the command is not supported
@@ -56,27 +177,47 @@ frameBatchCount(0)
 	glColorMaterial( GL_FRONT, GL_DIFFUSE );
 #endif	
 	
-#ifdef DOJO_GAMMA_CORRECTION_ENABLED
-	glEnable( GL_FRAMEBUFFER_SRGB );
-#endif
-	
 	//projection is always the same
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();		
 
 	//always active!
 	glEnableClientState(GL_VERTEX_ARRAY);
+#endif
 
 	setInterfaceOrientation( Platform::singleton().getGame().getNativeOrientation() );
 	
 	setDefaultAmbient( Color::BLACK );
 
+	mTextureStreamer = make_unique< TextureStreamer >();
+
+	currentState.time = 0;
+
 	CHECK_GL_ERROR;
 }
 
 Renderer::~Renderer()
 {
 	clearLayers();
+
+	if( mInstanceBuffer )
+		glDeleteBuffers( 1, &mInstanceBuffer );
+
+	if( mFrameUniformBuffer )
+		glDeleteBuffers( 1, &mFrameUniformBuffer );
+
+#ifdef DOJO_SHADERS_AVAILABLE
+	mDefaultShader->onUnload();
+	mDefaultTexturedShader->onUnload();
+#endif
+}
+
+Shader& Renderer::_getShaderFor( Renderable& r )
+{
+	if( r.getShader() )
+		return *r.getShader();
+
+	return r.getTexture( 0 ) ? *mDefaultTexturedShader : *mDefaultShader;
 }
 
 RenderLayer& Renderer::getLayer( RenderLayer::ID layerID )
@@ -90,7 +231,15 @@ RenderLayer& Renderer::getLayer( RenderLayer::ID layerID )
 	
 	//allocate the needed layers if layerID > layer size
 	while( (RenderLayer::ID)layerList->size() <= layerID )
-		layerList->emplace_back();	
+	{
+		layerList->emplace_back();
+
+		RenderLayer::ID newID = (RenderLayer::ID)layerList->size() - 1;
+		if( layerList == &negativeLayers )
+			newID = -newID - 1;
+
+		layerList->back().profileName = gp_profiler ? gp_profiler->intern( "Layer " + String( newID ).ASCII() ) : "Layer";
+	}
 
 	if( !currentLayer ) //first layer!
 		currentLayer = &(*layerList)[ layerID ];
@@ -113,22 +262,37 @@ bool Renderer::hasLayer( RenderLayer::ID layerID )
 
 void Renderer::addRenderable( Renderable& s, RenderLayer::ID layerID )
 {				
+	DEBUG_ASSERT( !mParallelUpdate, "Renderables can't be added during a parallel update" );
+
 	//get the needed layer	
 	RenderLayer& layer = getLayer( layerID );
 	
-	s._notifyRenderInfo( this, layerID, layer.elements.size() );
+	s._notifyRenderInfo( this, layerID, mNextRenderingOrder++ );
 	
 	//append at the end
 	layer.elements.emplace( &s );
+
+	if( layer.spatialIndex )
+		layer.spatialIndex->add( s );
 }
 
 void Renderer::removeRenderable( Renderable& s )
 {	
-	getLayer(s.getLayer()).elements.erase(&s);
+	DEBUG_ASSERT( !mParallelUpdate, "Renderables can't be removed during a parallel update" );
+
+	RenderLayer& layer = getLayer(s.getLayer());
+
+	if( layer.spatialIndex && s._getSpatialProxy() >= 0 )
+		layer.spatialIndex->remove( s );
+
+	layer.elements.erase(&s);
 	s._notifyRenderInfo( NULL, 0, 0 );
 }
 
 void Renderer::removeAllRenderables() {
+	for (auto& index : mSpatialIndices)
+		index.second->clear();
+
 	for (auto& l : negativeLayers)
 		l.elements.clear();
 
@@ -136,6 +300,61 @@ void Renderer::removeAllRenderables() {
 		l.elements.clear();
 }
 
+void Renderer::setSpatialIndexEnabled( RenderLayer::ID layerID, bool enabled, float gridCellSize )
+{
+	RenderLayer& layer = getLayer( layerID );
+
+	if( layer.spatialIndex )
+	{
+		layer.spatialIndex->clear();
+		layer.spatialIndex = nullptr;
+		mSpatialIndices.erase( layerID );
+	}
+
+	if( !enabled )
+		return;
+
+	Unique< SpatialIndex > index;
+	if( layer.orthographic )
+		index = make_unique< SpatialGrid >( gridCellSize );
+	else
+		index = make_unique< AABBTree >();
+
+	for( auto r : layer.elements )
+		index->add( *r );
+
+	layer.spatialIndex = index.get();
+	mSpatialIndices[ layerID ] = std::move( index );
+}
+
+void Renderer::_notifyWorldAABBChanged( Renderable& r )
+{
+	if( mParallelUpdate )
+	{
+		std::lock_guard< std::mutex > lock( mDeferredAABBMutex );
+		mDeferredAABBChanges.push_back( &r );
+		return;
+	}
+
+	RenderLayer& layer = getLayer( r.getLayer() );
+
+	if( layer.spatialIndex )
+		layer.spatialIndex->update( r );
+}
+
+void Renderer::_setParallelUpdate( bool parallel )
+{
+	mParallelUpdate = parallel;
+
+	if( !parallel )
+	{
+		for( auto r : mDeferredAABBChanges )
+			_notifyWorldAABBChanged( *r );
+
+		mDeferredAABBChanges.clear();
+	}
+}
+
 void Renderer::removeViewport(const Viewport& v) {
 
 }
@@ -145,6 +364,11 @@ void Renderer::removeAllViewports() {
 }
 
 void Renderer::clearLayers() {
+	for (auto& index : mSpatialIndices)
+		index.second->clear();
+
+	mSpatialIndices.clear();
+
 	negativeLayers.clear();
 	positiveLayers.clear();
 }
@@ -171,45 +395,105 @@ void Renderer::setInterfaceOrientation( Orientation o )
 	mRenderRotation = glm::mat4_cast( Quaternion( Vector( 0,0, Math::toRadian( renderRotation )  ) ) );
 }
 
-void Renderer::renderElement( Viewport& viewport, Renderable& elem )
+void Renderer::_bindInstanceAttributes( Shader& shader )
 {
-	DEBUG_ASSERT( frameStarted, "Tried to render an element but the frame wasn't started" );
-	DEBUG_ASSERT(elem.getMesh()->isLoaded(), "Rendering with a mesh with no GPU data!");
-	DEBUG_ASSERT(elem.getMesh()->getVertexCount() > 0, "Rendering a mesh with no vertices");
+#ifdef DOJO_INSTANCING_AVAILABLE
+	glBindBuffer( GL_ARRAY_BUFFER, mInstanceBuffer );
 
-#ifndef PUBLISH
-	frameVertexCount += elem.getMesh()->getVertexCount();
-	frameTriCount += elem.getMesh()->getPrimitiveCount();
+	for( auto& attr : shader.getAttributes() )
+	{
+		switch( attr.second.builtInInstanceAttribute )
+		{
+		case Shader::BIA_WORLD:
+			//a mat4 attribute takes 4 consecutive locations, one per column
+			for( int i = 0; i < 4; ++i )
+			{
+				glEnableVertexAttribArray( attr.second.location + i );
+				glVertexAttribPointer( attr.second.location + i, 4, GL_FLOAT, false, sizeof( InstanceData ), (void*)(offsetof( InstanceData, world ) + i * sizeof( glm::vec4 )) );
+				_vertexAttribDivisor( attr.second.location + i, 1 );
+			}
+			break;
+
+		case Shader::BIA_OBJECT_COLOR:
+			glEnableVertexAttribArray( attr.second.location );
+			glVertexAttribPointer( attr.second.location, 4, GL_FLOAT, false, sizeof( InstanceData ), (void*)offsetof( InstanceData, color ) );
+			_vertexAttribDivisor( attr.second.location, 1 );
+			break;
+
+		default:
+			break;
+		}
+	}
 
-	//each renderable is a single batch
-	++frameBatchCount;
-#endif // !PUBLISH
-	
-	currentState.world = elem.getWorldTransform();
+	CHECK_GL_ERROR;
+#endif
+}
+
+void Renderer::_setInstanceAttributes( Shader& shader, const InstanceData& instance )
+{
+	//with the arrays disabled, the attributes keep these values for the whole draw
+	for( auto& attr : shader.getAttributes() )
+	{
+		switch( attr.second.builtInInstanceAttribute )
+		{
+		case Shader::BIA_WORLD:
+			for( int i = 0; i < 4; ++i )
+				glVertexAttrib4fv( attr.second.location + i, glm::value_ptr( instance.world[i] ) );
+			break;
+
+		case Shader::BIA_OBJECT_COLOR:
+			glVertexAttrib4fv( attr.second.location, (const float*)&instance.color );
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+void Renderer::_renderMesh( Renderable& state, Mesh& m, int instances )
+{
 	currentState.worldView = currentState.view * currentState.world;
 
+#ifdef DOJO_SHADERS_AVAILABLE
+	Shader* shader = &_getShaderFor( state );
+
+	currentState.worldViewProjection = currentState.projection * currentState.worldView;
+	shader->use( state, frameUniformUploadCount, frameSkippedUniformCount );
+#else
+	Shader* shader = nullptr;
+
 	glMatrixMode(GL_MODELVIEW);
 	glLoadMatrixf( glm::value_ptr( currentState.worldView ) );
-	
-#ifdef DOJO_SHADERS_AVAILABLE
-	if( elem.getShader() )
-	{
-		currentState.worldViewProjection = currentState.projection * currentState.worldView;
-		elem.getShader()->use( elem );
-	}
-	else
-		glUseProgram( 0 );
-#endif
 		
 	//I'm not sure this actually makes sense
 #ifndef USING_OPENGLES
 	glColorMaterial( GL_FRONT_AND_BACK, GL_AMBIENT );
 #endif
-	glMaterialfv( GL_FRONT_AND_BACK, GL_DIFFUSE, (float*)(&elem.color) );
+	glMaterialfv( GL_FRONT_AND_BACK, GL_DIFFUSE, (float*)(&state.color) );
 	
 	glEnable( GL_COLOR_MATERIAL );
+#endif
 
-	elem.commitChanges();
+#ifdef DOJO_FORCE_WHOLE_RENDERSTATE_COMMIT
+	state.commitChanges( nullptr );
+	m.bind( shader );
+#else
+	int skipped = state.commitChanges( mLastState );
+
+	//the attribute locations are the same for every Shader, so the mesh binding only depends on the mesh
+	if( mLastMesh == &m )
+		++skipped;
+	else
+		m.bind( shader );
+
+#if !defined( PUBLISH ) || defined( DOJO_PROFILER_ENABLED )
+	frameSkippedStateChangeCount += skipped;
+#endif
+
+	mLastState = &state;
+	mLastMesh = &m;
+#endif
 
 	static const GLenum glModeMap[] = {
 		GL_TRIANGLE_STRIP, //TriangleStrip,
@@ -219,27 +503,287 @@ void Renderer::renderElement( Viewport& viewport, Renderable& elem )
 		GL_POINTS
 	};
 
-	Mesh* m = elem.getMesh();
-	GLenum mode = glModeMap[(byte)m->getTriangleMode()];
+	GLenum mode = glModeMap[(byte)m.getTriangleMode()];
 
-	if( !m->isIndexed() )
-		glDrawArrays( mode, 0, m->getVertexCount() );
-	else {
-		DEBUG_ASSERT(m->getIndexCount() > 0, "Rendering an indexed mesh with no indices");
-		glDrawElements(mode, m->getIndexCount(), m->getIndexGLType(), 0);  //on OpenGLES, we have max 65536 indices!!!
+	DEBUG_ASSERT( !m.isIndexed() || m.getIndexCount() > 0, "Rendering an indexed mesh with no indices" );
+
+#ifdef DOJO_INSTANCING_AVAILABLE
+	if( instances )
+	{
+		_bindInstanceAttributes( *shader );
+
+		if( !m.isIndexed() )
+			_drawArraysInstanced( mode, 0, m.getVertexCount(), instances );
+		else
+			_drawElementsInstanced( mode, m.getIndexCount(), m.getIndexGLType(), 0, instances );
+
+		//leave the mesh bindings as they were
+		for( auto& attr : shader->getAttributes() )
+		{
+			if( attr.second.builtInInstanceAttribute != Shader::BIA_NONE )
+			{
+				int locations = attr.second.builtInInstanceAttribute == Shader::BIA_WORLD ? 4 : 1;
+				for( int i = 0; i < locations; ++i )
+				{
+					_vertexAttribDivisor( attr.second.location + i, 0 );
+					glDisableVertexAttribArray( attr.second.location + i );
+				}
+			}
+		}
 	}
+	else
+#endif
+	if( !m.isIndexed() )
+		glDrawArrays( mode, 0, m.getVertexCount() );
+	else
+		glDrawElements(mode, m.getIndexCount(), m.getIndexGLType(), 0);  //on OpenGLES, we have max 65536 indices!!!
+}
+
+void Renderer::renderElement( Viewport& viewport, Renderable& elem )
+{
+	DEBUG_ASSERT( frameStarted, "Tried to render an element but the frame wasn't started" );
+	DEBUG_ASSERT(elem.getMesh()->isLoaded(), "Rendering with a mesh with no GPU data!");
+	DEBUG_ASSERT(elem.getMesh()->getVertexCount() > 0, "Rendering a mesh with no vertices");
+
+#if !defined( PUBLISH ) || defined( DOJO_PROFILER_ENABLED )
+	frameVertexCount += elem.getMesh()->getVertexCount();
+	frameTriCount += elem.getMesh()->getPrimitiveCount();
 
-#ifndef DOJO_DISABLE_VAOS
-	glBindVertexArray( 0 );
+	//a lone renderable is a batch on its own
+	++frameBatchCount;
 #endif
+	
+	currentState.world = elem.getWorldTransform();
 
-#ifdef DOJO_SHADERS_AVAILABLE
-	//HACK //TODO remove fixed function pipeline (it breaks if generic arrays are set)
-	if( elem.getShader() )
+	//compressed positions are decoded as a part of the world transform
+	if( elem.getMesh()->hasCompressedPositions() )
+		currentState.world = currentState.world * elem.getMesh()->getPositionDecodeTransform();
+
+	_renderMesh( elem, *elem.getMesh() );
+}
+
+Mesh& Renderer::_getBatchMesh( Mesh& format )
+{
+	//the batch only needs to know which optional fields are there, positions and colors are always 3D and per-vertex
+	int key = format.isVertexFieldEnabled( VertexField::Normal ) ? 1 : 0;
+	for( int i = 0; i < DOJO_MAX_TEXTURE_COORDS; ++i )
+	{
+		if( format.isVertexFieldEnabled( (VertexField)((int)VertexField::UV0 + i) ) )
+			key |= 2 << i;
+	}
+
+	auto& mesh = mBatchMeshes[ key ];
+
+	if( !mesh )
 	{
-		for( auto& attr : elem.getShader()->getAttributes() )
-			glDisableVertexAttribArray( attr.second.location );
+		mesh = make_unique< Mesh >();
+		mesh->setStreaming( true );
+		mesh->setIndexByteSize( sizeof( GLushort ) );
+		mesh->setVertexFields({ VertexField::Position3D, VertexField::Color });
+
+		if( key & 1 )
+			mesh->setVertexFieldEnabled( VertexField::Normal );
+
+		for( int i = 0; i < DOJO_MAX_TEXTURE_COORDS; ++i )
+		{
+			if( key & (2 << i) )
+				mesh->setVertexFieldEnabled( (VertexField)((int)VertexField::UV0 + i) );
+		}
 	}
+
+	return *mesh;
+}
+
+void Renderer::renderBatch( Viewport& viewport, const std::vector< Renderable* >& elems )
+{
+	DEBUG_ASSERT( frameStarted, "Tried to render a batch but the frame wasn't started" );
+	DEBUG_ASSERT( elems.size() > 0, "Tried to render an empty batch" );
+
+	Renderable& first = *elems[0];
+	Mesh& batch = _getBatchMesh( *first.getMesh() );
+
+	//shaders get the color as an uniform, so it must be the same for all the batch and it isn't baked in the vertices
+	bool bakeColor = first.getShader() == nullptr;
+
+	batch.setTriangleMode( Mesh::getListTriangleMode( first.getMesh()->getTriangleMode() ) );
+	batch.begin( mBatchVertexCount ? mBatchVertexCount : 1 );
+
+	for( auto r : elems )
+		batch.appendTransformedMesh( *r->getMesh(), r->getWorldTransform(), bakeColor ? r->color : Color::WHITE );
+
+	//end() unbinds the current VAO
+	mLastMesh = nullptr;
+
+	if( !batch.end() )
+		return;
+
+#if !defined( PUBLISH ) || defined( DOJO_PROFILER_ENABLED )
+	frameVertexCount += batch.getVertexCount();
+	frameTriCount += batch.getPrimitiveCount();
+
+	++frameBatchCount;
+#endif
+
+	//vertices are already in world space
+	currentState.world = Matrix( 1 );
+
+	_renderMesh( first, batch );
+}
+
+void Renderer::renderInstanced( Viewport& viewport, const std::vector< Renderable* >& elems )
+{
+	DEBUG_ASSERT( frameStarted, "Tried to render instances but the frame wasn't started" );
+	DEBUG_ASSERT( elems.size() > 0, "Tried to render no instances" );
+
+	Renderable& first = *elems[0];
+	Mesh& mesh = *first.getMesh();
+
+	bool decode = mesh.hasCompressedPositions();
+	Matrix decodeTransform = mesh.getPositionDecodeTransform();
+
+	mInstanceData.resize( elems.size() );
+	for( size_t i = 0; i < elems.size(); ++i )
+	{
+		mInstanceData[i].world = decode ? elems[i]->getWorldTransform() * decodeTransform : elems[i]->getWorldTransform();
+		mInstanceData[i].color = elems[i]->color;
+	}
+
+	if( !mInstancingAvailable )
+	{
+		//the instanced Shader still works with the instance data as constant attributes, with one draw per Renderable
+		Shader& shader = _getShaderFor( first );
+
+#if !defined( PUBLISH ) || defined( DOJO_PROFILER_ENABLED )
+		frameVertexCount += mesh.getVertexCount() * elems.size();
+		frameTriCount += mesh.getPrimitiveCount() * elems.size();
+
+		frameBatchCount += (int)elems.size();
+#endif
+
+		currentState.world = Matrix( 1 );
+
+		for( auto& instance : mInstanceData )
+		{
+			_setInstanceAttributes( shader, instance );
+			_renderMesh( first, mesh );
+		}
+
+		return;
+	}
+
+	if( !mInstanceBuffer )
+		glGenBuffers( 1, &mInstanceBuffer );
+
+	//orphan the previous storage, the driver might still be reading it
+	glBindBuffer( GL_ARRAY_BUFFER, mInstanceBuffer );
+	glBufferData( GL_ARRAY_BUFFER, mInstanceData.size() * sizeof( InstanceData ), mInstanceData.data(), GL_STREAM_DRAW );
+
+	CHECK_GL_ERROR;
+
+#if !defined( PUBLISH ) || defined( DOJO_PROFILER_ENABLED )
+	frameVertexCount += mesh.getVertexCount() * elems.size();
+	frameTriCount += mesh.getPrimitiveCount() * elems.size();
+
+	++frameBatchCount;
+#endif
+
+	//the world transform comes from the instance data
+	currentState.world = Matrix( 1 );
+
+	_renderMesh( first, mesh, elems.size() );
+}
+
+bool Renderer::_isInstanced( Renderable& r )
+{
+#ifdef DOJO_INSTANCING_AVAILABLE
+	return r.getShader() && r.getShader()->isInstanced();
+#else
+	return false;
+#endif
+}
+
+bool Renderer::_canBatch( Renderable& a, Renderable& b )
+{
+	Mesh& ma = *a.getMesh();
+	Mesh& mb = *b.getMesh();
+
+	//per-object uniforms other than the color and the world can't be merged
+	if( a.getShader() && !a.getShader()->isBatchable() )
+		return false;
+
+	//instances only need to share the state and the mesh
+	if( _isInstanced( a ) )
+		return mBatchingEnabled && &ma == &mb && a.isBatchableWith( b );
+
+	return mBatchingEnabled &&
+		ma.isBatchable() && mb.isBatchable() &&
+		ma.hasSameVertexFormat( mb ) &&
+		Mesh::getListTriangleMode( ma.getTriangleMode() ) == Mesh::getListTriangleMode( mb.getTriangleMode() ) &&
+		a.isBatchableWith( b ) &&
+		(!a.getShader() || a.color == b.color);
+}
+
+void Renderer::_flushBatch( Viewport& viewport )
+{
+	//instanced shaders can only be drawn instanced, even if alone
+	if( !mBatchQueue.empty() && _isInstanced( *mBatchQueue.front() ) )
+		renderInstanced( viewport, mBatchQueue );
+	else if( mBatchQueue.size() == 1 )
+		renderElement( viewport, *mBatchQueue[0] );
+	else if( mBatchQueue.size() > 1 )
+		renderBatch( viewport, mBatchQueue );
+
+	mBatchQueue.clear();
+	mBatchVertexCount = 0;
+}
+
+void Renderer::_sortRenderQueue( RenderQueue::iterator begin, RenderQueue::iterator end )
+{
+	for( auto it = begin; it != end; ++it )
+		it->first = it->second->getSortKey();
+
+	std::sort( begin, end, []( const RenderQueue::value_type& a, const RenderQueue::value_type& b ) {
+		return a.first < b.first;
+	});
+}
+
+void Renderer::_updateFrameUniforms()
+{
+	FrameUniforms u = FrameUniforms(); //zero the padding too, it gets compared
+
+	u.view = currentState.view;
+	u.projection = currentState.projection;
+	u.viewDirection[0] = currentState.viewDirection.x;
+	u.viewDirection[1] = currentState.viewDirection.y;
+	u.viewDirection[2] = currentState.viewDirection.z;
+	u.targetDimension[0] = currentState.targetDimension.x;
+	u.targetDimension[1] = currentState.targetDimension.y;
+	u.targetPixel[0] = 1.f / currentState.targetDimension.x;
+	u.targetPixel[1] = 1.f / currentState.targetDimension.y;
+	u.time = currentState.time;
+
+	//most layers share the viewport's view and projection
+	if( memcmp( &u, &mFrameUniforms, sizeof( u ) ) == 0 )
+	{
+#if !defined( PUBLISH ) || defined( DOJO_PROFILER_ENABLED )
+		++frameSkippedUniformCount;
+#endif
+		return;
+	}
+
+	mFrameUniforms = u;
+	++mFrameUniformsVersion;
+
+#ifdef DOJO_UNIFORM_BUFFERS_AVAILABLE
+	if( mFrameUniformBuffer )
+	{
+		glBindBuffer( GL_UNIFORM_BUFFER, mFrameUniformBuffer );
+		glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof( u ), &u );
+	}
+#endif
+
+#if !defined( PUBLISH ) || defined( DOJO_PROFILER_ENABLED )
+	++frameUniformUploadCount;
 #endif
 }
 
@@ -251,6 +795,8 @@ void Renderer::renderLayer( Viewport& viewport, const RenderLayer& layer )
 {
 	if( !layer.elements.size() || !layer.visible )
 		return;
+
+	DOJO_PROFILE_GPU_ZONE( layer.profileName );
 	
 #ifdef DOJO_WIREFRAME_AVAILABLE
 	glPolygonMode(GL_FRONT_AND_BACK, layer.wireframe ? GL_LINE : GL_FILL);
@@ -263,8 +809,12 @@ void Renderer::renderLayer( Viewport& viewport, const RenderLayer& layer )
 	//set projection state
 	currentState.projection = mRenderRotation * (layer.orthographic ? viewport.getOrthoProjectionTransform() : viewport.getPerspectiveProjectionTransform());
 	
+#ifdef DOJO_SHADERS_AVAILABLE
+	_updateFrameUniforms();
+#else
 	glMatrixMode( GL_PROJECTION );
 	glLoadMatrixf( glm::value_ptr( currentState.projection ) );
+#endif
 	
 	//we don't want different layers to be depth-checked together?
 	if( layer.depthClear )
@@ -272,15 +822,72 @@ void Renderer::renderLayer( Viewport& viewport, const RenderLayer& layer )
 
 	currentLayer = &layer;
 
-	for (auto& r : layer.elements)
+	//collect the visible elements
+	mRenderQueue.clear();
+	if( layer.spatialIndex )
 	{
-		if( r->canBeRendered() && _cull(layer, viewport, *r))
-			renderElement( viewport, *r );
+		//only look at the elements in the visible part of the index
+		mCullCandidates.clear();
+		layer.spatialIndex->query( viewport, mCullCandidates );
+
+		for (auto r : mCullCandidates)
+		{
+			if( r->canBeRendered() && _cull(layer, viewport, *r))
+				mRenderQueue.emplace_back( 0, r );
+		}
+
+		//the index loses the order, restore it where it matters
+		if( !layer.orderIndependent )
+		{
+			std::sort( mRenderQueue.begin(), mRenderQueue.end(), []( const RenderQueue::value_type& a, const RenderQueue::value_type& b ) {
+				return a.second->getRenderingOrder() < b.second->getRenderingOrder();
+			});
+		}
 	}
+	else
+	{
+		for (auto& r : layer.elements)
+		{
+			if( r->canBeRendered() && _cull(layer, viewport, *r))
+				mRenderQueue.emplace_back( 0, r );
+		}
+	}
+
+	//sort them by state wherever the drawing order doesn't matter
+	if( layer.orderIndependent )
+		_sortRenderQueue( mRenderQueue.begin(), mRenderQueue.end() );
+	else if( layer.depthCheck )
+	{
+		//the depth buffer takes care of opaque elements, so they can go first in any order
+		auto opaqueEnd = std::stable_partition( mRenderQueue.begin(), mRenderQueue.end(), []( const RenderQueue::value_type& e ) {
+			return !e.second->isBlendingEnabled();
+		});
+
+		_sortRenderQueue( mRenderQueue.begin(), opaqueEnd );
+	}
+
+	//merge runs of compatible elements into batches, keeping their order
+	for (auto& e : mRenderQueue)
+	{
+		Renderable* r = e.second;
+		int vertexCount = r->getMesh()->getVertexCount();
+
+		bool full = !_isInstanced( *r ) && mBatchVertexCount + vertexCount > BATCH_VERTEX_MAX;
+
+		if( !mBatchQueue.empty() && (full || !_canBatch( *mBatchQueue.front(), *r ) ) )
+			_flushBatch( viewport );
+
+		mBatchQueue.push_back( r );
+		mBatchVertexCount += vertexCount;
+	}
+
+	_flushBatch( viewport );
 }
 
 void Renderer::renderViewport( Viewport& viewport )
 {
+	DOJO_PROFILE_GPU_ZONE( "Renderer::renderViewport" );
+
 	Texture* rt = viewport.getRenderTarget();
 
 	if( rt )
@@ -295,6 +902,10 @@ void Renderer::renderViewport( Viewport& viewport )
     
 	glViewport(0, 0, (GLsizei) currentState.targetDimension.x, (GLsizei)currentState.targetDimension.y);
 
+	//binding the render target might have touched the textures, forget the last state
+	mLastState = nullptr;
+	mLastMesh = nullptr;
+
 	//clear the viewport
 	if (viewport.getClearEnabled()) {
 		glClearColor(
@@ -331,15 +942,27 @@ void Renderer::renderViewport( Viewport& viewport )
 void Renderer::render()
 {
 	DEBUG_ASSERT( !frameStarted, "Tried to start rendering but the frame was already started" );
+	DEBUG_ASSERT( !mParallelUpdate, "Tried to render during a parallel update" );
 
+	DOJO_PROFILE_ZONE( "Renderer::render" );
 
-	frameVertexCount = frameTriCount = frameBatchCount = 0;
+	//upload this frame's share of the streamed textures before they are used
+	mTextureStreamer->update();
+
+	frameVertexCount = frameTriCount = frameBatchCount = frameSkippedStateChangeCount = 0;
+	frameUniformUploadCount = frameSkippedUniformCount = 0;
 	frameStarted = true;
 
+	currentState.time = (float)mTimer.getElapsedTime();
+
 	//render all the viewports
 	for( auto& viewport : viewportList )
 		renderViewport( *viewport );
 
+	//the GL state could be changed by anyone outside of the frame
+	mLastState = nullptr;
+	mLastMesh = nullptr;
+
 	frameStarted = false;
 }
 
@@ -6,6 +6,7 @@
 #include "Timer.h"
 #include "FrameSet.h"
 #include "Mesh.h"
+#include "FileStream.h"
 #include "Font.h"
 #include "Table.h"
 #include "SoundSet.h"
@@ -13,6 +14,8 @@
 
 #include <Poco/File.h>
 #include "Texture.h"
+#include "Profiler.h"
+#include "dojomath.h"
 
 using namespace Dojo;
 
@@ -20,7 +23,12 @@ ResourceGroup::ResourceGroup() :
 finalized( false ),
 disableBilinear( false ),
 disableMipmaps( false ),
-disableTiling( false )
+disableTiling( false ),
+streamTextures( false ),
+mIndex( nullptr ),
+mIndexReaders( 0 ),
+mIndexVersion( 0 ),
+mVersion( 1 )
 {
 	//link map array
 	mapArray[ RT_FRAMESET ] = &frameSets;
@@ -32,6 +40,14 @@ disableTiling( false )
 	mapArray[ RT_PROGRAM ] = &programs;
 	
 	empty = new FrameSet( this, "empty" );
+
+	//a table with a single empty slot, so that there is always one to read even before the first build
+	auto index = make_unique< Index >();
+	index->slots.resize( 1 );
+	index->mask = 0;
+
+	mIndex = index.get();
+	mIndices.push_back( std::move( index ) );
 }
  
 ResourceGroup::~ResourceGroup()
@@ -39,6 +55,126 @@ ResourceGroup::~ResourceGroup()
 	SAFE_DELETE( empty );
 	
 	unloadResources( false );
+
+	//don't leave dangling pointers in the other groups
+	while( supers.size() )
+		supers[0]->removeSubgroup( this );
+
+	removeAllSubgroups();
+}
+
+void ResourceGroup::addSubgroup( ResourceGroup* g )
+{
+	DEBUG_ASSERT( g != nullptr, "Adding a null subgroup" );
+	DEBUG_ASSERT( g != this, "A group can't be its own subgroup" );
+
+	subs.add( g );
+	g->supers.add( this );
+
+	_invalidateIndex();
+}
+
+void ResourceGroup::removeSubgroup( ResourceGroup* g )
+{
+	DEBUG_ASSERT( g != nullptr, "Removing a null subgroup" );
+
+	//keep the order, it's the lookup priority
+	subs.removeOrdered( g );
+	g->supers.remove( this );
+
+	_invalidateIndex();
+}
+
+void ResourceGroup::removeAllSubgroups()
+{
+	for( int i = 0; i < subs.size(); ++i )
+		subs[i]->supers.remove( this );
+
+	subs.clear();
+
+	_invalidateIndex();
+}
+
+void ResourceGroup::_invalidateIndex()
+{
+	++mVersion;
+
+	for( int i = 0; i < supers.size(); ++i )
+		supers[i]->_invalidateIndex();
+}
+
+void ResourceGroup::_buildIndex() const
+{
+	std::lock_guard< std::mutex > lock( mIndexMutex );
+
+	//another thread could have rebuilt it already
+	if( !_isIndexStale() )
+		return;
+
+	//take the version before collecting the resources: if an invalidation comes during the build, the new table
+	//is still stale and the next lookup rebuilds it
+	unsigned int version = mVersion;
+
+	//gather the slots by priority: first this group, then each subgroup with its own subgroups
+	std::vector< IndexSlot > slots;
+
+	_collectIndexSlots( frameSets, RT_FRAMESET, slots );
+	_collectIndexSlots( fonts, RT_FONT, slots );
+	_collectIndexSlots( meshes, RT_MESH, slots );
+	_collectIndexSlots( sounds, RT_SOUND, slots );
+	_collectIndexSlots( tables, RT_TABLE, slots );
+	_collectIndexSlots( shaders, RT_SHADER, slots );
+	_collectIndexSlots( programs, RT_PROGRAM, slots );
+
+	for( int i = 0; i < subs.size(); ++i )
+	{
+		auto sub = subs[i];
+
+		if( sub->_isIndexStale() )
+			sub->_buildIndex();
+
+		//another thread could be rebuilding the subgroup, so read its table as any other reader
+		++sub->mIndexReaders;
+
+		for( auto& slot : sub->mIndex.load()->slots )
+		{
+			if( slot.key )
+				slots.push_back( slot );
+		}
+
+		--sub->mIndexReaders;
+	}
+
+	//keep the table at most half full, so that the probes are short
+	uint32_t capacity = Math::nextPowerOfTwo( std::max( 16, (int)slots.size() * 2 ) );
+	IndexSlot emptySlot = { 0, nullptr };
+
+	//fill a new table, as other threads could be probing the current one
+	auto index = make_unique< Index >();
+	index->slots.assign( capacity, emptySlot );
+	index->mask = capacity - 1;
+
+	for( auto& slot : slots )
+	{
+		uint32_t i = ( slot.key * 2654435769u ) & index->mask;
+
+		while( index->slots[ i ].key && index->slots[ i ].key != slot.key )
+			i = ( i + 1 ) & index->mask;
+
+		//the slots that come first hide the later ones with the same name
+		if( !index->slots[ i ].key )
+			index->slots[ i ] = slot;
+	}
+
+	mIndex = index.get();
+	mIndices.push_back( std::move( index ) );
+
+	//only after the swap, so that the readers that find the index up to date also find the new table
+	mIndexVersion = version;
+
+	//the readers that come after the swap only see the new table, so if there are none now the old ones can go
+	if( mIndexReaders == 0 )
+		mIndices.erase( mIndices.begin(), mIndices.end() - 1 );
 }
 
 void ResourceGroup::addLocalizedFolder( const String& basefolder, int version )
@@ -65,9 +201,10 @@ void ResourceGroup::addTable( const String& name, Unique<Table> t )
 	DEBUG_ASSERT( !finalized, "This ResourceGroup can't be modified" );
 	
 	tables[ name ] = t.release();
+	_onAdded( name );
 	
 	if (logchanges)
-		DEBUG_MESSAGE( "+" + name.ASCII() + "\t\t table" );
+		DEBUG_MESSAGE( "+" + name + "\t\t table" );
 }
 
 void ResourceGroup::addSets( const String& subdirectory, int version )
@@ -183,8 +320,16 @@ void ResourceGroup::addMeshes( const String& subdirectory )
 	for( int i = 0; i < paths.size(); ++i )
 	{
 		name = Utils::getFileName( paths[i] );
-		
-		addMesh( new Mesh( this, paths[i] ), name );
+
+		//only the header and the section table are read, the mesh data is checked when loading
+		std::vector< String > subMeshes;
+		MeshFile::readSubMeshNames( *Platform::singleton().getFile( paths[i] ), subMeshes );
+
+		//files with many sub-meshes add a Mesh for each, named file.subMesh
+		if( subMeshes.size() <= 1 )
+			addMesh( new Mesh( this, paths[i] ), name );
+		else for( auto& subMesh : subMeshes )
+			addMesh( new Mesh( this, paths[i], subMesh ), subMesh.empty() ? name : name + "." + subMesh );
 	}
 }
 
@@ -497,3 +642,111 @@ void ResourceGroup::addPrefabMeshes()
 	
 	addMesh( m, "wireframeQuad" );
 }
+
+void ResourceGroup::_collectGroups( std::vector< ResourceGroup* >& groups, bool recursive )
+{
+	if( std::find( groups.begin(), groups.end(), this ) != groups.end() )
+		return;
+
+	groups.push_back( this );
+
+	if( recursive )
+		for( int i = 0; i < subs.size(); ++i )	subs[i]->_collectGroups( groups, recursive );
+}
+
+void ResourceGroup::_collectUnloaded( const std::vector< ResourceGroup* >& groups, std::vector< Resource* >& resources, std::vector< Resource* >& fonts )
+{
+	for( auto group : groups )
+	{
+		_collectUnloaded( group->frameSets, resources );
+		_collectUnloaded( group->meshes, resources );
+		_collectUnloaded( group->sounds, resources );
+		_collectUnloaded( group->tables, resources );
+		_collectUnloaded( group->programs, resources );
+
+		_collectUnloaded( group->fonts, fonts );
+	}
+}
+
+void ResourceGroup::loadResources( bool recursive )
+{
+	DOJO_PROFILE_ZONE( "ResourceGroup::loadResources" );
+
+	std::vector< ResourceGroup* > groups;
+	_collectGroups( groups, recursive );
+
+	std::vector< Resource* > resources, fonts;
+	_collectUnloaded( groups, resources, fonts );
+
+	//first phase, in parallel; the Fonts go in the last job together
+	int jobs = resources.size() + (fonts.empty() ? 0 : 1);
+	auto prepare = [&]( int i )
+	{
+		if( i < (int)resources.size() )
+			resources[i]->onPrepare();
+		else
+			for( auto font : fonts )	font->onPrepare();
+	};
+
+	auto queue = Platform::singleton().getBackgroundQueue();
+	if( queue )
+		queue->parallelFor( jobs, prepare );
+	else
+		for( int i = 0; i < jobs; ++i )	prepare( i );
+
+	//second phase, the uploads
+	for( auto group : groups )
+		group->_loadPrepared();
+}
+
+TaskGraph::TaskID ResourceGroup::loadResourcesAsync( TaskGraph& graph, const ProgressCallback& progress, bool recursive )
+{
+	std::vector< ResourceGroup* > groups;
+	_collectGroups( groups, recursive );
+
+	std::vector< Resource* > resources, fonts;
+	_collectUnloaded( groups, resources, fonts );
+
+	//the upload pass counts as one more step
+	int steps = resources.size() + (fonts.empty() ? 0 : 1) + 1;
+	auto done = std::make_shared< int >( 0 );
+
+	TaskGraph::TaskList prepared;
+	auto addPrepareTask = [&]( const TaskGraph::Task& task )
+	{
+		auto id = graph.add( task, TaskGraph::TaskList(), TaskGraph::AFFINITY_WORKER, BackgroundQueue::PRIORITY_LOW );
+		prepared.push_back( id );
+
+		if( progress )
+		{
+			graph.add( [=]()
+			{
+				progress( (float)++(*done) / steps );
+			},
+			{ id },
+			TaskGraph::AFFINITY_MAIN_THREAD );
+		}
+	};
+
+	for( auto resource : resources )
+		addPrepareTask( [resource]() { resource->onPrepare(); } );
+
+	if( fonts.size() )
+	{
+		addPrepareTask( [fonts]()
+		{
+			for( auto font : fonts )	font->onPrepare();
+		} );
+	}
+
+	return graph.add( [groups, progress]()
+	{
+		for( auto group : groups )
+			group->_loadPrepared();
+
+		if( progress )
+			progress( 1.f );
+	},
+	prepared,
+	TaskGraph::AFFINITY_MAIN_THREAD );
+}
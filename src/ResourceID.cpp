@@ -0,0 +1,118 @@
+#include "stdafx.h"
+
+#include "ResourceID.h"
+
+using namespace Dojo;
+
+static const uint32_t INITIAL_CAPACITY = 1024;
+
+ResourceNames::Table::Table( uint32_t capacity ) :
+	mask( capacity - 1 ),
+	slots( new std::atomic< const Entry* >[ capacity ] )
+{
+	DEBUG_ASSERT( capacity && ( capacity & mask ) == 0, "The capacity must be a power of two" );
+
+	for( uint32_t i = 0; i < capacity; ++i )
+		slots[ i ].store( nullptr, std::memory_order_relaxed );
+}
+
+ResourceNames::ResourceNames()
+{
+	mTables.emplace_back( make_unique< Table >( INITIAL_CAPACITY ) );
+	mTable = mTables.back().get();
+}
+
+ResourceNames& ResourceNames::_singleton()
+{
+	static ResourceNames names;
+	return names;
+}
+
+ResourceID ResourceNames::_find( const Table& table, const String& name, size_t hash )
+{
+	for( uint32_t i = (uint32_t)hash & table.mask;; i = ( i + 1 ) & table.mask )
+	{
+		auto entry = table.slots[ i ].load( std::memory_order_acquire );
+
+		if( !entry )
+			return INVALID_RESOURCE_ID;
+
+		if( entry->hash == hash && entry->name == name )
+			return entry->id;
+	}
+}
+
+void ResourceNames::_insert( Table& table, const Entry& entry )
+{
+	uint32_t i = (uint32_t)entry.hash & table.mask;
+
+	while( table.slots[ i ].load( std::memory_order_relaxed ) )
+		i = ( i + 1 ) & table.mask;
+
+	//publish the complete entry to find()
+	table.slots[ i ].store( &entry, std::memory_order_release );
+}
+
+ResourceID ResourceNames::find( const String& name )
+{
+	auto& self = _singleton();
+
+	return _find( *self.mTable.load( std::memory_order_acquire ), name, std::hash< String >()( name ) );
+}
+
+ResourceID ResourceNames::intern( const String& name )
+{
+	DEBUG_ASSERT( name.size(), "Cannot intern an empty name" );
+
+	auto& self = _singleton();
+	size_t hash = std::hash< String >()( name );
+
+	ResourceID id = _find( *self.mTable.load( std::memory_order_acquire ), name, hash );
+
+	if( id != INVALID_RESOURCE_ID )
+		return id;
+
+	std::lock_guard< std::mutex > lock( self.mMutex );
+
+	//another thread could have added it in the meantime
+	Table* table = self.mTable.load( std::memory_order_relaxed );
+	id = _find( *table, name, hash );
+
+	if( id != INVALID_RESOURCE_ID )
+		return id;
+
+	auto entry = make_unique< Entry >();
+	entry->name = name;
+	entry->hash = hash;
+	entry->id = (ResourceID)self.mEntries.size() + 1;
+
+	//keep the table at most half full
+	if( ( self.mEntries.size() + 1 ) * 2 > table->mask + 1 )
+	{
+		auto bigger = make_unique< Table >( ( table->mask + 1 ) * 2 );
+
+		for( auto& e : self.mEntries )
+			_insert( *bigger, *e );
+
+		table = bigger.get();
+		self.mTables.emplace_back( std::move( bigger ) );
+	}
+
+	_insert( *table, *entry );
+	self.mTable.store( table, std::memory_order_release );
+
+	self.mEntries.emplace_back( std::move( entry ) );
+
+	return self.mEntries.back()->id;
+}
+
+const String& ResourceNames::getName( ResourceID id )
+{
+	auto& self = _singleton();
+
+	std::lock_guard< std::mutex > lock( self.mMutex );
+
+	DEBUG_ASSERT( id != INVALID_RESOURCE_ID && id <= self.mEntries.size(), "Invalid ResourceID" );
+
+	return self.mEntries[ id - 1 ]->name;
+}
@@ -13,6 +13,9 @@ using namespace Dojo;
 
 Shader::NameBuiltInUniformMap Shader::sBuiltiInUniformsNameMap; //TODO implement this with an initializer list when VS decides to work with it
 Shader::NameBuiltInAttributeMap Shader::sBuiltInAttributeNameMap; //TODO ^
+Shader::NameBuiltInInstanceAttributeMap Shader::sBuiltInInstanceAttributeNameMap; //TODO ^
+
+const char* Shader::FRAME_UNIFORM_BLOCK_NAME = "DOJO_FRAME";
 
 void Shader::_populateUniformNameMap()
 {
@@ -74,12 +77,82 @@ VertexField Shader::_getAttributeForName( const std::string& name )
 	return (elem != sBuiltInAttributeNameMap.end()) ? elem->second : VertexField::None;
 }
 
+Shader::BuiltInInstanceAttribute Shader::_getInstanceAttributeForName( const std::string& name )
+{
+	if( sBuiltInInstanceAttributeNameMap.empty() )
+	{
+		sBuiltInInstanceAttributeNameMap[ "INSTANCE_WORLD" ] = BIA_WORLD;
+		sBuiltInInstanceAttributeNameMap[ "INSTANCE_OBJECT_COLOR" ] = BIA_OBJECT_COLOR;
+	}
+
+	auto elem = sBuiltInInstanceAttributeNameMap.find( name );
+	return (elem != sBuiltInInstanceAttributeNameMap.end()) ? elem->second : BIA_NONE;
+}
+
 Shader::Shader( ResourceGroup* creator, const String& filePath ) :
-	Resource( creator, filePath )
+	Resource( creator, filePath ),
+	mInstanced( false ),
+	mBatchable( true ),
+	mFirstPerFrameUniform( 0 ),
+	mFrameUniformsVersion( -1 )
 {
 	memset( pProgram, 0, sizeof( pProgram ) ); //init to null
 }
 
+Shader::Shader( const std::string& vertexShader, const std::string& fragmentShader ) :
+	Resource(),
+	mInstanced( false ),
+	mBatchable( true ),
+	mFirstPerFrameUniform( 0 ),
+	mFrameUniformsVersion( -1 )
+{
+	pProgram[ (byte)ShaderProgramType::VertexShader ] = new ShaderProgram( ShaderProgramType::VertexShader, vertexShader );
+	pProgram[ (byte)ShaderProgramType::FragmentShader ] = new ShaderProgram( ShaderProgramType::FragmentShader, fragmentShader );
+
+	for( auto& owned : mOwnsProgram )
+		owned = true;
+}
+
+GLuint Shader::getBuiltInAttributeLocation( VertexField field )
+{
+	switch( field )
+	{
+	case VertexField::Position2D:
+	case VertexField::Position3D:	return 0; //a Shader can only use one of them
+	case VertexField::Color:		return 1;
+	case VertexField::Normal:		return 2;
+	default: //texture coordinates
+		DEBUG_ASSERT( field >= VertexField::UV0 && field <= VertexField::UVMax, "Invalid built-in attribute" );
+		return 3 + (GLuint)field - (GLuint)VertexField::UV0;
+	}
+}
+
+GLuint Shader::getBuiltInInstanceAttributeLocation( BuiltInInstanceAttribute attribute )
+{
+	DEBUG_ASSERT( attribute != BIA_NONE, "Invalid built-in instance attribute" );
+
+	//after the texture coordinates; the world matrix takes 4 locations
+	GLuint base = getBuiltInAttributeLocation( VertexField::UVMax ) + 1;
+	return attribute == BIA_WORLD ? base : base + 4;
+}
+
+void Shader::_bindBuiltInAttributeLocations()
+{
+	if( sBuiltInAttributeNameMap.empty() )
+		_populateAttributeNameMap();
+
+	for( auto& entry : sBuiltInAttributeNameMap )
+	{
+		if( entry.second < VertexField::_Count )
+			glBindAttribLocation( mGLProgram, getBuiltInAttributeLocation( entry.second ), entry.first.c_str() );
+	}
+
+	_getInstanceAttributeForName( "" ); //populate the map
+
+	for( auto& entry : sBuiltInInstanceAttributeNameMap )
+		glBindAttribLocation( mGLProgram, getBuiltInInstanceAttributeLocation( entry.second ), entry.first.c_str() );
+}
+
 void Shader::_assignProgram( const Table& desc, ShaderProgramType type )
 {
 	static const String typeKeyMap[] =	{ "vertexShader", "fragmentShader" };
@@ -111,13 +184,17 @@ void Shader::setUniformCallback( const String& nameUTF, const UniformCallback& d
 {
 	std::string name = nameUTF.ASCII();
 
-	auto elem = mUniformMap.find( name );
-	
-	if( elem != mUniformMap.end() )
-		elem->second.userUniformCallback = dataBinder; //assign the data source to the right uniform
+	for( auto& uniform : mUniforms )
+	{
+		if( uniform.name == name )
+		{
+			uniform.userUniformCallback = dataBinder; //assign the data source to the right uniform
+			mBatchable = false;
+			return;
+		}
+	}
 
-	else
-		DEBUG_MESSAGE( "WARNING: can't find a Shader uniform named \"" + name + "\". Was it optimized away by the compiler?" );
+	DEBUG_MESSAGE( "WARNING: can't find a Shader uniform named \"" + name + "\". Was it optimized away by the compiler?" );
 }
 
 #ifdef DOJO_SHADERS_AVAILABLE
@@ -149,8 +226,7 @@ const void* Shader::_getUniformData( const Uniform& uniform, const Renderable& u
 		case BU_VIEW_DIRECTION:
 			return &r.currentState.viewDirection;
 		case BU_TIME:
-			DEBUG_TODO;
-			return nullptr;
+			return &r.currentState.time;
 		case BU_TARGET_DIMENSION:
             return &r.currentState.targetDimension;
 		case BU_TARGET_PIXEL:
@@ -186,47 +262,134 @@ const void* Shader::_getUniformData( const Uniform& uniform, const Renderable& u
     }
 }
 
-void Shader::use( const Renderable& user )
+static int _getUniformTypeSize( GLenum type )
+{
+	switch( type )
+	{
+	case GL_FLOAT: case GL_INT: case GL_BOOL: case GL_SAMPLER_2D: case GL_SAMPLER_CUBE:
+		return 4;
+	case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_BOOL_VEC2:
+		return 4 * 2;
+	case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_BOOL_VEC3:
+		return 4 * 3;
+	case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2:
+		return 4 * 4;
+	case GL_FLOAT_MAT3:
+		return 4 * 9;
+	case GL_FLOAT_MAT4:
+		return 4 * 16;
+	default:
+		return 0; //not supported
+	}
+}
+
+void Shader::_compileUniforms()
+{
+	//per-object uniforms first, so that the per-frame ones can be skipped as a block
+	auto firstPerFrame = std::stable_partition( mUniforms.begin(), mUniforms.end(), []( const Uniform& u ) {
+		return !isPerFrameUniform( u.builtInUniform );
+	});
+
+	mFirstPerFrameUniform = firstPerFrame - mUniforms.begin();
+
+	mBatchable = true;
+
+	int shadowSize = 0;
+	for( auto& uniform : mUniforms )
+	{
+		if( uniform.userUniformCallback || (uniform.builtInUniform >= BU_TEXTURE_0_TRANSFORM && uniform.builtInUniform <= BU_TEXTURE_N_TRANSFORM) )
+			mBatchable = false;
+
+		uniform.shadowOffset = shadowSize;
+		uniform.size = _getUniformTypeSize( uniform.type ) * uniform.count;
+		uniform.uploaded = false;
+
+		shadowSize += uniform.size;
+	}
+
+	mUniformShadow.assign( shadowSize, 0 );
+	mFrameUniformsVersion = -1;
+}
+
+bool Shader::_uploadUniform( Uniform& uniform, const void* ptr )
+{
+	if( uniform.size == 0 ) //not found... but it's not possible to warn each frame. Do place a brk here if unsure
+		return false;
+
+	byte* shadow = mUniformShadow.data() + uniform.shadowOffset;
+
+	//the program keeps its uniform values, so there's no need to upload the same data twice
+	if( uniform.uploaded && memcmp( shadow, ptr, uniform.size ) == 0 )
+		return false;
+
+	memcpy( shadow, ptr, uniform.size );
+	uniform.uploaded = true;
+
+	//assign the data to the uniform
+	//yes, this code is ugly...but don't be scared, it's as fast as a single glUniform in release :)
+	//the types supported here are only the GLSL ES 2.0 types specified at 
+	//http://www.khronos.org/registry/gles/specs/2.0/GLSL_ES_Specification_1.0.17.pdf, page 18
+	switch ( uniform.type )
+	{
+	case GL_FLOAT:   glUniform1fv( uniform.location, uniform.count, (GLfloat*)ptr ); break;
+	case GL_FLOAT_VEC2:   glUniform2fv( uniform.location, uniform.count, (GLfloat*)ptr ); break;
+	case GL_FLOAT_VEC3:   glUniform3fv( uniform.location, uniform.count, (GLfloat*)ptr ); break;
+	case GL_FLOAT_VEC4:   glUniform4fv( uniform.location, uniform.count, (GLfloat*)ptr ); break;
+	case GL_INT: case GL_SAMPLER_2D:	case GL_SAMPLER_CUBE:	case GL_BOOL:
+		glUniform1iv( uniform.location, uniform.count, (GLint*)ptr ); break; //this call also sets the samplers
+	case GL_INT_VEC2:   case GL_BOOL_VEC2: glUniform2iv( uniform.location, uniform.count, (GLint*)ptr ); break;
+	case GL_INT_VEC3:   case GL_BOOL_VEC3: glUniform3iv( uniform.location, uniform.count, (GLint*)ptr ); break;
+	case GL_INT_VEC4:   case GL_BOOL_VEC4: glUniform4iv( uniform.location, uniform.count, (GLint*)ptr ); break;
+
+	case GL_FLOAT_MAT2:   glUniformMatrix2fv( uniform.location, uniform.count, false, (GLfloat*)ptr ); break;
+	case GL_FLOAT_MAT3:   glUniformMatrix3fv( uniform.location, uniform.count, false, (GLfloat*)ptr ); break;
+	case GL_FLOAT_MAT4:   glUniformMatrix4fv( uniform.location, uniform.count, false, (GLfloat*)ptr ); break;
+	}
+
+	CHECK_GL_ERROR;
+
+	return true;
+}
+
+void Shader::use( const Renderable& user, int& uploads, int& skipped )
 {
 	DEBUG_ASSERT( isLoaded(), "tried to use a Shader that wasn't loaded" );
 
 	glUseProgram( mGLProgram );
 
-	//bind the uniforms and the attributes
-	for( auto& uniform : mUniformMap )
+	//bind the per-object uniforms
+	for( int i = 0; i < mFirstPerFrameUniform; ++i )
 	{
-		const void* ptr = _getUniformData( uniform.second, user );
+		auto& uniform = mUniforms[i];
+		const void* ptr = _getUniformData( uniform, user );
 
 		if( ptr == nullptr ) //no data provided, skip
-			break;
+			continue;
 
-		//assign the data to the uniform
-		//yes, this code is ugly...but don't be scared, it's as fast as a single glUniform in release :)
-		//the types supported here are only the GLSL ES 2.0 types specified at 
-		//http://www.khronos.org/registry/gles/specs/2.0/GLSL_ES_Specification_1.0.17.pdf, page 18
-		switch ( uniform.second.type )
-		{
-		case GL_FLOAT:   glUniform1fv( uniform.second.location, uniform.second.count, (GLfloat*)ptr ); break;
-		case GL_FLOAT_VEC2:   glUniform2fv( uniform.second.location, uniform.second.count, (GLfloat*)ptr ); break;
-		case GL_FLOAT_VEC3:   glUniform3fv( uniform.second.location, uniform.second.count, (GLfloat*)ptr ); break;
-		case GL_FLOAT_VEC4:   glUniform4fv( uniform.second.location, uniform.second.count, (GLfloat*)ptr ); break;
-		case GL_INT: case GL_SAMPLER_2D:	case GL_SAMPLER_CUBE:	case GL_BOOL:
-			glUniform1iv( uniform.second.location, uniform.second.count, (GLint*)ptr ); break; //this call also sets the samplers
-		case GL_INT_VEC2:   case GL_BOOL_VEC2: glUniform2iv( uniform.second.location, uniform.second.count, (GLint*)ptr ); break;
-		case GL_INT_VEC3:   case GL_BOOL_VEC3: glUniform3iv( uniform.second.location, uniform.second.count, (GLint*)ptr ); break;
-		case GL_INT_VEC4:   case GL_BOOL_VEC4: glUniform4iv( uniform.second.location, uniform.second.count, (GLint*)ptr ); break;
-
-		case GL_FLOAT_MAT2:   glUniformMatrix2fv( uniform.second.location, uniform.second.count, false, (GLfloat*)ptr ); break;
-		case GL_FLOAT_MAT3:   glUniformMatrix3fv( uniform.second.location, uniform.second.count, false, (GLfloat*)ptr ); break;
-		case GL_FLOAT_MAT4:   glUniformMatrix4fv( uniform.second.location, uniform.second.count, false, (GLfloat*)ptr ); break;
-
-		default:
-			//not found... but it's not possible to warn each frame. Do place a brk here if unsure
-			break;
-		}
+		if( _uploadUniform( uniform, ptr ) )
+			++uploads;
+		else
+			++skipped;
+	}
 
-		CHECK_GL_ERROR;
+	//the per-frame uniforms only need to be looked at when the Renderer changes them
+	int frameVersion = Platform::singleton().getRenderer().getFrameUniformsVersion();
+
+	if( mFrameUniformsVersion == frameVersion )
+	{
+		skipped += (int)mUniforms.size() - mFirstPerFrameUniform;
+		return;
 	}
+
+	for( int i = mFirstPerFrameUniform; i < (int)mUniforms.size(); ++i )
+	{
+		if( _uploadUniform( mUniforms[i], _getUniformData( mUniforms[i], user ) ) )
+			++uploads;
+		else
+			++skipped;
+	}
+
+	mFrameUniformsVersion = frameVersion;
 }
 
 bool Shader::onLoad()
@@ -234,20 +397,25 @@ bool Shader::onLoad()
 	DEBUG_ASSERT( !isLoaded(), "cannot reload an already loaded Shader" );
 
 	loaded = false;
+	mInstanced = false;
 
-	//load the descriptor table
-	auto desc =	Table::loadFromFile( filePath );
+	//immediate shaders already have their programs
+	if( isFiledBased() )
+	{
+		//load the descriptor table
+		auto desc =	Table::loadFromFile( filePath );
 
-	//compose preprocessor flags
-	mPreprocessorHeader.clear();
-	auto& defines = desc.getTable( "defines" );
+		//compose preprocessor flags
+		mPreprocessorHeader.clear();
+		auto& defines = desc.getTable( "defines" );
 
-	for( auto& entry : defines )
-		mPreprocessorHeader += std::string("#define ") + entry.second->getAsString().ASCII() + "\n";
+		for( auto& entry : defines )
+			mPreprocessorHeader += std::string("#define ") + entry.second->getAsString().ASCII() + "\n";
 
-	//grab all types
-	for( int i = 0; i < (int)ShaderProgramType::_Count; ++i )
-		_assignProgram( desc, (ShaderProgramType)i );
+		//grab all types
+		for( int i = 0; i < (int)ShaderProgramType::_Count; ++i )
+			_assignProgram( desc, (ShaderProgramType)i );
+	}
 
 	//ensure they're loaded
 	for( auto program : pProgram )
@@ -265,6 +433,8 @@ bool Shader::onLoad()
 	for( auto program : pProgram )
 		glAttachShader( mGLProgram, program->getGLShader() );
 
+	_bindBuiltInAttributeLocations();
+
 	glLinkProgram( mGLProgram );
 
 	CHECK_GL_ERROR;
@@ -279,6 +449,19 @@ bool Shader::onLoad()
 	}
 	else
 	{
+#ifdef DOJO_UNIFORM_BUFFERS_AVAILABLE
+		//read the per-frame built-ins from the Renderer's uniform buffer, if the shader declares them in a block
+		//otherwise they are plain uniforms, uploaded by each program
+		if( GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object )
+		{
+			GLuint frameBlock = glGetUniformBlockIndex( mGLProgram, FRAME_UNIFORM_BLOCK_NAME );
+			if( frameBlock != GL_INVALID_INDEX )
+				glUniformBlockBinding( mGLProgram, frameBlock, FRAME_UNIFORM_BLOCK_BINDING );
+		}
+#endif
+
+		mUniforms.clear();
+
 		GLchar namebuf[1024];
 		GLint nameLength, size;
 		GLenum type;
@@ -294,9 +477,10 @@ bool Shader::onLoad()
 			{
 				GLint loc = glGetUniformLocation( mGLProgram, namebuf );
 
-				if( loc >= 0 )  //loc < 0 means that this is a OpenGL-builtin such as gl_WorldViewProjectionMatrix
+				if( loc >= 0 )  //loc < 0 means that this is a OpenGL-builtin such as gl_WorldViewProjectionMatrix, or it is in a block
 				{
-					mUniformMap[ namebuf ] = Uniform( 
+					mUniforms.emplace_back( 
+						namebuf,
 						loc,
 						size, 
 						type, 
@@ -305,6 +489,8 @@ bool Shader::onLoad()
 			}
 		}
 
+		_compileUniforms();
+
 		//get attributes and their locations
 		for( int i = 0;; ++i )
 		{
@@ -318,10 +504,16 @@ bool Shader::onLoad()
 
 				if( loc >= 0 )
 				{
+					auto instanceAttribute = _getInstanceAttributeForName( namebuf );
+
 					mAttributeMap[ namebuf ] = VertexAttribute(
 						loc,
 						size,
-						_getAttributeForName( namebuf ) );
+						_getAttributeForName( namebuf ),
+						instanceAttribute );
+
+					if( instanceAttribute != BIA_NONE )
+						mInstanced = true;
 				}
 			}
 		}
@@ -332,7 +524,7 @@ bool Shader::onLoad()
 
 #else
 
-void Shader::use( Renderable* user )
+void Shader::use( const Renderable& user, int& uploads, int& skipped )
 {
 	DEBUG_FAIL( "Shaders not supported" );
 }
@@ -9,7 +9,8 @@ using namespace Dojo;
 
 ///"real file" Resource constructor. When onLoad is called, it will use filePath to load its contents
 ShaderProgram::ShaderProgram( ResourceGroup* creator, const String& filePath ) : 
-	Resource( creator, filePath )
+	Resource( creator, filePath ),
+	mContentRead( false )
 {
 	//guess the type from the extension
 	String ext = Utils::getFileExtension( filePath );
@@ -23,6 +24,7 @@ ShaderProgram::ShaderProgram( ResourceGroup* creator, const String& filePath ) :
 ShaderProgram::ShaderProgram(ShaderProgramType type, const std::string& contents) :
 Resource(nullptr),
 mContentString(contents),
+mContentRead( false ),
 mType(type) {
 	DEBUG_ASSERT(mContentString.size(), "No shader code was defined (empty string)");
 }
@@ -93,23 +95,37 @@ void ShaderProgram::onUnload( bool soft /* = false */ )
 }
 #endif
 
+bool ShaderProgram::_readFile()
+{
+	auto file = Platform::singleton().getFile( filePath );
+
+	if( !file->open() )
+		return false;
+
+	mContentString.clear();
+	mContentString.resize( file->getSize() );
+
+	file->read( (byte*)mContentString.c_str(), mContentString.size() );
+	return true;
+}
+
+void ShaderProgram::onPrepare()
+{
+	if( getFilePath().size() && !isLoaded() )
+		mContentRead = _readFile();
+}
+
 bool ShaderProgram::onLoad()
 {
 	DEBUG_ASSERT( !isLoaded(), "Cannot reload an already loaded program" );
 
 	if( getFilePath().size() ) //try loading from file
 	{
-		auto file = Platform::singleton().getFile( filePath );
-
-		if( file->open() ) //open the file
-		{
-			mContentString.clear();
-			mContentString.resize( file->getSize() );
-
-			file->read( (byte*)mContentString.c_str(), mContentString.size() );
-
+		//onPrepare() might have read it already
+		if( mContentRead || _readFile() )
 			loaded = _load(); //load from the temp buffer
-		}
+
+		mContentRead = false;
 	}
 	else //load from the in-memory string
 	{
@@ -55,6 +55,66 @@ ov_callbacks VORBIS_CALLBACKS =
 	_vorbisTell 
 };
 
+//decodes size bytes of PCM from the ogg in source, starting from the given raw position
+//a negative size decodes until the end of the stream
+static bool _decodeOgg( Stream& source, long startPosition, long size, std::vector< char >& out, ALenum& format, ALsizei& frequency )
+{
+	OggVorbis_File file;
+	vorbis_info* info;
+	int totalRead = 0;
+
+	int error = ov_open_callbacks( &source, &file, NULL, 0, VORBIS_CALLBACKS );
+
+	DEBUG_ASSERT( error == 0, "Cannot load an ogg from the memory buffer" );
+
+	info = ov_info( &file, -1 );
+
+	int wordSize = 2;
+	format = (info->channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+
+	frequency = info->rate * 10; //wtf, why * 10 //HACK
+
+	if( size < 0 )
+		size = (long)( ov_pcm_total( &file, -1 ) * wordSize * info->channels );
+
+	out.resize( size );
+
+	//read all vorbis packets in the same buffer
+	long read = 0;
+
+	//seek to the start of the file segment
+	error = ov_raw_seek( &file, startPosition );
+	DEBUG_ASSERT( error == 0, "Cannot seek into file" );
+
+	bool corrupt = false;
+	do
+	{
+		int section = -1;
+		read = ov_read( &file, out.data() + totalRead, size - totalRead, 0, wordSize, 1, &section );
+
+		if( read == OV_HOLE || read == OV_EBADLINK || read == OV_EINVAL )
+			corrupt = true;
+
+		else if( read == 0 )
+			break;
+
+		else
+			totalRead += read;
+
+		DEBUG_ASSERT( totalRead <= size, "Total read bytes overflow the buffer" ); //this should always be true
+
+	} while( !corrupt && totalRead < size );
+
+	ov_clear( &file );
+
+	DEBUG_ASSERT( !corrupt, "an ogg vorbis stream was corrupt and could not be read" );
+	DEBUG_ASSERT( totalRead > 0, "no data was read from the stream" );
+
+	out.resize( totalRead );
+
+	return !corrupt && totalRead > 0;
+}
+
 
 SoundBuffer::Chunk::Chunk(SoundBuffer* parent, long streamStartPosition, long uncompressedSize) :
 size(0),
@@ -111,6 +171,21 @@ SoundBuffer::~SoundBuffer()
 
 }
 
+void SoundBuffer::onPrepare()
+{
+	if( isLoaded() )
+		return;
+
+	mFile = Platform::singleton().getFile( filePath );
+	mSource = mFile.get();
+
+	//decode the whole sound, the streaming chunks are decoded when they are played anyway
+	Unique< Stream > source( mSource->copy() );
+
+	if( source->open() )
+		_decodeOgg( *source, 0, -1, mPreparedPCM, mPreparedFormat, mPreparedFrequency );
+}
+
 bool SoundBuffer::onLoad()
 {
 	DEBUG_ASSERT( isLoaded() == false, "The SoundBuffer is already loaded" );
@@ -120,6 +195,9 @@ bool SoundBuffer::onLoad()
 	DEBUG_ASSERT( ext == String( "ogg" ), "Sound file extension is not ogg" );
 	
 	_loadOggFromFile();
+
+	//streaming sounds decode each chunk on demand and don't use the prepared data
+	std::vector< char >().swap( mPreparedPCM );
 			
 	return CHECK_AL_ERROR;
 }
@@ -147,69 +225,34 @@ bool SoundBuffer::Chunk::onLoad()
 	alGenBuffers( 1, &alBuffer ); //gen the buffer if it didn't exist
 
 	CHECK_AL_ERROR;
-    
-    //copy the source to avoid side-effects
-    Unique< Stream > source( pParent->mSource->copy() );
-    
-    source->open();
 
-	DEBUG_ASSERT( source->isReadable(), "The data source for the Ogg stream could not be open, or isn't readable" );
-
-	char* uncompressedData = (char*)malloc( mUncompressedSize );
-
-	OggVorbis_File file;
-	vorbis_info* info;
 	ALenum format;
-	int totalRead = 0;
-
-	int error = ov_open_callbacks( source.get(), &file, NULL, 0, VORBIS_CALLBACKS );
+	ALsizei frequency;
+	std::vector< char > uncompressedData;
 
-	DEBUG_ASSERT( error == 0, "Cannot load an ogg from the memory buffer" );
-
-	info = ov_info( &file, -1 );
-
-	int wordSize = 2;
-	format = (info->channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
-
-	int bitrate = info->rate * 10; //wtf, why * 10 //HACK
-
-	//read all vorbis packets in the same buffer
-	long read = 0;
-
-	//seek to the start of the file segment
-	error = ov_raw_seek( &file, mStartPosition );
-	DEBUG_ASSERT( error == 0, "Cannot seek into file" );
-
-	bool corrupt = false;
-	do
+	//the only chunk of a static sound might have been decoded already by SoundBuffer::onPrepare
+	if( !pParent->isStreaming() && !pParent->mPreparedPCM.empty() )
 	{
-		int section = -1;
-		read = ov_read( &file, uncompressedData + totalRead, mUncompressedSize - totalRead, 0, wordSize, 1, &section );
-
-		if( read == OV_HOLE || read == OV_EBADLINK || read == OV_EINVAL )
-			corrupt = true;
-
-		else if( read == 0 )
-			break;
-
-		else
-			totalRead += read;
-
-		DEBUG_ASSERT( totalRead <= mUncompressedSize, "Total read bytes overflow the buffer" ); //this should always be true
+		uncompressedData.swap( pParent->mPreparedPCM );
+		format = pParent->mPreparedFormat;
+		frequency = pParent->mPreparedFrequency;
+	}
+	else
+	{
+		//copy the source to avoid side-effects
+		Unique< Stream > source( pParent->mSource->copy() );
 
-	} while( !corrupt && totalRead < mUncompressedSize );
+		source->open();
 
-	ov_clear( &file );
+		DEBUG_ASSERT( source->isReadable(), "The data source for the Ogg stream could not be open, or isn't readable" );
 
-	DEBUG_ASSERT( !corrupt, "an ogg vorbis stream was corrupt and could not be read" );
-	DEBUG_ASSERT( totalRead > 0, "no data was read from the stream" );
+		_decodeOgg( *source, mStartPosition, mUncompressedSize, uncompressedData, format, frequency );
+	}
 
-	alBufferData( alBuffer, format, uncompressedData, totalRead, bitrate );
+	alBufferData( alBuffer, format, uncompressedData.data(), (ALsizei)uncompressedData.size(), frequency );
 
 	loaded = CHECK_AL_ERROR;
 
-	free( uncompressedData );
-
 	return loaded;
 }
 
@@ -219,17 +262,20 @@ void SoundBuffer::Chunk::loadAsync()
 
 	++references; //grab a reference and release to be sure that the chunk is not destroyed while loading
 
-	//async load
-	Platform::singleton().getBackgroundQueue()->queueTask([&]()
+	//async load, before the asset loads as the source is waiting for it
+	auto queue = Platform::singleton().getBackgroundQueue();
+	queue->queueTask([&, queue]()
 	{
 		onLoad();
 
+		BackgroundQueue::Blocking blocking( *queue );
 		std::this_thread::sleep_for(std::chrono::milliseconds(20)); //HACK
 	},
 	[&]() //then,
 	{
 		release();
-	});
+	},
+	BackgroundQueue::PRIORITY_HIGH );
 }
 
 void SoundBuffer::Chunk::onUnload( bool soft /* = false */ )
@@ -321,8 +367,12 @@ bool SoundBuffer::_loadOgg( Stream* source )
 
 bool SoundBuffer::_loadOggFromFile()
 {
-	mFile = Platform::singleton().getFile( filePath );
-	mSource = mFile.get();
+	//onPrepare might have opened the file already
+	if( !mFile )
+	{
+		mFile = Platform::singleton().getFile( filePath );
+		mSource = mFile.get();
+	}
 	
 	_loadOgg( mSource );
 
@@ -5,6 +5,7 @@
 #include "SoundBuffer.h"
 
 #include "Platform.h"
+#include "Profiler.h"
 
 #include "Utils.h"
 
@@ -68,7 +69,7 @@ currentFadeTime(0)
 	//ensure at least MIN sources have been built
 	DEBUG_ASSERT_INFO( 
 		idleSoundPool.size() >= NUM_SOURCES_MIN, 
-		"OpenAL could not preload the minimum sources number", String("NUM_SOURCES_MIN = ") + NUM_SOURCES_MIN ); 
+		"OpenAL could not preload the minimum sources number", String("NUM_SOURCES_MIN = ") + String( NUM_SOURCES_MIN ) ); 
 
 	//dummy source to manage source shortage
 	fakeSource = new SoundSource( 0 );
@@ -173,6 +174,8 @@ void SoundManager::setMasterVolume( float volume )
 
 void SoundManager::update( float dt )
 {
+	DOJO_PROFILE_ZONE( "SoundManager::update" );
+
 	SoundSource* current;
 	//sincronizza le sources con i nodes
 	for( int i = 0; i < busySoundPool.size(); ++i)
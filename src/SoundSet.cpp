@@ -33,6 +33,15 @@ void SoundSet::addBuffer(SoundBuffer* b) {
 	buffers.add(b);
 }
 
+void SoundSet::onPrepare()
+{
+	for( int i = 0; i < buffers.size(); ++i )
+	{
+		if( !buffers[i]->isLoaded() )
+			buffers[i]->onPrepare();
+	}
+}
+
 bool SoundSet::onLoad()
 {
 	for( int i = 0; i < buffers.size(); ++i )
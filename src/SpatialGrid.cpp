@@ -0,0 +1,205 @@
+#include "stdafx.h"
+
+#include "SpatialGrid.h"
+
+#include "Renderable.h"
+#include "Viewport.h"
+
+using namespace Dojo;
+
+SpatialGrid::SpatialGrid( float cellSize ) :
+	mCellSize( cellSize ),
+	mInvCellSize( 1.f / cellSize ),
+	mQueryStamp( 0 )
+{
+	DEBUG_ASSERT( cellSize > 0, "The cell size of a SpatialGrid must be positive" );
+}
+
+bool SpatialGrid::_getCellRange( const Vector& min, const Vector& max, CellRange& range, int maxSpan ) const
+{
+	if( !_isValidAABB( min, max ) )
+		return false;
+
+	//work in double to avoid overflowing the ints with faraway elements
+	double minX = floor( min.x * (double)mInvCellSize ), minY = floor( min.y * (double)mInvCellSize );
+	double maxX = floor( max.x * (double)mInvCellSize ), maxY = floor( max.y * (double)mInvCellSize );
+
+	if( maxX - minX >= maxSpan || maxY - minY >= maxSpan ||
+		fabs( minX ) > INT_MAX / 2 || fabs( minY ) > INT_MAX / 2 )
+		return false;
+
+	range.minX = (int)minX;
+	range.minY = (int)minY;
+	range.maxX = (int)maxX;
+	range.maxY = (int)maxY;
+	return true;
+}
+
+void SpatialGrid::_link( int proxyID )
+{
+	Proxy& p = mProxies[ proxyID ];
+
+	p.oversized = !_getCellRange( p.object->getWorldMin(), p.object->getWorldMax(), p.cells );
+
+	if( p.oversized )
+		mOversized.push_back( proxyID );
+	else
+	{
+		for( int x = p.cells.minX; x <= p.cells.maxX; ++x )
+			for( int y = p.cells.minY; y <= p.cells.maxY; ++y )
+				mCells[ _getCellKey( x, y ) ].push_back( proxyID );
+	}
+}
+
+static void _eraseProxy( std::vector< int >& list, int proxyID )
+{
+	auto elem = std::find( list.begin(), list.end(), proxyID );
+
+	DEBUG_ASSERT( elem != list.end(), "The proxy wasn't in the cell" );
+
+	*elem = list.back();
+	list.pop_back();
+}
+
+void SpatialGrid::_unlink( int proxyID )
+{
+	Proxy& p = mProxies[ proxyID ];
+
+	if( p.oversized )
+		_eraseProxy( mOversized, proxyID );
+	else
+	{
+		for( int x = p.cells.minX; x <= p.cells.maxX; ++x )
+		{
+			for( int y = p.cells.minY; y <= p.cells.maxY; ++y )
+			{
+				auto cell = mCells.find( _getCellKey( x, y ) );
+				_eraseProxy( cell->second, proxyID );
+
+				if( cell->second.empty() )
+					mCells.erase( cell );
+			}
+		}
+	}
+}
+
+void SpatialGrid::add( Renderable& r )
+{
+	DEBUG_ASSERT( r._getSpatialProxy() < 0, "This Renderable is already in a SpatialIndex" );
+
+	int proxyID;
+	if( mFreeProxies.size() )
+	{
+		proxyID = mFreeProxies.back();
+		mFreeProxies.pop_back();
+	}
+	else
+	{
+		proxyID = mProxies.size();
+		mProxies.emplace_back();
+	}
+
+	Proxy& p = mProxies[ proxyID ];
+	p.object = &r;
+	p.queryStamp = 0;
+
+	_link( proxyID );
+
+	r._setSpatialProxy( proxyID );
+}
+
+void SpatialGrid::remove( Renderable& r )
+{
+	int proxyID = r._getSpatialProxy();
+
+	DEBUG_ASSERT( proxyID >= 0 && mProxies[ proxyID ].object == &r, "This Renderable is not in this SpatialGrid" );
+
+	_unlink( proxyID );
+
+	mProxies[ proxyID ].object = nullptr;
+	mFreeProxies.push_back( proxyID );
+
+	r._setSpatialProxy( -1 );
+}
+
+void SpatialGrid::update( Renderable& r )
+{
+	int proxyID = r._getSpatialProxy();
+
+	DEBUG_ASSERT( proxyID >= 0 && mProxies[ proxyID ].object == &r, "This Renderable is not in this SpatialGrid" );
+
+	Proxy& p = mProxies[ proxyID ];
+
+	//most moves don't leave the cells
+	CellRange cells;
+	bool oversized = !_getCellRange( r.getWorldMin(), r.getWorldMax(), cells );
+
+	if( oversized == p.oversized && (oversized || cells == p.cells) )
+		return;
+
+	_unlink( proxyID );
+	_link( proxyID );
+}
+
+void SpatialGrid::clear()
+{
+	for( auto& p : mProxies )
+	{
+		if( p.object )
+			p.object->_setSpatialProxy( -1 );
+	}
+
+	mProxies.clear();
+	mFreeProxies.clear();
+	mCells.clear();
+	mOversized.clear();
+}
+
+void SpatialGrid::query( const Viewport& viewport, ResultList& result ) const
+{
+	++mQueryStamp;
+
+	for( int proxyID : mOversized )
+		result.push_back( mProxies[ proxyID ].object );
+
+	CellRange view;
+	bool small = _getCellRange( viewport.getWorldMin(), viewport.getWorldMax(), view, 1 << 16 );
+
+	if( !small || (int64_t)(view.maxX - view.minX + 1) * (view.maxY - view.minY + 1) > (int64_t)mCells.size() )
+	{
+		//the view spans more cells than there are, it's faster to visit the cells that exist
+		for( auto& cell : mCells )
+		{
+			for( int proxyID : cell.second )
+			{
+				const Proxy& p = mProxies[ proxyID ];
+				if( p.queryStamp != mQueryStamp )
+				{
+					p.queryStamp = mQueryStamp;
+					result.push_back( p.object );
+				}
+			}
+		}
+		return;
+	}
+
+	for( int x = view.minX; x <= view.maxX; ++x )
+	{
+		for( int y = view.minY; y <= view.maxY; ++y )
+		{
+			auto cell = mCells.find( _getCellKey( x, y ) );
+			if( cell == mCells.end() )
+				continue;
+
+			for( int proxyID : cell->second )
+			{
+				const Proxy& p = mProxies[ proxyID ];
+				if( p.queryStamp != mQueryStamp )
+				{
+					p.queryStamp = mQueryStamp;
+					result.push_back( p.object );
+				}
+			}
+		}
+	}
+}
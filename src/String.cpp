@@ -6,3 +6,188 @@ using namespace Dojo;
 
 const String String::EMPTY = String();
 
+unichar Unicode::_decodeMultibyteUTF8( const char*& ptr, const char* end )
+{
+	const unsigned char* s = (const unsigned char*)ptr;
+	size_t available = end - ptr;
+
+	unichar c, min;
+	size_t length;
+
+	if( ( s[0] & 0xe0 ) == 0xc0 )
+	{
+		c = s[0] & 0x1f;
+		length = 2;
+		min = 0x80;
+	}
+	else if( ( s[0] & 0xf0 ) == 0xe0 )
+	{
+		c = s[0] & 0x0f;
+		length = 3;
+		min = 0x800;
+	}
+	else if( ( s[0] & 0xf8 ) == 0xf0 )
+	{
+		c = s[0] & 0x07;
+		length = 4;
+		min = 0x10000;
+	}
+	else //a continuation byte or an invalid lead
+	{
+		++ptr;
+		return REPLACEMENT_CHARACTER;
+	}
+
+	if( length > available )
+	{
+		++ptr;
+		return REPLACEMENT_CHARACTER;
+	}
+
+	for( size_t i = 1; i < length; ++i )
+	{
+		if( ( s[i] & 0xc0 ) != 0x80 )
+		{
+			++ptr;
+			return REPLACEMENT_CHARACTER;
+		}
+
+		c = ( c << 6 ) | ( s[i] & 0x3f );
+	}
+
+	//reject overlong encodings, surrogates and out of range values
+	if( c < min || c > MAX_CODEPOINT || ( c >= 0xd800 && c <= 0xdfff ) )
+	{
+		++ptr;
+		return REPLACEMENT_CHARACTER;
+	}
+
+	ptr += length;
+	return c;
+}
+
+void Unicode::encodeUTF8( unichar c, std::string& dest )
+{
+	if( c > MAX_CODEPOINT || ( c >= 0xd800 && c <= 0xdfff ) )
+		c = REPLACEMENT_CHARACTER;
+
+	if( c < 0x80 )
+		dest += (char)c;
+	else if( c < 0x800 )
+	{
+		dest += (char)( 0xc0 | ( c >> 6 ) );
+		dest += (char)( 0x80 | ( c & 0x3f ) );
+	}
+	else if( c < 0x10000 )
+	{
+		dest += (char)( 0xe0 | ( c >> 12 ) );
+		dest += (char)( 0x80 | ( ( c >> 6 ) & 0x3f ) );
+		dest += (char)( 0x80 | ( c & 0x3f ) );
+	}
+	else
+	{
+		dest += (char)( 0xf0 | ( c >> 18 ) );
+		dest += (char)( 0x80 | ( ( c >> 12 ) & 0x3f ) );
+		dest += (char)( 0x80 | ( ( c >> 6 ) & 0x3f ) );
+		dest += (char)( 0x80 | ( c & 0x3f ) );
+	}
+}
+
+void Unicode::encodeUTF16( unichar c, std::wstring& dest )
+{
+	if( c > MAX_CODEPOINT || ( c >= 0xd800 && c <= 0xdfff ) )
+		c = REPLACEMENT_CHARACTER;
+
+	if( c < 0x10000 )
+		dest += (wchar_t)c;
+	else
+	{
+		c -= 0x10000;
+		dest += (wchar_t)( 0xd800 + ( c >> 10 ) );
+		dest += (wchar_t)( 0xdc00 + ( c & 0x3ff ) );
+	}
+}
+
+size_t Unicode::truncateUTF8( const char* s, size_t size, size_t maxSize )
+{
+	if( size <= maxSize )
+		return size;
+
+	//back off to the start of the codepoint that would be cut
+	size_t end = maxSize;
+	while( end > 0 && isContinuationByte( s[ end ] ) )
+		--end;
+
+	return end;
+}
+
+size_t StringView::countCodepoints() const
+{
+	//count the first bytes of each character
+	size_t count = 0;
+	for( char c : *this )
+	{
+		if( !Unicode::isContinuationByte( c ) )
+			++count;
+	}
+
+	return count;
+}
+
+std::string String::ASCII() const
+{
+	//every byte of a multibyte sequence is >= 0x80, so skipping them drops whole characters
+	std::string res;
+	res.reserve( size() );
+
+	for( char c : *this )
+	{
+		if( (unsigned char)c < 0x80 )
+			res += c;
+	}
+
+	return res;
+}
+
+std::wstring String::toWString() const
+{
+	std::wstring res;
+	res.reserve( size() );
+
+	for( unichar c : codepoints() )
+	{
+		if( sizeof( wchar_t ) == 2 )
+			Unicode::encodeUTF16( c, res );
+		else
+			res += (wchar_t)c;
+	}
+
+	return res;
+}
+
+void String::appendASCII( const char* s )
+{
+	DEBUG_ASSERT( s, "Tried to append a NULL ASCII string" );
+
+	for( ; *s; ++s )
+		appendCodepoint( (unsigned char)*s );
+}
+
+void String::appendWString( const wchar_t* s )
+{
+	DEBUG_ASSERT( s, "Tried to append a NULL wide string" );
+
+	for( ; *s; ++s )
+	{
+		unichar c = (unichar)*s;
+
+		//join the UTF-16 surrogate pairs
+		if( sizeof( wchar_t ) == 2 && c >= 0xd800 && c <= 0xdbff && s[1] >= 0xdc00 && s[1] <= 0xdfff )
+		{
+			c = 0x10000 + ( ( c - 0xd800 ) << 10 ) + ( (unichar)s[1] - 0xdc00 );
+			++s;
+		}
+
+		appendCodepoint( c );
+	}
+}
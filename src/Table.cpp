@@ -18,14 +18,23 @@ Table Table::loadFromFile( const String& path )
 	Table dest;
 	if( file->open() )
 	{
-		//read the contents directly in a string
-		std::string buf;
-		buf.resize( file->getSize() );
+		//parse the mapped file in place if possible
+		if( auto data = file->getData() )
+		{
+			StringReader reader( StringView( (const char*)data, file->getSize() ) );
+			dest.deserialize( reader );
+		}
+		else
+		{
+			//read the contents directly in a string
+			std::string buf;
+			buf.resize( file->getSize() );
 
-		file->read( (byte*)buf.c_str(), buf.size() );
+			file->read( (byte*)buf.c_str(), buf.size() );
 
-		StringReader reader( buf );
-		dest.deserialize( reader );
+			StringReader reader( buf );
+			dest.deserialize( reader );
+		}
 	}
 
 	return dest;
@@ -158,6 +167,7 @@ void Table::deserialize( StringReader& buf )
 	ParseTarget target = PT_UNDEFINED;
 	
 	String curName, str;
+	size_t pos, nameStart = 0;
 	float number;
 	Vector vec;
 	Data data;
@@ -170,6 +180,7 @@ void Table::deserialize( StringReader& buf )
 	unichar c = 1, c2;
 	while( state != PS_END && state != PS_ERROR )
 	{
+		pos = buf.getCurrentIndex();
 		c = buf.get();
 		
 		switch( state )
@@ -186,19 +197,18 @@ void Table::deserialize( StringReader& buf )
 			else if( isNumber( c ) )target = PT_NUMBER;
 
 			if( state == PS_NAME )
-			{
-				curName.clear();
-				curName += c;
-			}
+				nameStart = pos;
 
 			break;
 		case PS_NAME:			
-			if( isName( c ) )
-				curName += c;
-			else if( c == '=' )
-				state = PS_EQUAL;
-			else
-				state = PS_NAME_ENDED;
+			if( !isName( c ) )
+			{
+				//copy the whole name at once from the source
+				StringView name = buf.getView( nameStart, pos );
+				curName.assign( name.data(), name.size() );
+
+				state = ( c == '=' ) ? PS_EQUAL : PS_NAME_ENDED;
+			}
 
 			break;
 
@@ -259,18 +269,19 @@ void Table::deserialize( StringReader& buf )
 			}
 				
 			break;
-		case PT_STRING:
+		case PT_STRING: {
 
-			str.clear();
-			while( 1 )
-			{
-				c = buf.get();
-				if( c == '"' )	break;
-				str += c;
-			}
+			size_t start = buf.getCurrentIndex();
+			do { c = buf.get(); } while( c != '"' && c != 0 );
+
+			DEBUG_ASSERT( c, "Unterminated string in the Table" );
+
+			StringView value = buf.getView( start, buf.getCurrentIndex() - 1 );
+			str.assign( value.data(), value.size() );
 
 			set( curName, str );
-			break;
+		}
+		break;
 
 		case PT_VECTOR:
 			vec.x = buf.readFloat();
@@ -506,7 +517,7 @@ const Table::Data& Table::getData(const String& key) const {
 
 String Table::autoMemberName(int idx) const {
 	DEBUG_ASSERT(idx >= 0, "autoMemberName: idx is negative");
-	DEBUG_ASSERT_INFO(idx < getArrayLength(), "autoMemberName: idx is OOB", String("idx = ") + idx);
+	DEBUG_ASSERT_INFO(idx < getArrayLength(), "autoMemberName: idx is OOB", String("idx = ") + String(idx));
 
 	return '_' + String(idx);
 }
@@ -0,0 +1,249 @@
+#include "stdafx.h"
+
+#include "TaskGraph.h"
+
+using namespace Dojo;
+
+TaskGraph::TaskGraph( BackgroundQueue* queue ) :
+	mState( std::make_shared< State >( queue ) )
+{
+
+}
+
+TaskGraph::~TaskGraph()
+{
+	cancel();
+}
+
+TaskGraph::TaskID TaskGraph::_add( Node&& node, const TaskList& after )
+{
+	TaskID id;
+	bool ready;
+
+	{
+		std::lock_guard< std::mutex > lock( mState->mutex );
+
+		id = mState->nextID++;
+
+		for( TaskID predecessor : after )
+		{
+			DEBUG_ASSERT( predecessor >= 0 && predecessor < id, "Invalid predecessor TaskID" );
+
+			//the finished tasks are not in the map anymore
+			auto elem = mState->nodes.find( predecessor );
+			if( elem != mState->nodes.end() )
+			{
+				elem->second.successors.push_back( id );
+				++node.unfinishedPredecessors;
+			}
+		}
+
+		ready = node.unfinishedPredecessors == 0;
+
+		mState->nodes[ id ] = std::move( node );
+	}
+
+	if( ready )
+		_submit( mState, id );
+
+	return id;
+}
+
+TaskGraph::TaskID TaskGraph::add( const Task& task, const TaskList& after, Affinity affinity, BackgroundQueue::Priority priority )
+{
+	DEBUG_ASSERT( task, "The task can't be empty" );
+
+	Node node;
+	node.task = task;
+	node.affinity = affinity;
+	node.priority = priority;
+
+	return _add( std::move( node ), after );
+}
+
+TaskGraph::TaskID TaskGraph::addParallelFor( int count, const ForBody& body, const TaskList& after, BackgroundQueue::Priority priority )
+{
+	DEBUG_ASSERT( body, "The body can't be empty" );
+
+	Node node;
+
+	//an empty loop is just a join
+	if( count > 0 )
+	{
+		node.forBody = body;
+		node.forCount = count;
+	}
+	else
+		node.task = [](){};
+
+	node.priority = priority;
+
+	return _add( std::move( node ), after );
+}
+
+void TaskGraph::_submit( const StatePtr& state, TaskID id )
+{
+	Affinity affinity;
+	BackgroundQueue::Priority priority;
+	ForBody forBody;
+	int forCount;
+	int generation = state->generation;
+
+	{
+		std::lock_guard< std::mutex > lock( state->mutex );
+
+		auto elem = state->nodes.find( id );
+		if( elem == state->nodes.end() ) //cancelled
+			return;
+
+		affinity = elem->second.affinity;
+		priority = elem->second.priority;
+		forBody = elem->second.forBody;
+		forCount = elem->second.forCount;
+	}
+
+	BackgroundQueue* queue = state->queue;
+
+	if( forCount > 0 )
+	{
+		//fan out, each job takes the next iteration until there are none left
+		SharedCounter next = std::make_shared< std::atomic< int > >( 0 );
+		SharedCounter done = std::make_shared< std::atomic< int > >( 0 );
+
+		if( !queue )
+		{
+			_runIterations( state, id, generation, forBody, forCount, next, done );
+			return;
+		}
+
+		int jobs = std::max( 1, std::min( queue->getWorkerCount(), forCount ) );
+
+		for( int i = 0; i < jobs; ++i )
+		{
+			queue->queueTask( [=]()
+			{
+				_runIterations( state, id, generation, forBody, forCount, next, done );
+			},
+			BackgroundQueue::Callback(),
+			priority );
+		}
+	}
+	else if( !queue )
+		_run( state, id );
+
+	else if( affinity == AFFINITY_MAIN_THREAD )
+	{
+		queue->queueOnMainThread( [=]()
+		{
+			_run( state, id );
+		} );
+	}
+	else
+	{
+		queue->queueTask( [=]()
+		{
+			_run( state, id );
+		},
+		BackgroundQueue::Callback(),
+		priority );
+	}
+}
+
+void TaskGraph::_run( const StatePtr& state, TaskID id )
+{
+	Task task;
+	Affinity affinity;
+
+	{
+		std::lock_guard< std::mutex > lock( state->mutex );
+
+		auto elem = state->nodes.find( id );
+		if( elem == state->nodes.end() ) //cancelled
+			return;
+
+		task = std::move( elem->second.task );
+		affinity = elem->second.affinity;
+	}
+
+	task();
+
+	//the other contexts only see the GL objects created here once the commands are done
+	if( affinity == AFFINITY_GL_CONTEXT )
+		glFinish();
+
+	_finish( state, id );
+}
+
+void TaskGraph::_runIterations( const StatePtr& state, TaskID id, int generation, const ForBody& body, int count, const SharedCounter& next, const SharedCounter& done )
+{
+	for( int i = (*next)++; i < count; i = (*next)++ )
+	{
+		if( state->generation != generation )
+			return;
+
+		body( i );
+
+		if( ++(*done) == count )
+			_finish( state, id );
+	}
+}
+
+void TaskGraph::_finish( const StatePtr& state, TaskID id )
+{
+	TaskList ready;
+
+	{
+		std::lock_guard< std::mutex > lock( state->mutex );
+
+		auto elem = state->nodes.find( id );
+		if( elem == state->nodes.end() ) //cancelled
+			return;
+
+		for( TaskID successor : elem->second.successors )
+		{
+			auto s = state->nodes.find( successor );
+			if( s != state->nodes.end() && --s->second.unfinishedPredecessors == 0 )
+				ready.push_back( successor );
+		}
+
+		state->nodes.erase( elem );
+	}
+
+	for( TaskID successor : ready )
+		_submit( state, successor );
+}
+
+bool TaskGraph::isDone( TaskID task ) const
+{
+	std::lock_guard< std::mutex > lock( mState->mutex );
+
+	DEBUG_ASSERT( task >= 0 && task < mState->nextID, "Invalid TaskID" );
+
+	return mState->nodes.find( task ) == mState->nodes.end();
+}
+
+bool TaskGraph::isDone() const
+{
+	std::lock_guard< std::mutex > lock( mState->mutex );
+
+	return mState->nodes.empty();
+}
+
+void TaskGraph::wait()
+{
+	while( !isDone() )
+	{
+		if( mState->queue )
+			mState->queue->fireCompletedCallbacks();
+
+		std::this_thread::yield();
+	}
+}
+
+void TaskGraph::cancel()
+{
+	std::lock_guard< std::mutex > lock( mState->mutex );
+
+	mState->nodes.clear();
+	++mState->generation;
+}
@@ -8,6 +8,9 @@
 
 using namespace Dojo;
 
+//the two triangles of a glyph quad
+static const Mesh::IndexType GLYPH_INDICES[] = { 0, 1, 2, 1, 3, 2 };
+
 TextArea::TextArea( Object* l, 
 		 const String& fontSetName, 
 		 const Vector& pos, 
@@ -82,13 +85,10 @@ void TextArea::addText( const String& text )
 	content += text;
 
 	Font::Character* currentChar;
-	unichar c;
 
 	//parse and setup characters
-	for( int i = 0; i < (int)text.size(); ++i )
+	for( unichar c : text.codepoints() )
 	{
-		c = text[i];
-
 		currentChar = font->getCharacter( c );
 		characters.emplace( currentChar );
 
@@ -155,7 +155,7 @@ Renderable* TextArea::_enableLayer( Texture& tex )
 	r->setActive( true );
 	r->setTexture( &tex );
 	
-	r->getMesh()->begin( getLenght() * 2 );
+	r->getMesh()->begin( getLenght() * 4, getLenght() * 6 );
 	
 	busyLayers.emplace( r );
 	
@@ -223,7 +223,6 @@ void TextArea::_prepare() {
 	Vector newSize(0,0);
 	bool doKerning = font->isKerningEnabled();
 	int lastLineVertexID = 0;
-	int idx = 0;
 
 	cursorPosition.x = 0;
 	cursorPosition.y = 0;
@@ -270,23 +269,24 @@ void TextArea::_prepare() {
 			if( doKerning && lastRep )
 				x += font->getKerning( rep, lastRep ); 
 
-			idx = layer->getVertexCount();
-
 			//assign vertex positions and uv coordinates
-			layer->vertex( x, y );
-			layer->uv( rep->uvPos.x, rep->uvPos.y + rep->uvHeight );
+			Mesh::IndexType idx = layer->appendVertices( 4 );
+			auto positions = layer->getFieldSpan< glm::vec2 >( VertexField::Position2D, idx, 4 );
+			auto uvs = layer->getFieldSpan< glm::vec2 >( VertexField::UV0, idx, 4 );
+
+			positions[0] = glm::vec2( x, y );
+			uvs[0] = glm::vec2( rep->uvPos.x, rep->uvPos.y + rep->uvHeight );
 
-			layer->vertex( x + rep->widthRatio, y );
-			layer->uv( rep->uvPos.x + rep->uvWidth, rep->uvPos.y + rep->uvHeight );
- 
-			layer->vertex( x, y + rep->heightRatio );
-			layer->uv( rep->uvPos.x, rep->uvPos.y );
- 
-			layer->vertex( x + rep->widthRatio, y + rep->heightRatio );
-			layer->uv( rep->uvPos.x + rep->uvWidth, rep->uvPos.y );
+			positions[1] = glm::vec2( x + rep->widthRatio, y );
+			uvs[1] = glm::vec2( rep->uvPos.x + rep->uvWidth, rep->uvPos.y + rep->uvHeight );
 
-			layer->triangle( idx, idx+1, idx+2 );
-			layer->triangle( idx+1, idx+3, idx+2 );
+			positions[2] = glm::vec2( x, y + rep->heightRatio );
+			uvs[2] = glm::vec2( rep->uvPos.x, rep->uvPos.y );
+
+			positions[3] = glm::vec2( x + rep->widthRatio, y + rep->heightRatio );
+			uvs[3] = glm::vec2( rep->uvPos.x + rep->uvWidth, rep->uvPos.y );
+
+			layer->appendIndices( GLYPH_INDICES, 6, idx );
 
 			//now move to the next character
 			cursorPosition.x += rep->advance + charSpacing;
@@ -378,13 +378,13 @@ Renderable* TextArea::_getLayer(Texture& tex)
 
 void TextArea::onAction(float dt)
 {
-	_prepare();
+	//the meshes can only be uploaded on the main thread, so wait for the end of the parallel update
+	if( changed )
+		gameState->runSerially( [this]() { _prepare(); } );
 
 	{
 		Object::onAction(dt);
 
 		advanceFade(dt);
 	}
-	
-	_updateWorldAABB( mLayersLowerBound, mLayersUpperBound );
 }
@@ -5,6 +5,8 @@
 #include "Platform.h"
 #include "ResourceGroup.h"
 #include "Mesh.h"
+#include "Renderer.h"
+#include "TextureStreamer.h"
 
 using namespace Dojo;
 
@@ -21,7 +23,11 @@ Texture::Texture( ResourceGroup* creator ) :
 	ownerFrameSet( NULL ),
 	mMipmapsEnabled( true ),
 	internalFormat( GL_NONE ),
-	mFBO( GL_NONE )
+	mFBO( GL_NONE ),
+	mPreparedImage( nullptr ),
+	mPreparedFormat( GL_NONE ),
+	mResident( false ),
+	mStreamed( false )
 {			
 
 }
@@ -39,7 +45,11 @@ Texture::Texture( ResourceGroup* creator, const String& path ) :
 	ownerFrameSet( NULL ),
 	mMipmapsEnabled( true ),
 	internalFormat( GL_NONE ),
-	mFBO( GL_NONE )
+	mFBO( GL_NONE ),
+	mPreparedImage( nullptr ),
+	mPreparedFormat( GL_NONE ),
+	mResident( false ),
+	mStreamed( false )
 {			
 
 }
@@ -49,6 +59,10 @@ Texture::~Texture()
 	if( OBB )
 		SAFE_DELETE( OBB );
 
+	free( mPreparedImage );
+
+	_cancelStreaming();
+
 	if (loaded)
 		onUnload();
 }
@@ -66,7 +80,10 @@ void Texture::bind( GLuint index )
 	}
 
 	glActiveTexture( GL_TEXTURE0 + index );
-	glEnable( GL_TEXTURE_2D );
+
+#ifndef DOJO_SHADERS_AVAILABLE
+	glEnable( GL_TEXTURE_2D ); //only the fixed function pipeline needs this
+#endif
 
 	glBindTexture( GL_TEXTURE_2D, glhandle );
 }
@@ -172,6 +189,19 @@ void Texture::disableMipmaps()
 }
 
 bool Texture::loadEmpty( int w, int h, GLenum destFormat )
+{
+	//clear the storage, as it could be used as a render target
+	return _loadImage( w, h, destFormat, GL_NONE, nullptr, true );
+}
+
+bool Texture::loadFromMemory( byte* imageData, int width, int height, GLenum sourceFormat, GLenum destFormat )
+{
+	DEBUG_ASSERT( imageData, "null image data" );
+
+	return _loadImage( width, height, destFormat, sourceFormat, imageData, false );
+}
+
+bool Texture::_loadImage( int w, int h, GLenum destFormat, GLenum sourceFormat, const void* pixels, bool clear )
 {
 	width = w;
 	height = h;
@@ -179,6 +209,7 @@ bool Texture::loadEmpty( int w, int h, GLenum destFormat )
 	DEBUG_ASSERT( width > 0, "Width must be more than 0" );
 	DEBUG_ASSERT( height > 0, "Height must be more than 0" ); 
 	DEBUG_ASSERT( destFormat > 0, "the desired internal image format is undefined" );
+	DEBUG_ASSERT( !pixels || sourceFormat > 0, "the source image format is undefined" );
 
 	bind(0);
 
@@ -209,6 +240,10 @@ bool Texture::loadEmpty( int w, int h, GLenum destFormat )
 		destHeight = POTheight;
 	}
 
+	bool padded = destWidth != width || destHeight != height;
+
+	mResident = pixels || clear;
+
 	//check if the texture has to be recreated (changed dimensions)
 	if( destWidth != internalWidth || destHeight != internalHeight || internalFormat != destFormat )
 	{
@@ -217,41 +252,33 @@ bool Texture::loadEmpty( int w, int h, GLenum destFormat )
 		internalFormat = destFormat;
 		size = internalWidth * internalHeight * destPixelSize;
 
-        std::string dummyData(size, 0 ); //needs to preallocate the storage if this tex is used as rendertarget (TODO avoid this if we have data)
-        
-        //create an empty GPU mem space
-		glTexImage2D(
-			GL_TEXTURE_2D, 
-			0, 
-			internalFormat,
-			internalWidth, 
-			internalHeight,
-			0, 
-			internalFormat,
-			GL_UNSIGNED_BYTE, 
-			dummyData.c_str() );
-	}
-
-	UVSize.x = (float)width/(float)internalWidth;
-	UVSize.y = (float)height/(float)internalHeight;
-
-	GLenum err = glGetError();
-	loaded = (err == GL_NO_ERROR);
-	DEBUG_ASSERT( loaded, "Cannot load an empty texture" );
+		if( pixels && !padded )
+		{
+			//allocate and upload in a single call
+			glTexImage2D( GL_TEXTURE_2D, 0, internalFormat, internalWidth, internalHeight, 0, sourceFormat, GL_UNSIGNED_BYTE, pixels );
 
-	return loaded;
-}
+			pixels = nullptr;
+		}
+		else if( clear || padded )
+		{
+			//the padding around the image has to be clean too, as the filtering can read it
+			std::string dummyData( size, 0 );
 
-bool Texture::loadFromMemory( byte* imageData, int width, int height, GLenum sourceFormat, GLenum destFormat )
-{
-	DEBUG_ASSERT( imageData, "null image data" );
+			glTexImage2D( GL_TEXTURE_2D, 0, internalFormat, internalWidth, internalHeight, 0, internalFormat, GL_UNSIGNED_BYTE, dummyData.c_str() );
+		}
+		else //only allocate the GPU mem space, the contents come later
+			glTexImage2D( GL_TEXTURE_2D, 0, internalFormat, internalWidth, internalHeight, 0, internalFormat, GL_UNSIGNED_BYTE, nullptr );
+	}
 
-	loadEmpty( width, height, destFormat );
+	if( pixels )
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, width, height, sourceFormat, GL_UNSIGNED_BYTE, pixels );
 
-	glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, width, height, sourceFormat, GL_UNSIGNED_BYTE, imageData );
+	UVSize.x = (float)width/(float)internalWidth;
+	UVSize.y = (float)height/(float)internalHeight;
 
 	loaded = (glGetError() == GL_NO_ERROR);
-	DEBUG_ASSERT( loaded, "OpenGL error, cannot load a Texture from memory" );	
+	DEBUG_ASSERT( loaded, "OpenGL error, cannot load a Texture" );
+
 	return loaded;
 }
 
@@ -263,7 +290,19 @@ bool Texture::loadFromFile( const String& path )
 
 	GLenum sourceFormat = 0, destFormat;
 	int pixelSize;
-	sourceFormat = Platform::singleton().loadImageFile( imageData, path, width, height, pixelSize );
+
+	//use the image decoded by onPrepare() if there is one
+	if( mStreamed && path == filePath )
+		sourceFormat = mPreparedFormat;
+
+	else if( mPreparedImage && path == filePath )
+	{
+		imageData = mPreparedImage;
+		sourceFormat = mPreparedFormat;
+		mPreparedImage = nullptr;
+	}
+	else
+		sourceFormat = Platform::singleton().loadImageFile( imageData, path, width, height, pixelSize );
 	
 	DEBUG_ASSERT_INFO( sourceFormat, "Cannot load an image file", "path = " + path );
 	
@@ -299,7 +338,11 @@ bool Texture::loadFromFile( const String& path )
 	else if( sourceFormat == GL_RGB )	destFormat = GL_SRGB8;
 #endif
 		
-	loadFromMemory( (byte*)imageData, width, height, sourceFormat, destFormat );
+	//the pixels of a streamed image are uploaded by the TextureStreamer, only allocate the storage here
+	if( imageData )
+		loadFromMemory( (byte*)imageData, width, height, sourceFormat, destFormat );
+	else
+		_loadImage( width, height, destFormat, sourceFormat, nullptr, false );
 
 	free(imageData);
 
@@ -350,6 +393,27 @@ bool Texture::loadFromAtlas( Texture* tex, int x, int y, int sx, int sy )
 	return false;
 }
 
+void Texture::onPrepare()
+{
+	//atlas tiles have nothing to decode
+	if( isReloadable() && !isLoaded() && !mPreparedImage )
+	{
+		int pixelSize;
+		mPreparedFormat = Platform::singleton().loadImageFile( mPreparedImage, filePath, width, height, pixelSize );
+
+		//stage the pixels for an upload over the next frames, or keep them if there's no room
+		if( mPreparedImage && creator && creator->streamTextures )
+		{
+			if( Platform::singleton().getRenderer().getTextureStreamer().stream( *this, mPreparedImage, width, height, mPreparedFormat, pixelSize ) )
+			{
+				free( mPreparedImage );
+				mPreparedImage = nullptr;
+				mStreamed = true;
+			}
+		}
+	}
+}
+
 bool Texture::onLoad()
 {	
 	DEBUG_ASSERT( !isLoaded(), "The texture is already loaded" );
@@ -365,12 +429,29 @@ bool Texture::onLoad()
 		return false;
 }
 
+void Texture::_notifyResident()
+{
+	mResident = true;
+	mStreamed = false;
+}
+
+void Texture::_cancelStreaming()
+{
+	if( mStreamed )
+	{
+		Platform::singleton().getRenderer().getTextureStreamer().cancel( *this );
+		mStreamed = false;
+	}
+}
+
 void Texture::onUnload( bool soft )
 {		
 	DEBUG_ASSERT( isLoaded(), "The Texture is not loaded" );
 	
 	if( !soft || isReloadable() )
 	{
+		_cancelStreaming();
+
 		if( OBB )
 		{
 			OBB->onUnload();
@@ -384,6 +465,7 @@ void Texture::onUnload( bool soft )
 			internalWidth = internalHeight = 0;
 			internalFormat = GL_NONE;
 			glhandle = 0;
+			mResident = false;
 
 			if( mFBO ) //fbos are destroyed on unload, the user must care to rebuild their contents after a purge
 			{
@@ -0,0 +1,256 @@
+#include "stdafx.h"
+
+#include "TextureStreamer.h"
+
+#include "Texture.h"
+
+using namespace Dojo;
+
+//the staged images start on this alignment, which is enough for any pixel transfer
+static const int RING_ALIGNMENT = 16;
+
+TextureStreamer::TextureStreamer( int ringSize, int frameBudget ) :
+	mRingSize( ringSize ),
+	mFrameBudget( frameBudget ),
+	mLastFrameUploadedBytes( 0 ),
+	mPendingBytes( 0 ),
+	mPixelBuffer( GL_NONE ),
+	pRing( nullptr ),
+	mFirstUploadID( 0 ),
+	mHead( 0 )
+{
+	DEBUG_ASSERT( ringSize > 0, "The ring size must be positive" );
+	DEBUG_ASSERT( frameBudget > 0, "The frame budget must be positive" );
+
+#ifdef DOJO_PIXEL_BUFFERS_AVAILABLE
+	if( GLEW_ARB_buffer_storage && GLEW_ARB_sync )
+	{
+		//map the buffer once and for all, the workers write straight into it
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glGenBuffers( 1, &mPixelBuffer );
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, mPixelBuffer );
+		glBufferStorage( GL_PIXEL_UNPACK_BUFFER, mRingSize, nullptr, flags );
+
+		pRing = (byte*)glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, mRingSize, flags );
+
+		if( !pRing )
+		{
+			glDeleteBuffers( 1, &mPixelBuffer );
+			mPixelBuffer = GL_NONE;
+		}
+
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, GL_NONE );
+
+		CHECK_GL_ERROR;
+	}
+#endif
+
+	//fall back to uploading from client memory
+	if( !pRing )
+		pRing = (byte*)malloc( mRingSize );
+}
+
+TextureStreamer::~TextureStreamer()
+{
+#ifdef DOJO_PIXEL_BUFFERS_AVAILABLE
+	for( auto& u : mUploads )
+	{
+		if( u.fence )
+			glDeleteSync( u.fence );
+	}
+
+	if( mPixelBuffer )
+	{
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, mPixelBuffer );
+		glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, GL_NONE );
+
+		glDeleteBuffers( 1, &mPixelBuffer );
+		return;
+	}
+#endif
+
+	free( pRing );
+}
+
+int TextureStreamer::_reserve( int size ) const
+{
+	if( mUploads.empty() )
+		return size <= mRingSize ? 0 : -1;
+
+	int tail = mUploads.front().offset;
+
+	//the free space is after the head, and before the tail once wrapped around
+	//the head never reaches the tail, or a full ring would look empty
+	if( mHead >= tail )
+	{
+		if( mHead + size <= mRingSize )
+			return mHead;
+		else if( size < tail )
+			return 0;
+	}
+	else if( mHead + size < tail )
+		return mHead;
+
+	return -1;
+}
+
+bool TextureStreamer::stream( Texture& texture, const void* pixels, int width, int height, GLenum sourceFormat, int pixelSize )
+{
+	DEBUG_ASSERT( pixels, "null pixels" );
+	DEBUG_ASSERT( width > 0 && height > 0 && pixelSize > 0, "Invalid image size" );
+
+	int size = width * height * pixelSize;
+	int reserved = (size + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+
+	int offset, id;
+
+	{
+		std::lock_guard< std::mutex > lock( mMutex );
+
+		offset = _reserve( reserved );
+
+		if( offset < 0 )
+			return false;
+
+		Upload u;
+		u.texture = &texture;
+		u.offset = offset;
+		u.size = size;
+		u.width = width;
+		u.height = height;
+		u.sourceFormat = sourceFormat;
+		u.staged = false;
+		u.uploaded = false;
+#ifdef DOJO_PIXEL_BUFFERS_AVAILABLE
+		u.fence = nullptr;
+#endif
+
+		mUploads.push_back( u );
+		mHead = offset + reserved;
+
+		id = mFirstUploadID + (int)mUploads.size() - 1;
+	}
+
+	mPendingBytes += size;
+
+	//the range is reserved, the copy can happen outside of the lock
+	memcpy( pRing + offset, pixels, size );
+
+	{
+		std::lock_guard< std::mutex > lock( mMutex );
+
+		mUploads[ id - mFirstUploadID ].staged = true;
+	}
+
+	return true;
+}
+
+void TextureStreamer::cancel( Texture& texture )
+{
+	std::lock_guard< std::mutex > lock( mMutex );
+
+	//the ring space is released in order by update()
+	for( auto& u : mUploads )
+	{
+		if( u.texture == &texture )
+		{
+			if( !u.uploaded )
+				mPendingBytes -= u.size;
+
+			u.texture = nullptr;
+		}
+	}
+}
+
+bool TextureStreamer::_isDone( Upload& u )
+{
+#ifdef DOJO_PIXEL_BUFFERS_AVAILABLE
+	if( u.fence )
+	{
+		GLenum status = glClientWaitSync( u.fence, 0, 0 );
+
+		if( status == GL_TIMEOUT_EXPIRED )
+			return false;
+
+		DEBUG_ASSERT( status != GL_WAIT_FAILED, "Cannot wait for a texture upload fence" );
+
+		glDeleteSync( u.fence );
+		u.fence = nullptr;
+
+		if( u.texture )
+			u.texture->_notifyResident();
+	}
+#endif
+
+	return true;
+}
+
+void TextureStreamer::update()
+{
+	std::lock_guard< std::mutex > lock( mMutex );
+
+	//make resident the textures that the GPU is done with, even if the older uploads are still waiting
+	for( auto& u : mUploads )
+	{
+		if( u.uploaded )
+			_isDone( u );
+	}
+
+	//release the ring space in order
+	while( mUploads.size() )
+	{
+		Upload& u = mUploads.front();
+
+		if( !u.staged || !(u.uploaded || !u.texture) || !_isDone( u ) )
+			break;
+
+		mUploads.pop_front();
+		++mFirstUploadID;
+	}
+
+	if( mUploads.empty() )
+		mHead = 0;
+
+	//upload the staged images, always at least one per frame even if it's larger than the budget
+	mLastFrameUploadedBytes = 0;
+
+	if( mPixelBuffer )
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, mPixelBuffer );
+
+	for( auto& u : mUploads )
+	{
+		if( mLastFrameUploadedBytes >= mFrameBudget )
+			break;
+
+		//skip the textures that didn't allocate their storage yet
+		if( u.uploaded || !u.staged || !u.texture || !u.texture->isLoaded() )
+			continue;
+
+		DEBUG_ASSERT( u.texture->getWidth() == u.width && u.texture->getHeight() == u.height, "The texture was loaded with a different size than the streamed image" );
+
+		//from the pixel buffer the pointer is an offset
+		const void* pixels = mPixelBuffer ? (const void*)(size_t)u.offset : pRing + u.offset;
+
+		u.texture->bind( 0 );
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, u.width, u.height, u.sourceFormat, GL_UNSIGNED_BYTE, pixels );
+
+		u.uploaded = true;
+
+#ifdef DOJO_PIXEL_BUFFERS_AVAILABLE
+		if( mPixelBuffer )
+			u.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+		else
+#endif
+			u.texture->_notifyResident(); //the client memory was copied by the call
+
+		mLastFrameUploadedBytes += u.size;
+		mPendingBytes -= u.size;
+	}
+
+	if( mPixelBuffer )
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, GL_NONE );
+
+	CHECK_GL_ERROR;
+}
@@ -0,0 +1,301 @@
+#include "stdafx.h"
+
+#include "TransformSystem.h"
+
+#if defined( DOJO_SIMD_SSE )
+	#include <xmmintrin.h>
+#elif defined( DOJO_SIMD_NEON )
+	#include <arm_neon.h>
+#endif
+
+using namespace Dojo;
+
+//a minimal 4-wide float layer, so that the sweep is written once for all the instruction sets
+#if defined( DOJO_SIMD_SSE )
+	typedef __m128 float4;
+
+	static inline float4 _load( const float* p )				{	return _mm_loadu_ps( p );	}
+	static inline void _store( float* p, float4 v )			{	_mm_storeu_ps( p, v );		}
+	static inline float4 _set( float x, float y, float z, float w )	{	return _mm_setr_ps( x, y, z, w );	}
+	static inline float4 _splat( float f )					{	return _mm_set1_ps( f );	}
+	static inline float4 _add( float4 a, float4 b )			{	return _mm_add_ps( a, b );	}
+	static inline float4 _sub( float4 a, float4 b )			{	return _mm_sub_ps( a, b );	}
+	static inline float4 _mul( float4 a, float4 b )			{	return _mm_mul_ps( a, b );	}
+	static inline float4 _abs( float4 a )					{	return _mm_andnot_ps( _mm_set1_ps( -0.f ), a );	}
+#elif defined( DOJO_SIMD_NEON )
+	typedef float32x4_t float4;
+
+	static inline float4 _load( const float* p )				{	return vld1q_f32( p );		}
+	static inline void _store( float* p, float4 v )			{	vst1q_f32( p, v );			}
+	static inline float4 _set( float x, float y, float z, float w )	{	float v[] = { x, y, z, w }; return vld1q_f32( v );	}
+	static inline float4 _splat( float f )					{	return vdupq_n_f32( f );	}
+	static inline float4 _add( float4 a, float4 b )			{	return vaddq_f32( a, b );	}
+	static inline float4 _sub( float4 a, float4 b )			{	return vsubq_f32( a, b );	}
+	static inline float4 _mul( float4 a, float4 b )			{	return vmulq_f32( a, b );	}
+	static inline float4 _abs( float4 a )					{	return vabsq_f32( a );		}
+#else
+	struct float4
+	{
+		float v[4];
+	};
+
+	static inline float4 _load( const float* p )				{	float4 r = { { p[0], p[1], p[2], p[3] } }; return r;	}
+	static inline void _store( float* p, float4 a )			{	p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3];	}
+	static inline float4 _set( float x, float y, float z, float w )	{	float4 r = { { x, y, z, w } }; return r;	}
+	static inline float4 _splat( float f )					{	return _set( f, f, f, f );	}
+	static inline float4 _add( float4 a, float4 b )			{	return _set( a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] );	}
+	static inline float4 _sub( float4 a, float4 b )			{	return _set( a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] );	}
+	static inline float4 _mul( float4 a, float4 b )			{	return _set( a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] );	}
+	static inline float4 _abs( float4 a )					{	return _set( fabsf( a.v[0] ), fabsf( a.v[1] ), fabsf( a.v[2] ), fabsf( a.v[3] ) );	}
+#endif
+
+TransformSystem::TransformSystem() :
+	mDeadCount( 0 )
+{
+
+}
+
+TransformSystem::Handle TransformSystem::add( Handle parent, const Vector& position, const Quaternion& rotation, const Vector& scale )
+{
+	int parentIndex = (parent == INVALID_HANDLE) ? -1 : _getIndex( parent );
+
+	DEBUG_ASSERT( parentIndex < 0 || !mDead[ parentIndex ], "Cannot add a child to a removed transform" );
+
+	//appending keeps the parents before the children
+	int index = mParent.size();
+
+	mPosX.push_back( position.x );	mPosY.push_back( position.y );	mPosZ.push_back( position.z );
+	mRotX.push_back( rotation.x );	mRotY.push_back( rotation.y );	mRotZ.push_back( rotation.z );	mRotW.push_back( rotation.w );
+	mScaleX.push_back( scale.x );	mScaleY.push_back( scale.y );	mScaleZ.push_back( scale.z );
+
+	mLocalCenter.push_back( Vector::ZERO );
+	mLocalExtent.push_back( Vector( 0.5f, 0.5f, 0.5f ) );
+
+	mParent.push_back( parentIndex );
+	mWorld.push_back( Matrix( 1 ) );
+	mWorldMin.push_back( Vector::ZERO );
+	mWorldMax.push_back( Vector::ZERO );
+	mDead.push_back( false );
+
+	Handle h;
+	if( mFreeHandles.size() )
+	{
+		h = mFreeHandles.back();
+		mFreeHandles.pop_back();
+	}
+	else
+	{
+		h = mHandleToIndex.size();
+		mHandleToIndex.push_back( -1 );
+	}
+
+	mHandleToIndex[ h ] = index;
+	mIndexToHandle.push_back( h );
+
+	return h;
+}
+
+void TransformSystem::remove( Handle h )
+{
+	int index = _getIndex( h );
+
+	if( !mDead[ index ] )
+	{
+		mDead[ index ] = true;
+		++mDeadCount;
+	}
+}
+
+void TransformSystem::clear()
+{
+	mPosX.clear();	mPosY.clear();	mPosZ.clear();
+	mRotX.clear();	mRotY.clear();	mRotZ.clear();	mRotW.clear();
+	mScaleX.clear();	mScaleY.clear();	mScaleZ.clear();
+	mLocalCenter.clear();
+	mLocalExtent.clear();
+	mParent.clear();
+	mWorld.clear();
+	mWorldMin.clear();
+	mWorldMax.clear();
+	mDead.clear();
+	mDeadCount = 0;
+
+	mHandleToIndex.clear();
+	mIndexToHandle.clear();
+	mFreeHandles.clear();
+}
+
+void TransformSystem::setPosition( Handle h, const Vector& position )
+{
+	int i = _getIndex( h );
+	mPosX[i] = position.x;
+	mPosY[i] = position.y;
+	mPosZ[i] = position.z;
+}
+
+Vector TransformSystem::getPosition( Handle h ) const
+{
+	int i = _getIndex( h );
+	return Vector( mPosX[i], mPosY[i], mPosZ[i] );
+}
+
+void TransformSystem::setRotation( Handle h, const Quaternion& rotation )
+{
+	int i = _getIndex( h );
+	mRotX[i] = rotation.x;
+	mRotY[i] = rotation.y;
+	mRotZ[i] = rotation.z;
+	mRotW[i] = rotation.w;
+}
+
+Quaternion TransformSystem::getRotation( Handle h ) const
+{
+	int i = _getIndex( h );
+	return Quaternion( mRotW[i], mRotX[i], mRotY[i], mRotZ[i] );
+}
+
+void TransformSystem::setScale( Handle h, const Vector& scale )
+{
+	int i = _getIndex( h );
+	mScaleX[i] = scale.x;
+	mScaleY[i] = scale.y;
+	mScaleZ[i] = scale.z;
+}
+
+Vector TransformSystem::getScale( Handle h ) const
+{
+	int i = _getIndex( h );
+	return Vector( mScaleX[i], mScaleY[i], mScaleZ[i] );
+}
+
+void TransformSystem::setLocalAABB( Handle h, const Vector& min, const Vector& max )
+{
+	int i = _getIndex( h );
+	mLocalCenter[i] = (min + max) * 0.5f;
+	mLocalExtent[i] = (max - min) * 0.5f;
+}
+
+template< class T >
+static void _compactArray( std::vector< T >& array, const std::vector< int >& newIndex, int newSize )
+{
+	for( size_t i = 0; i < array.size(); ++i )
+	{
+		if( newIndex[i] >= 0 )
+			array[ newIndex[i] ] = array[i];
+	}
+
+	array.resize( newSize );
+}
+
+void TransformSystem::_compact()
+{
+	//the parents come first, so a dead parent is always found before its children
+	std::vector< int > newIndex( mParent.size() );
+	int newSize = 0;
+	for( size_t i = 0; i < mParent.size(); ++i )
+	{
+		int parent = mParent[i];
+		bool dead = mDead[i] || (parent >= 0 && newIndex[ parent ] < 0);
+
+		if( dead )
+		{
+			newIndex[i] = -1;
+
+			Handle h = mIndexToHandle[i];
+			mHandleToIndex[h] = -1;
+			mFreeHandles.push_back( h );
+		}
+		else
+			newIndex[i] = newSize++;
+	}
+
+	//remap the parents before moving them
+	for( auto& parent : mParent )
+	{
+		if( parent >= 0 )
+			parent = newIndex[ parent ];
+	}
+
+	_compactArray( mPosX, newIndex, newSize );			_compactArray( mPosY, newIndex, newSize );			_compactArray( mPosZ, newIndex, newSize );
+	_compactArray( mRotX, newIndex, newSize );			_compactArray( mRotY, newIndex, newSize );
+	_compactArray( mRotZ, newIndex, newSize );			_compactArray( mRotW, newIndex, newSize );
+	_compactArray( mScaleX, newIndex, newSize );		_compactArray( mScaleY, newIndex, newSize );		_compactArray( mScaleZ, newIndex, newSize );
+	_compactArray( mLocalCenter, newIndex, newSize );	_compactArray( mLocalExtent, newIndex, newSize );
+	_compactArray( mParent, newIndex, newSize );
+	_compactArray( mWorld, newIndex, newSize );
+	_compactArray( mWorldMin, newIndex, newSize );		_compactArray( mWorldMax, newIndex, newSize );
+	_compactArray( mIndexToHandle, newIndex, newSize );
+
+	mDead.assign( newSize, false );
+	mDeadCount = 0;
+
+	for( int i = 0; i < newSize; ++i )
+		mHandleToIndex[ mIndexToHandle[i] ] = i;
+}
+
+void TransformSystem::update()
+{
+	if( mDeadCount )
+		_compact();
+
+	int count = mParent.size();
+	for( int i = 0; i < count; ++i )
+	{
+		//local transform, the rotation is built as in glm::mat4_cast
+		float qx = mRotX[i], qy = mRotY[i], qz = mRotZ[i], qw = mRotW[i];
+		float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+		float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+		float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+		float sx = mScaleX[i], sy = mScaleY[i], sz = mScaleZ[i];
+
+		const float local[16] = {
+			(1.f - 2.f * (yy + zz)) * sx,	2.f * (xy + wz) * sx,			2.f * (xz - wy) * sx,			0,
+			2.f * (xy - wz) * sy,			(1.f - 2.f * (xx + zz)) * sy,	2.f * (yz + wx) * sy,			0,
+			2.f * (xz + wy) * sz,			2.f * (yz - wx) * sz,			(1.f - 2.f * (xx + yy)) * sz,	0,
+			mPosX[i],						mPosY[i],						mPosZ[i],						1
+		};
+
+		float* out = glm::value_ptr( mWorld[i] );
+
+		int parent = mParent[i];
+		if( parent < 0 )
+			memcpy( out, local, sizeof( local ) );
+		else
+		{
+			//world = parentWorld * local, one column at a time
+			const float* p = glm::value_ptr( mWorld[ parent ] );
+			float4 p0 = _load( p ), p1 = _load( p + 4 ), p2 = _load( p + 8 ), p3 = _load( p + 12 );
+
+			for( int c = 0; c < 3; ++c )
+			{
+				const float* l = local + c * 4;
+				_store( out + c * 4, _add( _add( _mul( p0, _splat( l[0] ) ), _mul( p1, _splat( l[1] ) ) ), _mul( p2, _splat( l[2] ) ) ) );
+			}
+
+			_store( out + 12, _add(
+				_add( _mul( p0, _splat( local[12] ) ), _mul( p1, _splat( local[13] ) ) ),
+				_add( _mul( p2, _splat( local[14] ) ), p3 ) ) );
+		}
+
+		float4 w0 = _load( out ), w1 = _load( out + 4 ), w2 = _load( out + 8 ), w3 = _load( out + 12 );
+
+		//world AABB from the transformed center and the extents projected on the world axes
+		const Vector& c = mLocalCenter[i];
+		const Vector& e = mLocalExtent[i];
+
+		float4 center = _add(
+			_add( _mul( w0, _splat( c.x ) ), _mul( w1, _splat( c.y ) ) ),
+			_add( _mul( w2, _splat( c.z ) ), w3 ) );
+
+		float4 extent = _add(
+			_add( _mul( _abs( w0 ), _splat( e.x ) ), _mul( _abs( w1 ), _splat( e.y ) ) ),
+			_mul( _abs( w2 ), _splat( e.z ) ) );
+
+		float min[4], max[4];
+		_store( min, _sub( center, extent ) );
+		_store( max, _add( center, extent ) );
+
+		mWorldMin[i] = Vector( min[0], min[1], min[2] );
+		mWorldMax[i] = Vector( max[0], max[1], max[2] );
+	}
+}
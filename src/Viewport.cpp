@@ -240,6 +240,20 @@ bool Viewport::isContainedInFrustum(const Renderable& r) const
 	return true;
 }
 
+bool Viewport::isInFrustum( const Vector& min, const Vector& max ) const
+{
+	Vector halfSize = (max - min) * 0.5f;
+	Vector center = min + halfSize;
+
+	for (int i = 0; i < 4; ++i)
+	{
+		if (worldFrustumPlanes[i].getSide(center, halfSize) < 0)
+			return false;
+	}
+
+	return true;
+}
+
 bool Viewport::isInViewRect(const Renderable& r) const {
 	return Math::AABBsCollide2D(r.getWorldMax(), r.getWorldMin(), getWorldMax(), getWorldMin());
 }
@@ -1,260 +1,153 @@
 #include "stdafx.h"
 
 #include "ZipArchive.h"
-extern "C"{
-	#include <zzip/write.h>
-}
+#include "MappedFile.h"
+#include "Log.h"
 
 using namespace Dojo;
 
-//ZipFile imp
-ZipFile::ZipFile(ZZIP_FILE *zf){
-	file=zf;
-}
-ZipFile::~ZipFile(){
-	close();
-}
-//close file
-void ZipFile::close(){
-	if(file!=NULL)
-		zzip_close(file);
-	file=NULL;
-}
-//read from file
-size_t ZipFile::read(void * ptr, size_t size, size_t count){
-	return zzip_read( file, ptr, size*count ) / size;
-}
-//seek from file
-int ZipFile::seek (long int offset, int origin ){	
-    return (zzip_seek( file, offset, origin) !=-1 ? 0 : -1);
-}
-//tell from file
-long int ZipFile::tell (){	
-	return zzip_tell(file);
-}
-//get file size
-long int ZipFile::size(){
-	seek( 0L, SEEK_END);
-	long int size = tell();
-	seek( 0L, SEEK_SET);
-	return size;
-}
-//return a uchar cast in int
-int ZipFile::getc (){	
-	char c;
-	return (read(&c, sizeof(char), 1) == 0) ? EOF : (int)c;
-}
-//rewind from file
-void ZipFile::rewind (){	
-	zzip_rewind(file);
-}
-//write to file
-size_t ZipFile::write ( const void * ptr, size_t size, size_t count){	 
-	return zzip_write ( file, ptr, size*count ) / size;
-}
+//the records of the zip format, see PKWARE's APPNOTE.TXT
+static const uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+static const uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+static const uint32_t END_OF_DIRECTORY_SIGNATURE = 0x06054b50;
+
+static const size_t LOCAL_HEADER_SIZE = 30;
+static const size_t CENTRAL_HEADER_SIZE = 46;
+static const size_t END_OF_DIRECTORY_SIZE = 22;
 
+static const uint16_t METHOD_STORE = 0;
+static const uint16_t METHOD_DEFLATE = 8;
 
-//ZipArchive imp
-ZipArchive::ZipArchive():zip_file(NULL){}
-//
-ZipArchive::ZipArchive(const String& path)
+static const uint16_t FLAG_ENCRYPTED = 0x1;
+
+static uint16_t _read16( const byte* p )
 {
-	open(path);
+	return (uint16_t)( p[0] | ( p[1] << 8 ) );
 }
-//
-ZipArchive::~ZipArchive()
+
+static uint32_t _read32( const byte* p )
 {
-	close();
+	return (uint32_t)p[0] | ( (uint32_t)p[1] << 8 ) | ( (uint32_t)p[2] << 16 ) | ( (uint32_t)p[3] << 24 );
 }
-//open zip file
-bool ZipArchive::open(const String& path){
-	zip_file=zzip_opendir_ext_io(path.UTF8().c_str(),ZZIP_CASELESS|ZZIP_ONLYZIP, 0, 0);
-	return zip_file!=NULL;
-}		
-//close zip file
-void ZipArchive::close(){
-	if(zip_file!=NULL)
-		zzip_closedir(zip_file);
-	zip_file=NULL;
+
+ZipArchive::ZipArchive( const String& path ) :
+	mPath( path )
+{
+	auto file = make_shared< MappedFile >( path );
+
+	if( file->isOpen() && _readCentralDirectory( *file ) )
+		mFile = file;
+	else
+		mEntries.clear();
 }
-//open file
-ZipFile* ZipArchive::openFile(const String& path,const String& mode){
-	if(zip_file!=NULL){
-		zzip_rewinddir(zip_file);
-		int mode_flags=ZZIP_CASELESS;
-		//fake fopen MODE like C
-		if(mode.size()){	
-			#ifndef WIN32	
-			#define  O_BINARY 0x0000
-			#endif 
-			mode_flags |= mode[0]=='b' ? O_BINARY : 0;
-			mode_flags |= mode[0]=='r' ? O_RDONLY : 0;
-			if(mode.size()>=2){
-				mode_flags |= mode[1]=='b' ? O_BINARY : 0;
-				mode_flags |= mode[1]=='r' ? O_RDONLY : 0;
-			}
+
+bool ZipArchive::_readCentralDirectory( const MappedFile& file )
+{
+	const byte* data = file.getData();
+	size_t size = file.getSize();
+
+	if( size < END_OF_DIRECTORY_SIZE )
+		return false;
+
+	//the end of directory record is at the end of the file, followed by a comment of up to 64k
+	const byte* end = nullptr;
+	size_t minEnd = size > END_OF_DIRECTORY_SIZE + 0xffff ? size - END_OF_DIRECTORY_SIZE - 0xffff : 0;
+
+	for( size_t i = size - END_OF_DIRECTORY_SIZE + 1; i-- > minEnd; )
+	{
+		if( _read32( data + i ) == END_OF_DIRECTORY_SIGNATURE )
+		{
+			end = data + i;
+			break;
 		}
-		ZZIP_FILE *file_out=zzip_file_open (zip_file,path.UTF8().c_str(), mode_flags);
-		if(file_out!=NULL) return new ZipFile(file_out);
 	}
-	return NULL;
-}
-//open paths info
-void ZipArchive::getList(String path,std::vector<String>& out){
-	if(zip_file!=NULL){	
-		madeValidPath(path);
-		ZZIP_DIRENT *dirp;
-		int size=0;
-		int size_path=path.size();
-		while ((dirp = zzip_readdir(zip_file)) != NULL) {
-			size=strlen(dirp->d_name);
-			if(size_path<size &&      //not this dir and prev path
-				strncmp(dirp->d_name,path.UTF8().c_str(),size_path)==0){ //path is a "sub path"
-					
-				//is not a sub sub directory?
-			    bool isnotasubsubdir=true;
-
-				for(int c=size-2; size_path<=c ;--c){
-					if(dirp->d_name[c]=='/') { isnotasubsubdir=false; break; }
-				}
-
-				if(isnotasubsubdir)
-					out.push_back(&dirp->d_name[size_path]);
-					
-			}
-		}		
-		zzip_rewinddir(zip_file);
-	}
-}
-void ZipArchive::getListAll(String path,std::vector<String>& out){
-	if(zip_file!=NULL){	
-		madeValidPath(path);
-		ZZIP_DIRENT *dirp;
-		int size=0;		
-		int size_path=path.size();
-		while ((dirp = zzip_readdir(zip_file)) != NULL) {
-			size=strlen(dirp->d_name);
-			if(size_path<size &&      //not this dir and prev path
-					strncmp(dirp->d_name,path.UTF8().c_str(),size_path)==0) //path is a "sub path"
-					out.push_back(&dirp->d_name[size_path]);			
+
+	if( !end )
+		return false;
+
+	size_t count = _read16( end + 10 );
+	size_t directorySize = _read32( end + 12 );
+	size_t directoryOffset = _read32( end + 16 );
+
+	if( directoryOffset + directorySize > size )
+		return false;
+
+	mEntries.reserve( count );
+
+	const byte* record = data + directoryOffset;
+	const byte* directoryEnd = record + directorySize;
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		if( record + CENTRAL_HEADER_SIZE > directoryEnd || _read32( record ) != CENTRAL_HEADER_SIGNATURE )
+			return false;
+
+		uint16_t flags = _read16( record + 8 );
+		uint16_t method = _read16( record + 10 );
+		size_t nameLength = _read16( record + 28 );
+		size_t recordSize = CENTRAL_HEADER_SIZE + nameLength + _read16( record + 30 ) + _read16( record + 32 );
+
+		if( record + recordSize > directoryEnd )
+			return false;
+
+		String name( (const char*)record + CENTRAL_HEADER_SIZE, nameLength );
+
+		Entry entry;
+		entry.offset = _read32( record + 42 ); //the local header, the data is found when opening
+		entry.storedSize = _read32( record + 20 );
+		entry.size = _read32( record + 24 );
+		entry.compression = ( method == METHOD_DEFLATE ) ? MappedFileStream::C_DEFLATE : MappedFileStream::C_NONE;
+
+		record += recordSize;
+
+		//skip the folders
+		if( name.empty() || name.back() == '/' )
+			continue;
+
+		if( ( flags & FLAG_ENCRYPTED ) || ( method != METHOD_STORE && method != METHOD_DEFLATE ) )
+		{
+			DEBUG_MESSAGE( "WARNING: " + mPath + " contains " + name + ", which is encrypted or uses an unsupported compression" );
+			continue;
 		}
-		zzip_rewinddir(zip_file);
-	}
-}
-void ZipArchive::getListFiles(String path,std::vector<String>& out){
-	if(zip_file!=NULL){	
-		madeValidPath(path);
-		ZZIP_DIRENT *dirp;
-		int size=0;
-		int size_path=path.size();
-		while ((dirp = zzip_readdir(zip_file)) != NULL) {
-			size=strlen(dirp->d_name);
-			if(dirp->d_name[size-1]!='/'){ //is not a dir
-				if(size_path<size &&      //not this dir and prev path
-					strncmp(dirp->d_name,path.UTF8().c_str(),size_path)==0){ //file is in this directory
-					
-				    //is not in sub sub directory?
-					bool isnotasubsubdir=true;
-									
-					for(int c=size-2; size_path<=c ;--c){
-						if(dirp->d_name[c]=='/') { isnotasubsubdir=false; break; }
-					}
-
-					if(isnotasubsubdir)
-						out.push_back(&dirp->d_name[size_path]);
-					
-				}
-			}
-		}		
-		zzip_rewinddir(zip_file);
-	}
-}
 
-void ZipArchive::getListAllFiles(String path,std::vector<String>& out){
-	if(zip_file!=NULL){	
-		madeValidPath(path);
-		ZZIP_DIRENT *dirp;
-		int size=0;
-		int size_path=path.size();
-		while ((dirp = zzip_readdir(zip_file)) != NULL) {
-			size=strlen(dirp->d_name);
-			if(dirp->d_name[size-1]!='/'){ //is not a dir
-				if(size_path<size &&      //not this dir and prev path
-				   strncmp(dirp->d_name,path.UTF8().c_str(),size_path)==0){ //file is in this directory					  
-					   out.push_back(&dirp->d_name[size_path]);					
-				}
-			}
-		}		
-		zzip_rewinddir(zip_file);
+		mEntries[ name ] = entry;
 	}
+
+	return true;
 }
-void ZipArchive::getListSubDirectories(String path,std::vector<String>& out){
-	if(zip_file!=NULL){	
-		madeValidPath(path);
-		ZZIP_DIRENT *dirp;
-		int size=0;
-		int size_path=path.size();
-		while ((dirp = zzip_readdir(zip_file)) != NULL) {
-			size=strlen(dirp->d_name);
-			if(dirp->d_name[size-1]=='/'){ //is a dir
-				if(size_path<size &&      //not this dir and prev path
-					strncmp(dirp->d_name,path.UTF8().c_str(),size_path)==0){ //path is a "sub path"
-					
-				    //is not a sub sub directory?
-					bool isnotasubsubdir=true;
-									
-					for(int c=size-2; size_path<=c ;--c){
-						if(dirp->d_name[c]=='/') { isnotasubsubdir=false; break; }
-					}
-
-					if(isnotasubsubdir)
-						out.push_back(&dirp->d_name[size_path]);
-					
-				}
-			}
-		}		
-		zzip_rewinddir(zip_file);
-	}
+
+void ZipArchive::getListAllFiles( std::vector< String >& out ) const
+{
+	out.reserve( out.size() + mEntries.size() );
+
+	for( auto& entry : mEntries )
+		out.push_back( entry.first );
 }
-void ZipArchive::getListAllSubDirectories(String path,std::vector<String>& out){
-	if(zip_file!=NULL){	
-		madeValidPath(path);
-		ZZIP_DIRENT *dirp;
-		int size=0;		
-		int size_path=path.size();
-		while ((dirp = zzip_readdir(zip_file)) != NULL) {
-			size=strlen(dirp->d_name);
-			if(dirp->d_name[size-1]=='/'){ //is a dir
-				if(size_path<size &&      //not this dir and prev path
-					strncmp(dirp->d_name,path.UTF8().c_str(),size_path)==0) //path is a "sub path"
-					out.push_back(&dirp->d_name[size_path]);
-			}
-		}
-		zzip_rewinddir(zip_file);
+
+Unique< FileStream > ZipArchive::openFile( const String& internalPath, const String& path ) const
+{
+	auto elem = mEntries.find( internalPath );
+
+	if( elem == mEntries.end() )
+		return nullptr;
+
+	const Entry& entry = elem->second;
+	const byte* header = mFile->getData() + entry.offset;
+
+	if( entry.offset + LOCAL_HEADER_SIZE > mFile->getSize() || _read32( header ) != LOCAL_HEADER_SIGNATURE )
+	{
+		DEBUG_MESSAGE( "WARNING: invalid local header for " + path );
+		return nullptr;
 	}
-}
-void ZipArchive::madeValidPath(String& path){		
-		/* 1 delete \  */
-		for(auto& c : path){ if(c=='\\') c='/';}
-		/* 2 delete void string:  "path/    " */
-		for(int i=path.size()-1;-1<i;--i){
-			if(path[i]=='/') break;
-			if(path[i]!=' '&&path[i]!='\0'){
-				path=path.substr(0,i+1)+'/'; //delete void path
-				break;
-			}		
-		}		
-		/* 3 delete //  */
-		for(int i=path.size()-1;0<i;--i){
-			if(path[i]=='/'&&path[i-1]=='/'){
-				path=path.substr(0,i-2)+path.substr(i,path.size()-i);
-				break;
-			}		
-		}
-		/* delete . */
-		if(path.size() && path[0]=='.') path=path.substr(1,path.size()-1);
-		/* delete /path */
-		if(path.size() && path[0]=='/') path=path.substr(1,path.size()-1);
-}
 
+	//the local header has its own extra field, which can be different from the central one
+	size_t dataOffset = entry.offset + LOCAL_HEADER_SIZE + _read16( header + 26 ) + _read16( header + 28 );
 
+	if( dataOffset + entry.storedSize > mFile->getSize() )
+	{
+		DEBUG_MESSAGE( "WARNING: " + path + " is truncated" );
+		return nullptr;
+	}
+
+	return make_unique< MappedFileStream >( path, mFile, dataOffset, entry.storedSize, entry.size, entry.compression );
+}
@@ -1,77 +1,64 @@
-#ifndef ZIPARCHIVE_H
-#define ZIPARCHIVE_H
+#pragma once
 
-#include "dojostring.h"
-#include <string>
-#include <vector>
-#include <zzip/zzip.h>
+#include "dojo_common_header.h"
 
-namespace Dojo{
+#include "MappedFileStream.h"
 
-	class ZipArchive;
-	class ZipFile;
+namespace Dojo
+{
+	class MappedFile;
 
-	class ZipFile
-	{       
+	///ZipArchive indexes a .zip file mapped in memory, and opens its files as MappedFileStreams
+	/**
+	only the central directory is read when the archive is opened; stored entries are then read in place and
+	deflated entries are inflated when their stream is opened.
+	ZIP64 archives, encrypted entries and compression methods other than store and deflate are not supported.
+	*/
+	class ZipArchive
+	{
 	public:
 
-        friend class ZipArchive;
+		///maps and indexes the archive at path; check isOpen() to know if it worked
+		ZipArchive( const String& path );
 
-                ~ZipFile();
-                //close file
-                void close();
-                //read from file
-                size_t read(void * ptr, size_t size, size_t count);
-                //seek from file
-                int seek (long int offset, int origin );
-                //tell from file
-                long int tell ();
-                //get file size
-                long int size();
-                //return a uchar cast in int
-                int getc();
-                //rewind from file
-                void rewind ();
-                //write to file
-                size_t write ( const void * ptr, size_t size, size_t count);
-       
-	private:
-        
-                ZipFile(ZZIP_FILE* file);
-                ZZIP_FILE* file;
-	};
+		bool isOpen() const
+		{
+			return mFile != nullptr;
+		}
 
-	class ZipArchive
-	{
-	public:
-	
-                ZipArchive();
-                ZipArchive(const String& path);
-                ~ZipArchive();
-                //open zip file
-                bool open(const String& path);
-                //close zip file
-                void close();
-                //open file
-                ZipFile* openFile(const String& path,const String& mode);
-                //paths and files in zip
-                void getList(String path,std::vector<String>& out);
-                void getListFiles(String path,std::vector<String>& out);
-                void getListSubDirectories(String path,std::vector<String>& out);
+		const String& getPath() const
+		{
+			return mPath;
+		}
 
-                void getListAll(String path,std::vector<String>& out);
-                void getListAllFiles(String path,std::vector<String>& out);
-                void getListAllSubDirectories(String path,std::vector<String>& out);
+		///tells if the archive has a file at internalPath, eg. "textures/hero.png"
+		bool contains( const String& internalPath ) const
+		{
+			return mEntries.find( internalPath ) != mEntries.end();
+		}
 
-	private:
+		///appends the paths of all the files in the archive to out
+		void getListAllFiles( std::vector< String >& out ) const;
 
-                void madeValidPath(String& path);
-                ZZIP_DIR* zip_file;
+		///creates an unopened stream for the file at internalPath, or nullptr if it doesn't exist
+		/**
+		\param path the path that the stream will report
+		*/
+		Unique< FileStream > openFile( const String& internalPath, const String& path ) const;
 
-	};
+	protected:
 
+		struct Entry
+		{
+			size_t offset, storedSize, size;
+			MappedFileStream::Compression compression;
+		};
 
-};
+		String mPath;
+		Shared< MappedFile > mFile;
 
+		std::unordered_map< String, Entry > mEntries;
 
-#endif
+		bool _readCentralDirectory( const MappedFile& file );
+	};
+}
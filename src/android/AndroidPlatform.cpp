@@ -17,6 +17,7 @@
 #include "FontSystem.h"
 #include "SoundManager.h"
 #include "InputSystem.h"
+#include "Profiler.h"
 
 #define LODEPNG_COMPILE_DECODER
 #include "lodepng.h"
@@ -412,10 +413,21 @@ void AndroidPlatform::present()
 void AndroidPlatform::step( float dt )
 {
 	DEBUG_ASSERT( running );
+	//close the profiler stats of the previous frame
+	mProfiler->_endFrame();
+
+	DOJO_PROFILE_ZONE( "Platform::step" );
+
+	//send the messages logged since the last frame to the listeners
+	mLog->flush();
+
 	//update accelerometer	
 	UpdateEvent();
 	//update game
-	game->loop( dt );
+	{
+		DOJO_PROFILE_ZONE( "Game::loop" );
+		game->loop( dt );
+	}
 	render->render();	
 	sound->update( dt );
 
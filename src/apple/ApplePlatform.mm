@@ -30,6 +30,7 @@
 #include "dojostring.h"
 #include "StringReader.h"
 #include "BackgroundQueue.h"
+#include "Profiler.h"
 
 using namespace Dojo;
 using namespace std;
@@ -52,16 +53,27 @@ ApplePlatform::~ApplePlatform()
 
 void ApplePlatform::step( float dt )
 {
+	//close the profiler stats of the previous frame
+	mProfiler->_endFrame();
+
+	DOJO_PROFILE_ZONE( "Platform::step" );
+
     frameTimer.reset();
 	
 	//clamp to max dt to avoid crazy behaviour
 	dt = Math::min( dt, game->getMaximumFrameLength() );
     
     mBackgroundQueue->fireCompletedCallbacks();
+
+	//send the messages logged since the last frame to the listeners
+	mLog->flush();
 	
     input->poll( dt );
 	
-    game->loop(dt);
+	{
+		DOJO_PROFILE_ZONE( "Game::loop" );
+		game->loop( dt );
+	}
     
     sound->update(dt);
     
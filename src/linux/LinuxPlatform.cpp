@@ -4,10 +4,525 @@
 
 #ifdef PLATFORM_LINUX
 
-#include "Render.h"
+#include "Renderer.h"
 #include "Game.h"
 #include "Utils.h"
 #include "Table.h"
+#include "FontSystem.h"
+#include "dojomath.h"
+#include "SoundManager.h"
+#include "InputSystem.h"
+#include "Log.h"
+#include "BackgroundQueue.h"
+#include "Profiler.h"
 
+#include <png.h>
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <cfloat>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
-#endif
\ No newline at end of file
+using namespace Dojo;
+
+LinuxPlatform::LinuxPlatform( const Table& configTable ) :
+Platform( configTable ),
+mDisplay( EGL_NO_DISPLAY ),
+mEGLConfig( nullptr ),
+mSurface( EGL_NO_SURFACE ),
+mContext( EGL_NO_CONTEXT ),
+mFixedStepFrames( 0 ),
+mFixedStepLength( 0 )
+{
+	//TODO detect locale code
+	locale = "en";
+}
+
+LinuxPlatform::~LinuxPlatform()
+{
+	_destroyContext();
+}
+
+static String _cleanPath( const String& name )
+{
+	String path = name;
+	for (size_t i = 0; i < path.size(); ++i) {
+		auto& c = path[i];
+		if (c == ':' || c == '\\' || c == '/') { //TODO more invalid chars
+			path.erase(path.begin() + i);
+			--i;
+		}
+	}
+
+	return path;
+}
+
+bool LinuxPlatform::_initializeContext( int w, int h )
+{
+	mDisplay = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+	if( mDisplay == EGL_NO_DISPLAY || !eglInitialize( mDisplay, NULL, NULL ) )
+	{
+		DEBUG_FAIL( "Cannot initialize an EGL display" );
+		return false;
+	}
+
+	//dojo still uses the compatibility profile, so ask for desktop GL rather than GLES
+	if( !eglBindAPI( EGL_OPENGL_API ) )
+	{
+		DEBUG_FAIL( "This EGL implementation doesn't support desktop OpenGL" );
+		return false;
+	}
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 16,
+		EGL_NONE
+	};
+
+	EGLint configNumber = 0;
+	if( !eglChooseConfig( mDisplay, configAttribs, &mEGLConfig, 1, &configNumber ) || configNumber == 0 )
+	{
+		DEBUG_FAIL( "No EGL config supports offscreen OpenGL rendering" );
+		return false;
+	}
+
+	const EGLint surfaceAttribs[] = {
+		EGL_WIDTH, w,
+		EGL_HEIGHT, h,
+		EGL_NONE
+	};
+
+	mSurface = eglCreatePbufferSurface( mDisplay, mEGLConfig, surfaceAttribs );
+	mContext = eglCreateContext( mDisplay, mEGLConfig, EGL_NO_CONTEXT, NULL );
+
+	if( mSurface == EGL_NO_SURFACE || mContext == EGL_NO_CONTEXT )
+	{
+		DEBUG_FAIL( "Cannot create the offscreen EGL context" );
+		return false;
+	}
+
+	acquireContext();
+
+	glewInit();
+
+	return true;
+}
+
+void LinuxPlatform::_destroyContext()
+{
+	if( mDisplay == EGL_NO_DISPLAY )
+		return;
+
+	eglMakeCurrent( mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+
+	//the worker threads are gone, so their contexts aren't current anywhere anymore
+	for( auto& threadContext : mThreadContexts )
+	{
+		eglDestroyContext( mDisplay, threadContext.second );
+		eglDestroySurface( mDisplay, threadContext.first );
+	}
+
+	mThreadContexts.clear();
+
+	if( mContext != EGL_NO_CONTEXT )
+		eglDestroyContext( mDisplay, mContext );
+	if( mSurface != EGL_NO_SURFACE )
+		eglDestroySurface( mDisplay, mSurface );
+
+	eglTerminate( mDisplay );
+
+	mDisplay = EGL_NO_DISPLAY;
+	mContext = EGL_NO_CONTEXT;
+	mSurface = EGL_NO_SURFACE;
+}
+
+void LinuxPlatform::initialize( Game* g )
+{
+	game = g;
+	DEBUG_ASSERT( game, "The Game implementation passed to initialize() can't be null" );
+
+	//get root path
+	char exePath[ PATH_MAX ];
+	ssize_t exePathLength = readlink( "/proc/self/exe", exePath, sizeof( exePath ) - 1 );
+
+	if( exePathLength > 0 )
+	{
+		mRootPath = String( std::string( exePath, exePathLength ) );
+		mRootPath.resize( mRootPath.find_last_of( '/' ) );
+	}
+	else
+	{
+		char cwd[ PATH_MAX ];
+		mRootPath = String( getcwd( cwd, sizeof( cwd ) ) ? cwd : "." );
+	}
+
+	Utils::makeCanonicalPath( mRootPath );
+
+	//init appdata folder, following the XDG spec
+	const char* dataHome = getenv( "XDG_DATA_HOME" );
+	const char* home = getenv( "HOME" );
+
+	if( dataHome && dataHome[0] )
+		mAppDataPath = String( dataHome );
+	else
+		mAppDataPath = String( home ? home : "." ) + "/.local/share";
+
+	mAppDataPath += "/" + _cleanPath( game->getName() );
+	Utils::makeCanonicalPath( mAppDataPath );
+
+	DEBUG_MESSAGE( "Initializing Dojo Linux" );
+
+	//create the appdata user folder
+	mkdir( getAppDataPath().UTF8().c_str(), 0755 );
+
+	//load settings
+	auto userConfig = Table::loadFromFile(mRootPath + "/config.ds");
+
+	if ( userConfig.isEmpty() ) //also look in appdata
+		userConfig = Table::loadFromFile( getAppDataPath() + "/config.ds" );
+
+	config.inherit( &userConfig ); //use the table that was loaded from file but override any config-passed members
+
+	Vector windowSize = config.getVector( "windowSize", Vector( (float)game->getNativeWidth(), (float)game->getNativeHeight() ) );
+
+	//there is no screen, the offscreen surface is all we've got
+	screenWidth = windowWidth = (int)windowSize.x;
+	screenHeight = windowHeight = (int)windowSize.y;
+
+	mFixedStepFrames = config.getInt( "fixedStepFrames" );
+	mFixedStepLength = config.getNumber( "fixedStepLength", game->getNativeFrameLength() );
+
+	if( !_initializeContext( windowWidth, windowHeight ) )
+		return;
+
+	render = new Renderer( windowWidth, windowHeight, DO_LANDSCAPE_LEFT );
+
+	//on machines without audio hardware, run with ALSOFT_DRIVERS=null
+	sound = new SoundManager();
+
+	input = new InputSystem();
+
+	fonts = new FontSystem();
+
+	mBackgroundQueue = new BackgroundQueue( config.getInt( "threads", -1 ) );
+
+	DEBUG_MESSAGE( "---- Game Launched!");
+
+	//start the game
+	game->begin();
+}
+
+void LinuxPlatform::prepareThreadContext()
+{
+	//EGL can create shared contexts from any thread, no need to bother the main one
+	//give each thread a tiny pbuffer of its own so that this works without EGL_KHR_surfaceless_context
+	const EGLint surfaceAttribs[] = {
+		EGL_WIDTH, 1,
+		EGL_HEIGHT, 1,
+		EGL_NONE
+	};
+
+	eglBindAPI( EGL_OPENGL_API );
+
+	EGLSurface surface = eglCreatePbufferSurface( mDisplay, mEGLConfig, surfaceAttribs );
+	EGLContext context = eglCreateContext( mDisplay, mEGLConfig, mContext, NULL );
+
+	bool success = surface != EGL_NO_SURFACE && context != EGL_NO_CONTEXT && eglMakeCurrent( mDisplay, surface, surface, context );
+
+	DEBUG_ASSERT( success, "Cannot share OpenGL on this thread" );
+
+	//no glewInit() here: the function pointers are global, the main thread already loaded them for this same display
+	//and calling it from all the workers at once would race on them
+
+	{
+		std::lock_guard< std::mutex > lock( mThreadContextsMutex );
+		mThreadContexts.emplace_back( surface, context );
+	}
+}
+
+void LinuxPlatform::shutdown()
+{
+	if( game )
+	{
+		game->end();
+		delete game;
+		game = nullptr;
+	}
+
+	//stop the background queue
+	delete mBackgroundQueue;
+	mBackgroundQueue = nullptr;
+
+	//destroy managers
+	delete render;
+	delete sound;
+	delete input;
+	delete fonts;
+
+	render = nullptr;
+	sound = nullptr;
+	input = nullptr;
+	fonts = nullptr;
+
+	_destroyContext();
+}
+
+void LinuxPlatform::setFullscreen( bool enabled )
+{
+	//nothing to do, there is no window
+}
+
+void LinuxPlatform::acquireContext()
+{
+	eglMakeCurrent( mDisplay, mSurface, mSurface, mContext );
+}
+
+void LinuxPlatform::present()
+{
+	//swapping a pbuffer is a no-op, but it still flushes the pipeline just like a real present would
+	eglSwapBuffers( mDisplay, mSurface );
+}
+
+void LinuxPlatform::step( float dt )
+{
+	//close the profiler stats of the previous frame
+	mProfiler->_endFrame();
+
+	DOJO_PROFILE_ZONE( "Platform::step" );
+
+	mStepTimer.reset();
+
+	//send the messages logged since the last frame to the listeners
+	mLog->flush();
+
+	input->poll( dt );
+
+	//update completed tasks
+	mBackgroundQueue->fireCompletedCallbacks();
+
+	{
+		DOJO_PROFILE_ZONE( "Game::loop" );
+		game->loop( dt );
+	}
+
+	sound->update( dt );
+
+	render->render();
+
+	//take the time before swapBuffers because on some implementations it is blocking
+	realFrameTime = (float)mStepTimer.getElapsedTime();
+
+	present();
+}
+
+void LinuxPlatform::_loopFixedStep()
+{
+	float minFrameTime = FLT_MAX, maxFrameTime = 0, totalFrameTime = 0;
+	int frames = 0;
+
+	Timer timer;
+	running = true;
+	for( ; frames < mFixedStepFrames && running && game->isRunning(); ++frames )
+	{
+		step( mFixedStepLength );
+
+		minFrameTime = Math::min( minFrameTime, realFrameTime );
+		maxFrameTime = Math::max( maxFrameTime, realFrameTime );
+		totalFrameTime += realFrameTime;
+	}
+
+	float elapsed = (float)timer.getElapsedTime();
+
+	if( frames > 0 )
+	{
+		mLog->append(
+			"Fixed step run: " + String( frames ) + " frames in " + String( elapsed ) + " s, " +
+			"frame time avg " + String( totalFrameTime / frames * 1000.f ) + " ms, " +
+			"min " + String( minFrameTime * 1000.f ) + " ms, " +
+			"max " + String( maxFrameTime * 1000.f ) + " ms",
+			LogEntry::EL_INFO );
+	}
+
+	_fireTermination();
+	running = false;
+}
+
+void LinuxPlatform::loop()
+{
+	DEBUG_ASSERT( game, "A game must be specified when starting the main loop" );
+
+	if( isFixedStepRun() )
+	{
+		_loopFixedStep();
+		return;
+	}
+
+	Timer timer;
+	running = true;
+	while( running && game->isRunning() )
+	{
+		//never send a dt lower than the minimum!
+		float dt = Math::min( game->getMaximumFrameLength(), (float)timer.deltaTime() );
+
+		step( dt );
+	}
+}
+
+///routes libjpeg's fatal errors back to loadImageFile instead of calling exit()
+struct _JPEGErrorManager
+{
+	jpeg_error_mgr pub;
+	jmp_buf jump;
+
+	static void onError( j_common_ptr info )
+	{
+		longjmp( ((_JPEGErrorManager*)info->err)->jump, 1 );
+	}
+};
+
+GLenum LinuxPlatform::loadImageFile( void*& bufptr, const String& path, int& width, int& height, int& pixelSize )
+{
+	String ext = Utils::getFileExtension( path );
+
+	bool isPNG = ext == String( "png" ) || ext == String( "img" );
+	bool isJPG = ext == String( "jpg" ) || ext == String( "jpeg" );
+
+	//I want to enforce correct filenames
+	if( !isPNG && !isJPG )
+		return 0;
+
+	char* buf;
+	int fileSize = loadFileContent( buf, path );
+
+	if( !fileSize )
+		return 0;
+
+	bufptr = nullptr;
+
+	if( isPNG )
+	{
+		png_image image;
+		memset( &image, 0, sizeof( image ) );
+		image.version = PNG_IMAGE_VERSION;
+
+		if( png_image_begin_read_from_memory( &image, buf, fileSize ) )
+		{
+			//expand anything to RGB or RGBA, dojo only supports those
+			image.format = (image.format & PNG_FORMAT_FLAG_ALPHA) ? PNG_FORMAT_RGBA : PNG_FORMAT_RGB;
+
+			width = image.width;
+			height = image.height;
+			pixelSize = PNG_IMAGE_PIXEL_SIZE( image.format );
+
+			bufptr = malloc( PNG_IMAGE_SIZE( image ) );
+
+			if( !png_image_finish_read( &image, NULL, bufptr, 0, NULL ) )
+			{
+				free( bufptr );
+				bufptr = nullptr;
+			}
+		}
+
+		png_image_free( &image );
+	}
+	else
+	{
+		jpeg_decompress_struct dinfo;
+		_JPEGErrorManager jerr;
+
+		dinfo.err = jpeg_std_error( &jerr.pub );
+		jerr.pub.error_exit = _JPEGErrorManager::onError;
+
+		if( setjmp( jerr.jump ) )
+		{
+			free( bufptr );
+			bufptr = nullptr;
+		}
+		else
+		{
+			jpeg_create_decompress( &dinfo );
+			jpeg_mem_src( &dinfo, (unsigned char*)buf, fileSize );
+			jpeg_read_header( &dinfo, TRUE );
+
+			dinfo.out_color_space = JCS_RGB;
+
+			jpeg_start_decompress( &dinfo );
+
+			width = dinfo.output_width;
+			height = dinfo.output_height;
+			pixelSize = dinfo.output_components;
+
+			int rowStride = width * pixelSize;
+			bufptr = malloc( rowStride * height );
+
+			while( dinfo.output_scanline < dinfo.output_height )
+			{
+				JSAMPROW row = (JSAMPROW)bufptr + dinfo.output_scanline * rowStride;
+				jpeg_read_scanlines( &dinfo, &row, 1 );
+			}
+
+			jpeg_finish_decompress( &dinfo );
+		}
+
+		jpeg_destroy_decompress( &dinfo );
+	}
+
+	free( buf );
+
+	if( !bufptr )
+		return 0;
+
+	DEBUG_ASSERT( pixelSize == 3 || pixelSize == 4, "Error: Only RGB and RGBA images are supported!" );
+
+	static const GLenum formatsForSize[] = { GL_NONE, GL_UNSIGNED_BYTE, GL_RG, GL_RGB, GL_RGBA };
+	return formatsForSize[ pixelSize ];
+}
+
+const String& LinuxPlatform::getAppDataPath()
+{
+	return mAppDataPath;
+}
+
+const String& LinuxPlatform::getRootPath()
+{
+	return mRootPath;
+}
+
+const String& LinuxPlatform::getResourcesPath()
+{
+	return getRootPath(); //same as on windows
+}
+
+void LinuxPlatform::openWebPage( const String& site )
+{
+	//run xdg-open directly rather than through the shell, so that the url can't inject commands
+	std::string url = site.UTF8();
+
+	pid_t child = fork();
+
+	if( child == 0 )
+	{
+		//fork again so that xdg-open is adopted by init and nobody has to reap it
+		if( fork() == 0 )
+		{
+			execlp( "xdg-open", "xdg-open", url.c_str(), (char*)nullptr );
+			_exit( 127 );
+		}
+
+		_exit( 0 );
+	}
+
+	if( child < 0 )
+		DEBUG_MESSAGE( "Cannot open " + site );
+	else
+		waitpid( child, nullptr, 0 );
+}
+
+#endif
@@ -13,6 +13,7 @@
 #include "SoundManager.h"
 #include "InputSystem.h"
 #include "BackgroundQueue.h"
+#include "Profiler.h"
 
 #include "Keyboard.h"
 
@@ -377,7 +378,7 @@ bool Win32Platform::_initializeWindow(const String& windowCaption, int w, int h)
 	// specify the width and height of the window.
 
 	hwnd = CreateWindowW(L"DojoOpenGLWindow",
-		windowCaption.c_str(),
+		windowCaption.toWString().c_str(),
 		dwstyle,  //non-resizabile
 		rect.left, rect.top,
 		rect.right - rect.left, rect.bottom - rect.top,
@@ -509,7 +510,7 @@ void Win32Platform::initialize( Game* g )
 	DEBUG_ASSERT( game, "The Game implementation passed to initialize() can't be null" );
 
 	//init appdata folder
-	TCHAR szPath[MAX_PATH];
+	WCHAR szPath[MAX_PATH];
 
 	SHGetFolderPathW(
 		hwnd, 
@@ -522,16 +523,18 @@ void Win32Platform::initialize( Game* g )
 	Utils::makeCanonicalPath( mAppDataPath );
 
 	//get root path
-	mRootPath.resize(MAX_PATH);
-	mRootPath.resize(GetModuleFileName(NULL, (TCHAR*) mRootPath.data(), MAX_PATH));
-	mRootPath.resize(mRootPath.find_last_of(L"\\/"));
+	WCHAR modulePath[MAX_PATH];
+	modulePath[GetModuleFileNameW(NULL, modulePath, MAX_PATH - 1)] = 0;
+
+	mRootPath = String(modulePath);
+	mRootPath.resize(mRootPath.find_last_of("\\/"));
 
 	Utils::makeCanonicalPath( mRootPath );
 
 	DEBUG_MESSAGE( "Initializing Dojo Win32" );
 
 	//create the appdata user folder
-	CreateDirectoryW( getAppDataPath().c_str(), NULL );
+	CreateDirectoryW( getAppDataPath().toWString().c_str(), NULL );
 
 	//load settings
 	auto userConfig = Table::loadFromFile(mRootPath + "/config.ds");
@@ -580,7 +583,7 @@ void Win32Platform::initialize( Game* g )
 
 	fonts = new FontSystem();
 
-	//mBackgroundQueue = new BackgroundQueue( config.getInt( "threads", -1) );
+	mBackgroundQueue = new BackgroundQueue( config.getInt( "threads", -1) );
 
 	DEBUG_MESSAGE( "---- Game Launched!");
 
@@ -593,7 +596,10 @@ void Win32Platform::prepareThreadContext()
 
 	ContextShareRequest req;
 
-	mContextRequestsQueue->queue( &req );
+	{
+		std::lock_guard< std::mutex > lock( mContextRequestsMutex );
+		mContextRequestsQueue->queue( &req );
+	}
 			
 	//wait for the request
 	while (!req.done)
@@ -662,6 +668,11 @@ void Win32Platform::_pollDevices( float dt )
 
 void Win32Platform::step( float dt )
 {
+	//close the profiler stats of the previous frame
+	mProfiler->_endFrame();
+
+	DOJO_PROFILE_ZONE( "Platform::step" );
+
 	mStepTimer.reset();
 
 	//check if some other thread requested a new context
@@ -678,13 +689,19 @@ void Win32Platform::step( float dt )
 		req->done = true;
 	}
 
+	//send the messages logged since the last frame to the listeners
+	mLog->flush();
+
 	//update input
 	_pollDevices( dt );
 
 	//update completed tasks
-	//mBackgroundQueue->fireCompletedCallbacks();
+	mBackgroundQueue->fireCompletedCallbacks();
 
-	game->loop( dt);
+	{
+		DOJO_PROFILE_ZONE( "Game::loop" );
+		game->loop( dt );
+	}
 
 	sound->update( dt );
 
@@ -976,7 +993,7 @@ const String& Win32Platform::getResourcesPath()
 
 void Win32Platform::openWebPage( const String& site )
 {
-	ShellExecuteW(hwnd, L"open", site.c_str(), NULL, NULL, SW_SHOWNORMAL);
+	ShellExecuteW(hwnd, L"open", site.toWString().c_str(), NULL, NULL, SW_SHOWNORMAL);
 }
 
 //init key map